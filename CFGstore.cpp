@@ -0,0 +1,339 @@
+#include "mbed.h"
+#include "string.h"
+#include "CFGstore.h"
+#include "CMDshell.h"
+#include "L2_FSMmain.h"
+#include "L2_LLinterface.h"
+#include "L2_rate.h"
+#include "L3_FSMmain.h"
+#include "L3_strategy.h"
+#include "L3_payoff.h"
+#include "EVstream.h"
+#include "protocol_parameters.h"
+
+//Persistent node configuration (FlashIAP)
+//Records are appended slot after slot in the last flash sector and the newest one of each type whose
+//CRC matches wins, so the sector is erased once every (sector size / CFGSTORE_SLOTSIZE) saves, 4096
+//with the 128 KB sector of the F446RE, instead of at each save. A record cut by a reset while being
+//programmed fails its CRC and the one before it is used. The written slots are a prefix of the sector,
+//so the boot finds its end with a binary search instead of reading the whole sector.
+//The configuration shares the sector with the game snapshots (L3_snapshot.h), written at each round :
+//when the sector is full, the newest record of each type is written back right after the erase (a
+//reset in between loses them, the IDs are then asked again at the next boot). Snapshots never erase
+//(CFGstore_appendRecord) : the game compacts ahead of time between games (CFGstore_makeRoom), and the
+//boot skips them by their header without checking their CRC.
+//Programming and erasing stall the CPU, interrupts included : well below 1 ms per record, 1..2 s
+//for the sector erase.
+
+#define CFGSTORE_OFFSET_MAGIC   0
+#define CFGSTORE_OFFSET_SEQ     2
+#define CFGSTORE_OFFSET_TYPE    4
+#define CFGSTORE_OFFSET_LEN     5               //size of the record when it was written (layout check)
+#define CFGSTORE_OFFSET_DATA    6
+#define CFGSTORE_OFFSET_CRC     (CFGSTORE_SLOTSIZE - 2)
+
+//the configuration has to fit between the header and the CRC of a slot
+typedef char CFGstore_sizeCheck[(CFGSTORE_OFFSET_DATA + CFGSTORE_DATASIZE == CFGSTORE_OFFSET_CRC &&
+                                 sizeof(CFGstore_t) <= CFGSTORE_DATASIZE) ? 1 : -1];
+
+//linker script symbols : end of the firmware image in flash
+extern "C" uint32_t __etext[];
+extern "C" uint32_t __data_start__[];
+extern "C" uint32_t __data_end__[];
+
+static FlashIAP flash;
+static MbedCRC<POLY_16BIT_CCITT, 16> crc16;
+static uint32_t sectorAddr;
+static uint32_t slotNum = 0;                    //0 : no usable flash sector
+static uint32_t nextSlot = 0;                   //first erased slot
+static uint16_t saveCnt = 0;                    //sequence number of the newest record
+
+
+static uint16_t CFGstore_getU16(const uint8_t* p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static void CFGstore_putU16(uint8_t* p, uint16_t val)
+{
+    p[0] = (uint8_t)(val >> 8);
+    p[1] = (uint8_t)val;
+}
+
+static uint16_t CFGstore_crc(const uint8_t* slot)
+{
+    uint32_t crc;
+
+    crc16.compute((void*)slot, CFGSTORE_OFFSET_CRC, &crc);
+    return (uint16_t)crc;
+}
+
+static uint8_t CFGstore_isErased(uint32_t slot)
+{
+    uint8_t magic[2];
+
+    flash.read(magic, sectorAddr + slot * CFGSTORE_SLOTSIZE + CFGSTORE_OFFSET_MAGIC, sizeof(magic));
+    return CFGstore_getU16(magic) == 0xFFFF;
+}
+
+//1 if the slot read into buf holds a whole record (magic, length and CRC)
+static uint8_t CFGstore_isValid(const uint8_t* buf)
+{
+    return (CFGstore_getU16(buf + CFGSTORE_OFFSET_MAGIC) == CFGSTORE_MAGIC && buf[CFGSTORE_OFFSET_LEN] <= CFGSTORE_DATASIZE &&
+            CFGstore_getU16(buf + CFGSTORE_OFFSET_CRC) == CFGstore_crc(buf));
+}
+
+//slot into buf : 1 if it holds a whole record
+static uint8_t CFGstore_readSlot(uint32_t slot, uint8_t* buf)
+{
+    flash.read(buf, sectorAddr + slot * CFGSTORE_SLOTSIZE, CFGSTORE_SLOTSIZE);
+    return CFGstore_isValid(buf);
+}
+
+//newest record of the type and length below the slot : slot + 1 where it is, 0 if there is none
+//(the header is compared first : the CRC is only computed for the records of that type)
+static uint32_t CFGstore_findRecord(uint32_t below, uint8_t type, uint8_t len, uint8_t* buf)
+{
+    while (below > 0)
+    {
+        below--;
+        flash.read(buf, sectorAddr + below * CFGSTORE_SLOTSIZE, CFGSTORE_SLOTSIZE);
+        if (buf[CFGSTORE_OFFSET_TYPE] == type && buf[CFGSTORE_OFFSET_LEN] == len && CFGstore_isValid(buf))
+            return below + 1;
+    }
+    return 0;
+}
+
+//buf into the next slot : 1 if it reads back right
+static uint8_t CFGstore_program(const uint8_t* buf)
+{
+    uint8_t check[CFGSTORE_SLOTSIZE];
+    uint32_t addr = sectorAddr + nextSlot * CFGSTORE_SLOTSIZE;
+
+    nextSlot++;
+    return (flash.program(buf, addr, CFGSTORE_SLOTSIZE) == 0 && flash.read(check, addr, CFGSTORE_SLOTSIZE) == 0 &&
+            memcmp(buf, check, CFGSTORE_SLOTSIZE) == 0);
+}
+
+//full sector : erased, then the newest record of each type is written back as it was
+static uint8_t CFGstore_compact(void)
+{
+    uint8_t keep[CFGSTORE_TYPE_NUM][CFGSTORE_SLOTSIZE];
+    uint8_t kept[CFGSTORE_TYPE_NUM];
+    uint8_t buf[CFGSTORE_SLOTSIZE];
+    uint32_t slot = nextSlot;
+    uint8_t type, left = CFGSTORE_TYPE_NUM;
+
+    memset(kept, 0, sizeof(kept));
+    while (slot > 0 && left > 0)
+    {
+        slot--;
+        if (CFGstore_readSlot(slot, buf) && (type = buf[CFGSTORE_OFFSET_TYPE]) < CFGSTORE_TYPE_NUM && kept[type] == 0)
+        {
+            memcpy(keep[type], buf, CFGSTORE_SLOTSIZE);
+            kept[type] = 1;
+            left--;
+        }
+    }
+
+    if (CFGstore_erase() == 0)
+        return 0;
+    for (type = 0; type < CFGSTORE_TYPE_NUM; type++)
+    {
+        if (kept[type] && CFGstore_program(keep[type]) == 0)
+            return 0;
+    }
+    return 1;
+}
+
+//values a record may hold (the same limits as the shell)
+static uint8_t CFGstore_isSane(const CFGstore_t* cfg)
+{
+    int i;
+
+    for (i = 0; i < L3_STRATEGY_TABLESIZE; i++)
+    {
+        if (cfg->strategyTable[i] != L3_CHOICE_COOPERATE && cfg->strategyTable[i] != L3_CHOICE_BETRAY)
+            return 0;
+    }
+    return (cfg->arqMinWait < cfg->arqMaxWait && cfg->maxDataSize >= CMDSHELL_MINDATASIZE &&
+            cfg->maxDataSize <= L3_MAXDATASIZE && cfg->pktLoss <= 100 && cfg->strategy < L3_STRATEGY_NUM &&
+            cfg->phyRate < L2_rate_getNumRates() && cfg->evStream <= 1);
+}
+
+
+//locates the record area : 1 if the last sector is free for it
+uint8_t CFGstore_init(void)
+{
+    uint32_t flashEnd, imageEnd;
+    uint32_t lo, hi, mid;
+
+    if (flash.init() != 0)
+        return 0;
+    flashEnd = flash.get_flash_start() + flash.get_flash_size();
+    sectorAddr = flashEnd - flash.get_sector_size(flashEnd - 1);
+    imageEnd = (uint32_t)(uintptr_t)__etext + (uint32_t)((uint8_t*)__data_end__ - (uint8_t*)__data_start__);
+    if (imageEnd > sectorAddr || CFGSTORE_SLOTSIZE % flash.get_page_size() != 0)
+    {
+        printf("[CFG] the firmware reaches into the last flash sector (MBED_APP_SIZE in the Makefile) : configuration not stored\n");
+        return 0;
+    }
+    slotNum = (flashEnd - sectorAddr) / CFGSTORE_SLOTSIZE;
+
+    lo = 0;
+    hi = slotNum;
+    while (lo < hi)
+    {
+        mid = (lo + hi) / 2;
+        if (CFGstore_isErased(mid))
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    nextSlot = lo;
+
+    //sequence number of the newest record, whatever its type
+    while (lo > 0)
+    {
+        uint8_t buf[CFGSTORE_SLOTSIZE];
+
+        if (CFGstore_readSlot(--lo, buf))
+        {
+            saveCnt = CFGstore_getU16(buf + CFGSTORE_OFFSET_SEQ);
+            break;
+        }
+    }
+
+    return 1;
+}
+
+//newest record of the type : 0 if there is none of that length
+uint8_t CFGstore_loadRecord(uint8_t type, uint8_t* data, uint8_t len)
+{
+    uint8_t buf[CFGSTORE_SLOTSIZE];
+
+    if (slotNum == 0 || CFGstore_findRecord(nextSlot, type, len, buf) == 0)
+        return 0;
+    memcpy(data, buf + CFGSTORE_OFFSET_DATA, len);
+    return 1;
+}
+
+//record into the next slot, compacting a full sector first if allowed : 1 if it reads back right
+static uint8_t CFGstore_write(uint8_t type, const uint8_t* data, uint8_t len, uint8_t compact)
+{
+    uint8_t buf[CFGSTORE_SLOTSIZE];
+    uint8_t i;
+
+    if (slotNum == 0 || len > CFGSTORE_DATASIZE)
+        return 0;
+
+    memset(buf, 0xFF, sizeof(buf));
+    CFGstore_putU16(buf + CFGSTORE_OFFSET_MAGIC, CFGSTORE_MAGIC);
+    CFGstore_putU16(buf + CFGSTORE_OFFSET_SEQ, (uint16_t)(saveCnt + 1));
+    buf[CFGSTORE_OFFSET_TYPE] = type;
+    buf[CFGSTORE_OFFSET_LEN] = len;
+    memcpy(buf + CFGSTORE_OFFSET_DATA, data, len);
+    CFGstore_putU16(buf + CFGSTORE_OFFSET_CRC, CFGstore_crc(buf));
+
+    //second try on a freshly erased sector : the slot was not blank (sector erase cut by a reset)
+    for (i = 0; i < 2; i++)
+    {
+        if (nextSlot >= slotNum && (compact == 0 || CFGstore_compact() == 0))
+            return 0;
+        if (CFGstore_program(buf))
+        {
+            saveCnt++;
+            return 1;
+        }
+        nextSlot = slotNum;
+    }
+
+    return 0;
+}
+
+//appends the record in the next slot (the sector is compacted when it is full) : 1 if it reads back right
+uint8_t CFGstore_saveRecord(uint8_t type, const uint8_t* data, uint8_t len)
+{
+    return CFGstore_write(type, data, len, 1);
+}
+
+//same without ever erasing (for records written while the game runs) : 0 when the sector is full
+uint8_t CFGstore_appendRecord(uint8_t type, const uint8_t* data, uint8_t len)
+{
+    return CFGstore_write(type, data, len, 0);
+}
+
+//compacts the sector ahead of time when fewer than the given number of slots are left : 1 if it did
+//(1..2 s stall, to be called where the caller can afford it)
+uint8_t CFGstore_makeRoom(uint32_t slots)
+{
+    if (slotNum == 0 || nextSlot + slots < slotNum)
+        return 0;
+    return CFGstore_compact();
+}
+
+//newest valid configuration : 0 if there is none
+uint8_t CFGstore_load(CFGstore_t* cfg)
+{
+    uint8_t buf[CFGSTORE_SLOTSIZE];
+    uint32_t slot = nextSlot;
+
+    while (slotNum > 0 && (slot = CFGstore_findRecord(slot, CFGSTORE_TYPE_CONFIG, sizeof(CFGstore_t), buf)) > 0)
+    {
+        memcpy(cfg, buf + CFGSTORE_OFFSET_DATA, sizeof(CFGstore_t));
+        if (CFGstore_isSane(cfg))
+            return 1;
+        slot--;
+    }
+
+    return 0;
+}
+
+uint8_t CFGstore_save(const CFGstore_t* cfg)
+{
+    return CFGstore_saveRecord(CFGSTORE_TYPE_CONFIG, (const uint8_t*)cfg, sizeof(CFGstore_t));
+}
+
+//erases the whole record area (the next boot asks for the IDs again)
+uint8_t CFGstore_erase(void)
+{
+    if (slotNum == 0 || flash.erase(sectorAddr, slotNum * CFGSTORE_SLOTSIZE) != 0)
+        return 0;
+    nextSlot = 0;
+
+    return 1;
+}
+
+//runtime parameters in use into the record (the IDs are left as they are)
+void CFGstore_capture(CFGstore_t* cfg)
+{
+    L2_getArqParams(&cfg->arqMaxRetx, &cfg->arqMinWait, &cfg->arqMaxWait);
+    cfg->pktLoss = L2_LLI_getPktLoss();
+    cfg->maxDataSize = L3_getMaxDataSize();
+    cfg->dbgL2 = (uint8_t)dbgmsgL2;
+    cfg->dbgL3 = (uint8_t)dbgmsgL3;
+    cfg->phyRate = L2_rate_getFixedRate();
+    cfg->evStream = EVstream_isEnabled();
+    cfg->strategy = L3_strategy_getSelected();
+    L3_strategy_getTable(cfg->strategyTable);
+}
+
+//runtime parameters of the record (after L2_initFSM and L3_initFSM, which set the compiled ones)
+void CFGstore_apply(const CFGstore_t* cfg)
+{
+    L2_setArqParams(cfg->arqMaxRetx, cfg->arqMinWait, cfg->arqMaxWait);
+    L2_LLI_setPktLoss(cfg->pktLoss);
+    L3_setMaxDataSize(cfg->maxDataSize);
+    dbgmsgL2 = cfg->dbgL2;
+    dbgmsgL3 = cfg->dbgL3;
+    L2_rate_setFixedRate(cfg->phyRate);
+    EVstream_setEnabled(cfg->evStream);
+    L3_strategy_setTable(cfg->strategyTable);
+    L3_strategy_select(cfg->strategy);
+}
+
+//records written so far (the sequence number of the newest one)
+uint16_t CFGstore_getSaveCount(void)
+{
+    return saveCnt;
+}
@@ -0,0 +1,42 @@
+#include <stdint.h>
+#include "L3_strategy.h"
+
+#define CFGSTORE_MAGIC          0xC0F2              //start of a written record (0xFFFF : erased slot)
+#define CFGSTORE_SLOTSIZE       32                  //bytes of flash per record
+#define CFGSTORE_DATASIZE       (CFGSTORE_SLOTSIZE - 8) //largest record (slot header and CRC taken out)
+
+//record types sharing the sector : the newest record of each type is the valid one
+#define CFGSTORE_TYPE_CONFIG    0                   //node configuration (CFGstore_t)
+#define CFGSTORE_TYPE_SNAPSHOT  1                   //game snapshots (L3_snapshot.h)
+#define CFGSTORE_TYPE_NUM       2
+#define CFGSTORE_OVERRIDE_MS    500                 //ms a stored configuration waits at boot for a key to change it, 0 : no wait
+
+//node configuration kept in the last flash sector (the Makefile keeps the firmware out of it)
+typedef struct
+{
+    uint8_t thisId;
+    uint8_t destId;
+    uint8_t strategy;           //input mode of the game (L3_strategy.h)
+    uint8_t arqMaxRetx;
+    uint8_t arqMinWait;
+    uint8_t arqMaxWait;
+    uint8_t pktLoss;
+    uint8_t maxDataSize;
+    uint8_t dbgL2;
+    uint8_t dbgL3;
+    uint8_t phyRate;            //fixed PHY rate without link adaptation (L2_rate.h)
+    uint8_t evStream;           //binary event frames on the console (EVstream.h)
+    uint8_t strategyTable[L3_STRATEGY_TABLESIZE]; //moves of the table strategy (L3_strategy.h)
+} CFGstore_t;
+
+uint8_t CFGstore_init(void);
+uint8_t CFGstore_load(CFGstore_t* cfg);
+uint8_t CFGstore_save(const CFGstore_t* cfg);
+uint8_t CFGstore_erase(void);
+uint8_t CFGstore_loadRecord(uint8_t type, uint8_t* data, uint8_t len);
+uint8_t CFGstore_saveRecord(uint8_t type, const uint8_t* data, uint8_t len);
+uint8_t CFGstore_appendRecord(uint8_t type, const uint8_t* data, uint8_t len);
+uint8_t CFGstore_makeRoom(uint32_t slots);
+void CFGstore_capture(CFGstore_t* cfg);
+void CFGstore_apply(const CFGstore_t* cfg);
+uint16_t CFGstore_getSaveCount(void);
@@ -0,0 +1,355 @@
+#include "mbed.h"
+#include "string.h"
+#include "CMDshell.h"
+#include "L2_FSMmain.h"
+#include "L2_LLinterface.h"
+#include "L2_rate.h"
+#include "L3_FSMmain.h"
+#include "L3_strategy.h"
+#include "L3_payoff.h"
+#include "L3_history.h"
+#include "MEMstat.h"
+#include "CFGstore.h"
+#include "EVstream.h"
+#include "protocol_parameters.h"
+
+//Serial control shell
+//Lines starting with CMDSHELL_PREFIX on the game console are taken by the shell instead of the game :
+//the RX interrupt only collects the line, CMDshell_run executes it from the main loop, between two
+//FSM passes, so a change never lands in the middle of an FSM step.
+//  :help                       commands and parameters
+//  :get [name]                 current value of the parameters
+//  :set name value [name value]...
+//                              all values are checked first (range, minwait < maxwait), then
+//                              applied together, or none of them if one is wrong
+//  :stats                      L2 and L3 counters
+//  :mem                        memory report (same as the MEMSTAT_REPORT_KEY key)
+//  :mode name|number [moves]   input mode of the game (manual or an automated strategy), moves : the
+//                              5 moves of the table strategy (first, after CC, CD, DC, DD), 1 or 2 each
+//  :save                       parameters, mode and table in use into the stored configuration (CFGstore.h)
+//  :forget                     erases the stored configuration : the IDs are asked at the next boot
+//  :history [n]                round history totals (cooperation, sentence, rounds per game), or its
+//                              last n rounds (L3_history.h)
+
+#define CMDSHELL_PARAM_RETX         0
+#define CMDSHELL_PARAM_MINWAIT      1
+#define CMDSHELL_PARAM_MAXWAIT      2
+#define CMDSHELL_PARAM_LOSS         3
+#define CMDSHELL_PARAM_MAXDATA      4
+#define CMDSHELL_PARAM_DBGL2        5
+#define CMDSHELL_PARAM_DBGL3        6
+#define CMDSHELL_PARAM_RATE         7
+#define CMDSHELL_PARAM_EVSTREAM     8
+#define CMDSHELL_PARAM_NUM          9
+
+typedef struct
+{
+    const char* name;
+    int32_t min;
+    int32_t max;
+    const char* help;
+} CMDshell_param_t;
+
+static const CMDshell_param_t params[CMDSHELL_PARAM_NUM] =
+{
+    {"retx",    0,                      30,             "ARQ retransmissions before a PDU is given up"},
+    {"minwait", 1,                      59,             "ARQ timer, shortest (s)"},
+    {"maxwait", 2,                      60,             "ARQ timer, longest (s)"},
+    {"loss",    0,                      100,            "% of the received frames dropped (loss emulation)"},
+    {"maxdata", CMDSHELL_MINDATASIZE,   L3_MAXDATASIZE, "L3 message buffer (bytes, message length + 1)"},
+    {"dbgl2",   0,                      1,              "L2 debug messages"},
+    {"dbgl3",   0,                      1,              "L3 debug messages"},
+    {"rate",    0,                      L2_RATE_NUMRATES - 1, "PHY rate without link adaptation (0 : SF7 CR 4/5, L2_rate.cpp)"},
+    {"evstream", 0,                     1,              "binary event frames next to the text (EVstream.h)"}
+};
+
+static char line[CMDSHELL_LINESIZE];        //command line being typed (RX interrupt)
+static uint8_t lineLen = 0;
+static uint8_t collecting = 0;              //the prefix was received, the line is not finished yet
+static volatile uint8_t lineReady = 0;
+
+
+//from the serial RX interrupt : 1 if the character belongs to a shell command line
+uint8_t CMDshell_inputChar(char c)
+{
+    if (collecting == 0)
+    {
+        if (c != CMDSHELL_PREFIX)
+            return 0;
+        collecting = 1;
+        lineLen = 0;
+        return 1;
+    }
+
+    if (c == '\r' || c == '\n')
+    {
+        line[lineLen] = '\0';
+        collecting = 0;
+        lineReady = 1;
+    }
+    else if (c == '\b' || c == 0x7F)
+    {
+        if (lineLen > 0)
+            lineLen--;
+    }
+    else if (lineLen < CMDSHELL_LINESIZE - 1)
+        line[lineLen++] = c;
+
+    return 1;
+}
+
+
+static void CMDshell_readParams(int32_t* val)
+{
+    uint8_t maxRetx, minWait, maxWait;
+
+    L2_getArqParams(&maxRetx, &minWait, &maxWait);
+    val[CMDSHELL_PARAM_RETX] = maxRetx;
+    val[CMDSHELL_PARAM_MINWAIT] = minWait;
+    val[CMDSHELL_PARAM_MAXWAIT] = maxWait;
+    val[CMDSHELL_PARAM_LOSS] = L2_LLI_getPktLoss();
+    val[CMDSHELL_PARAM_MAXDATA] = L3_getMaxDataSize();
+    val[CMDSHELL_PARAM_DBGL2] = dbgmsgL2;
+    val[CMDSHELL_PARAM_DBGL3] = dbgmsgL3;
+    val[CMDSHELL_PARAM_RATE] = L2_rate_getFixedRate();
+    val[CMDSHELL_PARAM_EVSTREAM] = EVstream_isEnabled();
+}
+
+static void CMDshell_applyParams(const int32_t* val)
+{
+    L2_setArqParams((uint8_t)val[CMDSHELL_PARAM_RETX], (uint8_t)val[CMDSHELL_PARAM_MINWAIT], (uint8_t)val[CMDSHELL_PARAM_MAXWAIT]);
+    L2_LLI_setPktLoss((uint8_t)val[CMDSHELL_PARAM_LOSS]);
+    L3_setMaxDataSize((uint8_t)val[CMDSHELL_PARAM_MAXDATA]);
+    dbgmsgL2 = val[CMDSHELL_PARAM_DBGL2];
+    dbgmsgL3 = val[CMDSHELL_PARAM_DBGL3];
+    L2_rate_setFixedRate((uint8_t)val[CMDSHELL_PARAM_RATE]);
+    EVstream_setEnabled((uint8_t)val[CMDSHELL_PARAM_EVSTREAM]);
+}
+
+static int CMDshell_findParam(const char* name)
+{
+    int i;
+
+    for (i = 0; i < CMDSHELL_PARAM_NUM; i++)
+    {
+        if (strcmp(name, params[i].name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+//decimal number, 0 if it is not one
+static uint8_t CMDshell_parseNum(const char* str, int32_t* val)
+{
+    char* end;
+    long v = strtol(str, &end, 10);
+
+    if (end == str || *end != '\0')
+        return 0;
+    *val = (int32_t)v;
+    return 1;
+}
+
+static void CMDshell_printHelp(void)
+{
+    int i;
+
+    printf("[SHELL] help | get [name] | set name value [name value]... | stats | mem | mode name|number [moves] | save | forget | history [n]\n");
+    for (i = 0; i < CMDSHELL_PARAM_NUM; i++)
+        printf("[SHELL]   %-8s %3li..%-3li %s\n", params[i].name, (long)params[i].min, (long)params[i].max, params[i].help);
+    printf("[SHELL] modes :");
+    for (i = 0; i < L3_STRATEGY_NUM; i++)
+        printf(" %i=%s", i, L3_strategy_getName(i));
+    printf("\n");
+}
+
+static void CMDshell_get(int argc, char** argv)
+{
+    int32_t val[CMDSHELL_PARAM_NUM];
+    int i;
+
+    CMDshell_readParams(val);
+    if (argc > 1)
+    {
+        if ((i = CMDshell_findParam(argv[1])) < 0)
+            printf("[SHELL] unknown parameter %s\n", argv[1]);
+        else
+            printf("[SHELL] %s = %li\n", params[i].name, (long)val[i]);
+        return;
+    }
+    for (i = 0; i < CMDSHELL_PARAM_NUM; i++)
+        printf("[SHELL] %-8s = %li\n", params[i].name, (long)val[i]);
+}
+
+//all or nothing : the values are staged on a copy of the current ones, checked, then applied together
+static void CMDshell_set(int argc, char** argv)
+{
+    int32_t val[CMDSHELL_PARAM_NUM];
+    int32_t v;
+    int i, p;
+
+    if (argc < 3 || (argc - 1) % 2 != 0)
+    {
+        printf("[SHELL] usage : set name value [name value]...\n");
+        return;
+    }
+
+    CMDshell_readParams(val);
+    for (i = 1; i < argc; i += 2)
+    {
+        if ((p = CMDshell_findParam(argv[i])) < 0)
+        {
+            printf("[SHELL] unknown parameter %s, nothing changed\n", argv[i]);
+            return;
+        }
+        if (CMDshell_parseNum(argv[i + 1], &v) == 0 || v < params[p].min || v > params[p].max)
+        {
+            printf("[SHELL] %s must be %li..%li, nothing changed\n", params[p].name, (long)params[p].min, (long)params[p].max);
+            return;
+        }
+        val[p] = v;
+    }
+    if (val[CMDSHELL_PARAM_MINWAIT] >= val[CMDSHELL_PARAM_MAXWAIT])
+    {
+        printf("[SHELL] minwait must be below maxwait, nothing changed\n");
+        return;
+    }
+
+    CMDshell_applyParams(val);
+    printf("[SHELL] applied\n");
+}
+
+//moves of the table strategy : L3_STRATEGY_TABLESIZE digits, 1 (cooperate) or 2 (defect) each
+static uint8_t CMDshell_parseTable(const char* str, uint8_t* table)
+{
+    int i;
+
+    if (strlen(str) != L3_STRATEGY_TABLESIZE)
+        return 0;
+    for (i = 0; i < L3_STRATEGY_TABLESIZE; i++)
+    {
+        if (str[i] != '0' + L3_CHOICE_COOPERATE && str[i] != '0' + L3_CHOICE_BETRAY)
+            return 0;
+        table[i] = (uint8_t)(str[i] - '0');
+    }
+    return 1;
+}
+
+static void CMDshell_mode(int argc, char** argv)
+{
+    uint8_t table[L3_STRATEGY_TABLESIZE];
+    int32_t id;
+    int i;
+
+    if (argc != 2 && argc != 3)
+    {
+        printf("[SHELL] usage : mode name|number [moves]\n");
+        return;
+    }
+    if (CMDshell_parseNum(argv[1], &id) == 0)
+    {
+        id = -1;
+        for (i = 0; i < L3_STRATEGY_NUM; i++)
+        {
+            if (strcmp(argv[1], L3_strategy_getName(i)) == 0)
+                id = i;
+        }
+    }
+    if (id < 0 || id >= L3_STRATEGY_NUM)
+    {
+        printf("[SHELL] unknown mode %s\n", argv[1]);
+        return;
+    }
+    if (argc == 3 && (id != L3_STRATEGY_TABLE || CMDshell_parseTable(argv[2], table) == 0))
+    {
+        printf("[SHELL] moves are %i digits (first, after CC, CD, DC, DD), 1 or 2, for mode %s only\n",
+               L3_STRATEGY_TABLESIZE, L3_strategy_getName(L3_STRATEGY_TABLE));
+        return;
+    }
+
+    if (argc == 3)
+        L3_strategy_setTable(table);
+    L3_strategy_select((uint8_t)id);
+    if (id == L3_STRATEGY_TABLE)
+    {
+        L3_strategy_getTable(table);
+        printf("[SHELL] mode %s, moves %i%i%i%i%i\n", L3_strategy_getName((uint8_t)id),
+               table[0], table[1], table[2], table[3], table[4]);
+    }
+    else
+        printf("[SHELL] mode %s\n", L3_strategy_getName((uint8_t)id));
+}
+
+//the IDs come from the stored record : it exists from the first boot on, unless it was erased
+static void CMDshell_save(void)
+{
+    CFGstore_t cfg;
+
+    if (CFGstore_load(&cfg) == 0)
+    {
+        printf("[SHELL] no stored configuration (IDs unknown until the next boot), nothing saved\n");
+        return;
+    }
+    CFGstore_capture(&cfg);
+    if (CFGstore_save(&cfg))
+        printf("[SHELL] saved (record %u)\n", CFGstore_getSaveCount());
+    else
+        printf("[SHELL] flash write failed, nothing saved\n");
+}
+
+static void CMDshell_history(int argc, char** argv)
+{
+    int32_t num;
+
+    if (argc == 1)
+        L3_history_printSummary();
+    else if (CMDshell_parseNum(argv[1], &num) && num > 0 && num <= L3_HISTORY_RAMRECS)
+        L3_history_printRecent((uint16_t)num);
+    else
+        printf("[SHELL] usage : history [1..%i]\n", L3_HISTORY_RAMRECS);
+}
+
+//executes a command line typed on the console (call from the main loop, between the FSM passes)
+void CMDshell_run(void)
+{
+    char cmd[CMDSHELL_LINESIZE];
+    char* argv[CMDSHELL_MAXARGS];
+    int argc = 0;
+    char* tok;
+
+    if (lineReady == 0)
+        return;
+    core_util_critical_section_enter();
+    strcpy(cmd, line);
+    lineReady = 0;
+    core_util_critical_section_exit();
+
+    for (tok = strtok(cmd, " \t"); tok != NULL && argc < CMDSHELL_MAXARGS; tok = strtok(NULL, " \t"))
+        argv[argc++] = tok;
+    if (argc == 0)
+        return;
+
+    if (strcmp(argv[0], "help") == 0)
+        CMDshell_printHelp();
+    else if (strcmp(argv[0], "get") == 0)
+        CMDshell_get(argc, argv);
+    else if (strcmp(argv[0], "set") == 0)
+        CMDshell_set(argc, argv);
+    else if (strcmp(argv[0], "stats") == 0)
+    {
+        L2_printStats();
+        L3_printStats();
+    }
+    else if (strcmp(argv[0], "mem") == 0)
+        MEMstat_requestReport();
+    else if (strcmp(argv[0], "mode") == 0)
+        CMDshell_mode(argc, argv);
+    else if (strcmp(argv[0], "save") == 0)
+        CMDshell_save();
+    else if (strcmp(argv[0], "forget") == 0)
+        printf(CFGstore_erase() ? "[SHELL] stored configuration erased, the IDs are asked at the next boot\n" : "[SHELL] flash erase failed\n");
+    else if (strcmp(argv[0], "history") == 0)
+        CMDshell_history(argc, argv);
+    else
+        printf("[SHELL] unknown command %s (help : commands)\n", argv[0]);
+}
@@ -0,0 +1,9 @@
+#include <stdint.h>
+
+#define CMDSHELL_PREFIX         ':'                 //serial key starting a shell command line
+#define CMDSHELL_LINESIZE       48                  //longest command line (longer lines are cut)
+#define CMDSHELL_MAXARGS        9                   //words of a command line
+#define CMDSHELL_MINDATASIZE    28                  //lowest maxdata : the longest game message fits (RESYNC_OK, L3_FSMmain.cpp)
+
+uint8_t CMDshell_inputChar(char c);
+void CMDshell_run(void);
@@ -0,0 +1,104 @@
+#include "mbed.h"
+#include "EVstream.h"
+#include "protocol_parameters.h"
+
+//Binary game/link event stream on the console
+//Each event is one fixed-size record with a CRC, COBS-encoded so that its body has no EVSTREAM_DELIM
+//byte, and sent between two delimiters on the same serial port as the game text. The text is UTF-8
+//without NUL bytes, so the host splits the capture at the delimiters : a chunk of EVSTREAM_FRAMESIZE - 2
+//bytes that decodes and whose CRC matches is an event, anything else is text. A frame is about 21 bytes
+//where the console line of the same event is 40..120, and the sequence number shows the events the
+//host lost (serial overrun, capture started late).
+//Frames go out byte by byte through the port of the caller, from where the game prints its text : the
+//main loop, and the serial RX interrupt for the manual input. A frame cut by the other context fails
+//its CRC on the host and shows up as a lost sequence number, like a frame lost by the capture.
+
+static MbedCRC<POLY_16BIT_CCITT, 16> crc16;
+static void (*putByte)(uint8_t) = NULL;
+static uint8_t enabled = EVSTREAM_INIT;
+static uint8_t node = 0;
+static uint16_t seq = 0;
+static uint32_t count = 0;
+static Timer evTimer;
+
+
+static void EVstream_putU16(uint8_t* p, uint16_t val)
+{
+    p[0] = (uint8_t)(val >> 8);
+    p[1] = (uint8_t)val;
+}
+
+static void EVstream_putU32(uint8_t* p, uint32_t val)
+{
+    EVstream_putU16(p, (uint16_t)(val >> 16));
+    EVstream_putU16(p + 2, (uint16_t)val);
+}
+
+//COBS : each run of non-zero bytes is sent after a code byte (run length + 1), the zero after it is implied
+//(a record is far below the 254 bytes that would need a code without a zero)
+static void EVstream_sendCobs(const uint8_t* data, uint8_t size)
+{
+    uint8_t start = 0;
+    uint8_t i, j;
+
+    putByte(EVSTREAM_DELIM);
+    for (i = 0; i <= size; i++)
+    {
+        if (i == size || data[i] == 0)
+        {
+            putByte((uint8_t)(i - start + 1));
+            for (j = start; j < i; j++)
+                putByte(data[j]);
+            start = i + 1;
+        }
+    }
+    putByte(EVSTREAM_DELIM);
+}
+
+
+//putFunc writes one byte to the console (blocking, as the text)
+void EVstream_init(uint8_t nodeId, void (*putFunc)(uint8_t))
+{
+    node = nodeId;
+    putByte = putFunc;
+    evTimer.start();
+}
+
+void EVstream_setEnabled(uint8_t on)
+{
+    enabled = on;
+}
+
+uint8_t EVstream_isEnabled(void)
+{
+    return enabled;
+}
+
+//one event (EVSTREAM_* type) : dropped while the stream is off, the sequence number counts the sent ones
+void EVstream_emit(uint8_t type, uint16_t round, uint8_t a, uint8_t b, uint32_t value)
+{
+    uint8_t rec[EVSTREAM_RECSIZE + 2];
+    uint32_t crc;
+
+    if (enabled == 0 || putByte == NULL)
+        return;
+
+    rec[0] = type;
+    rec[1] = node;
+    EVstream_putU16(rec + 2, seq++);
+    EVstream_putU32(rec + 4, (uint32_t)evTimer.read_ms());
+    EVstream_putU16(rec + 8, round);
+    rec[10] = a;
+    rec[11] = b;
+    EVstream_putU32(rec + 12, value);
+    crc16.compute((void*)rec, EVSTREAM_RECSIZE, &crc);
+    EVstream_putU16(rec + EVSTREAM_RECSIZE, (uint16_t)crc);
+
+    EVstream_sendCobs(rec, sizeof(rec));
+    count++;
+}
+
+uint32_t EVstream_getCount(void)
+{
+    return count;
+}
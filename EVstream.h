@@ -0,0 +1,30 @@
+#include <stdint.h>
+
+#define EVSTREAM_DELIM          0x00                //frame delimiter : never in the console text nor in a COBS body
+#define EVSTREAM_RECSIZE        16                  //event record (layout below)
+#define EVSTREAM_FRAMESIZE      (EVSTREAM_RECSIZE + 2 + 1 + 2) //record + CRC, COBS overhead, both delimiters
+
+//event record, big-endian (same for every type, so that the host reader stores it column by column)
+//  0 type  1 node  2..3 seq  4..7 time (ms since boot)  8..9 round  10 a  11 b  12..15 value
+//then CRC-16/CCITT-FALSE of the 16 bytes (big-endian), COBS-encoded between two EVSTREAM_DELIM bytes
+#define EVSTREAM_ROUNDSTART     1                   //a : players, b : 1 if resumed after a restart, value : sentence
+#define EVSTREAM_CHOICE         2                   //a : node that chose (this node or the peer), b : choice (1 : coop, 2 : betray)
+#define EVSTREAM_PREDICT        3                   //a : node that predicts, b : predicted choice, value : EVSTREAM_PRED_*
+#define EVSTREAM_SENTENCE       4                   //a : cause (EVSTREAM_CAUSE_*), b : peer or majority choice, value : new sentence
+#define EVSTREAM_GAMEOVER       5                   //a : 1 if released, b : 1 if the link was lost, value : sentence
+#define EVSTREAM_LINK           6                   //a : peer, b : 1 up / 0 down, value : ms since last heard / down time
+#define EVSTREAM_NUMTYPES       7
+
+#define EVSTREAM_PRED_MADE      0                   //prediction entered or received (checked at the next round)
+#define EVSTREAM_PRED_HIT       1
+#define EVSTREAM_PRED_MISS      2
+
+#define EVSTREAM_CAUSE_ROUND    1                   //dilemma payoff of the round (2 players)
+#define EVSTREAM_CAUSE_PREDICT  2                   //own prediction checked
+#define EVSTREAM_CAUSE_GROUP    3                   //dilemma payoff of an N player round (b : majority of the others)
+
+void EVstream_init(uint8_t nodeId, void (*putFunc)(uint8_t));
+void EVstream_setEnabled(uint8_t on);
+uint8_t EVstream_isEnabled(void);
+void EVstream_emit(uint8_t type, uint16_t round, uint8_t a, uint8_t b, uint32_t value);
+uint32_t EVstream_getCount(void);
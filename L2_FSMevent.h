@@ -5,9 +5,10 @@ typedef enum L2_event
     L2_event_ackRcvd = 2,
     L2_event_dataRcvd = 3,
     L2_event_dataToSend = 4,
-    L2_event_arqTimeout = 5,
     L2_event_reconfigSrcId = 6,
-    L2_event_dataToSendBuffer = 7
+    L2_event_backoffDone = 7,
+    L2_event_ctrlRcvd = 8,
+    L2_event_dataCorrupt = 9
 } L2_event_e;
 
 
@@ -1,52 +1,102 @@
 #include "L2_FSMevent.h"
 #include "L2_msg.h"
-#include "L2_timer.h"
 #include "L2_LLinterface.h"
 #include "L3_LLinterface.h"
+#include "L2_crc.h"
+#include "L2_fec.h"
+#include "L2_rate.h"
+#include "L2_airtime.h"
+#include "L2_rbc.h"
+#include "L2_link.h"
+#include "L2_peer.h"
+#include "L2_seq.h"
+#include "L2_agg.h"
+#include "PDUbuf.h"
+#include "MEMstat.h"
 #include "protocol_parameters.h"
 
 //FSM state -------------------------------------------------
 #define L2STATE_IDLE              0
 #define L2STATE_TX                1
-#ifndef DISABLE_ARQ
-#define L2STATE_ACK               2
-#endif
 
-#define SDUBUFFER_SIZE              1024
+#define L2_TXQUEUE_SIZE             4
+#define L2_BROADCAST_ID             L2_PEER_BROADCAST
+#define L2_FEC_FRAGSIZE             (L2_MSG_FEC_MAXDATASIZE - L2_CRC_LEN)
+#define L2_AGG_MAXLEN               (L2_MSG_MAXDATASIZE - L2_CRC_LEN)
+#define L2_FEC_ACKMARGINMS          20      //after the expected end of the sender's FEC block before ACKing it (TX to RX turnaround)
+
+#if L2_FEC_GROUPSIZE > 0 && (L3_MAXDATASIZE + L2_FEC_FRAGSIZE - 1) / L2_FEC_FRAGSIZE > L2_FEC_MAXDATAFRAG
+#error "L3_MAXDATASIZE needs more FEC fragments than L2_FEC_MAXDATAFRAG"
+#endif
+#if L2_CRC_MAXLEN > L2_PEER_FCSMAXLEN
+#error "L2_PEER_FCSMAXLEN is too small for the FCS"
+#endif
+#if L2_AGG_SUBHDR + L2_MSG_OFFSET_DATA > PDUBUF_HEADROOM
+#error "PDUBUF_HEADROOM is too small for the AGG header"
+#endif
 
 //state variables
+int dbgmsgL2 = DBGMSG_L2_INIT;
+
 static uint8_t main_state = L2STATE_IDLE; //protocol state
 static uint8_t prev_state = main_state;
 
-//source/destination ID
+//source ID
 static uint8_t myL2ID=1;
-static uint8_t destL2ID=0;
 
-//L2 PDU context/size
-static uint8_t sduBuffer[SDUBUFFER_SIZE];
-static uint8_t sduBufferSize;
+//L2 SDU/PDU context (buffers are PDUbuf handles shared with L3)
+static uint8_t txQueue[L2_TXQUEUE_SIZE];        //SDUs handed over by L3, not yet in the queue of their peer
+static uint8_t txQueueDest[L2_TXQUEUE_SIZE];
+static uint8_t txQueueHead = 0;
+static uint8_t txQueueLen = 0;
 
-static uint8_t arqPdu[200];
-static uint8_t sduIn[200];
-static uint8_t pduSize;
-static uint8_t sduLen;
+//neighbour table : SDU queue, PDU in flight and sequence numbers of each peer (see L2_peer.h)
+static L2_peerTable_t peerTbl;
+static L2_peer_t* txPeer = NULL;                //peer whose data frame is on air
+
+static uint8_t rxAggPdu = PDUBUF_INVALID;       //multi-fragment broadcast SDU under reassembly
+
+//AGG frame whose sub-frames are handed to L3 one at a time (see L2_agg.h)
+static uint8_t aggRxPdu = PDUBUF_INVALID;
+static uint8_t aggRxSrc;
+static uint8_t aggRxPos;                        //next sub-frame in its payload
+static int8_t aggRxSnr;
+static int16_t aggRxRssi;
+
+//FEC block context (SDUs longer than one fragment when L2_FEC_GROUPSIZE > 0)
+static uint8_t fecFrame[L2_MSG_OFFSET_FEC_DATA + L2_MSG_FEC_MAXDATASIZE + L2_CRC_MAXLEN];  //FEC frame in flight
+static uint8_t fecBrSeq = 0;                    //block number of broadcast FEC blocks
+static L2_fecRx_t fecRx;
+static uint8_t fecRxSdu = PDUBUF_INVALID;       //SDU being rebuilt
+static uint8_t fecRxParity = PDUBUF_INVALID;    //parity fragments received for it
+static uint8_t fecRxSrc;
+static uint8_t fecRxSeq;
+static uint8_t fecRxBrDone = 0;                 //last broadcast block already delivered (late frames are ignored)
+static uint8_t fecRxBrDoneSrc;
+static uint8_t fecRxBrDoneSeq;
+static uint8_t fecAckPending = 0;               //block rebuilt before its last frame : ACKed once the sender is done with it
+static uint8_t fecAckSrc;
+static uint8_t fecAckSeq;
+static uint32_t fecAckAtMs;
+
+//reliable broadcast (L2_RBC_ENABLE) and link liveness (L2_LINK_DETECTTIME) contexts
+static L2_rbcCtx_t rbcCtx;
+static L2_linkCtx_t linkCtx;
+static uint8_t ctrlFrame[L2_RBC_MAXFRAME + L2_CRC_MAXLEN];  //repair, NACK, SYNC or PROBE in flight
+static uint8_t ctrlTxBusy = 0;                  //that frame is on its way (not a frame of txSdu)
 
-static uint8_t pduBuffer[SDUBUFFER_SIZE];
-static uint8_t pduBufferSize;
 //ARQ parameters -------------------------------------------------------------
-static uint8_t seqNum = 0;     //ARQ sequence number
-#ifndef DISABLE_ARQ
-static uint8_t retxCnt = 0;    //ARQ retransmission counter
-static uint8_t arqAck[5];      //ARQ ACK PDU
-#define L2_BROADCAST_ID             255
-#endif
+static uint8_t arqAck[L2_MSG_ACKSIZE+L2_CRC_MAXLEN];      //ARQ ACK PDU
+static uint8_t arqMaxRetx = L2_ARQ_MAXRETRANSMISSION;   //ARQ parameters, changed at runtime by L2_setArqParams
+static uint8_t arqMinWait = L2_ARQ_MINWAITTIME;
+static uint8_t arqMaxWait = L2_ARQ_MAXWAITTIME;
 static uint8_t reqestedId=0;
 
-static uint8_t L2_validityCheck_ID(void)
+static uint8_t L2_validityCheck_ID(uint8_t destId)
 {
-    if (myL2ID == destL2ID)
+    if (myL2ID == destId)
     {
-        debug("[WARNING] myID and destination ID is the same! my:%i, dest:%i\n", myL2ID, destL2ID);
+        debug("[WARNING] myID and destination ID is the same! my:%i, dest:%i\n", myL2ID, destId);
         return 1;
     }
 
@@ -54,66 +104,214 @@ static uint8_t L2_validityCheck_ID(void)
 }
 
 
-uint8_t L2_configDestId(uint8_t destId)
+//frame aggregation : an SDU queued for a peer with nothing in flight waits up to L2_AGG_DELAYMS for
+//others to pack with it, unless the queued SDUs already fill a frame (or cannot be packed at all)
+static void L2_holdForAgg(L2_peer_t* peer)
 {
-    if (L2_validityCheck_ID() == 1)
+    uint8_t aggLen = 0;
+    uint8_t i;
+
+    if (L2_AGG_DELAYMS == 0 || peer->txSdu != PDUBUF_INVALID)
+        return;
+
+    for (i = 0; i < peer->qLen; i++)
     {
-        debug("[L2] Failed to config dest to ID %i\n", destId);
-        return 1;
-    }
+        uint8_t len = PDUbuf_getLen(peer->queue[(peer->qHead + i) % L2_PEER_QUEUESIZE]);
 
-    destL2ID = destId;
-    return 0;
+        if (L2_agg_fits(aggLen, len, L2_AGG_MAXLEN) == 0)
+        {
+            L2_peer_release(peer);
+            return;
+        }
+        aggLen += L2_AGG_SUBHDR + len;
+    }
+    if (peer->qLen >= L2_PEER_QUEUESIZE || L2_agg_fits(aggLen, 1, L2_AGG_MAXLEN) == 0)
+        L2_peer_release(peer);
+    else
+        L2_peer_hold(peer, L2_LLI_getTimeMs() + L2_AGG_DELAYMS);
 }
 
-
-int L2_pullSduBuffer(uint8_t size)
+//frame aggregation : the queued SDUs that fit in the frame of the peer's new txSdu join it as
+//sub-frames (copied behind it, their buffers freed) : aggCnt SDUs are then sent and confirmed together
+static void L2_packTxSdu(L2_peer_t* peer)
 {
-    int res;
+    uint8_t len = PDUbuf_getLen(peer->txSdu);
+    uint8_t* payload;
+    uint8_t aggLen;
+
+    peer->aggCnt = 0;
+    if (peer->qLen == 0 || L2_agg_fits(0, len, L2_AGG_MAXLEN) == 0 ||
+        L2_agg_fits(L2_AGG_SUBHDR + len, PDUbuf_getLen(peer->queue[peer->qHead]), L2_AGG_MAXLEN) == 0)
+        return;
 
-    if (size > sduBufferSize)
+    payload = PDUbuf_push(peer->txSdu, L2_AGG_SUBHDR);
+    payload[0] = len;
+    aggLen = L2_AGG_SUBHDR + len;
+    peer->aggCnt = 1;
+    while (peer->qLen > 0 && L2_agg_fits(aggLen, PDUbuf_getLen(peer->queue[peer->qHead]), L2_AGG_MAXLEN))
     {
-        debug_if(DBGMSG_L2, "[L2][WARNING] sdu buffer size (%i) is less than request size (%i), truncating the requested size...\n", sduBufferSize, size);
-        size = sduBufferSize;
+        uint8_t sdu = L2_peer_dequeue(peer);
+
+        aggLen = L2_agg_put(payload, aggLen, PDUbuf_getData(sdu), PDUbuf_getLen(sdu));
+        PDUbuf_free(sdu);
+        peer->aggCnt++;
     }
+    PDUbuf_setLen(peer->txSdu, aggLen);
+    debug_if(DBGMSG_L2, "[L2] %i SDUs to %i packed in one frame (%i bytes)\n", peer->aggCnt, peer->id, aggLen);
+}
 
-    memcpy(sduIn, sduBuffer, size);
-    sduLen = size;
+//the peer's txSdu is done : L3 gets a confirmation for each SDU packed in it
+static void L2_confirmTxSdu(L2_peer_t* peer, uint8_t res)
+{
+    uint8_t n = (peer->aggCnt > 0) ? peer->aggCnt : 1;
 
+    PDUbuf_free(peer->txSdu);
+    peer->txSdu = PDUBUF_INVALID;
+    peer->aggCnt = 0;
+    while (n-- > 0)
+        L3_LLI_dataCnf(res);
+}
 
-    sduBufferSize -= size;
-    if (sduBufferSize > 0)
+//moves the SDUs handed over by L3 to the queues of their peers
+//(DATA_REQ may come from the serial input interrupt, so the hand-over queue is guarded)
+static void L2_dispatchTxQueue(void)
+{
+    while (txQueueLen > 0)
     {
-        memcpy(sduBuffer, sduBuffer+size, sduBufferSize);
-        res = 1;
-    }  
-    else
-        res = 0;
+        uint8_t sdu;
+        uint8_t destId;
+        L2_peer_t* peer = NULL;
+
+        core_util_critical_section_enter();
+        sdu = txQueue[txQueueHead];
+        destId = txQueueDest[txQueueHead];
+        txQueueHead = (txQueueHead + 1) % L2_TXQUEUE_SIZE;
+        txQueueLen--;
+        core_util_critical_section_exit();
 
-    return res;
+        if (L2_validityCheck_ID(destId) == 1 || (peer = L2_peer_add(&peerTbl, destId, L2_LLI_getTimeMs())) == NULL ||
+            L2_peer_enqueue(&peerTbl, peer, sdu) != 0)
+        {
+            debug("[L2][WARNING] Failed to queue an SDU to %i (%s), dropping it\n", destId,
+                  (peer == NULL) ? "neighbour table is full" : "queue is full");
+            PDUbuf_free(sdu);
+            L3_LLI_dataCnf(0);
+        }
+        else if (L2_AGG_ENABLE && destId != L2_BROADCAST_ID)
+            L2_holdForAgg(peer);
+    }
 }
 
-void L2_LLI_handleDataReq(uint8_t* sdu, uint8_t len, uint8_t destId)
+//prepends the header in front of the next fragment of the peer's txSdu and returns the PDU size
+//the FCS (if any) is written right after the fragment : the bytes it covers are kept in fcsSaved
+//and put back by L2_completePdu()
+static uint8_t L2_encodeNextPdu(L2_peer_t* peer, uint8_t seq)
 {
-    if (L2_configDestId(destId) == 1 && L2_event_checkEventFlag(L2_event_dataToSendBuffer))
+    uint8_t len;
+    uint8_t flag_end;
+    uint8_t size;
+
+    peer->arqPdu = PDUbuf_push(peer->txSdu, L2_MSG_OFFSET_DATA);
+    len = PDUbuf_getLen(peer->txSdu) - L2_MSG_OFFSET_DATA;
+    flag_end = 1;
+    if (len > L2_MSG_MAXDATASIZE - L2_CRC_LEN)
     {
-        debug_if(DBGMSG_L2, "[L2] Failed to handle DATA_REQ (dest ID is invalid or data TX is in progress...(SDU flag : %i)\n", L2_event_checkEventFlag(L2_event_dataToSendBuffer));
-        return;
+        len = L2_MSG_MAXDATASIZE - L2_CRC_LEN;
+        flag_end = 0;
     }
 
-    if (len < L2_MSG_MAXDATASIZE)
+    if (peer->aggCnt > 0)
+        size = L2_msg_encodeAgg(peer->arqPdu, seq, len);
+    else
+        size = L2_msg_encodeData(peer->arqPdu, seq, len, flag_end);
+    memcpy(peer->fcsSaved, peer->arqPdu + size, L2_CRC_LEN);
+    L2_crc_append(peer->arqPdu, size);
+
+    return size;
+}
+
+//sends frame fecTxIdx of the FEC block made from the peer's txSdu
+//(the frames are built in fecFrame since the whole block may have to be sent again : only one
+//frame is on air at a time, so the peers share it)
+static void L2_sendFecFrame(L2_peer_t* peer)
+{
+    uint8_t len;
+
+    len = L2_fec_getFragment(fecFrame + L2_MSG_OFFSET_FEC_DATA, PDUbuf_getData(peer->txSdu), PDUbuf_getLen(peer->txSdu), L2_FEC_FRAGSIZE, peer->fecTxIdx);
+    peer->pduSize = L2_msg_encodeFec(fecFrame, peer->fecTxSeq, peer->fecTxIdx, PDUbuf_getLen(peer->txSdu), len);
+    L2_LLI_sendData(fecFrame, L2_crc_append(fecFrame, peer->pduSize), peer->id);
+}
+
+//sequence number of the PDU (or FEC block) in flight to the peer
+static uint8_t L2_getTxSeq(L2_peer_t* peer)
+{
+    return (peer->fecTxNum > 0) ? peer->fecTxSeq : L2_msg_getSeq(peer->arqPdu);
+}
+
+//current PDU of the peer is done (ACKed, broadcasted or given up) : move on to the next fragment or SDU
+static void L2_completePdu(L2_peer_t* peer, uint8_t res)
+{
+    if (peer->fecTxNum > 0) //FEC block : the whole SDU is done at once
     {
-        memcpy(sduIn, sdu, len);
-        sduLen = len;
+        if (res)
+            L2_airtime_noteDelivered(PDUbuf_getLen(peer->txSdu));
+        peer->fecTxNum = 0;
+        PDUbuf_setLen(peer->txSdu, 0);
     }
     else
     {
-        memcpy(sduBuffer, sdu, len);
-        sduBufferSize = len;
+        if (res)
+            L2_airtime_noteDelivered(peer->pduSize - L2_MSG_OFFSET_DATA - peer->aggCnt * L2_AGG_SUBHDR);
+        memcpy(peer->arqPdu + peer->pduSize, peer->fcsSaved, L2_CRC_LEN);
+        PDUbuf_pull(peer->txSdu, peer->pduSize);
+    }
+
+    if (res == 0 || PDUbuf_getLen(peer->txSdu) == 0)
+        L2_confirmTxSdu(peer, res);
 
-        L2_pullSduBuffer(L2_MSG_MAXDATASIZE);
-        L2_event_setEventFlag(L2_event_dataToSendBuffer);
+    if (L2_peer_hasData(peer) || txQueueLen > 0)
+        L2_event_setEventFlag(L2_event_dataToSend);
+}
+
+//the link to the peer is lost : its PDU waiting for an ACK and its queued SDUs fail at once
+//(a frame on air is given up at its ARQ timeout, a partly sent SDU before its next fragment)
+static void L2_failPeer(L2_peer_t* peer)
+{
+    uint8_t sdu;
+
+#ifndef DISABLE_ARQ
+    if (peer->waitAck)
+    {
+        L2_peer_stopWait(peer);
+        L2_completePdu(peer, 0);
     }
+#endif
+    while ((sdu = L2_peer_dequeue(peer)) != L2_PEER_NOSDU)
+    {
+        PDUbuf_free(sdu);
+        L3_LLI_dataCnf(0);
+    }
+}
+
+void L2_LLI_handleDataReq(uint8_t sdu, uint8_t destId)
+{
+    uint8_t idx;
+
+    core_util_critical_section_enter();
+    if (txQueueLen >= L2_TXQUEUE_SIZE)
+    {
+        core_util_critical_section_exit();
+        debug_if(DBGMSG_L2, "[L2] Failed to handle DATA_REQ (TX queue is full : %i)\n", txQueueLen);
+        PDUbuf_free(sdu);
+        L3_LLI_dataCnf(0);
+        return;
+    }
+
+    idx = (txQueueHead + txQueueLen) % L2_TXQUEUE_SIZE;
+    txQueue[idx] = sdu;
+    txQueueDest[idx] = destId;
+    txQueueLen++;
+    core_util_critical_section_exit();
 
     L2_event_setEventFlag(L2_event_dataToSend);
 }
@@ -128,36 +326,642 @@ void L2_LLI_reconfigSrcId(uint8_t myId)
 void L2_initFSM(uint8_t myId)
 {
     myL2ID = myId;
-    destL2ID = 0; 
 
     L2_event_clearAllEventFlag();
 
-    L2_validityCheck_ID();
-
+    L2_crc_init();
+    L2_crc_benchmark();
+    L2_rate_init();
+    L2_rbc_init(&rbcCtx);
+    L2_link_init(&linkCtx, (uint32_t)L2_LINK_DETECTTIME * 1000);
+    L2_peer_init(&peerTbl);
     L2_LLI_initLowLayer(myL2ID);
     L3_LLI_setDataReqFunc(L2_LLI_handleDataReq);
     L3_LLI_setReconfigSrcIdReqFunc(L2_LLI_reconfigSrcId);
+
+    MEMstat_registerStatic("L2 TX queue/ACK", sizeof(txQueue) + sizeof(txQueueDest) + sizeof(arqAck));
+    MEMstat_registerStatic("L2 neighbour table", sizeof(peerTbl));
+    if (L2_RBC_ENABLE)
+        MEMstat_registerStatic("L2 reliable broadcast", sizeof(rbcCtx) + sizeof(ctrlFrame));
+}
+
+//ARQ parameters (retransmissions, timer range in s) : validated by the caller (minWait < maxWait),
+//applied from the main loop between two FSM passes, so a PDU in flight keeps its running timer
+void L2_setArqParams(uint8_t maxRetx, uint8_t minWait, uint8_t maxWait)
+{
+    arqMaxRetx = maxRetx;
+    arqMinWait = minWait;
+    arqMaxWait = maxWait;
+}
+
+void L2_getArqParams(uint8_t* maxRetx, uint8_t* minWait, uint8_t* maxWait)
+{
+    *maxRetx = arqMaxRetx;
+    *minWait = arqMinWait;
+    *maxWait = arqMaxWait;
+}
+
+//counters of the neighbour table, FCS, reliable broadcast, link watch, channel access and buffers
+void L2_printStats(void)
+{
+    L2_csmaStats_t csma;
+    uint32_t crcOk, crcBad, copies, allocFail;
+    uint8_t inUse, peak;
+
+    printf("[L2] peers : %lu SDUs queued, %lu rejected, %lu evicted, %lu duplicates ACKed again, %lu NACK retransmissions\n",
+           (unsigned long)peerTbl.stats.sduQueued, (unsigned long)peerTbl.stats.sduRejected, (unsigned long)peerTbl.stats.evicted,
+           (unsigned long)peerTbl.stats.dupReAcked, (unsigned long)peerTbl.stats.nackRetx);
+    if (L2_FCS_MODE > 0)
+    {
+        L2_crc_getStats(&crcOk, &crcBad);
+        printf("[L2] FCS : %lu ok, %lu mismatch\n", (unsigned long)crcOk, (unsigned long)crcBad);
+    }
+    if (L2_RBC_ENABLE)
+        printf("[L2] broadcast : %lu NACKs (%lu suppressed), %lu repairs, %lu SYNCs, %lu gaps, %lu duplicates, %lu lost\n",
+               (unsigned long)rbcCtx.stats.nackSent, (unsigned long)rbcCtx.stats.nackSuppressed,
+               (unsigned long)rbcCtx.stats.repairSent, (unsigned long)rbcCtx.stats.syncSent, (unsigned long)rbcCtx.stats.gapCnt,
+               (unsigned long)rbcCtx.stats.dupCnt, (unsigned long)rbcCtx.stats.lostCnt);
+    if (L2_LINK_DETECTTIME > 0)
+        printf("[L2] links : %lu probes, %lu replies, %lu down, %lu up\n", (unsigned long)linkCtx.stats.probeSent,
+               (unsigned long)linkCtx.stats.replySent, (unsigned long)linkCtx.stats.downCnt, (unsigned long)linkCtx.stats.upCnt);
+    if (L2_CSMA_ENABLE)
+    {
+        L2_LLI_getCsmaStats(&csma);
+        printf("[L2] CSMA : %lu frames, %lu/%lu sensings busy, %lu failed, %lu not ACKed\n", (unsigned long)csma.frames,
+               (unsigned long)csma.busyCnt, (unsigned long)csma.ccaCnt, (unsigned long)csma.failCnt, (unsigned long)csma.noAckCnt);
+    }
+    PDUbuf_getStats(&inUse, &peak, &allocFail, &copies);
+    printf("[L2] PDUbuf : %i/%i blocks in use, peak %i, alloc fail %lu, copies %lu\n", inUse, PDUBUF_NUM, peak,
+           (unsigned long)allocFail, (unsigned long)copies);
+    if (L2_LLI_getRxQueueDrop() > 0)
+        printf("[L2] RX queue : %lu frames dropped (queue full)\n", (unsigned long)L2_LLI_getRxQueueDrop());
+    L2_airtime_printReport();
 }
 
 
 
-int L2_aggregateData(uint8_t* dataPtr, uint8_t srcId, uint8_t size, uint8_t brflag, uint8_t flag_end)
+//takes the received frame from the RX interface : whatever it is, its sender is alive
+//(unicast senders have their link watched from then on)
+static uint8_t L2_takeRcvdPdu(void)
 {
-    memcpy(pduBuffer+pduBufferSize,L2_msg_getWord(dataPtr), size);
-    pduBufferSize+=size-L2_MSG_OFFSET_DATA;
+    uint8_t pdu = L2_LLI_takeRcvdPdu();
+    uint32_t nowMs = L2_LLI_getTimeMs();
 
-    debug_if(DBGMSG_L2, "[L2] Aggregation PDU : size : %i end : %i\n", pduBufferSize, flag_end);
+    if (pdu != PDUBUF_INVALID)
+    {
+        if (L2_LLI_getIsBroadcasted() == 0)
+            L2_link_watch(&linkCtx, L2_LLI_getSrcId(), nowMs);
+        L2_link_onRx(&linkCtx, L2_LLI_getSrcId(), nowMs);
+    }
+
+    return pdu;
+}
+
+
+//takes over the received PDU : single-fragment SDUs go up to L3 in their own buffer,
+//fragments of longer SDUs are appended to the reassembly buffer aggPdu (of the sender, or the broadcast one)
+int L2_aggregateData(uint8_t pdu, uint8_t srcId, uint8_t* aggPdu, uint8_t brflag, uint8_t flag_end)
+{
+    if (*aggPdu == PDUBUF_INVALID && (brflag == 1 || flag_end == 1))
+    {
+        PDUbuf_pull(pdu, L2_MSG_OFFSET_DATA);
+        L3_LLI_dataInd(pdu, srcId, L2_LLI_getSnr(), L2_LLI_getRssi());
+
+        return 0;
+    }
+
+    if (*aggPdu == PDUBUF_INVALID && (*aggPdu = PDUbuf_alloc()) == PDUBUF_INVALID)
+    {
+        debug("[L2][WARNING] no PDU buffer for reassembly, dropping the fragment\n");
+        PDUbuf_free(pdu);
+        return 0;
+    }
+
+    if (PDUbuf_put(*aggPdu, L2_msg_getWord(PDUbuf_getData(pdu)), PDUbuf_getLen(pdu)-L2_MSG_OFFSET_DATA) != 0)
+        debug("[L2][WARNING] reassembled SDU is too long, truncating it\n");
+    PDUbuf_free(pdu);
+
+    debug_if(DBGMSG_L2, "[L2] Aggregation PDU : size : %i end : %i\n", PDUbuf_getLen(*aggPdu), flag_end);
     if (brflag == 1 || flag_end == 1)
     {
-        L3_LLI_dataInd(pduBuffer, srcId, pduBufferSize, L2_LLI_getSnr(), L2_LLI_getRssi());
-        pduBufferSize = 0;
+        L3_LLI_dataInd(*aggPdu, srcId, L2_LLI_getSnr(), L2_LLI_getRssi());
+        *aggPdu = PDUBUF_INVALID;
+
+        return 0;
+    }
+
+    return 1;
+}
+
+
+static void L2_resetFecRx(void)
+{
+    PDUbuf_free(fecRxSdu);
+    PDUbuf_free(fecRxParity);
+    fecRxSdu = PDUBUF_INVALID;
+    fecRxParity = PDUBUF_INVALID;
+}
+
+//what L2_receiveFecFrame asks to answer
+#define L2_FECRX_NONE               0
+#define L2_FECRX_ACK                1
+#define L2_FECRX_NACK               2
+
+//ms the sender still needs for the num last frames of its FEC block (at the rate advised to it)
+static uint32_t L2_getFecRestMs(uint8_t srcId, uint8_t num)
+{
+    uint8_t rate = L2_rate_getAdvice(srcId);
+    uint32_t toaUs = L2_rate_getToaUs((rate == L2_RATE_NONE) ? 0 : rate,
+                                      L2_MSG_OFFSET_FEC_DATA + L2_MSG_FEC_MAXDATASIZE + L2_AIRTIME_PHYHDR);
+
+    return (num * toaUs + 999) / 1000 + L2_FEC_ACKMARGINMS;
+}
+
+//takes over a received FEC frame : the SDU goes up to L3 as soon as it is complete or rebuilt
+//a unicast block is ACKed on its last frame, or, when it was rebuilt (or received again) before that
+//frame, once the sender has had the time to send the rest of it : the sender does not listen in the
+//middle of a block, and its last frame may be the one that was lost
+//a block that still cannot be rebuilt on its last frame is NACKed so that the sender does not wait
+//for its timer
+//peer : context of the sender, NULL for a broadcast block
+static uint8_t L2_receiveFecFrame(uint8_t pdu, uint8_t srcId, L2_peer_t* peer)
+{
+    uint8_t* frame = PDUbuf_getData(pdu);
+    uint8_t rxSeq = L2_msg_getSeq(frame);
+    uint8_t idx = L2_msg_getFecIdx(frame);
+    uint8_t sduLen = L2_msg_getFecSduLen(frame);
+    uint8_t numData = L2_fec_getNumData(sduLen, L2_FEC_FRAGSIZE);
+    uint8_t lastIdx = numData + L2_fec_getNumParity(numData) - 1;
+    uint8_t isNew;
+
+    if (peer == NULL)
+        isNew = !(fecRxBrDone && fecRxBrDoneSrc == srcId && fecRxBrDoneSeq == rxSeq);
+    else
+        isNew = (L2_seq_check(rxSeq, peer->rxSeq) == L2_SEQ_EXPECTED);
+
+    if (isNew)
+    {
+        //an incomplete older block is given up
+        if (fecRxSdu != PDUBUF_INVALID && (fecRxSrc != srcId || fecRxSeq != rxSeq || fecRx.sduLen != sduLen))
+            L2_resetFecRx();
+
+        if (fecRxSdu == PDUBUF_INVALID)
+        {
+            fecRxSdu = PDUbuf_alloc();
+            fecRxParity = PDUbuf_alloc();
+            if (fecRxSdu == PDUBUF_INVALID || fecRxParity == PDUBUF_INVALID ||
+                L2_fec_rxInit(&fecRx, PDUbuf_getData(fecRxSdu), PDUbuf_getData(fecRxParity), sduLen, L2_FEC_FRAGSIZE) != 0)
+            {
+                debug("[L2][WARNING] cannot rebuild the FEC block (seq:%i, len:%i), dropping the fragment\n", rxSeq, sduLen);
+                L2_resetFecRx();
+                PDUbuf_free(pdu);
+                return L2_FECRX_NONE;
+            }
+            fecRxSrc = srcId;
+            fecRxSeq = rxSeq;
+        }
+
+        if (L2_fec_rxPut(&fecRx, idx, frame + L2_MSG_OFFSET_FEC_DATA, PDUbuf_getLen(pdu) - L2_MSG_OFFSET_FEC_DATA) == 1)
+        {
+            debug_if(DBGMSG_L2, "[L2] FEC block %i complete (len:%i, rebuilt so far:%lu)\n", rxSeq, sduLen, (unsigned long)L2_fec_getRecoveredCnt());
+            PDUbuf_setLen(fecRxSdu, sduLen);
+            L3_LLI_dataInd(fecRxSdu, srcId, L2_LLI_getSnr(), L2_LLI_getRssi());
+            fecRxSdu = PDUBUF_INVALID;
+            L2_resetFecRx();
+
+            if (peer == NULL)
+            {
+                fecRxBrDone = 1;
+                fecRxBrDoneSrc = srcId;
+                fecRxBrDoneSeq = rxSeq;
+            }
+            else
+                peer->rxSeq = L2_seq_next(peer->rxSeq);
+        }
+    }
+    PDUbuf_free(pdu);
+
+    if (peer == NULL)
+        return L2_FECRX_NONE;
+    if (rxSeq == L2_seq_prev(peer->rxSeq) || L2_peer_rxIsAcked(peer, rxSeq))
+    {
+        if (idx >= lastIdx)
+        {
+            fecAckPending = 0;
+            return L2_FECRX_ACK;
+        }
+        fecAckPending = 1;
+        fecAckSrc = srcId;
+        fecAckSeq = rxSeq;
+        fecAckAtMs = L2_LLI_getTimeMs() + L2_getFecRestMs(srcId, lastIdx - idx);
+        return L2_FECRX_NONE;
+    }
+    return (idx == lastIdx && isNew) ? L2_FECRX_NACK : L2_FECRX_NONE;
+}
+
+
+//takes over a received broadcast data frame
+//reliable broadcast : only the next frame in order of its sender is delivered, and the fragments
+//of an SDU are reassembled up to its last one
+static void L2_receiveBroadcast(uint8_t pdu, uint8_t srcId, uint8_t rxSeq, uint8_t flag_end)
+{
+    int res;
+
+    if (L2_RBC_ENABLE == 0)
+    {
+        L2_aggregateData(pdu, srcId, &rxAggPdu, 1, flag_end);
+        return;
+    }
+
+    res = L2_rbc_onData(&rbcCtx, L2_LLI_getTimeMs(), srcId, rxSeq);
+    if (res != L2_RBC_ACCEPT)
+    {
+        debug_if(DBGMSG_L2, "[L2] broadcast frame %i from %i %s, dropping it\n", rxSeq, srcId,
+                 (res == L2_RBC_DUPLICATE) ? "already delivered" : "after a gap");
+        PDUbuf_free(pdu);
+        return;
+    }
+    L2_aggregateData(pdu, srcId, &rxAggPdu, 0, flag_end);
+}
+
+//hands the next sub-frame of the AGG frame under delivery to L3 (copied to a buffer of its own,
+//the last one is left in the buffer of the frame)
+static void L2_deliverAggSub(void)
+{
+    uint8_t* payload = L2_msg_getWord(PDUbuf_getData(aggRxPdu));
+    uint8_t len = PDUbuf_getLen(aggRxPdu) - L2_MSG_OFFSET_DATA;
+    uint8_t subLen;
+    uint8_t sdu;
+    int off = L2_agg_next(payload, len, &aggRxPos, &subLen);
+
+    if (aggRxPos >= len)
+    {
+        PDUbuf_pull(aggRxPdu, L2_MSG_OFFSET_DATA + off);
+        PDUbuf_setLen(aggRxPdu, subLen);
+        L3_LLI_dataInd(aggRxPdu, aggRxSrc, aggRxSnr, aggRxRssi);
+        aggRxPdu = PDUBUF_INVALID;
+        return;
+    }
+
+    if ((sdu = PDUbuf_alloc()) == PDUBUF_INVALID)
+    {
+        debug("[L2][WARNING] no PDU buffer for a sub-frame from %i, dropping it\n", aggRxSrc);
+        return;
+    }
+    PDUbuf_put(sdu, payload + off, subLen);
+    L3_LLI_dataInd(sdu, aggRxSrc, aggRxSnr, aggRxRssi);
+}
+
+//takes over an AGG frame in order : each sub-frame goes up to L3 as an SDU of its own, the next one
+//once L3 has taken the previous (those of an earlier frame still waiting go up at once, L3 keeps the
+//last message only)
+static void L2_receiveAggFrame(uint8_t pdu, uint8_t srcId)
+{
+    uint8_t cnt = L2_agg_count(L2_msg_getWord(PDUbuf_getData(pdu)), PDUbuf_getLen(pdu) - L2_MSG_OFFSET_DATA);
+
+    if (cnt == 0)
+    {
+        debug("[L2][WARNING] malformed aggregated frame from %i, dropping it\n", srcId);
+        PDUbuf_free(pdu);
+        return;
+    }
+    while (aggRxPdu != PDUBUF_INVALID)
+        L2_deliverAggSub();
+
+    debug_if(DBGMSG_L2, "[L2] aggregated frame from %i : %i SDUs\n", srcId, cnt);
+    aggRxPdu = pdu;
+    aggRxSrc = srcId;
+    aggRxPos = 0;
+    aggRxSnr = L2_LLI_getSnr();
+    aggRxRssi = L2_LLI_getRssi();
+    L2_deliverAggSub();
+}
+
+//frames given up by the reliable broadcast : the SDU under reassembly cannot be completed
+static void L2_dropRxAggPdu(void)
+{
+    if (rxAggPdu == PDUBUF_INVALID)
+        return;
+
+    debug("[L2][WARNING] broadcast frames were lost for good, dropping the partial SDU\n");
+    PDUbuf_free(rxAggPdu);
+    rxAggPdu = PDUBUF_INVALID;
+}
+
+//context of the unicast sender srcId of a frame with sequence number rxSeq : a new peer is
+//taken in sync on its first frame. NULL if the neighbour table is full
+static L2_peer_t* L2_getRxPeer(uint8_t srcId, uint8_t rxSeq)
+{
+    L2_peer_t* peer = L2_peer_add(&peerTbl, srcId, L2_LLI_getTimeMs());
+
+    if (peer != NULL && peer->rxSynced == 0)
+    {
+        peer->rxSeq = rxSeq;
+        peer->rxSynced = 1;
+    }
+    return peer;
+}
+
+static void L2_sendAck(uint8_t destId, uint8_t seq)
+{
+    L2_msg_encodeAck(arqAck, seq, L2_rate_getAdvice(destId));
+    L2_LLI_sendData(arqAck, L2_crc_append(arqAck, L2_MSG_ACKSIZE), destId);
+    main_state = L2STATE_TX;
+}
+
+//NACK to destId : its PDU seq is missing (received damaged, or an FEC block that could not be rebuilt)
+static void L2_sendNack(uint8_t destId, uint8_t seq)
+{
+    L2_msg_encodeNack(arqAck, seq, destId);
+    L2_LLI_sendData(arqAck, L2_crc_append(arqAck, L2_MSG_CTRLSIZE), destId);
+    main_state = L2STATE_TX;
+}
+
+//ACKs PDU seq of the peer : a PDU ACKed before is sent again when our ACK was lost, it is only ACKed again
+static void L2_ackPdu(L2_peer_t* peer, uint8_t seq)
+{
+    if (L2_peer_rxAcked(&peerTbl, peer, seq))
+        debug_if(DBGMSG_L2, "[L2] PDU %i from %i received again, ACKing it again (duplicates so far:%lu)\n",
+                 seq, peer->id, (unsigned long)peerTbl.stats.dupReAcked);
+    L2_sendAck(peer->id, seq);
+}
+
+//takes over a received data frame : broadcast frames go to the reliable broadcast, unicast frames
+//are delivered in the order of their sender's sequence numbers and ACKed (a PDU ACKed
+//before is ACKed again : our ACK was lost)
+static void L2_receiveData(void)
+{
+    uint8_t srcId = L2_LLI_getSrcId();
+    uint8_t rxPdu = L2_takeRcvdPdu();
+    uint8_t brflag = L2_LLI_getIsBroadcasted();
+    uint8_t flag_end;
+    uint8_t rxSeq;
+    L2_peer_t* peer = NULL;
+
+    if (rxPdu == PDUBUF_INVALID) //already dropped by the RX interface
+        return;
+    flag_end = L2_msg_checkIfEndData(PDUbuf_getData(rxPdu));
+    rxSeq = L2_msg_getSeq(PDUbuf_getData(rxPdu));
+
+    if (brflag == 0 && L2_seq_isValid(rxSeq) == 0)
+    {
+        debug("[L2][WARNING] PDU SN (%i) from %i is out of the sequence space, discarding it...\n", rxSeq, srcId);
+        PDUbuf_free(rxPdu);
+        return;
+    }
+    if (brflag == 0 && (peer = L2_getRxPeer(srcId, rxSeq)) == NULL)
+    {
+        debug("[L2][WARNING] no context for %i (neighbour table is full), dropping the frame\n", srcId);
+        PDUbuf_free(rxPdu);
+        return;
+    }
+
+    //one PDU in flight per peer : a PDU ahead of the expected one means that the sender gave up
+    //those in between, the receiver moves on to it
+    if (brflag == 0 && L2_seq_check(rxSeq, peer->rxSeq) == L2_SEQ_AHEAD)
+    {
+        debug("[L2][WARNING] PDUs %i..%i from %i were given up by the sender, moving on to %i\n",
+              peer->rxSeq, L2_seq_prev(rxSeq), srcId, rxSeq);
+        if (peer->rxAggPdu != PDUBUF_INVALID)
+        {
+            PDUbuf_free(peer->rxAggPdu);
+            peer->rxAggPdu = PDUBUF_INVALID;
+        }
+        peer->rxSeq = rxSeq;
+    }
+
+    if (L2_msg_checkIfFec(PDUbuf_getData(rxPdu)))
+    {
+        switch (L2_receiveFecFrame(rxPdu, srcId, peer))
+        {
+            case L2_FECRX_ACK:
+                L2_ackPdu(peer, rxSeq);
+                break;
+            case L2_FECRX_NACK:
+                debug_if(DBGMSG_L2, "[L2] FEC block %i from %i cannot be rebuilt, NACKing it\n", rxSeq, srcId);
+                L2_sendNack(srcId, rxSeq);
+                break;
+        }
+        return;
+    }
+
+    if (brflag)
+    {
+        L2_receiveBroadcast(rxPdu, srcId, rxSeq, flag_end);
+        return;
+    }
+
+#ifndef DISABLE_ARQ
+    switch (L2_seq_check(rxSeq, peer->rxSeq))
+    {
+        case L2_SEQ_EXPECTED:
+            break;
+        case L2_SEQ_OLD:
+            //a PDU ACKed before comes again when our ACK was lost : ACKed again, not delivered twice.
+            //Only one further back than the duplicate cache comes from a sender that restarted
+            //(reset) its sequence numbers, the receiver resyncs on it
+            switch (L2_peer_rxCheckOld(peer, rxSeq))
+            {
+                case L2_PEER_RXOLD_ACKED:
+                    PDUbuf_free(rxPdu);
+                    L2_ackPdu(peer, rxSeq);
+                    return;
+                case L2_PEER_RXOLD_STALE:
+                    debug("[L2][WARNING] PDU SN (%i) from %i is old but not ACKed (%i is required), discarding it...\n",
+                          rxSeq, srcId, peer->rxSeq);
+                    PDUbuf_free(rxPdu);
+                    return;
+            }
+            debug("[L2][WARNING] PDU SN (%i) from %i is behind the last one ACKed (%i is required) : the sender restarted, resyncing\n",
+                  rxSeq, srcId, peer->rxSeq);
+            if (peer->rxAggPdu != PDUBUF_INVALID)
+            {
+                PDUbuf_free(peer->rxAggPdu);
+                peer->rxAggPdu = PDUBUF_INVALID;
+            }
+            peer->rxSeq = rxSeq;
+            peer->rxAckedLen = 0;
+            peer->rxAckedIdx = 0;
+            break;
+        default:
+            debug("[L2][WARNING] Invalid PDU SN (%i) from %i while (%i) is required! discarding it...\n", rxSeq, srcId, peer->rxSeq);
+            PDUbuf_free(rxPdu);
+            return;
+    }
+#endif
+    if (L2_msg_checkIfAgg(PDUbuf_getData(rxPdu)))
+        L2_receiveAggFrame(rxPdu, srcId);
+    else
+        L2_aggregateData(rxPdu, srcId, &peer->rxAggPdu, 0, flag_end);
+
+#ifndef DISABLE_ARQ
+    peer->rxSeq = L2_seq_next(peer->rxSeq);
+    L2_ackPdu(peer, rxSeq);
+#endif
+}
+
+#ifndef DISABLE_ARQ
+//takes over a received ACK : the PDU its sender was waiting for is done
+static void L2_receiveAck(void)
+{
+    uint8_t srcId = L2_LLI_getSrcId();
+    uint8_t rxPdu = L2_takeRcvdPdu();
+    L2_peer_t* peer = L2_peer_find(&peerTbl, srcId);
+
+    if (rxPdu == PDUBUF_INVALID)
+    {
+        debug_if(DBGMSG_L2, "[L2] ACK was dropped by the RX interface\n");
+        return;
+    }
+
+    if (peer != NULL && peer->waitAck && L2_seq_check(L2_msg_getSeq(PDUbuf_getData(rxPdu)), L2_getTxSeq(peer)) == L2_SEQ_EXPECTED)
+    {
+        debug_if(DBGMSG_L2, "[L2] ACK from %i is correctly received! \n", srcId);
+        L2_peer_stopWait(peer);
+        L2_completePdu(peer, 1);
+    }
+    else if (peer != NULL && peer->waitAck && L2_seq_check(L2_msg_getSeq(PDUbuf_getData(rxPdu)), L2_getTxSeq(peer)) == L2_SEQ_OLD)
+    {
+        debug_if(DBGMSG_L2, "[L2] late ACK of an earlier PDU (%i) from %i, ignoring it\n", L2_msg_getSeq(PDUbuf_getData(rxPdu)), srcId);
+    }
+    else if (peer != NULL && peer->waitAck)
+    {
+        debug_if(DBGMSG_L2, "[L2]ACK seq number is weird! (expected : %i, received : %i\n", L2_getTxSeq(peer), L2_msg_getSeq(PDUbuf_getData(rxPdu)));
+    }
+    else
+    {
+        debug_if(DBGMSG_L2, "[L2] unexpected ACK from %i, ignoring it\n", srcId);
+    }
+    PDUbuf_free(rxPdu);
+}
+
+//ARQ timer of the peer : 2..5 s drawn at each transmission
+static uint32_t L2_getArqWaitMs(void)
+{
+    return 1000 * (arqMinWait + rand()%(arqMaxWait-arqMinWait));
+}
+#endif
 
+//takes over a received NACK, SYNC or PROBE
+static void L2_receiveCtrl(void)
+{
+    uint8_t srcId = L2_LLI_getSrcId();
+    uint8_t rxPdu = L2_takeRcvdPdu();
+    uint8_t* frame;
+    uint32_t nowMs = L2_LLI_getTimeMs();
+
+    if (rxPdu == PDUBUF_INVALID)
+        return;
+    frame = PDUbuf_getData(rxPdu);
+
+    if (frame[L2_MSG_OFFSET_TYPE] == L2_MSG_TYPE_NACK && L2_LLI_getIsBroadcasted() == 0)
+    {
+        //ARQ : the receiver misses our PDU in flight, which is sent again without waiting for its timer
+        L2_peer_t* peer = L2_peer_find(&peerTbl, srcId);
+
+        if (peer != NULL && peer->waitAck && L2_msg_getNackSrc(frame) == myL2ID &&
+            L2_seq_check(L2_msg_getSeq(frame), L2_getTxSeq(peer)) == L2_SEQ_EXPECTED)
+        {
+            debug_if(DBGMSG_L2, "[L2] NACK from %i for PDU %i\n", srcId, L2_msg_getSeq(frame));
+            L2_peer_nacked(peer, nowMs);
+        }
+    }
+    else if (L2_RBC_ENABLE && frame[L2_MSG_OFFSET_TYPE] == L2_MSG_TYPE_NACK)
+    {
+        if (L2_msg_getNackSrc(frame) == myL2ID)
+        {
+            debug_if(DBGMSG_L2, "[L2] NACK from %i : broadcast frames from %i on are missing\n", srcId, L2_msg_getSeq(frame));
+            L2_rbc_onNack(&rbcCtx, nowMs, L2_msg_getSeq(frame));
+        }
+        else
+            L2_rbc_onPeerNack(&rbcCtx, nowMs, L2_msg_getNackSrc(frame), L2_msg_getSeq(frame));
+    }
+    else if (L2_RBC_ENABLE && frame[L2_MSG_OFFSET_TYPE] == L2_MSG_TYPE_SYNC)
+    {
+        if (L2_rbc_onSync(&rbcCtx, nowMs, srcId, L2_msg_getSeq(frame), L2_msg_getSyncOldest(frame)))
+            L2_dropRxAggPdu();
+    }
+    else if (frame[L2_MSG_OFFSET_TYPE] == L2_MSG_TYPE_PROBE && L2_msg_getProbeIsReply(frame) == 0)
+    {
+        L2_link_onProbe(&linkCtx, srcId, nowMs);
+    }
+    PDUbuf_free(rxPdu);
+}
+
+//sends the PROBE or probe reply the link liveness asks for : 1 if a frame went out
+static uint8_t L2_sendProbe(void)
+{
+    uint8_t peerId;
+    uint8_t kind;
+
+    if (L2_LINK_DETECTTIME == 0 || (kind = L2_link_getTx(&linkCtx, L2_LLI_getTimeMs(), &peerId)) == L2_LINK_NONE)
         return 0;
+
+    debug_if(DBGMSG_L2, "[L2] probing the link to %i%s\n", peerId, (kind == L2_LINK_REPLY) ? " (reply)" : "");
+    L2_LLI_sendData(ctrlFrame, L2_crc_append(ctrlFrame, L2_msg_encodeProbe(ctrlFrame, kind == L2_LINK_REPLY)), peerId);
+    ctrlTxBusy = 1;
+
+    return 1;
+}
+
+//sends what the reliable broadcast (repair, NACK or SYNC) or the link liveness (PROBE) asks for :
+//1 if a frame went out
+static uint8_t L2_sendCtrlFrame(void)
+{
+    L2_rbcTx_t tx;
+    uint8_t size;
+
+    if (L2_RBC_ENABLE == 0 || L2_rbc_getTx(&rbcCtx, L2_LLI_getTimeMs(), &tx) == L2_RBC_TX_NONE)
+        return L2_sendProbe();
+
+    switch (tx.kind)
+    {
+        case L2_RBC_TX_REPAIR:
+            memcpy(ctrlFrame, tx.frame, tx.size);
+            size = tx.size;
+            debug_if(DBGMSG_L2, "[L2] repairing broadcast frame %i\n", tx.seq);
+            break;
+        case L2_RBC_TX_NACK:
+            size = L2_msg_encodeNack(ctrlFrame, tx.seq, tx.srcId);
+            debug_if(DBGMSG_L2, "[L2] NACK to %i : frames from %i on are missing\n", tx.srcId, tx.seq);
+            break;
+        case L2_RBC_TX_SYNC:
+            size = L2_msg_encodeSync(ctrlFrame, tx.seq, tx.oldest);
+            break;
+        default: //L2_RBC_TX_SKIP
+            L2_dropRxAggPdu();
+            return L2_sendProbe();
     }
 
+    L2_LLI_sendData(ctrlFrame, L2_crc_append(ctrlFrame, size), L2_BROADCAST_ID);
+    ctrlTxBusy = 1;
+
     return 1;
 }
 
+//reports the links gone down or back up to L3 : what waits for a lost peer is given up at once
+static void L2_checkLinks(void)
+{
+    uint8_t peerId;
+    uint32_t ms;
+    uint8_t res = L2_link_poll(&linkCtx, L2_LLI_getTimeMs(), &peerId, &ms);
+
+    if (res == L2_LINK_DOWN)
+    {
+        L2_peer_t* peer = L2_peer_find(&peerTbl, peerId);
+
+        debug("[L2][WARNING] link to %i is down (nothing heard for %lu ms)\n", peerId, (unsigned long)ms);
+        L3_LLI_linkInd(peerId, 0, ms);
+        if (peer != NULL)
+            L2_failPeer(peer);
+    }
+    else if (res == L2_LINK_UP)
+    {
+        debug("[L2] link to %i is up again (down for %lu ms)\n", peerId, (unsigned long)ms);
+        L3_LLI_linkInd(peerId, 1, ms);
+    }
+}
+
 
 void L2_FSMrun(void)
 {
@@ -168,11 +972,49 @@ void L2_FSMrun(void)
         prev_state = main_state;
     }
 
+    //frame received while the previous one was still held
+    L2_LLI_nextRcvdPdu();
+
+    //channel access of the frame waiting for a free channel (in any state)
+    if (L2_event_checkEventFlag(L2_event_backoffDone))
+    {
+        L2_event_clearEventFlag(L2_event_backoffDone);
+        L2_LLI_accessChannel();
+    }
+
+    //NACK / SYNC / PROBE (in any state : they only update the broadcast or liveness state)
+    if (L2_event_checkEventFlag(L2_event_ctrlRcvd))
+    {
+        L2_event_clearEventFlag(L2_event_ctrlRcvd);
+        L2_receiveCtrl();
+    }
+
+#ifndef DISABLE_ARQ
+    //ACK (in any state : it only ends the wait of its peer, whose frame is not on air)
+    if (L2_event_checkEventFlag(L2_event_ackRcvd))
+    {
+        L2_event_clearEventFlag(L2_event_ackRcvd);
+        L2_receiveAck();
+    }
+#endif
+
+    //link liveness (in any state)
+    if (L2_LINK_DETECTTIME > 0)
+        L2_checkLinks();
+
+    //next sub-frame of an aggregated frame, once L3 has taken the previous one (in any state)
+    if (aggRxPdu != PDUBUF_INVALID && L3_LLI_isRxFree())
+        L2_deliverAggSub();
+
     //FSM should be implemented here! ---->>>>
     switch (main_state)
     {
         case L2STATE_IDLE: //IDLE state description
-            
+        {
+#ifndef DISABLE_ARQ
+            L2_peer_t* peer;
+#endif
+
             if (L2_event_checkEventFlag(L2_event_reconfigSrcId)) //if src id reconfiguration is requested
             {
                 int res;
@@ -184,82 +1026,142 @@ void L2_FSMrun(void)
             }
             else if (L2_event_checkEventFlag(L2_event_dataRcvd)) //if data reception event happens
             {
-                //Retrieving data info.
+                L2_receiveData(); //goes to TX state if an ACK is sent
+                L2_event_clearEventFlag(L2_event_dataRcvd);
+            }
 #ifndef DISABLE_ARQ
-                uint8_t srcId = L2_LLI_getSrcId();
+            else if (L2_event_checkEventFlag(L2_event_dataCorrupt)) //data frame damaged on its way
+            {
+                L2_event_clearEventFlag(L2_event_dataCorrupt);
+                if ((peer = L2_peer_find(&peerTbl, L2_LLI_getCorruptSrcId())) != NULL && peer->rxSynced)
+                {
+                    debug_if(DBGMSG_L2, "[L2] damaged data frame from %i, NACKing PDU %i\n", peer->id, peer->rxSeq);
+                    L2_sendNack(peer->id, peer->rxSeq); //goes to TX state
+                }
+            }
 #endif
-                uint8_t* dataPtr = L2_LLI_getRcvdDataPtr();
-                uint8_t size = L2_LLI_getSize();
-                uint8_t brflag = L2_LLI_getIsBroadcasted();
-                uint8_t flag_end = L2_msg_checkIfEndData(dataPtr);
-
-                //L3_LLI_dataInd(L2_msg_getWord(dataPtr), srcId, size-L2_MSG_OFFSET_DATA, L2_LLI_getSnr(), L2_LLI_getRssi());
 #ifndef DISABLE_ARQ
-            if (brflag)
+            else if (fecAckPending && (int32_t)(L2_LLI_getTimeMs() - fecAckAtMs) >= 0) //FEC block rebuilt before its last frame
             {
-                L2_aggregateData(dataPtr, srcId, size, brflag, flag_end);
+                fecAckPending = 0;
+                if ((peer = L2_peer_find(&peerTbl, fecAckSrc)) != NULL)
+                {
+                    debug_if(DBGMSG_L2, "[L2] FEC block %i from %i rebuilt before its last frame, ACKing it\n", fecAckSeq, fecAckSrc);
+                    L2_ackPdu(peer, fecAckSeq); //goes to TX state
+                }
             }
-            else
+            else if (L2_peer_inAckGuard(&peerTbl, L2_LLI_getTimeMs()))
+            {
+                //the channel is left to the ACK of the frame just sent : nothing else goes out meanwhile
+            }
+            else if ((peer = L2_peer_getExpired(&peerTbl, L2_LLI_getTimeMs())) != NULL) //ARQ timeout of a peer
             {
-                if (seqNum != L2_msg_getSeq(dataPtr))
+                L2_peer_stopWait(peer);
+                if (peer->retxCnt >= arqMaxRetx || L2_link_isUp(&linkCtx, peer->id) == 0)
                 {
-                    debug("[L3][WARNING] Invalid PDU SN (%i) while (%i) is required! discarding it...\n", L2_msg_getSeq(dataPtr), seqNum);
-                    break; // 💥 여기가 핵심! PDU 무시하고 상태 종료
+                    debug("[L2][WARNING] Failed to send data %i to %i, %s! \n", L2_getTxSeq(peer), peer->id,
+                          (peer->retxCnt >= arqMaxRetx) ? "max retx cnt reached" : "link is down");
+                    L2_completePdu(peer, 0); //the rest of the SDU is dropped as well
+                }
+                else //retx < max, then goto TX for retransmission
+                {
+                    if (peer->nacked)
+                    {
+                        debug_if(DBGMSG_L2, "[L2] NACKed! retransmit to %i\n", peer->id);
+                        peerTbl.stats.nackRetx++;
+                    }
+                    else
+                    {
+                        debug_if(DBGMSG_L2, "[L2] timeout! retransmit to %i\n", peer->id);
+                        L2_rate_onTimeout(peer->id);
+                        L2_LLI_noteNoAck();
+                    }
+                    if (peer->fecTxNum > 0) //not rebuilt at the receiver : the whole block again
+                    {
+                        peer->fecTxIdx = 0;
+                        L2_sendFecFrame(peer);
+                    }
+                    else
+                        L2_LLI_sendData(peer->arqPdu, peer->pduSize + L2_CRC_LEN, peer->id);
+                    //Setting ARQ parameter 
+                    peer->retxCnt += 1;
+                    txPeer = peer;
+                    main_state = L2STATE_TX;
                 }
-                L2_aggregateData(dataPtr, srcId, size, brflag, flag_end);
             }
-#else
-            L2_aggregateData(dataPtr, srcId, size, brflag, flag_end);
 #endif
+            else if (L2_sendCtrlFrame()) //reliable broadcast repair, NACK, SYNC or PROBE (before new data)
+            {
+                main_state = L2STATE_TX;
+            }
+            else if (L2_event_checkEventFlag(L2_event_dataToSend)) //if data needs to be sent (keyboard input)
+            {
+                //next peer with data and no ACK to wait for : a peer slow to answer does not hold back the others
+                L2_dispatchTxQueue();
+                if ((txPeer = L2_peer_next(&peerTbl, L2_LLI_getTimeMs())) == NULL)
+                {
+                    //a peer held for aggregation has its SDUs sent once its hold is over
+                    if (L2_peer_anyHeld(&peerTbl) == 0)
+                        L2_event_clearEventFlag(L2_event_dataToSend);
+                    break;
+                }
 
+                if (txPeer->txSdu == PDUBUF_INVALID)
+                {
+                    txPeer->txSdu = L2_peer_dequeue(txPeer);
+                    if (txPeer->id != L2_BROADCAST_ID)
+                        L2_link_watch(&linkCtx, txPeer->id, L2_LLI_getTimeMs());
 
-#ifdef DISABLE_ARQ
-                main_state = L2STATE_IDLE;
-#else
-                if (brflag)
+                    //SDUs that do not fit in one frame go as one FEC block
+                    if (L2_FEC_GROUPSIZE > 0 && PDUbuf_getLen(txPeer->txSdu) > L2_MSG_MAXDATASIZE - L2_CRC_LEN)
+                    {
+                        uint8_t numData = L2_fec_getNumData(PDUbuf_getLen(txPeer->txSdu), L2_FEC_FRAGSIZE);
+                        txPeer->fecTxNum = numData + L2_fec_getNumParity(numData);
+                    }
+                    else if (L2_AGG_ENABLE && txPeer->id != L2_BROADCAST_ID)
+                        L2_packTxSdu(txPeer);
+                }
+
+                //the peer is known to be unreachable : the SDU fails at once
+                if (txPeer->id != L2_BROADCAST_ID && L2_link_isUp(&linkCtx, txPeer->id) == 0)
                 {
-                    main_state = L2STATE_IDLE;
+                    debug("[L2][WARNING] link to %i is down, dropping the SDU\n", txPeer->id);
+                    txPeer->fecTxNum = 0;
+                    L2_confirmTxSdu(txPeer, 0);
+                    break;
+                }
+
+                if (txPeer->fecTxNum > 0)
+                {
+                    txPeer->fecTxIdx = 0;
+                    txPeer->fecTxSeq = (txPeer->id == L2_BROADCAST_ID) ? fecBrSeq++ : txPeer->txSeq;
+                    L2_sendFecFrame(txPeer);
                 }
                 else
                 {
-                    //ACK transmission
-                    if (brflag == 0 && seqNum == L2_msg_getSeq(dataPtr))
-                        seqNum = (seqNum + 1)%L2_MSSG_MAX_SEQNUM;
-                    L2_msg_encodeAck(arqAck, L2_msg_getSeq(dataPtr));
-                    L2_LLI_sendData(arqAck, L2_MSG_ACKSIZE, srcId);
-
-                    main_state = L2STATE_TX; //goto TX state
+                    //msg header setting (in place, in front of the next fragment)
+                    if (L2_RBC_ENABLE && txPeer->id == L2_BROADCAST_ID)
+                    {
+                        txPeer->pduSize = L2_encodeNextPdu(txPeer, L2_rbc_nextTxSeq(&rbcCtx));
+                        L2_rbc_storeTx(&rbcCtx, L2_LLI_getTimeMs(), txPeer->arqPdu, txPeer->pduSize, L2_msg_getSeq(txPeer->arqPdu));
+                    }
+                    else
+                        txPeer->pduSize = L2_encodeNextPdu(txPeer, txPeer->txSeq);
+                    L2_LLI_sendData(txPeer->arqPdu, txPeer->pduSize + L2_CRC_LEN, txPeer->id);
                 }
-#endif
-                L2_event_clearEventFlag(L2_event_dataRcvd);
-            }
-            else if (L2_event_checkEventFlag(L2_event_dataToSend)) //if data needs to be sent (keyboard input)
-            {
-                //msg header setting
-                pduSize = L2_msg_encodeData(arqPdu, sduIn, seqNum, sduLen, L2_event_checkEventFlag(L2_event_dataToSendBuffer) == 0);
-                L2_LLI_sendData(arqPdu, pduSize, destL2ID);
 
 #ifndef DISABLE_ARQ
                 //Setting ARQ parameter 
-                if (destL2ID != L2_BROADCAST_ID)
-                    seqNum = (seqNum + 1)%L2_MSSG_MAX_SEQNUM;
-                retxCnt = 0;
+                if (txPeer->id != L2_BROADCAST_ID)
+                    txPeer->txSeq = L2_seq_next(txPeer->txSeq);
+                txPeer->retxCnt = 0;
 #endif
-                debug_if(DBGMSG_L2, "[L2] sending to %i (seq:%i)\n", destL2ID, (seqNum-1)%L2_MSSG_MAX_SEQNUM);
+                debug_if(DBGMSG_L2, "[L2] sending to %i (seq:%i)\n", txPeer->id, L2_getTxSeq(txPeer));
 
                 main_state = L2STATE_TX;
-
-                L2_event_clearEventFlag(L2_event_dataToSend);
+                //dataToSend stays set : the other peers are served at the next pass
             }
-            else if (L2_event_checkEventFlag(L2_event_dataToSendBuffer))
-            {
-                L2_event_setEventFlag(L2_event_dataToSend);
-
-                if (L2_pullSduBuffer(L2_MSG_MAXDATASIZE) == 0)
-                    L2_event_clearEventFlag(L2_event_dataToSendBuffer);
-            }
-#ifndef DISABLE_ARQ
-            //ignore events (arqEvent_dataTxDone, arqEvent_ackTxDone, arqEvent_ackRcvd, arqEvent_arqTimeout)
+            //ignore events (arqEvent_dataTxDone, arqEvent_ackTxDone)
             else if (L2_event_checkEventFlag(L2_event_dataTxDone)) //if data needs to be sent (keyboard input)
             {
                 debug_if(DBGMSG_L2, "[L2][WARNING] cannot happen in IDLE state (event %i)\n", L2_event_dataTxDone);
@@ -270,155 +1172,53 @@ void L2_FSMrun(void)
                 debug_if(DBGMSG_L2, "[L2][WARNING] cannot happen in IDLE state (event %i)\n", L2_event_ackTxDone);
                 L2_event_clearEventFlag(L2_event_ackTxDone);
             }
-            else if (L2_event_checkEventFlag(L2_event_dataTxDone)) //if data needs to be sent (keyboard input)
-            {
-                debug_if(DBGMSG_L2, "[L2][WARNING] cannot happen in IDLE state (event %i)\n", L2_event_ackRcvd);
-                L2_event_clearEventFlag(L2_event_ackRcvd);
-            }
-            else if (L2_event_checkEventFlag(L2_event_arqTimeout)) //if data needs to be sent (keyboard input)
-            {
-                debug_if(DBGMSG_L2, "[WARNING] cannot happen in IDLE state (event %i)\n", L2_event_arqTimeout);
-                L2_event_clearEventFlag(L2_event_arqTimeout);
-            }   
-#endif
             break;
+        }
 
         case L2STATE_TX: //TX state description
 
-#ifndef DISABLE_ARQ
-            if (L2_event_checkEventFlag(L2_event_ackTxDone)) //data TX finished
+            //repair, NACK, SYNC or PROBE sent : nothing to wait for
+            if (ctrlTxBusy && (L2_event_checkEventFlag(L2_event_dataTxDone) || L2_event_checkEventFlag(L2_event_ackTxDone)))
             {
-                if (L2_timer_getTimerStatus() == 1 ||
-                    L2_event_checkEventFlag(L2_event_arqTimeout))
-                {
-                    main_state = L2STATE_ACK;
-                }
-                else
-                {
-                    main_state = L2STATE_IDLE;
-                }
-
+                ctrlTxBusy = 0;
+                main_state = L2STATE_IDLE;
+                L2_event_clearEventFlag(L2_event_dataTxDone);
                 L2_event_clearEventFlag(L2_event_ackTxDone);
+                break;
             }
-            else 
-#endif
+
+            if (L2_event_checkEventFlag(L2_event_ackTxDone)) //ACK TX finished
             {
-                if (L2_event_checkEventFlag(L2_event_dataTxDone)) //data TX finished
-                {
-#ifdef DISABLE_ARQ
-                    main_state = L2STATE_IDLE;
-                    L3_LLI_dataCnf(1);
-#else
-                    if (destL2ID == L2_BROADCAST_ID)
-                    {
-                        main_state = L2STATE_IDLE;
-                         L3_LLI_dataCnf(1);
-                    }
-                    else
-                    {
-                        main_state = L2STATE_ACK;
-                        L2_timer_startTimer(); //start ARQ timer for retransmission
-                    }
-#endif
-                    L2_event_clearEventFlag(L2_event_dataTxDone);
-                }
+                main_state = L2STATE_IDLE;
+                L2_event_clearEventFlag(L2_event_ackTxDone);
             }
-
-            break;
-
-#ifndef DISABLE_ARQ
-        case L2STATE_ACK: //ACK state description
-
-            if (L2_event_checkEventFlag(L2_event_ackRcvd)) //data TX finished
+            else if (L2_event_checkEventFlag(L2_event_dataTxDone)) //data TX finished
             {
-                uint8_t* dataPtr = L2_LLI_getRcvdDataPtr();
-                if ( L2_msg_getSeq(arqPdu) == L2_msg_getSeq(dataPtr) )
+                if (txPeer->fecTxNum > 0 && txPeer->fecTxIdx + 1 < txPeer->fecTxNum)
                 {
-                    debug_if(DBGMSG_L2, "[L2] ACK is correctly received! \n");
-                    L2_timer_stopTimer();
-                    main_state = L2STATE_IDLE;
-                    L3_LLI_dataCnf(1);
+                    //the frames of an FEC block go back to back, the block is ACKed once at the end
+                    txPeer->fecTxIdx++;
+                    L2_sendFecFrame(txPeer);
                 }
                 else
                 {
-                    debug_if(DBGMSG_L2, "[L2]ACK seq number is weird! (expected : %i, received : %i\n", L2_msg_getSeq(arqPdu),L2_msg_getSeq(dataPtr));
-                }
-
-                L2_event_clearEventFlag(L2_event_ackRcvd);
-            }
-            else if (L2_event_checkEventFlag(L2_event_arqTimeout)) //data TX finished
-            {
-                if (retxCnt >= L2_ARQ_MAXRETRANSMISSION)
-                {
-                    debug("[L2][WARNING] Failed to send data %i, max retx cnt reached! \n", L2_msg_getSeq(arqPdu));
                     main_state = L2STATE_IDLE;
-                    L3_LLI_dataCnf(0);
-                    //arqPdu clear
-                    //retxCnt clear
-                }
-                else //retx < max, then goto TX for retransmission
-                {
-                    debug_if(DBGMSG_L2, "[L2] timeout! retransmit\n");
-                    L2_LLI_sendData(arqPdu, pduSize, destL2ID);
-                    //Setting ARQ parameter 
-                    retxCnt += 1;
-                    main_state = L2STATE_TX;
-                }
-
-                L2_event_clearEventFlag(L2_event_arqTimeout);
-            }
-            else if (L2_event_checkEventFlag(L2_event_dataRcvd)) //data TX finished
-            {
-                //Retrieving data info.
-                uint8_t srcId = L2_LLI_getSrcId();
-                uint8_t* dataPtr = L2_LLI_getRcvdDataPtr();
-                uint8_t size = L2_LLI_getSize();
-                uint8_t brflag = L2_LLI_getIsBroadcasted();
-                uint8_t flag_end = L2_msg_checkIfEndData(dataPtr);
-
-                //L3_LLI_dataInd(L2_msg_getWord(dataPtr), srcId, size-L2_MSG_OFFSET_DATA, L2_LLI_getSnr(), L2_LLI_getRssi());
-#ifndef DISABLE_ARQ                
-                if (brflag == 0 && seqNum != L2_msg_getSeq(dataPtr))
-                    debug("[L3][WARNING] Invalid PDU SN (%i) while (%i) is required! discarding it...\n", L2_msg_getSeq(dataPtr), seqNum);
-                else
-#endif
-                    L2_aggregateData(dataPtr, srcId, size, brflag, flag_end);            
-
 #ifdef DISABLE_ARQ
-                main_state = L2STATE_IDLE;
+                    L2_completePdu(txPeer, 1);
 #else
-                if (brflag)
-                {
-                    main_state = L2STATE_IDLE;
-                }
-                else
-                {
-                    //ACK transmission
-                    if (brflag == 0 && seqNum == L2_msg_getSeq(dataPtr))
-                        seqNum = (seqNum + 1)%L2_MSSG_MAX_SEQNUM;
-                    L2_msg_encodeAck(arqAck, L2_msg_getSeq(dataPtr));
-                    L2_LLI_sendData(arqAck, L2_MSG_ACKSIZE, srcId);
-
-                    main_state = L2STATE_TX; //goto TX state
-                }
+                    if (txPeer->id == L2_BROADCAST_ID)
+                        L2_completePdu(txPeer, 1);
+                    else
+                        L2_peer_startWait(txPeer, L2_LLI_getTimeMs(), L2_getArqWaitMs()); //start ARQ timer for retransmission
 #endif
-                L2_event_clearEventFlag(L2_event_dataRcvd);
-            }
-            else if (L2_event_checkEventFlag(L2_event_dataTxDone)) //data TX finished
-            {
-                debug_if(DBGMSG_L2, "[L2][WARNING] cannot happen in ACK state (event %i)\n", L2_event_dataTxDone);
+                }
                 L2_event_clearEventFlag(L2_event_dataTxDone);
             }
-            else if (L2_event_checkEventFlag(L2_event_ackTxDone)) //data TX finished
-            {
-                debug_if(DBGMSG_L2, "[L2][WARNING] cannot happen in ACK state (event %i)\n", L2_event_ackTxDone);
-                L2_event_clearEventFlag(L2_event_ackTxDone);
-            }
 
             break;
-#endif
+
         default :
             break;
     }
 
-}
\ No newline at end of file
+}
@@ -1,2 +1,5 @@
 void L2_initFSM(uint8_t myId);
-void L2_FSMrun(void);
\ No newline at end of file
+void L2_FSMrun(void);
+void L2_setArqParams(uint8_t maxRetx, uint8_t minWait, uint8_t maxWait);
+void L2_getArqParams(uint8_t* maxRetx, uint8_t* minWait, uint8_t* maxWait);
+void L2_printStats(void);
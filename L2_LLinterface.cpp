@@ -2,56 +2,138 @@
 #include "PHYMAC_layer.h"
 #include "L2_FSMevent.h"
 #include "L2_msg.h"
+#include "L2_crc.h"
+#include "L2_rate.h"
+#include "L2_airtime.h"
+#include "L2_LLinterface.h"
+#include "PDUbuf.h"
+#include "MEMstat.h"
 #include "protocol_parameters.h"
 #include "time.h"
 
-#define L2_LLI_MAX_PDUSIZE          50
-#define L2_LLI_PKT_LOSS             0
+#define L2_LLI_CHANNEL_FREQ         922100000   //channel phymac programs (Hz)
+#define L2_LLI_RXQUEUE_SIZE         3           //frames received while the FSM still holds the previous one
 
+//lib/ HAL functions that have no header in this tree
+int HAL_cmd_Sleep(void);
+bool HAL_isSignalDetected(void);
+bool HAL_isRxOngoing(void);
+bool HW_IsChannelFree(unsigned long freq, short rssiThreshold);
+
+static uint8_t pktLoss = L2_LLI_PKT_LOSS;    //% of the received frames dropped (loss emulation)
 static uint8_t txType;
-static uint8_t rcvdData[L2_LLI_MAX_PDUSIZE];
+static uint8_t rcvdPdu = PDUBUF_INVALID;    //received frame, not yet taken by the FSM
 static uint8_t rcvdSrc;
 static uint8_t rcvdSize;
 static int16_t rcvdRssi;
 static int8_t rcvdSnr;
 static uint8_t isBroadcasted;
+static uint8_t corruptSrc;                  //sender of the last unicast data frame that failed the FCS check
 
-//interface event : DATA_CNF, TX done event
-void L2_LLI_dataCnfFunc(int err) 
+//frames received behind rcvdPdu : a burst of broadcasts (N-player game) arrives while the FSM waits for the
+//channel or its own TX, and only one of them could be held before
+typedef struct
+{
+    uint8_t pdu;
+    uint8_t src;
+    uint8_t size;
+    int16_t rssi;
+    int8_t snr;
+    uint8_t br;
+} L2_LLI_rxFrame_t;
+
+static L2_LLI_rxFrame_t rxQueue[L2_LLI_RXQUEUE_SIZE];
+static uint8_t rxHead = 0;
+static uint8_t rxLen = 0;
+static uint32_t rxQueueDrop = 0;
+
+//channel access : the frame to send waits here until the channel is found free (L2_CSMA_ENABLE)
+//and the duty-cycle budget allows it (L2_DUTYCYCLE_PERMILLE)
+static L2_csmaCtx_t csmaCtx;
+static Timeout accessTimer;
+static Timer airtimeClock;
+static uint8_t* pendingMsg;
+static uint8_t pendingSize;
+static uint8_t pendingDest;
+static uint8_t pendingTx = 0;
+
+static void L2_LLI_setTxDone(void)
 {
-    if (txType == L2_MSG_TYPE_DATA || txType == L2_MSG_TYPE_DATA_CONT)
+    if (txType == L2_MSG_TYPE_DATA || txType == L2_MSG_TYPE_DATA_CONT ||
+        txType == L2_MSG_TYPE_FEC || txType == L2_MSG_TYPE_AGG)
     {
         L2_event_setEventFlag(L2_event_dataTxDone);
     }
-    else if (txType == L2_MSG_TYPE_ACK)
+    else    //ACK, or control frame (NACK, SYNC, PROBE)
     {
         L2_event_setEventFlag(L2_event_ackTxDone);
     }
 }
 
+//interface event : DATA_CNF, TX done event
+void L2_LLI_dataCnfFunc(int err) 
+{
+    MEMstat_sampleIsrStack();
+    L2_LLI_setTxDone();
+}
+
 //interface event : DATA_IND, RX data has arrived
 void L2_LLI_dataIndFunc(uint8_t srcId, uint8_t* dataPtr, uint8_t size, uint8_t BR)
 {
+    MEMstat_sampleIsrStack();
     debug_if(DBGMSG_L2, "\n[L2]  --> DATA IND : src:%i, size:%i type : %i BR : %i\n", srcId, size, dataPtr[0], BR);
 
-    if ((float)rand()/RAND_MAX > L2_LLI_PKT_LOSS)
+    if (L2_crc_check(dataPtr, size) != 0)
     {
-        memcpy(rcvdData, dataPtr, size*sizeof(uint8_t));
-        rcvdSrc = srcId;
-        rcvdSize = size;
-        rcvdSnr = phymac_getDataSnr();
-        rcvdRssi = phymac_getDataRssi();
-        isBroadcasted = BR;
-
-        //ready for ACK TX
-        if (L2_msg_checkIfData(dataPtr))
+        debug_if(DBGMSG_L2, "\n[L2][WARNING] FCS mismatch (src:%i, size:%i), dropping the frame\n", srcId, size);
+        //longer than an ACK or control frame : a data frame of srcId to NACK (the PHY header is intact)
+        if (BR == 0 && size > L2_MSG_CTRLSIZE + L2_CRC_LEN)
         {
-            L2_event_setEventFlag(L2_event_dataRcvd);
+            corruptSrc = srcId;
+            L2_event_setEventFlag(L2_event_dataCorrupt);
         }
-        else if (L2_msg_checkIfAck(dataPtr))
+        return;
+    }
+    size -= L2_CRC_LEN;
+
+    if (pktLoss == 0 || rand() % 100 >= pktLoss)
+    {
+        L2_LLI_rxFrame_t* frame;
+        uint8_t pdu;
+
+        if (rxLen == L2_LLI_RXQUEUE_SIZE)
         {
-            L2_event_setEventFlag(L2_event_ackRcvd);
+            debug_if(DBGMSG_L2, "\n[L2][WARNING] RX queue full (src:%i, size:%i), dropping the frame\n", srcId, size);
+            rxQueueDrop++;
+            return;
         }
+
+        //the only copy on RX : PHY buffer -> pool block (later handed up to L3 as is)
+        pdu = PDUbuf_alloc();
+        if (pdu == PDUBUF_INVALID || PDUbuf_put(pdu, dataPtr, size) != 0)
+        {
+            debug_if(DBGMSG_L2, "\n[L2][WARNING] no PDU buffer for RX (size:%i), dropping it\n", size);
+            PDUbuf_free(pdu);
+            return;
+        }
+        frame = &rxQueue[(rxHead + rxLen) % L2_LLI_RXQUEUE_SIZE];
+        frame->pdu = pdu;
+        frame->src = srcId;
+        frame->size = size;
+        frame->snr = phymac_getDataSnr();
+        frame->rssi = phymac_getDataRssi();
+        frame->br = BR;
+        rxLen++;
+
+        L2_rate_updateSnr(srcId, frame->snr);
+        //sent at the rate advised to that peer (rate 0 if it was not advised any)
+        L2_airtime_noteRx(srcId, L2_rate_getToaUs(L2_rate_getAdvice(srcId) == L2_RATE_NONE ? 0 : L2_rate_getAdvice(srcId),
+                                                  size + L2_CRC_LEN + L2_AIRTIME_PHYHDR));
+        if (L2_msg_checkIfAck(dataPtr))
+            L2_rate_setAdvised(srcId, L2_msg_getAckRate(dataPtr));
+
+        //handed to the FSM at once if it holds no frame
+        L2_LLI_nextRcvdPdu();
     }
     else
     {
@@ -64,16 +146,137 @@ void L2_LLI_initLowLayer(uint8_t srcId)
 {
     srand(time(NULL));
     phymac_init(srcId, L2_LLI_dataCnfFunc, L2_LLI_dataIndFunc);
+    L2_csma_init(&csmaCtx);
+    L2_airtime_init();
+    airtimeClock.start();
 }
 
 
+//timer event : backoff or duty-cycle deferral over, channel access is tried again
+void L2_LLI_accessTimeoutHandler(void)
+{
+    MEMstat_sampleIsrStack();
+    L2_event_setEventFlag(L2_event_backoffDone);
+}
+
+//1 if nothing is heard on the channel
+static uint8_t L2_LLI_senseChannel(void)
+{
+    //a frame is coming in : sensing would abort its reception
+    if (HAL_isSignalDetected() || HAL_isRxOngoing())
+        return 0;
+
+    if (HW_IsChannelFree(L2_LLI_CHANNEL_FREQ, L2_CSMA_RSSI_THRESHOLD))
+        return 1;
+
+    //the sensing leaves the radio asleep : back to RX as phymac does after a TX
+    HAL_cmd_Sleep();
+    phymac_startRx();
+    return 0;
+}
+
+//the pending frame goes on air if the duty-cycle budget has room for it, otherwise it is deferred
+static void L2_LLI_transmit(void)
+{
+    uint8_t rate = L2_rate_selectTx(pendingDest); //applied when phymac programs the TX configuration
+    uint32_t toaUs = L2_rate_getToaUs(rate, pendingSize + L2_AIRTIME_PHYHDR);
+    uint32_t nowMs = (uint32_t)airtimeClock.read_ms();
+    uint32_t waitMs;
+
+    waitMs = L2_airtime_getWaitMs(nowMs, toaUs, txType == L2_MSG_TYPE_ACK);
+    if (waitMs > 0)
+    {
+        waitMs += rand() % L2_AIRTIME_JITTER_MS;
+        debug_if(DBGMSG_L2, "[L2] duty-cycle budget used up : type %i to %i deferred by %lu ms\n",
+                 pendingMsg[L2_MSG_OFFSET_TYPE], pendingDest, (unsigned long)waitMs);
+        accessTimer.attach_us(L2_LLI_accessTimeoutHandler, waitMs * 1000);
+        return;
+    }
+
+    core_util_critical_section_enter();
+    L2_airtime_noteTx(nowMs, pendingDest, toaUs);
+    core_util_critical_section_exit();
+
+    pendingTx = 0;
+    phymac_dataReq(pendingMsg, pendingSize, pendingDest);
+}
 
+//channel access of the pending frame, called by the L2 FSM when the backoff or deferral is over
+void L2_LLI_accessChannel(void)
+{
+    uint32_t delayUs;
+    int res;
+
+    if (pendingTx == 0)
+        return;
+    if (L2_CSMA_ENABLE == 0)
+    {
+        L2_LLI_transmit();
+        return;
+    }
+
+    res = L2_csma_onCca(&csmaCtx, L2_LLI_senseChannel(), &delayUs);
+    if (res == L2_CSMA_SEND)
+    {
+        L2_LLI_transmit();
+    }
+    else if (res == L2_CSMA_BACKOFF)
+    {
+        accessTimer.attach_us(L2_LLI_accessTimeoutHandler, delayUs);
+    }
+    else
+    {
+        //given up : handled as a frame lost on air (ARQ retransmits it, the peer retransmits for an ACK)
+        debug_if(DBGMSG_L2, "[L2][WARNING] channel access failure (type %i to %i)\n", pendingMsg[L2_MSG_OFFSET_TYPE], pendingDest);
+        pendingTx = 0;
+        L2_LLI_setTxDone();
+    }
+}
 
 //TX function
 void L2_LLI_sendData(uint8_t* msg, uint8_t size, uint8_t dest)
 {
-    phymac_dataReq(msg, size, dest);
     txType = msg[L2_MSG_OFFSET_TYPE];
+
+    if (pendingTx)
+        debug("[L2][WARNING] frame to %i replaced while waiting for channel access\n", pendingDest);
+    pendingMsg = msg;
+    pendingSize = size;
+    pendingDest = dest;
+    pendingTx = 1;
+
+    if (L2_CSMA_ENABLE)
+        accessTimer.attach_us(L2_LLI_accessTimeoutHandler, L2_csma_start(&csmaCtx, txType == L2_MSG_TYPE_ACK));
+    else
+        L2_LLI_transmit();
+}
+
+//the last data frame was not ACKed in time
+void L2_LLI_noteNoAck(void)
+{
+    L2_csma_noteNoAck(&csmaCtx);
+}
+
+void L2_LLI_getCsmaStats(L2_csmaStats_t* stats)
+{
+    *stats = csmaCtx.stats;
+}
+
+void L2_LLI_setPktLoss(uint8_t percent)
+{
+    pktLoss = percent;
+}
+
+uint8_t L2_LLI_getPktLoss(void)
+{
+    return pktLoss;
+}
+
+
+//ms since the start of L2 (wraps after 49 days)
+uint32_t L2_LLI_getTimeMs(void)
+{
+    return (uint32_t)airtimeClock.read_ms();
 }
 
 
@@ -92,9 +295,61 @@ uint8_t L2_LLI_getSrcId()
     return rcvdSrc;
 }
 
-uint8_t* L2_LLI_getRcvdDataPtr()
+uint8_t L2_LLI_getCorruptSrcId(void)
+{
+    return corruptSrc;
+}
+
+//the next queued frame becomes the received one once the FSM has taken the previous one
+//(its event is raised then, and the GET functions describe it from then on)
+void L2_LLI_nextRcvdPdu(void)
+{
+    core_util_critical_section_enter();
+    while (rcvdPdu == PDUBUF_INVALID && rxLen > 0)
+    {
+        L2_LLI_rxFrame_t* frame = &rxQueue[rxHead];
+        uint8_t* data = PDUbuf_getData(frame->pdu);
+
+        rxHead = (rxHead + 1) % L2_LLI_RXQUEUE_SIZE;
+        rxLen--;
+
+        if (L2_msg_checkIfData(data))
+            L2_event_setEventFlag(L2_event_dataRcvd);
+        else if (L2_msg_checkIfAck(data))
+            L2_event_setEventFlag(L2_event_ackRcvd);
+        else if (L2_msg_checkIfCtrl(data))
+            L2_event_setEventFlag(L2_event_ctrlRcvd);
+        else
+        {
+            PDUbuf_free(frame->pdu);    //no FSM event would ever take it
+            continue;
+        }
+        rcvdPdu = frame->pdu;
+        rcvdSrc = frame->src;
+        rcvdSize = frame->size;
+        rcvdSnr = frame->snr;
+        rcvdRssi = frame->rssi;
+        isBroadcasted = frame->br;
+    }
+    core_util_critical_section_exit();
+}
+
+uint32_t L2_LLI_getRxQueueDrop(void)
 {
-    return rcvdData;
+    return rxQueueDrop;
+}
+
+//hands the received frame buffer over to the caller (who has to release it)
+uint8_t L2_LLI_takeRcvdPdu()
+{
+    uint8_t pdu;
+
+    core_util_critical_section_enter();
+    pdu = rcvdPdu;
+    rcvdPdu = PDUBUF_INVALID;
+    core_util_critical_section_exit();
+
+    return pdu;
 }
 
 uint8_t L2_LLI_getSize()
@@ -1,8 +1,19 @@
+#include "L2_csma.h"
+
 void L2_LLI_initLowLayer(uint8_t srcId);
 void L2_LLI_sendData(uint8_t* msg, uint8_t size, uint8_t dest);
+void L2_LLI_accessChannel(void);
+void L2_LLI_noteNoAck(void);
+void L2_LLI_getCsmaStats(L2_csmaStats_t* stats);
+void L2_LLI_setPktLoss(uint8_t percent);
+uint8_t L2_LLI_getPktLoss(void);
+uint32_t L2_LLI_getTimeMs(void);
 int L2_LLI_configSrcId(uint8_t);
 uint8_t L2_LLI_getSrcId();
-uint8_t* L2_LLI_getRcvdDataPtr();
+uint8_t L2_LLI_getCorruptSrcId(void);
+void L2_LLI_nextRcvdPdu(void);
+uint32_t L2_LLI_getRxQueueDrop(void);
+uint8_t L2_LLI_takeRcvdPdu();
 uint8_t L2_LLI_getSize();
 int16_t L2_LLI_getRssi(void);
 int8_t L2_LLI_getSnr(void);
@@ -0,0 +1,52 @@
+#include <string.h>
+#include "L2_agg.h"
+
+//sub-frame packing of the aggregated frames
+//No mbed dependency, so the host model (tools/aggsim.cpp) runs the same code.
+
+
+//1 if an SDU of sduLen bytes still fits behind aggLen bytes of sub-frames (maxLen : data size of a frame)
+uint8_t L2_agg_fits(uint8_t aggLen, uint8_t sduLen, uint8_t maxLen)
+{
+    return (sduLen > 0 && aggLen + L2_AGG_SUBHDR + sduLen <= maxLen);
+}
+
+//appends the SDU as a sub-frame behind aggLen bytes of the payload and returns the new length
+uint8_t L2_agg_put(uint8_t* payload, uint8_t aggLen, const uint8_t* sdu, uint8_t sduLen)
+{
+    payload[aggLen] = sduLen;
+    memmove(payload + aggLen + L2_AGG_SUBHDR, sdu, sduLen);
+
+    return (uint8_t)(aggLen + L2_AGG_SUBHDR + sduLen);
+}
+
+//sub-frames in a payload of len bytes, 0 if it is malformed (empty sub-frame or one running past the end)
+uint8_t L2_agg_count(const uint8_t* payload, uint8_t len)
+{
+    uint8_t pos = 0;
+    uint8_t cnt = 0;
+    uint8_t subLen;
+    int off;
+
+    while ((off = L2_agg_next(payload, len, &pos, &subLen)) >= 0)
+        cnt++;
+
+    return (off == -1) ? cnt : 0;
+}
+
+//walks the sub-frames from pos (0 at first) : offset of the next one in the payload with its length,
+//-1 at the end of the payload, -2 if it is malformed
+int L2_agg_next(const uint8_t* payload, uint8_t len, uint8_t* pos, uint8_t* subLen)
+{
+    int off;
+
+    if (*pos >= len)
+        return -1;
+    *subLen = payload[*pos];
+    off = *pos + L2_AGG_SUBHDR;
+    if (*subLen == 0 || off + *subLen > len)
+        return -2;
+    *pos = (uint8_t)(off + *subLen);
+
+    return off;
+}
@@ -0,0 +1,15 @@
+#include <stdint.h>
+#include "protocol_parameters.h"
+
+//frame aggregation (L2_AGG_ENABLE in protocol_parameters.h)
+//small SDUs queued for the same unicast peer go out in one AGG frame, one sequence number and one
+//ACK for all of them : the payload is a run of sub-frames, each one its length byte then its bytes,
+//up to the data size of a frame. The receiver hands each sub-frame to L3 as an SDU of its own.
+//A lone SDU may wait up to L2_AGG_DELAYMS for others to the same peer (not the reassembly of the
+//fragments of a long SDU, which L2_aggregateData does).
+#define L2_AGG_SUBHDR           1       //length byte in front of each sub-frame
+
+uint8_t L2_agg_fits(uint8_t aggLen, uint8_t sduLen, uint8_t maxLen);
+uint8_t L2_agg_put(uint8_t* payload, uint8_t aggLen, const uint8_t* sdu, uint8_t sduLen);
+uint8_t L2_agg_count(const uint8_t* payload, uint8_t len);
+int L2_agg_next(const uint8_t* payload, uint8_t len, uint8_t* pos, uint8_t* subLen);
@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <string.h>
+#include "L2_airtime.h"
+
+//airtime accounting and duty-cycle budget
+//No mbed dependency : the caller gives the time (ms), so the host models can run it too.
+
+#define L2_AIRTIME_BUCKET_MS    ((uint32_t)L2_DUTYCYCLE_WINDOW * 1000 / L2_AIRTIME_NUMBUCKETS)
+#define L2_AIRTIME_BUDGET_US    ((uint32_t)L2_DUTYCYCLE_WINDOW * 1000 * L2_DUTYCYCLE_PERMILLE)
+
+#if L2_DUTYCYCLE_PERMILLE > 1000 || L2_DUTYCYCLE_WINDOW > 3600
+#error "L2_DUTYCYCLE_PERMILLE must be 0 .. 1000 and L2_DUTYCYCLE_WINDOW at most 3600 s"
+#endif
+
+static uint32_t bucketUs[L2_AIRTIME_NUMBUCKETS];    //airtime sent in each bucket of the window
+static uint32_t curBucket = 0;                      //number (time / bucket length) of the newest bucket
+static uint32_t windowUs = 0;                       //sum of bucketUs
+static L2_airtimeNode_t nodes[L2_AIRTIME_MAXNODES];
+static uint8_t nextVictim = 0;
+static uint32_t deliveredBytes = 0;                 //payload of the SDU parts delivered (ACKed or broadcasted)
+static uint32_t deferCnt = 0;
+
+
+//LoRa time on air (Semtech AN1200.13) of a PHY payload of phySize bytes, explicit header and CRC on
+//(HAL enum values : bw 0/1/2 = 125/250/500 kHz, cr 1..4 = 4/5..4/8)
+uint32_t L2_airtime_getToaUs(uint8_t sf, uint8_t bw, uint8_t cr, uint8_t preambleLen, uint8_t phySize)
+{
+    uint32_t symUs = ((uint32_t)1000 << sf) / (125 << bw);
+    uint8_t lowDr = (bw == 0 && sf >= 11) || (bw == 1 && sf == 12);
+    int32_t num = 8 * phySize - 4 * sf + 28 + 16;
+    int32_t den = 4 * (sf - 2 * lowDr);
+    int32_t numPayload = 8;
+
+    if (num > 0)
+        numPayload += (num + den - 1) / den * (cr + 4);
+
+    return ((preambleLen * 4 + 17) + numPayload * 4) * symUs / 4;
+}
+
+
+void L2_airtime_init(void)
+{
+    memset(bucketUs, 0, sizeof(bucketUs));
+    memset(nodes, 0, sizeof(nodes));
+    curBucket = 0;
+    windowUs = 0;
+    nextVictim = 0;
+    deliveredBytes = 0;
+    deferCnt = 0;
+}
+
+//moves the window to nowMs : the buckets that left it are emptied
+static void L2_airtime_slide(uint32_t nowMs)
+{
+    uint32_t bucket = nowMs / L2_AIRTIME_BUCKET_MS;
+    uint32_t n;
+
+    for (n = 0; curBucket != bucket && n < L2_AIRTIME_NUMBUCKETS; n++)
+    {
+        curBucket++;
+        windowUs -= bucketUs[curBucket % L2_AIRTIME_NUMBUCKETS];
+        bucketUs[curBucket % L2_AIRTIME_NUMBUCKETS] = 0;
+    }
+    curBucket = bucket;
+}
+
+//0 if a frame of toaUs may be sent now, otherwise the time (ms) to wait before asking again
+uint32_t L2_airtime_getWaitMs(uint32_t nowMs, uint32_t toaUs, uint8_t isAck)
+{
+    uint32_t limit = L2_AIRTIME_BUDGET_US;
+    uint32_t used, k;
+
+    if (L2_DUTYCYCLE_PERMILLE == 0)
+        return 0;
+
+    if (isAck == 0)
+        limit -= limit / 100 * L2_DUTYCYCLE_ACKRESERVE;
+
+    //a frame longer than the whole budget still goes when the window is empty
+    L2_airtime_slide(nowMs);
+    if (windowUs + toaUs <= limit || windowUs == 0)
+        return 0;
+
+    deferCnt++;
+    //the oldest buckets leave the window first
+    used = windowUs;
+    for (k = 1; k < L2_AIRTIME_NUMBUCKETS; k++)
+    {
+        used -= bucketUs[(curBucket + k) % L2_AIRTIME_NUMBUCKETS];
+        if (used + toaUs <= limit)
+            break;
+    }
+    k = (curBucket + k) * L2_AIRTIME_BUCKET_MS - nowMs;
+
+    return (k < L2_AIRTIME_MAXWAIT_MS) ? k : L2_AIRTIME_MAXWAIT_MS;
+}
+
+static L2_airtimeNode_t* L2_airtime_getNodeById(uint8_t id)
+{
+    L2_airtimeNode_t* n = NULL;
+    uint8_t i;
+
+    for (i = 0; i < L2_AIRTIME_MAXNODES; i++)
+    {
+        if (nodes[i].valid && nodes[i].id == id)
+            return &nodes[i];
+        if (n == NULL && nodes[i].valid == 0)
+            n = &nodes[i];
+    }
+    if (n == NULL)
+    {
+        n = &nodes[nextVictim];
+        nextVictim = (nextVictim + 1) % L2_AIRTIME_MAXNODES;
+    }
+
+    memset(n, 0, sizeof(*n));
+    n->id = id;
+    n->valid = 1;
+
+    return n;
+}
+
+//a frame of toaUs goes on air now
+void L2_airtime_noteTx(uint32_t nowMs, uint8_t destId, uint32_t toaUs)
+{
+    L2_airtimeNode_t* n = L2_airtime_getNodeById(destId);
+
+    L2_airtime_slide(nowMs);
+    bucketUs[curBucket % L2_AIRTIME_NUMBUCKETS] += toaUs;
+    windowUs += toaUs;
+
+    n->txFrames++;
+    n->txUs += toaUs;
+}
+
+//may be called from interrupt context (DATA_IND)
+void L2_airtime_noteRx(uint8_t srcId, uint32_t toaUs)
+{
+    L2_airtimeNode_t* n = L2_airtime_getNodeById(srcId);
+
+    n->rxFrames++;
+    n->rxUs += toaUs;
+}
+
+void L2_airtime_noteDelivered(uint16_t bytes)
+{
+    deliveredBytes += bytes;
+}
+
+//airtime sent in the current window
+uint32_t L2_airtime_getWindowUs(void)
+{
+    return windowUs;
+}
+
+const L2_airtimeNode_t* L2_airtime_getNode(uint8_t idx)
+{
+    if (idx >= L2_AIRTIME_MAXNODES || nodes[idx].valid == 0)
+        return NULL;
+    return &nodes[idx];
+}
+
+void L2_airtime_printReport(void)
+{
+    uint64_t txUs = 0;
+    uint8_t i;
+
+    for (i = 0; i < L2_AIRTIME_MAXNODES; i++)
+    {
+        if (nodes[i].valid == 0)
+            continue;
+        txUs += nodes[i].txUs;
+        printf("[AIR] node %3i : TX %5lu frames %7lu ms, RX %5lu frames %7lu ms\n", nodes[i].id,
+               (unsigned long)nodes[i].txFrames, (unsigned long)(nodes[i].txUs / 1000),
+               (unsigned long)nodes[i].rxFrames, (unsigned long)(nodes[i].rxUs / 1000));
+    }
+    printf("[AIR] goodput %lu B/s of TX airtime (%lu B delivered)", (unsigned long)(txUs ? (uint64_t)deliveredBytes * 1000000 / txUs : 0),
+           (unsigned long)deliveredBytes);
+    if (L2_DUTYCYCLE_PERMILLE > 0)
+        printf(", duty cycle %lu/%lu ms in the last %i s, %lu deferrals", (unsigned long)(windowUs / 1000),
+               (unsigned long)(L2_AIRTIME_BUDGET_US / 1000), L2_DUTYCYCLE_WINDOW, (unsigned long)deferCnt);
+    printf("\n");
+}
@@ -0,0 +1,36 @@
+#include <stdint.h>
+#include "protocol_parameters.h"
+
+//LoRa time on air, airtime counters and duty-cycle budget (L2_DUTYCYCLE_PERMILLE in protocol_parameters.h)
+//the airtime of every transmitted frame is kept in a sliding window of L2_DUTYCYCLE_WINDOW seconds
+//(L2_AIRTIME_NUMBUCKETS buckets) : a frame that would take the window over the budget is deferred
+//until enough of the old airtime has left it. Data frames may not use the last
+//L2_DUTYCYCLE_ACKRESERVE % of the budget, kept for the ACKs the peers are waiting for.
+#define L2_AIRTIME_PHYHDR       4       //header phymac puts in front of the L2 frame
+#define L2_AIRTIME_PREAMBLELEN  8       //as programmed by phymac
+#define L2_AIRTIME_NUMBUCKETS   30
+#define L2_AIRTIME_MAXNODES     4       //nodes with their own airtime counters
+#define L2_AIRTIME_MAXWAIT_MS   60000   //longest deferral in one go (the budget is checked again after it)
+#define L2_AIRTIME_JITTER_MS    1000    //random extra deferral : nodes deferred to the same bucket end do not send together
+
+//airtime exchanged with one node
+typedef struct
+{
+    uint8_t id;
+    uint8_t valid;
+    uint32_t txFrames;      //frames sent to it (broadcasts are counted under ID 255)
+    uint32_t rxFrames;      //frames received from it
+    uint64_t txUs;
+    uint64_t rxUs;
+} L2_airtimeNode_t;
+
+uint32_t L2_airtime_getToaUs(uint8_t sf, uint8_t bw, uint8_t cr, uint8_t preambleLen, uint8_t phySize);
+
+void L2_airtime_init(void);
+uint32_t L2_airtime_getWaitMs(uint32_t nowMs, uint32_t toaUs, uint8_t isAck);
+void L2_airtime_noteTx(uint32_t nowMs, uint8_t destId, uint32_t toaUs);
+void L2_airtime_noteRx(uint8_t srcId, uint32_t toaUs);
+void L2_airtime_noteDelivered(uint16_t bytes);
+uint32_t L2_airtime_getWindowUs(void);
+const L2_airtimeNode_t* L2_airtime_getNode(uint8_t idx);
+void L2_airtime_printReport(void);
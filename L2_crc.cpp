@@ -0,0 +1,205 @@
+#include "mbed.h"
+#include "L2_crc.h"
+
+//Optional L2 frame check sequence
+//The FCS is appended big-endian after the L2 header and payload and checked in the RX
+//interrupt, so that a corrupted frame never reaches the FSM (nor L2_aggregateData).
+//CRC-16 uses MbedCRC with the vendored TableCRC table. CRC-32 uses the STM32 CRC unit, which
+//only takes whole 32-bit words with the fixed 0x04C11DB7 polynomial, MSB first and without
+//reflection or final XOR (CRC-32/MPEG-2) : the 0..3 trailing bytes are done in software,
+//and builds without the unit compute the very same value in software.
+
+#define L2_CRC_POLY32           0x04C11DB7UL
+#define L2_CRC_INIT32           0xFFFFFFFFUL
+
+#define L2_CRC_BENCH_SIZE       240     //benchmark buffer (one L3 SDU)
+#define L2_CRC_BENCH_ROUNDS     64
+
+#if L2_FCS_MODE == L2_CRC_CCITT16 || L2_FCS_BENCHMARK
+static MbedCRC<POLY_16BIT_CCITT, 16> crc16;         //table mode (or the HW unit if the HAL supports it)
+#endif
+
+static uint32_t crcOkCnt = 0;
+static uint32_t crcBadCnt = 0;
+
+
+//bitwise CRC-32/MPEG-2, continuing from crc
+static uint32_t L2_crc_sw32(uint32_t crc, const uint8_t* data, uint8_t size)
+{
+    uint8_t i, b;
+
+    for (i = 0; i < size; i++)
+    {
+        crc ^= (uint32_t)data[i] << 24;
+        for (b = 0; b < 8; b++)
+            crc = (crc & 0x80000000UL) ? (crc << 1) ^ L2_CRC_POLY32 : (crc << 1);
+    }
+
+    return crc;
+}
+
+#if defined(TARGET_STM32F4)
+//the unit is shared between the RX interrupt and the main loop
+static uint32_t L2_crc_hw32(const uint8_t* data, uint8_t size)
+{
+    uint32_t crc;
+    uint8_t i;
+
+    core_util_critical_section_enter();
+    CRC->CR = CRC_CR_RESET;
+    for (i = 0; i + 4 <= size; i += 4)
+        CRC->DR = ((uint32_t)data[i] << 24) | ((uint32_t)data[i+1] << 16) | ((uint32_t)data[i+2] << 8) | data[i+3];
+    crc = CRC->DR;
+    core_util_critical_section_exit();
+
+    return L2_crc_sw32(crc, data + i, size - i);
+}
+#endif
+
+
+void L2_crc_init(void)
+{
+#if defined(TARGET_STM32F4)
+    __HAL_RCC_CRC_CLK_ENABLE();
+#endif
+}
+
+uint32_t L2_crc_compute(const uint8_t* data, uint8_t size)
+{
+#if L2_FCS_MODE == L2_CRC_CCITT16
+    uint32_t crc;
+
+    crc16.compute((void*)data, size, &crc);
+    return crc;
+#elif L2_FCS_MODE == L2_CRC_32 && defined(TARGET_STM32F4)
+    return L2_crc_hw32(data, size);
+#elif L2_FCS_MODE == L2_CRC_32
+    return L2_crc_sw32(L2_CRC_INIT32, data, size);
+#else
+    return 0;
+#endif
+}
+
+//appends the FCS after frame[0..size-1] and returns the new frame size
+uint8_t L2_crc_append(uint8_t* frame, uint8_t size)
+{
+#if L2_CRC_LEN > 0
+    uint32_t crc = L2_crc_compute(frame, size);
+    uint8_t i;
+
+    for (i = 0; i < L2_CRC_LEN; i++)
+        frame[size + i] = (uint8_t)(crc >> (8 * (L2_CRC_LEN - 1 - i)));
+#endif
+
+    return size + L2_CRC_LEN;
+}
+
+//checks the FCS at the end of a received frame (size includes the FCS) : 0 if valid
+int L2_crc_check(const uint8_t* frame, uint8_t size)
+{
+#if L2_CRC_LEN > 0
+    uint32_t crc;
+    uint8_t i;
+
+    if (size < L2_CRC_LEN + 1)
+    {
+        crcBadCnt++;
+        return 1;
+    }
+
+    crc = L2_crc_compute(frame, size - L2_CRC_LEN);
+    for (i = 0; i < L2_CRC_LEN; i++)
+    {
+        if (frame[size - L2_CRC_LEN + i] != (uint8_t)(crc >> (8 * (L2_CRC_LEN - 1 - i))))
+        {
+            crcBadCnt++;
+            return 1;
+        }
+    }
+#endif
+
+    crcOkCnt++;
+    return 0;
+}
+
+void L2_crc_getStats(uint32_t* okCnt, uint32_t* badCnt)
+{
+    *okCnt = crcOkCnt;
+    *badCnt = crcBadCnt;
+}
+
+const char* L2_crc_getBackendName(void)
+{
+#if L2_FCS_MODE == L2_CRC_CCITT16
+    return "CRC-16/CCITT (MbedCRC)";
+#elif L2_FCS_MODE == L2_CRC_32 && defined(TARGET_STM32F4)
+    return "CRC-32 (STM32 CRC unit)";
+#elif L2_FCS_MODE == L2_CRC_32
+    return "CRC-32 (software)";
+#else
+    return "none";
+#endif
+}
+
+
+#if L2_FCS_BENCHMARK && defined(TARGET_STM32F4)
+static uint8_t benchBuf[L2_CRC_BENCH_SIZE];
+
+static void L2_crc_printBench(const char* name, uint32_t cycles)
+{
+    uint32_t bytes = L2_CRC_BENCH_SIZE * L2_CRC_BENCH_ROUNDS;
+
+    if (cycles == 0)
+        cycles = 1;
+    //bytes/cycle with three decimals, cycles/byte with one decimal
+    debug("[L2] CRC bench %-26s : %lu.%03lu bytes/cycle (%lu.%lu cycles/byte)\n", name,
+          (unsigned long)(bytes / cycles), (unsigned long)((uint64_t)bytes * 1000 / cycles % 1000),
+          (unsigned long)(cycles / bytes), (unsigned long)((uint64_t)cycles * 10 / bytes % 10));
+}
+
+//measures every CRC backend with the DWT cycle counter
+void L2_crc_benchmark(void)
+{
+    MbedCRC<POLY_16BIT_CCITT, 16> crc16bitwise(0xFFFF, 0, false, false);    //no table given : bitwise mode
+    volatile uint32_t sink = 0;
+    uint32_t crc, start;
+    uint16_t i;
+
+    for (i = 0; i < L2_CRC_BENCH_SIZE; i++)
+        benchBuf[i] = (uint8_t)(i * 7 + 1);
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    start = DWT->CYCCNT;
+    for (i = 0; i < L2_CRC_BENCH_ROUNDS; i++)
+        sink += L2_crc_hw32(benchBuf, L2_CRC_BENCH_SIZE);
+    L2_crc_printBench("CRC-32 STM32 CRC unit", DWT->CYCCNT - start);
+
+    start = DWT->CYCCNT;
+    for (i = 0; i < L2_CRC_BENCH_ROUNDS; i++)
+        sink += L2_crc_sw32(L2_CRC_INIT32, benchBuf, L2_CRC_BENCH_SIZE);
+    L2_crc_printBench("CRC-32 software bitwise", DWT->CYCCNT - start);
+
+    start = DWT->CYCCNT;
+    for (i = 0; i < L2_CRC_BENCH_ROUNDS; i++)
+    {
+        crc16.compute(benchBuf, L2_CRC_BENCH_SIZE, &crc);
+        sink += crc;
+    }
+    L2_crc_printBench("CRC-16 MbedCRC table", DWT->CYCCNT - start);
+
+    start = DWT->CYCCNT;
+    for (i = 0; i < L2_CRC_BENCH_ROUNDS; i++)
+    {
+        crc16bitwise.compute(benchBuf, L2_CRC_BENCH_SIZE, &crc);
+        sink += crc;
+    }
+    L2_crc_printBench("CRC-16 MbedCRC bitwise", DWT->CYCCNT - start);
+}
+#else
+void L2_crc_benchmark(void)
+{
+}
+#endif
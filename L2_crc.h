@@ -0,0 +1,24 @@
+#include <stdint.h>
+#include "protocol_parameters.h"
+
+//L2 frame check sequence modes (L2_FCS_MODE in protocol_parameters.h)
+#define L2_CRC_NONE             0       //no L2 FCS, only the PHY CRC protects the frame
+#define L2_CRC_CCITT16          1       //CRC-16/CCITT-FALSE computed with MbedCRC (TableCRC)
+#define L2_CRC_32               2       //CRC-32/MPEG-2 computed with the STM32 CRC unit (software elsewhere)
+
+#if L2_FCS_MODE == L2_CRC_CCITT16
+#define L2_CRC_LEN              2
+#elif L2_FCS_MODE == L2_CRC_32
+#define L2_CRC_LEN              4
+#else
+#define L2_CRC_LEN              0
+#endif
+#define L2_CRC_MAXLEN           4       //largest FCS of all modes (buffer sizing)
+
+void L2_crc_init(void);
+uint32_t L2_crc_compute(const uint8_t* data, uint8_t size);
+uint8_t L2_crc_append(uint8_t* frame, uint8_t size);
+int L2_crc_check(const uint8_t* frame, uint8_t size);
+void L2_crc_getStats(uint32_t* okCnt, uint32_t* badCnt);
+const char* L2_crc_getBackendName(void);
+void L2_crc_benchmark(void);
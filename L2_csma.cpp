@@ -0,0 +1,61 @@
+#include <stdlib.h>
+#include <string.h>
+#include "L2_csma.h"
+
+//channel access backoff (unslotted CSMA/CA, as IEEE 802.15.4)
+//No mbed dependency : the radio side (sensing, timer) is in L2_LLinterface.cpp, and the same
+//code runs for every node of the host simulator (tools/csmasim.cpp).
+
+
+static uint32_t L2_csma_drawBackoff(L2_csmaCtx_t* ctx)
+{
+    uint32_t delay = (uint32_t)(rand() % (1 << ctx->be)) * L2_CSMA_SLOT_US;
+
+    ctx->stats.delaySumMs += delay / 1000;
+    return delay;
+}
+
+void L2_csma_init(L2_csmaCtx_t* ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+//new frame : returns the delay (us) before its first channel sensing
+uint32_t L2_csma_start(L2_csmaCtx_t* ctx, uint8_t isAck)
+{
+    ctx->nb = 0;
+    ctx->be = isAck ? L2_CSMA_MINBE_ACK : L2_CSMA_MINBE;
+    ctx->stats.frames++;
+
+    return L2_csma_drawBackoff(ctx);
+}
+
+//result of the channel sensing of the current frame
+int L2_csma_onCca(L2_csmaCtx_t* ctx, uint8_t isFree, uint32_t* delayUs)
+{
+    ctx->stats.ccaCnt++;
+    if (isFree)
+        return L2_CSMA_SEND;
+
+    ctx->stats.busyCnt++;
+    ctx->nb++;
+    if (ctx->nb > ctx->stats.maxBackoffs)
+        ctx->stats.maxBackoffs = ctx->nb;
+    if (ctx->nb > L2_CSMA_MAXBACKOFFS)
+    {
+        ctx->stats.failCnt++;
+        return L2_CSMA_FAIL;
+    }
+
+    if (ctx->be < L2_CSMA_MAXBE)
+        ctx->be++;
+    *delayUs = L2_csma_drawBackoff(ctx);
+
+    return L2_CSMA_BACKOFF;
+}
+
+//the last frame was not acknowledged : counted as a collision (or loss) after channel access
+void L2_csma_noteNoAck(L2_csmaCtx_t* ctx)
+{
+    ctx->stats.noAckCnt++;
+}
@@ -0,0 +1,41 @@
+#include <stdint.h>
+#include "protocol_parameters.h"
+
+//listen before talk with random binary exponential backoff (L2_CSMA_ENABLE in protocol_parameters.h)
+//each frame waits a random number of slots in [0, 2^BE - 1] before sensing the channel; a busy
+//channel doubles the window (BE + 1 up to L2_CSMA_MAXBE) and the frame is given up after
+//L2_CSMA_MAXBACKOFFS busy senses. ACKs start from a smaller window than data (they are awaited).
+#define L2_CSMA_SLOT_US         5000    //backoff slot : channel sensing (1 ms) + TX turnaround, well below one frame
+#define L2_CSMA_MINBE           3
+#define L2_CSMA_MINBE_ACK       1
+#define L2_CSMA_MAXBE           5
+#define L2_CSMA_MAXBACKOFFS     4
+
+//result of a channel sensing
+#define L2_CSMA_SEND            0       //channel free : transmit now
+#define L2_CSMA_BACKOFF         1       //channel busy : sense again after the returned delay
+#define L2_CSMA_FAIL            2       //channel busy too often : frame given up
+
+typedef struct
+{
+    uint32_t frames;        //frames that went through channel access
+    uint32_t ccaCnt;        //channel sensings
+    uint32_t busyCnt;       //sensings that found the channel busy
+    uint32_t failCnt;       //frames given up (channel access failure)
+    uint32_t noAckCnt;      //frames sent on a free channel but not ACKed (collision or loss)
+    uint32_t delaySumMs;    //total backoff time
+    uint8_t maxBackoffs;    //most busy sensings for one frame
+} L2_csmaStats_t;
+
+//channel access state of one node
+typedef struct
+{
+    uint8_t nb;             //busy sensings of the current frame
+    uint8_t be;             //backoff exponent of the current frame
+    L2_csmaStats_t stats;
+} L2_csmaCtx_t;
+
+void L2_csma_init(L2_csmaCtx_t* ctx);
+uint32_t L2_csma_start(L2_csmaCtx_t* ctx, uint8_t isAck);
+int L2_csma_onCca(L2_csmaCtx_t* ctx, uint8_t isFree, uint32_t* delayUs);
+void L2_csma_noteNoAck(L2_csmaCtx_t* ctx);
@@ -0,0 +1,172 @@
+#include <string.h>
+#include "L2_fec.h"
+
+//XOR parity FEC for L2 fragments
+//An SDU of sduLen bytes is cut into numData fragments of fragSize bytes (the last one shorter),
+//followed by numParity parity fragments. Parity fragment g is the XOR of the data fragments
+//g*G .. g*G+G-1 (shorter fragments are zero-padded), so any single missing data fragment of a
+//group can be rebuilt from the parity and the other fragments of the group.
+//No mbed dependency : the same code runs in the firmware and in the host simulator (tools/fecsim.cpp).
+
+#if L2_FEC_GROUPSIZE > 0
+#define L2_FEC_GROUP            L2_FEC_GROUPSIZE
+#else
+#define L2_FEC_GROUP            L2_FEC_MAXDATAFRAG      //FEC off : no parity fragments are made
+#endif
+
+static uint32_t recoveredCnt = 0;
+
+
+//length of data fragment idx
+static uint8_t L2_fec_fragLen(uint8_t sduLen, uint8_t fragSize, uint8_t idx)
+{
+    uint16_t start = (uint16_t)idx * fragSize;
+
+    if (start >= sduLen)
+        return 0;
+    if (sduLen - start < fragSize)
+        return sduLen - start;
+    return fragSize;
+}
+
+uint8_t L2_fec_getNumData(uint8_t sduLen, uint8_t fragSize)
+{
+    if (sduLen == 0)
+        return 1;
+    return (sduLen + fragSize - 1) / fragSize;
+}
+
+uint8_t L2_fec_getNumParity(uint8_t numData)
+{
+    if (L2_FEC_GROUPSIZE == 0)
+        return 0;
+    return (numData + L2_FEC_GROUP - 1) / L2_FEC_GROUP;
+}
+
+//writes fragment idx of the FEC block (data fragments first, then parity) and returns its length
+uint8_t L2_fec_getFragment(uint8_t* out, const uint8_t* sdu, uint8_t sduLen, uint8_t fragSize, uint8_t idx)
+{
+    uint8_t numData = L2_fec_getNumData(sduLen, fragSize);
+    uint8_t len, first, i, k;
+
+    if (idx < numData)
+    {
+        len = L2_fec_fragLen(sduLen, fragSize, idx);
+        memcpy(out, sdu + (uint16_t)idx * fragSize, len);
+        return len;
+    }
+
+    //parity : the first fragment of the group is the longest one
+    first = (idx - numData) * L2_FEC_GROUP;
+    len = L2_fec_fragLen(sduLen, fragSize, first);
+    memset(out, 0, len);
+    for (i = first; i < numData && i < first + L2_FEC_GROUP; i++)
+    {
+        const uint8_t* frag = sdu + (uint16_t)i * fragSize;
+        uint8_t fragLen = L2_fec_fragLen(sduLen, fragSize, i);
+
+        for (k = 0; k < fragLen; k++)
+            out[k] ^= frag[k];
+    }
+    return len;
+}
+
+
+int L2_fec_rxInit(L2_fecRx_t* rx, uint8_t* data, uint8_t* parity, uint8_t sduLen, uint8_t fragSize)
+{
+    rx->data = data;
+    rx->parity = parity;
+    rx->sduLen = sduLen;
+    rx->fragSize = fragSize;
+    rx->numData = L2_fec_getNumData(sduLen, fragSize);
+    rx->numParity = L2_fec_getNumParity(rx->numData);
+    rx->dataMask = 0;
+    rx->parityMask = 0;
+
+    if (rx->numData > L2_FEC_MAXDATAFRAG || rx->numParity > L2_FEC_MAXPARITYFRAG)
+    {
+        rx->numData = 0;
+        return 1;
+    }
+
+    return 0;
+}
+
+//rebuilds the missing data fragment of group g if exactly one is missing and the parity is there
+static void L2_fec_tryRecover(L2_fecRx_t* rx, uint8_t g)
+{
+    uint8_t first = g * L2_FEC_GROUP;
+    uint8_t missing = 0xFF;
+    uint8_t i, k, len;
+    uint8_t* out;
+
+    if ((rx->parityMask & (1 << g)) == 0)
+        return;
+
+    for (i = first; i < rx->numData && i < first + L2_FEC_GROUP; i++)
+    {
+        if ((rx->dataMask & (1 << i)) == 0)
+        {
+            if (missing != 0xFF)
+                return; //two or more missing : needs a retransmission
+            missing = i;
+        }
+    }
+    if (missing == 0xFF)
+        return;
+
+    out = rx->data + (uint16_t)missing * rx->fragSize;
+    len = L2_fec_fragLen(rx->sduLen, rx->fragSize, missing);
+    memcpy(out, rx->parity + (uint16_t)g * rx->fragSize, len);
+    for (i = first; i < rx->numData && i < first + L2_FEC_GROUP; i++)
+    {
+        const uint8_t* frag = rx->data + (uint16_t)i * rx->fragSize;
+        uint8_t fragLen = L2_fec_fragLen(rx->sduLen, rx->fragSize, i);
+
+        if (i == missing)
+            continue;
+        for (k = 0; k < len && k < fragLen; k++)
+            out[k] ^= frag[k];
+    }
+
+    rx->dataMask |= (1 << missing);
+    recoveredCnt++;
+}
+
+//stores fragment idx of the block : returns 1 when the whole SDU is available, 0 if not yet, -1 if invalid
+int L2_fec_rxPut(L2_fecRx_t* rx, uint8_t idx, const uint8_t* frag, uint8_t len)
+{
+    uint8_t g;
+
+    if (rx->numData == 0 || idx >= rx->numData + rx->numParity)
+        return -1;
+
+    if (idx < rx->numData)
+    {
+        uint8_t fragLen = L2_fec_fragLen(rx->sduLen, rx->fragSize, idx);
+
+        if (len > fragLen)
+            len = fragLen;
+        memcpy(rx->data + (uint16_t)idx * rx->fragSize, frag, len);
+        rx->dataMask |= (1 << idx);
+        g = idx / L2_FEC_GROUP;
+    }
+    else
+    {
+        g = idx - rx->numData;
+        if (len > rx->fragSize)
+            len = rx->fragSize;
+        memcpy(rx->parity + (uint16_t)g * rx->fragSize, frag, len);
+        memset(rx->parity + (uint16_t)g * rx->fragSize + len, 0, rx->fragSize - len);
+        rx->parityMask |= (1 << g);
+    }
+
+    L2_fec_tryRecover(rx, g);
+
+    return rx->dataMask == (uint16_t)((1UL << rx->numData) - 1);
+}
+
+uint32_t L2_fec_getRecoveredCnt(void)
+{
+    return recoveredCnt;
+}
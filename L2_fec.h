@@ -0,0 +1,32 @@
+#include <stdint.h>
+#include "protocol_parameters.h"
+
+//XOR parity FEC over the fragments of one SDU (L2_FEC_GROUPSIZE in protocol_parameters.h)
+//data fragments are grouped by L2_FEC_GROUPSIZE, each group gets one parity fragment
+//(code rate G/(G+1)) : one lost fragment per group is rebuilt without retransmission
+#define L2_FEC_MAXDATAFRAG      16      //fragments tracked per SDU (bit mask)
+#define L2_FEC_MAXPARITYFRAG    8
+
+#if L2_FEC_GROUPSIZE == 1
+#error "L2_FEC_GROUPSIZE must be 0 (off) or at least 2"
+#endif
+
+//reassembly context of one FEC block (buffers are provided by the caller)
+typedef struct
+{
+    uint8_t* data;          //SDU being rebuilt (sduLen bytes)
+    uint8_t* parity;        //received parity fragments (numParity x fragSize bytes)
+    uint8_t sduLen;
+    uint8_t fragSize;
+    uint8_t numData;
+    uint8_t numParity;
+    uint16_t dataMask;      //received (or rebuilt) data fragments
+    uint8_t parityMask;     //received parity fragments
+} L2_fecRx_t;
+
+uint8_t L2_fec_getNumData(uint8_t sduLen, uint8_t fragSize);
+uint8_t L2_fec_getNumParity(uint8_t numData);
+uint8_t L2_fec_getFragment(uint8_t* out, const uint8_t* sdu, uint8_t sduLen, uint8_t fragSize, uint8_t idx);
+int L2_fec_rxInit(L2_fecRx_t* rx, uint8_t* data, uint8_t* parity, uint8_t sduLen, uint8_t fragSize);
+int L2_fec_rxPut(L2_fecRx_t* rx, uint8_t idx, const uint8_t* frag, uint8_t len);
+uint32_t L2_fec_getRecoveredCnt(void);
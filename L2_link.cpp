@@ -0,0 +1,164 @@
+#include <stdlib.h>
+#include <string.h>
+#include "L2_link.h"
+
+//link liveness : silence timers and probes per peer
+//No mbed dependency : the caller gives the time (ms) and sends the probes, so the host model
+//(tools/linksim.cpp) runs the same code.
+
+#define L2_LINK_DUE(now, t)     ((int32_t)((now) - (t)) >= 0)
+
+
+void L2_link_init(L2_linkCtx_t* ctx, uint32_t detectMs)
+{
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->detectMs = detectMs;
+    ctx->probeMs = detectMs / (L2_LINK_NUMPROBES + 1);
+}
+
+static L2_linkPeer_t* L2_link_findPeer(L2_linkCtx_t* ctx, uint8_t peerId)
+{
+    uint8_t i;
+
+    for (i = 0; i < L2_LINK_MAXPEERS; i++)
+    {
+        if (ctx->peer[i].valid && ctx->peer[i].id == peerId)
+            return &ctx->peer[i];
+    }
+    return NULL;
+}
+
+//starts watching the link to peerId (we send it unicast data or it sends us some), taken as up
+void L2_link_watch(L2_linkCtx_t* ctx, uint8_t peerId, uint32_t nowMs)
+{
+    L2_linkPeer_t* p;
+    uint8_t i;
+
+    if (ctx->detectMs == 0 || L2_link_findPeer(ctx, peerId) != NULL)
+        return;
+
+    p = NULL;
+    for (i = 0; i < L2_LINK_MAXPEERS; i++)
+    {
+        if (ctx->peer[i].valid == 0)
+        {
+            p = &ctx->peer[i];
+            break;
+        }
+    }
+    if (p == NULL)
+    {
+        p = &ctx->peer[ctx->nextVictim];
+        ctx->nextVictim = (ctx->nextVictim + 1) % L2_LINK_MAXPEERS;
+    }
+
+    memset(p, 0, sizeof(*p));
+    p->id = peerId;
+    p->valid = 1;
+    p->up = 1;
+    p->lastRxMs = nowMs;
+    p->lastProbeMs = nowMs;
+}
+
+//a frame (of any type) was heard from peerId
+void L2_link_onRx(L2_linkCtx_t* ctx, uint8_t peerId, uint32_t nowMs)
+{
+    L2_linkPeer_t* p = L2_link_findPeer(ctx, peerId);
+
+    if (p == NULL)
+        return;
+
+    p->lastRxMs = nowMs;
+    if (p->up == 0)
+        p->rxSinceDown = 1;
+}
+
+//PROBE request from peerId : answered at the next poll (the peer is watched from now on as well)
+void L2_link_onProbe(L2_linkCtx_t* ctx, uint8_t peerId, uint32_t nowMs)
+{
+    L2_linkPeer_t* p;
+
+    L2_link_watch(ctx, peerId, nowMs);
+    if ((p = L2_link_findPeer(ctx, peerId)) == NULL)
+        return;
+
+    L2_link_onRx(ctx, peerId, nowMs);
+    p->replyPending = 1;
+}
+
+//1 unless the link to peerId was found down
+uint8_t L2_link_isUp(L2_linkCtx_t* ctx, uint8_t peerId)
+{
+    L2_linkPeer_t* p = L2_link_findPeer(ctx, peerId);
+
+    return (p == NULL || p->up);
+}
+
+//link of one peer gone down or back up since the last poll, if any
+uint8_t L2_link_poll(L2_linkCtx_t* ctx, uint32_t nowMs, uint8_t* peerId, uint32_t* ms)
+{
+    uint8_t i;
+
+    for (i = 0; i < L2_LINK_MAXPEERS; i++)
+    {
+        L2_linkPeer_t* p = &ctx->peer[i];
+
+        if (p->valid == 0)
+            continue;
+        *peerId = p->id;
+
+        if (p->up && L2_LINK_DUE(nowMs, p->lastRxMs + ctx->detectMs))
+        {
+            p->up = 0;
+            p->rxSinceDown = 0;
+            p->downMs = nowMs;
+            ctx->stats.downCnt++;
+            *ms = nowMs - p->lastRxMs;
+            return L2_LINK_DOWN;
+        }
+        if (p->up == 0 && p->rxSinceDown)
+        {
+            p->up = 1;
+            ctx->stats.upCnt++;
+            *ms = nowMs - p->downMs;
+            return L2_LINK_UP;
+        }
+    }
+
+    return L2_LINK_NONE;
+}
+
+//next probe or probe reply to send, if any (replies first)
+uint8_t L2_link_getTx(L2_linkCtx_t* ctx, uint32_t nowMs, uint8_t* peerId)
+{
+    L2_linkPeer_t* probe = NULL;
+    uint8_t i;
+
+    for (i = 0; i < L2_LINK_MAXPEERS; i++)
+    {
+        L2_linkPeer_t* p = &ctx->peer[i];
+
+        if (p->valid == 0)
+            continue;
+
+        if (p->replyPending)
+        {
+            p->replyPending = 0;
+            ctx->stats.replySent++;
+            *peerId = p->id;
+            return L2_LINK_REPLY;
+        }
+        //silent for a probe interval and no probe for one either (with some jitter so that
+        //both ends of a quiet link do not probe together)
+        if (probe == NULL && L2_LINK_DUE(nowMs, p->lastRxMs + ctx->probeMs) && L2_LINK_DUE(nowMs, p->lastProbeMs + ctx->probeMs))
+            probe = p;
+    }
+
+    if (probe == NULL)
+        return L2_LINK_NONE;
+
+    probe->lastProbeMs = nowMs + (uint32_t)(rand() % (ctx->probeMs / 4 + 1));
+    ctx->stats.probeSent++;
+    *peerId = probe->id;
+    return L2_LINK_PROBE;
+}
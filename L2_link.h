@@ -0,0 +1,55 @@
+#include <stdint.h>
+#include "protocol_parameters.h"
+
+//link liveness (L2_LINK_DETECTTIME in protocol_parameters.h)
+//every frame heard from a peer proves the link up. When a peer has been silent for a probe interval
+//(detection time / (L2_LINK_NUMPROBES + 1)) it is sent a PROBE, which it answers at once : a link
+//with nothing heard for the whole detection time is declared down, and up again on the first frame
+//heard from the peer (probes go on while it is down). The ARQ then gives up at once instead of
+//going through all its retransmissions.
+#define L2_LINK_MAXPEERS        4       //peers watched at the same time
+#define L2_LINK_NUMPROBES       3       //probes without answer before the detection time is over
+
+//what L2_link_poll reports / L2_link_getTx asks to do
+#define L2_LINK_NONE            0
+#define L2_LINK_DOWN            1       //link to the peer lost (ms : time since it was last heard)
+#define L2_LINK_UP              2       //link to the peer back (ms : time it was down)
+#define L2_LINK_PROBE           3       //send a PROBE request to the peer
+#define L2_LINK_REPLY           4       //send a PROBE reply to the peer
+
+typedef struct
+{
+    uint8_t id;
+    uint8_t valid;
+    uint8_t up;
+    uint8_t rxSinceDown;        //heard while down : reported up at the next poll
+    uint8_t replyPending;
+    uint32_t lastRxMs;
+    uint32_t lastProbeMs;
+    uint32_t downMs;
+} L2_linkPeer_t;
+
+typedef struct
+{
+    uint32_t probeSent;
+    uint32_t replySent;
+    uint32_t downCnt;
+    uint32_t upCnt;
+} L2_linkStats_t;
+
+typedef struct
+{
+    uint32_t detectMs;          //0 : liveness detection off
+    uint32_t probeMs;
+    L2_linkPeer_t peer[L2_LINK_MAXPEERS];
+    uint8_t nextVictim;
+    L2_linkStats_t stats;
+} L2_linkCtx_t;
+
+void L2_link_init(L2_linkCtx_t* ctx, uint32_t detectMs);
+void L2_link_watch(L2_linkCtx_t* ctx, uint8_t peerId, uint32_t nowMs);
+void L2_link_onRx(L2_linkCtx_t* ctx, uint8_t peerId, uint32_t nowMs);
+void L2_link_onProbe(L2_linkCtx_t* ctx, uint8_t peerId, uint32_t nowMs);
+uint8_t L2_link_isUp(L2_linkCtx_t* ctx, uint8_t peerId);
+uint8_t L2_link_poll(L2_linkCtx_t* ctx, uint32_t nowMs, uint8_t* peerId, uint32_t* ms);
+uint8_t L2_link_getTx(L2_linkCtx_t* ctx, uint32_t nowMs, uint8_t* peerId);
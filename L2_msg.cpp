@@ -3,7 +3,8 @@
 
 int L2_msg_checkIfData(uint8_t* msg)
 {
-    return (msg[L2_MSG_OFFSET_TYPE] == L2_MSG_TYPE_DATA || msg[L2_MSG_OFFSET_TYPE] == L2_MSG_TYPE_DATA_CONT);
+    return (msg[L2_MSG_OFFSET_TYPE] == L2_MSG_TYPE_DATA || msg[L2_MSG_OFFSET_TYPE] == L2_MSG_TYPE_DATA_CONT ||
+            msg[L2_MSG_OFFSET_TYPE] == L2_MSG_TYPE_FEC || msg[L2_MSG_OFFSET_TYPE] == L2_MSG_TYPE_AGG);
 }
 
 int L2_msg_checkIfEndData(uint8_t* msg)
@@ -12,32 +13,108 @@ int L2_msg_checkIfEndData(uint8_t* msg)
 }
 
 
+int L2_msg_checkIfFec(uint8_t* msg)
+{
+    return (msg[L2_MSG_OFFSET_TYPE] == L2_MSG_TYPE_FEC);
+}
+
+int L2_msg_checkIfAgg(uint8_t* msg)
+{
+    return (msg[L2_MSG_OFFSET_TYPE] == L2_MSG_TYPE_AGG);
+}
+
+//control frame that needs no ARQ : NACK or SYNC of the reliable broadcast, PROBE
+int L2_msg_checkIfCtrl(uint8_t* msg)
+{
+    return (msg[L2_MSG_OFFSET_TYPE] == L2_MSG_TYPE_NACK || msg[L2_MSG_OFFSET_TYPE] == L2_MSG_TYPE_SYNC ||
+            msg[L2_MSG_OFFSET_TYPE] == L2_MSG_TYPE_PROBE);
+}
+
 int L2_msg_checkIfAck(uint8_t* msg)
 {
     return (msg[L2_MSG_OFFSET_TYPE] == L2_MSG_TYPE_ACK);
 }
 
-uint8_t L2_msg_encodeAck(uint8_t* msg_ack, uint8_t seq)
+//rate : rate advice for the receiver of the ACK, L2_MSG_ACK_NORATE if none (the byte is then 1 as before)
+uint8_t L2_msg_encodeAck(uint8_t* msg_ack, uint8_t seq, uint8_t rate)
 {
     msg_ack[L2_MSG_OFFSET_TYPE] = L2_MSG_TYPE_ACK;
     msg_ack[L2_MSG_OFFSET_SEQ] = seq;
-    msg_ack[L2_MSG_OFFSET_DATA] = 1;
+    if (rate == L2_MSG_ACK_NORATE)
+        msg_ack[L2_MSG_OFFSET_ACK_RATE] = 1;
+    else
+        msg_ack[L2_MSG_OFFSET_ACK_RATE] = L2_MSG_ACK_RATEFLAG | rate;
 
     return L2_MSG_ACKSIZE;
 }
 
-uint8_t L2_msg_encodeData(uint8_t* msg_data, uint8_t* data, int seq, int len, uint8_t flag_end)
+uint8_t L2_msg_getAckRate(uint8_t* msg)
+{
+    if (msg[L2_MSG_OFFSET_ACK_RATE] & L2_MSG_ACK_RATEFLAG)
+        return msg[L2_MSG_OFFSET_ACK_RATE] & ~L2_MSG_ACK_RATEFLAG;
+    return L2_MSG_ACK_NORATE;
+}
+
+//writes the data header in front of a payload that is already in place (msg_data + L2_MSG_OFFSET_DATA)
+uint8_t L2_msg_encodeData(uint8_t* msg_data, int seq, int len, uint8_t flag_end)
 {
     if (flag_end == 1)
         msg_data[L2_MSG_OFFSET_TYPE] = L2_MSG_TYPE_DATA;
     else
         msg_data[L2_MSG_OFFSET_TYPE] = L2_MSG_TYPE_DATA_CONT;
     msg_data[L2_MSG_OFFSET_SEQ] = seq;
-    memcpy(&msg_data[L2_MSG_OFFSET_DATA], data, len*sizeof(uint8_t));
 
     return len+L2_MSG_OFFSET_DATA;
 }
+
+//writes the AGG header in front of the sub-frames (len bytes) already at msg_agg + L2_MSG_OFFSET_DATA
+uint8_t L2_msg_encodeAgg(uint8_t* msg_agg, uint8_t seq, uint8_t len)
+{
+    msg_agg[L2_MSG_OFFSET_TYPE] = L2_MSG_TYPE_AGG;
+    msg_agg[L2_MSG_OFFSET_SEQ] = seq;
+
+    return len+L2_MSG_OFFSET_DATA;
+}
+
+//writes the FEC header, the fragment (len bytes) is already at msg_fec + L2_MSG_OFFSET_FEC_DATA
+uint8_t L2_msg_encodeFec(uint8_t* msg_fec, uint8_t seq, uint8_t idx, uint8_t sduLen, uint8_t len)
+{
+    msg_fec[L2_MSG_OFFSET_TYPE] = L2_MSG_TYPE_FEC;
+    msg_fec[L2_MSG_OFFSET_SEQ] = seq;
+    msg_fec[L2_MSG_OFFSET_FEC_IDX] = idx;
+    msg_fec[L2_MSG_OFFSET_FEC_SDULEN] = sduLen;
+
+    return len+L2_MSG_OFFSET_FEC_DATA;
+}
                     
+//seq : first frame of srcId that is missing
+uint8_t L2_msg_encodeNack(uint8_t* msg_nack, uint8_t seq, uint8_t srcId)
+{
+    msg_nack[L2_MSG_OFFSET_TYPE] = L2_MSG_TYPE_NACK;
+    msg_nack[L2_MSG_OFFSET_SEQ] = seq;
+    msg_nack[L2_MSG_OFFSET_NACK_SRC] = srcId;
+
+    return L2_MSG_CTRLSIZE;
+}
+
+//next : sequence number of the next broadcast frame, oldest : oldest frame that can still be repaired
+uint8_t L2_msg_encodeSync(uint8_t* msg_sync, uint8_t next, uint8_t oldest)
+{
+    msg_sync[L2_MSG_OFFSET_TYPE] = L2_MSG_TYPE_SYNC;
+    msg_sync[L2_MSG_OFFSET_SEQ] = next;
+    msg_sync[L2_MSG_OFFSET_SYNC_OLDEST] = oldest;
+
+    return L2_MSG_CTRLSIZE;
+}
+
+uint8_t L2_msg_encodeProbe(uint8_t* msg_probe, uint8_t isReply)
+{
+    msg_probe[L2_MSG_OFFSET_TYPE] = L2_MSG_TYPE_PROBE;
+    msg_probe[L2_MSG_OFFSET_SEQ] = 0;
+    msg_probe[L2_MSG_OFFSET_PROBE_REPLY] = isReply;
+
+    return L2_MSG_CTRLSIZE;
+}
 
 uint8_t L2_msg_getSeq(uint8_t* msg)
 {
@@ -47,4 +124,29 @@ uint8_t L2_msg_getSeq(uint8_t* msg)
 uint8_t* L2_msg_getWord(uint8_t* msg)
 {
     return &msg[L2_MSG_OFFSET_DATA];
+}
+
+uint8_t L2_msg_getFecIdx(uint8_t* msg)
+{
+    return msg[L2_MSG_OFFSET_FEC_IDX];
+}
+
+uint8_t L2_msg_getFecSduLen(uint8_t* msg)
+{
+    return msg[L2_MSG_OFFSET_FEC_SDULEN];
+}
+
+uint8_t L2_msg_getNackSrc(uint8_t* msg)
+{
+    return msg[L2_MSG_OFFSET_NACK_SRC];
+}
+
+uint8_t L2_msg_getSyncOldest(uint8_t* msg)
+{
+    return msg[L2_MSG_OFFSET_SYNC_OLDEST];
+}
+
+uint8_t L2_msg_getProbeIsReply(uint8_t* msg)
+{
+    return msg[L2_MSG_OFFSET_PROBE_REPLY];
 }
\ No newline at end of file
@@ -3,21 +3,53 @@
 #define L2_MSG_TYPE_ACK         0
 #define L2_MSG_TYPE_DATA        1
 #define L2_MSG_TYPE_DATA_CONT   2
+#define L2_MSG_TYPE_FEC         3       //data or parity fragment of an FEC block (see L2_fec.h)
+#define L2_MSG_TYPE_NACK        4       //reliable broadcast : frames missing from a sender (see L2_rbc.h)
+#define L2_MSG_TYPE_SYNC        5       //reliable broadcast : sequence state of the sender
+#define L2_MSG_TYPE_PROBE       6       //link liveness probe or its reply (see L2_link.h)
+#define L2_MSG_TYPE_AGG         7       //SDUs to the same peer packed as length-prefixed sub-frames (see L2_agg.h)
 
 #define L2_MSG_OFFSET_TYPE  0
-#define L2_MSG_OFFSET_SEQ   1
+#define L2_MSG_OFFSET_SEQ   1   //L2_SEQ_BITS wide sequence number (see L2_seq.h)
 #define L2_MSG_OFFSET_DATA  2
 
+#define L2_MSG_OFFSET_FEC_IDX       2   //fragment index in the FEC block (parity after data)
+#define L2_MSG_OFFSET_FEC_SDULEN    3   //length of the whole SDU
+#define L2_MSG_OFFSET_FEC_DATA      4
+
+#define L2_MSG_OFFSET_ACK_RATE      2   //rate advice of the ACK sender (see L2_rate.h)
+#define L2_MSG_ACK_RATEFLAG         0x80
+#define L2_MSG_ACK_NORATE           0xFF
+
+#define L2_MSG_OFFSET_NACK_SRC      2   //sender of the missing frames (seq : first missing frame)
+#define L2_MSG_OFFSET_SYNC_OLDEST   2   //oldest frame the sender can repair (seq : its next frame)
+#define L2_MSG_OFFSET_PROBE_REPLY   2   //0 : request, 1 : reply
+
 #define L2_MSG_ACKSIZE      3
+#define L2_MSG_CTRLSIZE     3   //NACK, SYNC, PROBE
 
 #define L2_MSG_MAXDATASIZE  26
-#define L2_MSSG_MAX_SEQNUM  1024
+#define L2_MSG_FEC_MAXDATASIZE  (L2_MSG_MAXDATASIZE + L2_MSG_OFFSET_DATA - L2_MSG_OFFSET_FEC_DATA)   //same frame size as DATA
 
 
 int L2_msg_checkIfData(uint8_t* msg);
 int L2_msg_checkIfAck(uint8_t* msg);
 int L2_msg_checkIfEndData(uint8_t* msg);
-uint8_t L2_msg_encodeAck(uint8_t* msg_ack, uint8_t seq);
-uint8_t L2_msg_encodeData(uint8_t* msg_data, uint8_t* data, int seq, int len, uint8_t);
+int L2_msg_checkIfFec(uint8_t* msg);
+int L2_msg_checkIfAgg(uint8_t* msg);
+int L2_msg_checkIfCtrl(uint8_t* msg);
+uint8_t L2_msg_encodeAck(uint8_t* msg_ack, uint8_t seq, uint8_t rate);
+uint8_t L2_msg_encodeData(uint8_t* msg_data, int seq, int len, uint8_t flag_end);
+uint8_t L2_msg_encodeAgg(uint8_t* msg_agg, uint8_t seq, uint8_t len);
+uint8_t L2_msg_encodeFec(uint8_t* msg_fec, uint8_t seq, uint8_t idx, uint8_t sduLen, uint8_t len);
+uint8_t L2_msg_encodeNack(uint8_t* msg_nack, uint8_t seq, uint8_t srcId);
+uint8_t L2_msg_encodeSync(uint8_t* msg_sync, uint8_t next, uint8_t oldest);
+uint8_t L2_msg_encodeProbe(uint8_t* msg_probe, uint8_t isReply);
+uint8_t L2_msg_getFecIdx(uint8_t* msg);
+uint8_t L2_msg_getFecSduLen(uint8_t* msg);
+uint8_t L2_msg_getAckRate(uint8_t* msg);
+uint8_t L2_msg_getNackSrc(uint8_t* msg);
+uint8_t L2_msg_getSyncOldest(uint8_t* msg);
+uint8_t L2_msg_getProbeIsReply(uint8_t* msg);
 uint8_t L2_msg_getSeq(uint8_t* msg);
 uint8_t* L2_msg_getWord(uint8_t* msg);
\ No newline at end of file
@@ -0,0 +1,261 @@
+#include <string.h>
+#include "L2_peer.h"
+#include "L2_seq.h"
+
+//neighbour table : per-peer ARQ contexts and the round-robin scheduler
+//No mbed dependency : the caller gives the time (ms) and owns the buffers, so the host model
+//(tools/peersim.cpp) runs the same code.
+
+#define L2_PEER_DUE(now, t)     ((int32_t)((now) - (t)) >= 0)
+
+
+void L2_peer_init(L2_peerTable_t* tbl)
+{
+    memset(tbl, 0, sizeof(*tbl));
+}
+
+L2_peer_t* L2_peer_find(L2_peerTable_t* tbl, uint8_t peerId)
+{
+    uint8_t i;
+
+    for (i = 0; i < L2_PEER_MAXPEERS; i++)
+    {
+        if (tbl->peer[i].valid && tbl->peer[i].id == peerId)
+            return &tbl->peer[i];
+    }
+    return NULL;
+}
+
+//nothing queued, in flight nor under reassembly : the entry can be given to another peer
+static uint8_t L2_peer_isIdle(L2_peer_t* p)
+{
+    return (p->qLen == 0 && p->txSdu == L2_PEER_NOSDU && p->waitAck == 0 && p->rxAggPdu == L2_PEER_NOSDU);
+}
+
+//context of peerId, made if there is none yet (the least recently used idle entry is reused when
+//the table is full) : NULL if every entry is busy
+L2_peer_t* L2_peer_add(L2_peerTable_t* tbl, uint8_t peerId, uint32_t nowMs)
+{
+    L2_peer_t* p = L2_peer_find(tbl, peerId);
+    uint8_t i;
+
+    if (p != NULL)
+    {
+        p->lastUseMs = nowMs;
+        return p;
+    }
+
+    for (i = 0; i < L2_PEER_MAXPEERS; i++)
+    {
+        L2_peer_t* q = &tbl->peer[i];
+
+        if (q->valid == 0)
+        {
+            p = q;
+            break;
+        }
+        if (L2_peer_isIdle(q) && (p == NULL || (int32_t)(q->lastUseMs - p->lastUseMs) < 0))
+            p = q;
+    }
+    if (p == NULL)
+        return NULL;
+    if (p->valid)
+        tbl->stats.evicted++;
+
+    memset(p, 0, sizeof(*p));
+    p->id = peerId;
+    p->valid = 1;
+    p->txSdu = L2_PEER_NOSDU;
+    p->rxAggPdu = L2_PEER_NOSDU;
+    p->lastUseMs = nowMs;
+
+    return p;
+}
+
+//1 if the queue of the peer is full
+uint8_t L2_peer_enqueue(L2_peerTable_t* tbl, L2_peer_t* peer, uint8_t sdu)
+{
+    if (peer->qLen >= L2_PEER_QUEUESIZE)
+    {
+        tbl->stats.sduRejected++;
+        return 1;
+    }
+
+    peer->queue[(peer->qHead + peer->qLen) % L2_PEER_QUEUESIZE] = sdu;
+    peer->qLen++;
+    tbl->stats.sduQueued++;
+
+    return 0;
+}
+
+//next SDU of the peer, L2_PEER_NOSDU if none
+uint8_t L2_peer_dequeue(L2_peer_t* peer)
+{
+    uint8_t sdu;
+
+    if (peer->qLen == 0)
+        return L2_PEER_NOSDU;
+
+    sdu = peer->queue[peer->qHead];
+    peer->qHead = (peer->qHead + 1) % L2_PEER_QUEUESIZE;
+    peer->qLen--;
+
+    return sdu;
+}
+
+//SDU being sent or waiting
+uint8_t L2_peer_hasData(L2_peer_t* peer)
+{
+    return (peer->txSdu != L2_PEER_NOSDU || peer->qLen > 0);
+}
+
+//next peer that may send a new PDU (data to send, no ACK to wait for and not held), round-robin : NULL if none
+L2_peer_t* L2_peer_next(L2_peerTable_t* tbl, uint32_t nowMs)
+{
+    uint8_t i;
+
+    for (i = 0; i < L2_PEER_MAXPEERS; i++)
+    {
+        L2_peer_t* p = &tbl->peer[(tbl->nextServed + i) % L2_PEER_MAXPEERS];
+
+        if (p->valid && p->waitAck == 0 && L2_peer_hasData(p) && (p->held == 0 || L2_PEER_DUE(nowMs, p->holdUntilMs)))
+        {
+            p->held = 0;
+            tbl->nextServed = (uint8_t)((p - tbl->peer + 1) % L2_PEER_MAXPEERS);
+            return p;
+        }
+    }
+    return NULL;
+}
+
+//the queued SDUs of the peer wait until untilMs (a hold already running keeps its end)
+void L2_peer_hold(L2_peer_t* peer, uint32_t untilMs)
+{
+    if (peer->held)
+        return;
+
+    peer->held = 1;
+    peer->holdUntilMs = untilMs;
+}
+
+//the queued SDUs of the peer may go at once
+void L2_peer_release(L2_peer_t* peer)
+{
+    peer->held = 0;
+}
+
+//1 if a peer with data is held : there will be something to send once its hold is over
+uint8_t L2_peer_anyHeld(L2_peerTable_t* tbl)
+{
+    uint8_t i;
+
+    for (i = 0; i < L2_PEER_MAXPEERS; i++)
+    {
+        L2_peer_t* p = &tbl->peer[i];
+
+        if (p->valid && p->held && L2_peer_hasData(p))
+            return 1;
+    }
+    return 0;
+}
+
+//the PDU in flight is on air : its ACK is awaited for waitMs
+void L2_peer_startWait(L2_peer_t* peer, uint32_t nowMs, uint32_t waitMs)
+{
+    peer->waitAck = 1;
+    peer->nacked = 0;
+    peer->sentMs = nowMs;
+    peer->ackDeadlineMs = nowMs + waitMs;
+}
+
+void L2_peer_stopWait(L2_peer_t* peer)
+{
+    peer->waitAck = 0;
+}
+
+//the receiver reports the PDU in flight missing : its timer expires now, and its ACK guard is over
+//since the receiver has answered
+void L2_peer_nacked(L2_peer_t* peer, uint32_t nowMs)
+{
+    if (peer->waitAck == 0)
+        return;
+
+    peer->nacked = 1;
+    peer->ackDeadlineMs = nowMs;
+    peer->sentMs = nowMs - L2_PEER_ACKGUARDMS;
+}
+
+//peer whose ACK did not come in time, if any
+L2_peer_t* L2_peer_getExpired(L2_peerTable_t* tbl, uint32_t nowMs)
+{
+    uint8_t i;
+
+    for (i = 0; i < L2_PEER_MAXPEERS; i++)
+    {
+        L2_peer_t* p = &tbl->peer[i];
+
+        if (p->valid && p->waitAck && L2_PEER_DUE(nowMs, p->ackDeadlineMs))
+            return p;
+    }
+    return NULL;
+}
+
+//1 while the ACK of a frame just sent may be on its way : nothing else should be sent
+uint8_t L2_peer_inAckGuard(L2_peerTable_t* tbl, uint32_t nowMs)
+{
+    uint8_t i;
+
+    for (i = 0; i < L2_PEER_MAXPEERS; i++)
+    {
+        L2_peer_t* p = &tbl->peer[i];
+
+        if (p->valid && p->waitAck && !L2_PEER_DUE(nowMs, p->sentMs + L2_PEER_ACKGUARDMS))
+            return 1;
+    }
+    return 0;
+}
+
+//1 if seq is among the sequence numbers last ACKed to the peer
+uint8_t L2_peer_rxIsAcked(L2_peer_t* peer, uint8_t seq)
+{
+    uint8_t i;
+
+    for (i = 0; i < peer->rxAckedLen; i++)
+    {
+        if (peer->rxAcked[i] == seq)
+            return 1;
+    }
+    return 0;
+}
+
+//seq is being ACKed to the peer : returns 1 if it was already (duplicate, counted), the oldest
+//entry makes room otherwise
+uint8_t L2_peer_rxAcked(L2_peerTable_t* tbl, L2_peer_t* peer, uint8_t seq)
+{
+    if (L2_peer_rxIsAcked(peer, seq))
+    {
+        tbl->stats.dupReAcked++;
+        return 1;
+    }
+
+    if (peer->rxAckedLen < L2_PEER_RXCACHE)
+        peer->rxAcked[peer->rxAckedLen++] = seq;
+    else
+    {
+        peer->rxAcked[peer->rxAckedIdx] = seq;
+        peer->rxAckedIdx = (peer->rxAckedIdx + 1) % L2_PEER_RXCACHE;
+    }
+    return 0;
+}
+
+//seq is before the sequence number expected from the peer (L2_SEQ_OLD) : a duplicate when it was
+//ACKed before or is within the L2_PEER_RXCACHE numbers before the expected one (a resync emptied
+//the cache), a sender that restarted its sequence numbers when it is further back
+uint8_t L2_peer_rxCheckOld(L2_peer_t* peer, uint8_t seq)
+{
+    if (L2_peer_rxIsAcked(peer, seq))
+        return L2_PEER_RXOLD_ACKED;
+    if (((unsigned)(peer->rxSeq - seq) & L2_SEQ_MASK) <= L2_PEER_RXCACHE)
+        return L2_PEER_RXOLD_STALE;
+    return L2_PEER_RXOLD_RESTART;
+}
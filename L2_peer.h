@@ -0,0 +1,98 @@
+#include <stdint.h>
+#include "protocol_parameters.h"
+
+//neighbour table : one ARQ context per peer
+//each peer has its own TX / expected RX sequence numbers, its own SDU queue and its own PDU in flight
+//with its retransmission timer, so waiting for the ACK of a slow peer does not hold back the others :
+//L2_peer_next hands the channel round-robin to the peers that have something to send and no ACK to
+//wait for. Right after a frame is sent the channel is left to its ACK for L2_PEER_ACKGUARDMS (the
+//node does not hear while it sends). Broadcast SDUs go through an entry of their own
+//(L2_PEER_BROADCAST, never waits for an ACK).
+//An entry with nothing queued nor in flight is reused for a new peer when the table is full.
+//The sequence numbers last ACKed to a peer are kept, so a PDU sent again because our ACK was lost is
+//ACKed again at once without going to L3 a second time. Only a PDU further back than that window
+//(L2_PEER_RXCACHE) is taken for a sender that restarted its sequence numbers.
+//A peer may be held for a while (frame aggregation, see L2_agg.h) : L2_peer_next passes it over
+//until the hold is over or released.
+#define L2_PEER_MAXPEERS        4       //peers with a context at the same time (broadcast included)
+#define L2_PEER_QUEUESIZE       4       //SDUs waiting per peer
+#define L2_PEER_FCSMAXLEN       4       //room for the FCS covered bytes (L2_CRC_MAXLEN)
+#define L2_PEER_ACKGUARDMS      100     //ACK backoff + time on air at the slowest rate, with margin
+#define L2_PEER_RXCACHE         4       //sequence numbers last ACKed per peer
+#define L2_PEER_BROADCAST       255
+#define L2_PEER_NOSDU           0xFF    //no SDU (same value as PDUBUF_INVALID)
+
+//what L2_peer_rxCheckOld reports for a PDU before the one expected from the peer
+#define L2_PEER_RXOLD_ACKED     0       //ACKed before (our ACK was lost) : ACK again, do not deliver
+#define L2_PEER_RXOLD_STALE     1       //within the window of the cache but not in it : drop
+#define L2_PEER_RXOLD_RESTART   2       //behind the window : the sender restarted, resync on it
+
+typedef struct
+{
+    uint8_t id;
+    uint8_t valid;
+    uint8_t txSeq;              //sequence number of the next new PDU to the peer
+    uint8_t rxSeq;              //sequence number expected next from the peer
+    uint8_t rxSynced;           //rxSeq taken from the first frame of the peer
+    uint8_t rxAcked[L2_PEER_RXCACHE];   //sequence numbers last ACKed (duplicate cache)
+    uint8_t rxAckedLen;
+    uint8_t rxAckedIdx;         //oldest entry once the cache is full
+    uint8_t waitAck;            //PDU in flight, waiting for its ACK
+    uint8_t retxCnt;
+    uint8_t nacked;             //the receiver reported the PDU in flight missing : sent again at once
+    uint32_t sentMs;            //end of the transmission of the PDU in flight
+    uint32_t ackDeadlineMs;
+    uint32_t lastUseMs;
+
+    uint8_t queue[L2_PEER_QUEUESIZE];
+    uint8_t qHead;
+    uint8_t qLen;
+    uint8_t held;               //queued SDUs wait for others until holdUntilMs
+    uint32_t holdUntilMs;
+
+    //PDU / SDU buffers of the FSM
+    uint8_t txSdu;              //SDU being sent (remaining fragments from the data start)
+    uint8_t* arqPdu;            //PDU in flight, header prepended in place inside txSdu
+    uint8_t pduSize;            //header + payload (the FCS follows)
+    uint8_t fcsSaved[L2_PEER_FCSMAXLEN];    //start of the next fragment, overwritten by the FCS
+    uint8_t fecTxNum;           //frames of the FEC block being sent (0 : no FEC block)
+    uint8_t fecTxIdx;
+    uint8_t fecTxSeq;
+    uint8_t aggCnt;             //SDUs packed in txSdu as sub-frames of one AGG frame (0 : not aggregated)
+    uint8_t rxAggPdu;           //multi-fragment SDU under reassembly
+} L2_peer_t;
+
+typedef struct
+{
+    uint32_t sduQueued;
+    uint32_t sduRejected;       //queue or table full
+    uint32_t evicted;
+    uint32_t dupReAcked;        //PDUs received again and ACKed again (our ACK was lost)
+    uint32_t nackRetx;          //PDUs sent again on a NACK, before their timer
+} L2_peerStats_t;
+
+typedef struct
+{
+    L2_peer_t peer[L2_PEER_MAXPEERS];
+    uint8_t nextServed;         //round-robin position of L2_peer_next
+    L2_peerStats_t stats;
+} L2_peerTable_t;
+
+void L2_peer_init(L2_peerTable_t* tbl);
+L2_peer_t* L2_peer_find(L2_peerTable_t* tbl, uint8_t peerId);
+L2_peer_t* L2_peer_add(L2_peerTable_t* tbl, uint8_t peerId, uint32_t nowMs);
+uint8_t L2_peer_enqueue(L2_peerTable_t* tbl, L2_peer_t* peer, uint8_t sdu);
+uint8_t L2_peer_dequeue(L2_peer_t* peer);
+uint8_t L2_peer_hasData(L2_peer_t* peer);
+L2_peer_t* L2_peer_next(L2_peerTable_t* tbl, uint32_t nowMs);
+void L2_peer_hold(L2_peer_t* peer, uint32_t untilMs);
+void L2_peer_release(L2_peer_t* peer);
+uint8_t L2_peer_anyHeld(L2_peerTable_t* tbl);
+void L2_peer_startWait(L2_peer_t* peer, uint32_t nowMs, uint32_t waitMs);
+void L2_peer_stopWait(L2_peer_t* peer);
+void L2_peer_nacked(L2_peer_t* peer, uint32_t nowMs);
+L2_peer_t* L2_peer_getExpired(L2_peerTable_t* tbl, uint32_t nowMs);
+uint8_t L2_peer_inAckGuard(L2_peerTable_t* tbl, uint32_t nowMs);
+uint8_t L2_peer_rxIsAcked(L2_peer_t* peer, uint8_t seq);
+uint8_t L2_peer_rxAcked(L2_peerTable_t* tbl, L2_peer_t* peer, uint8_t seq);
+uint8_t L2_peer_rxCheckOld(L2_peer_t* peer, uint8_t seq);
@@ -0,0 +1,283 @@
+#include <stddef.h>
+#include "L2_rate.h"
+#include "L2_airtime.h"
+
+//SNR-driven PHY rate selection
+//Each peer has an SNR estimate (EWMA of the SNR of its frames and of their deviation from it, 1/16 dB,
+//as the RTT estimate of TCP) and the rate this node advises it to use (sent back in the ACKs), plus the
+//rate that peer advised us (used for our TX). Rates are chosen on the estimate minus its deviation
+//so that fading frames still meet the target.
+//The SNR each rate needs is a constant of the table (computed offline from the frame error model
+//of tools/ratesim.cpp), so that the firmware does no floating point here.
+//No mbed dependency except the HAL hook at the bottom.
+
+#define L2_RATE_EWMA_SHIFT      2       //SNR estimate weight 1/4 for a new sample
+#define L2_RATE_DEV_WEIGHT      1       //deviations taken off the estimate (tools/ratesim.cpp)
+
+//fastest first : the CR rows keep SF7/125 kHz that every node listens to (the coding rate is in the
+//explicit LoRa header), the SF rows need all receivers on the same SF (host model only, see L2_RATE_NUMRATES)
+//snr50 : demodulator floor of the SF (SX1276 datasheet) minus an approximate coding gain of the CR
+//snrReq : snr50 + 2.6 dB, where the logistic FER curve of tools/ratesim.cpp (slope 1.75 /dB) is at
+//1 % loss (ln(99) / 1.75 = 2.63 dB) : a lost frame costs an ARQ timeout of seconds
+static const L2_rate_t rateTable[] =
+{
+    {7,  0, 1,  -75,  -49},
+    {7,  0, 2,  -80,  -54},
+    {7,  0, 3,  -90,  -64},
+    {7,  0, 4,  -95,  -69},
+    {8,  0, 1, -100,  -74},
+    {9,  0, 1, -125,  -99},
+    {10, 0, 1, -150, -124},
+    {11, 0, 1, -175, -149},
+    {12, 0, 1, -200, -174},
+};
+#define L2_RATE_TABLESIZE       (sizeof(rateTable) / sizeof(rateTable[0]))
+
+#if L2_RATE_NUMRATES > 9 || L2_RATE_NUMRATES < 1
+#error "L2_RATE_NUMRATES must be 1 .. 9"
+#endif
+
+typedef struct
+{
+    uint8_t id;
+    uint8_t valid;
+    int16_t snrEst;         //1/16 dB
+    int16_t snrDev;         //mean deviation, 1/16 dB
+    uint8_t advice;         //rate we ask the peer to use
+    uint8_t txRate;         //rate the peer asked us to use (L2_RATE_NONE : not heard yet)
+} L2_ratePeer_t;
+
+static L2_ratePeer_t peers[L2_RATE_MAXPEERS];
+static uint8_t nextVictim = 0;
+static int16_t reqSnr[L2_RATE_TABLESIZE];      //snrReq of the table in 1/16 dB (the unit of the estimate)
+static volatile uint8_t curTxRate = 0;
+static uint8_t fixedRate = 0;                   //rate of all frames without link adaptation
+
+
+void L2_rate_init(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < L2_RATE_TABLESIZE; i++)
+        reqSnr[i] = (int16_t)(rateTable[i].snrReq * 16 / 10);
+    for (i = 0; i < L2_RATE_MAXPEERS; i++)
+        peers[i].valid = 0;
+    curTxRate = 0;
+}
+
+uint8_t L2_rate_getNumRates(void)
+{
+    return L2_RATE_NUMRATES;
+}
+
+const L2_rate_t* L2_rate_getRate(uint8_t rate)
+{
+    if (rate >= L2_RATE_NUMRATES)
+        rate = 0;
+    return &rateTable[rate];
+}
+
+//LoRa time on air of a PHY payload of phySize bytes at the given rate
+uint32_t L2_rate_getToaUs(uint8_t rate, uint8_t phySize)
+{
+    const L2_rate_t* r = L2_rate_getRate(rate);
+
+    return L2_airtime_getToaUs(r->sf, r->bw, r->cr, L2_AIRTIME_PREAMBLELEN, phySize);
+}
+
+
+static L2_ratePeer_t* L2_rate_findPeer(uint8_t peerId)
+{
+    uint8_t i;
+
+    for (i = 0; i < L2_RATE_MAXPEERS; i++)
+    {
+        if (peers[i].valid && peers[i].id == peerId)
+            return &peers[i];
+    }
+    return NULL;
+}
+
+static L2_ratePeer_t* L2_rate_addPeer(uint8_t peerId)
+{
+    L2_ratePeer_t* p = NULL;
+    uint8_t i;
+
+    for (i = 0; i < L2_RATE_MAXPEERS; i++)
+    {
+        if (peers[i].valid == 0)
+        {
+            p = &peers[i];
+            break;
+        }
+    }
+    if (p == NULL)
+    {
+        p = &peers[nextVictim];
+        nextVictim = (nextVictim + 1) % L2_RATE_MAXPEERS;
+    }
+
+    p->id = peerId;
+    p->valid = 1;
+    p->snrEst = 0;
+    p->snrDev = 0;
+    p->advice = 0;
+    p->txRate = L2_RATE_NONE;
+
+    return p;
+}
+
+//SNR of a frame received from peerId : updates the estimate and the rate advised to that peer
+//(slower at once when the estimate drops below the need of the current rate, one step faster
+//only with L2_RATE_HYSTERESIS dB to spare)
+void L2_rate_updateSnr(uint8_t peerId, int8_t snr)
+{
+    L2_ratePeer_t* p;
+    int16_t err, snrSafe;
+    uint8_t best;
+
+    if (L2_LINKADAPT == 0)
+        return;
+
+    p = L2_rate_findPeer(peerId);
+    if (p == NULL)
+    {
+        p = L2_rate_addPeer(peerId);
+        p->snrEst = snr * 16;
+    }
+    else
+    {
+        err = snr * 16 - p->snrEst;
+        p->snrEst += err / (1 << L2_RATE_EWMA_SHIFT);
+        p->snrDev += ((err < 0 ? -err : err) - p->snrDev) / (1 << L2_RATE_EWMA_SHIFT);
+    }
+    snrSafe = p->snrEst - L2_RATE_DEV_WEIGHT * p->snrDev;
+
+    for (best = 0; best < L2_RATE_NUMRATES - 1; best++)
+    {
+        if (snrSafe >= reqSnr[best])
+            break;
+    }
+
+    if (best > p->advice)
+        p->advice = best;
+    else if (best < p->advice && snrSafe >= reqSnr[p->advice - 1] + L2_RATE_HYSTERESIS * 16)
+        p->advice--;
+}
+
+//rate to advise peerId in the next ACK (L2_RATE_NONE if link adaptation is off)
+uint8_t L2_rate_getAdvice(uint8_t peerId)
+{
+    L2_ratePeer_t* p;
+
+    if (L2_LINKADAPT == 0)
+        return L2_RATE_NONE;
+
+    p = L2_rate_findPeer(peerId);
+    return (p == NULL) ? 0 : p->advice;
+}
+
+//rate advised by peerId in its ACK
+void L2_rate_setAdvised(uint8_t peerId, uint8_t rate)
+{
+    L2_ratePeer_t* p;
+
+    if (L2_LINKADAPT == 0 || rate == L2_RATE_NONE)
+        return;
+
+    p = L2_rate_findPeer(peerId);
+    if (p == NULL)
+        p = L2_rate_addPeer(peerId);
+    p->txRate = (rate < L2_RATE_NUMRATES) ? rate : L2_RATE_NUMRATES - 1;
+}
+
+static uint8_t L2_rate_peerTxRate(const L2_ratePeer_t* p)
+{
+    if (p->txRate != L2_RATE_NONE)
+        return p->txRate;
+    return p->advice;       //no feedback yet : the channel is assumed symmetric
+}
+
+//no ACK from peerId : one step more robust until its next advice
+void L2_rate_onTimeout(uint8_t peerId)
+{
+    L2_ratePeer_t* p;
+    uint8_t rate;
+
+    if (L2_LINKADAPT == 0)
+        return;
+
+    p = L2_rate_findPeer(peerId);
+    if (p == NULL)
+        p = L2_rate_addPeer(peerId);
+
+    rate = L2_rate_peerTxRate(p);
+    if (rate < L2_RATE_NUMRATES - 1)
+        rate++;
+    p->txRate = rate;
+}
+
+//rate of every frame when L2_LINKADAPT is 0 (0 : the SF7 CR 4/5 phymac programs anyway), set from the
+//stored configuration or the shell
+void L2_rate_setFixedRate(uint8_t rate)
+{
+    fixedRate = (rate < L2_RATE_NUMRATES) ? rate : 0;
+}
+
+uint8_t L2_rate_getFixedRate(void)
+{
+    return fixedRate;
+}
+
+//rate of the next transmission to destId (broadcast or unknown : the most robust rate in use)
+uint8_t L2_rate_selectTx(uint8_t destId)
+{
+    L2_ratePeer_t* p;
+    uint8_t rate = 0;
+    uint8_t i;
+
+    if (L2_LINKADAPT == 0)
+    {
+        curTxRate = fixedRate;
+        return fixedRate;
+    }
+
+    p = L2_rate_findPeer(destId);
+    if (p != NULL)
+        rate = L2_rate_peerTxRate(p);
+    else
+    {
+        for (i = 0; i < L2_RATE_MAXPEERS; i++)
+        {
+            if (peers[i].valid && L2_rate_peerTxRate(&peers[i]) > rate)
+                rate = L2_rate_peerTxRate(&peers[i]);
+        }
+    }
+
+    curTxRate = rate;
+    return rate;
+}
+
+
+#ifdef __MBED__
+//phymac_dataReq() programs a fixed TX configuration (SF7, 125 kHz, CR 4/5) right before each
+//transmission : the linker sends that call here (-Wl,--wrap in the Makefile) so that the rate
+//selected by L2_rate_selectTx() is applied instead
+int L2_rate_realSetTxConfig(int8_t power, int bw, int dr, int cr, uint16_t preambleLen, uint32_t freq)
+    __asm__("__real__Z19HAL_cmd_SetTxConfiga12HALenum_bw_e12HALenum_dr_e12HALenum_cr_etm");
+int L2_rate_wrapSetTxConfig(int8_t power, int bw, int dr, int cr, uint16_t preambleLen, uint32_t freq)
+    __asm__("__wrap__Z19HAL_cmd_SetTxConfiga12HALenum_bw_e12HALenum_dr_e12HALenum_cr_etm");
+
+int L2_rate_wrapSetTxConfig(int8_t power, int bw, int dr, int cr, uint16_t preambleLen, uint32_t freq)
+{
+    if (L2_LINKADAPT || fixedRate > 0)
+    {
+        const L2_rate_t* r = L2_rate_getRate(curTxRate);
+
+        bw = r->bw;
+        dr = r->sf;
+        cr = r->cr;
+    }
+    return L2_rate_realSetTxConfig(power, bw, dr, cr, preambleLen, freq);
+}
+#endif
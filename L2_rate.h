@@ -0,0 +1,32 @@
+#include <stdint.h>
+#include "protocol_parameters.h"
+
+//SNR-driven PHY rate selection (L2_LINKADAPT in protocol_parameters.h)
+//the receiver keeps an SNR estimate per peer and advises, in the third byte of its ACKs, the
+//fastest rate of the table below whose snrReq the estimate still meets; the sender uses the
+//advice of the destination for its next frames and falls back one rate on each ARQ timeout
+#define L2_RATE_MAXPEERS        4
+#define L2_RATE_NONE            0xFF    //no rate advice
+
+//PHY configuration of one rate (values of the HAL enums : bw 0/1/2 = 125/250/500 kHz, cr 1..4 = 4/5..4/8)
+typedef struct
+{
+    uint8_t sf;
+    uint8_t bw;
+    uint8_t cr;
+    int16_t snr50;          //SNR (0.1 dB) at which a full frame is lost half of the time
+    int16_t snrReq;         //SNR (0.1 dB) the rate is advised from (1 % frame loss)
+} L2_rate_t;
+
+void L2_rate_init(void);
+uint8_t L2_rate_getNumRates(void);
+const L2_rate_t* L2_rate_getRate(uint8_t rate);
+uint32_t L2_rate_getToaUs(uint8_t rate, uint8_t phySize);
+
+void L2_rate_updateSnr(uint8_t peerId, int8_t snr);
+uint8_t L2_rate_getAdvice(uint8_t peerId);
+void L2_rate_setAdvised(uint8_t peerId, uint8_t rate);
+void L2_rate_onTimeout(uint8_t peerId);
+uint8_t L2_rate_selectTx(uint8_t destId);
+void L2_rate_setFixedRate(uint8_t rate);
+uint8_t L2_rate_getFixedRate(void);
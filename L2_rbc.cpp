@@ -0,0 +1,294 @@
+#include <stdlib.h>
+#include <string.h>
+#include "L2_rbc.h"
+
+//reliable broadcast : sequence numbers, NACK timers and repair cache
+//No mbed dependency : the caller gives the time (ms) and builds the frames, so every node of the
+//host model (tools/rbcsim.cpp) runs the same code. Sequence numbers are 8 bit, compared on their difference.
+
+#define L2_RBC_TIMER_OFF        0
+#define L2_RBC_TIMER_NACK       1
+#define L2_RBC_TIMER_WAIT       2
+
+#define L2_RBC_DIFF(a, b)       ((int8_t)(uint8_t)((a) - (b)))
+#define L2_RBC_DUE(now, t)      ((int32_t)((now) - (t)) >= 0)
+
+
+void L2_rbc_init(L2_rbcCtx_t* ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+
+//sender side ------------------------------------------------------
+
+//sequence number of the next new broadcast frame
+uint8_t L2_rbc_nextTxSeq(L2_rbcCtx_t* ctx)
+{
+    return ctx->txNext++;
+}
+
+//keeps a sent frame (header + payload) for repairs and (re)arms the SYNC of the burst
+void L2_rbc_storeTx(L2_rbcCtx_t* ctx, uint32_t nowMs, const uint8_t* frame, uint8_t size, uint8_t seq)
+{
+    L2_rbcCache_t* c = &ctx->cache[seq % L2_RBC_CACHESIZE];
+
+    if (size > L2_RBC_MAXFRAME)
+        size = L2_RBC_MAXFRAME;
+    memcpy(c->frame, frame, size);
+    c->size = size;
+    c->seq = seq;
+    if (ctx->cacheCnt < L2_RBC_CACHESIZE)
+        ctx->cacheCnt++;
+
+    ctx->syncPending = 1;
+    ctx->syncMs = nowMs + L2_RBC_SYNC_DELAY_MS;
+}
+
+static uint8_t L2_rbc_oldestSeq(L2_rbcCtx_t* ctx)
+{
+    return (uint8_t)(ctx->txNext - ctx->cacheCnt);
+}
+
+//a receiver misses our frames from seq on
+void L2_rbc_onNack(L2_rbcCtx_t* ctx, uint32_t nowMs, uint8_t seq)
+{
+    //not sent yet : the receiver is confused, tell it where we are
+    if (L2_RBC_DIFF(ctx->txNext, seq) <= 0)
+    {
+        ctx->syncPending = 1;
+        ctx->syncMs = nowMs;
+        return;
+    }
+    //no longer cached : the receiver has to give those frames up
+    if (L2_RBC_DIFF(seq, L2_rbc_oldestSeq(ctx)) < 0)
+    {
+        ctx->syncPending = 1;
+        ctx->syncMs = nowMs;
+        seq = L2_rbc_oldestSeq(ctx);
+    }
+
+    if (ctx->repairPending)
+    {
+        if (L2_RBC_DIFF(seq, ctx->repairSeq) < 0)
+            ctx->repairSeq = seq;
+        if (L2_RBC_DIFF(seq, ctx->repairFrom) < 0)
+            ctx->repairFrom = seq;
+    }
+    else if (ctx->stats.repairSent == 0 || L2_RBC_DIFF(seq, ctx->repairFrom) < 0 ||
+             L2_RBC_DUE(nowMs, ctx->repairMs + L2_RBC_HOLDOFF_MS))
+    {
+        ctx->repairPending = 1;
+        ctx->repairSeq = seq;
+        ctx->repairFrom = seq;
+    }
+}
+
+
+//receiver side ----------------------------------------------------
+
+static L2_rbcSrc_t* L2_rbc_findSrc(L2_rbcCtx_t* ctx, uint8_t srcId)
+{
+    uint8_t i;
+
+    for (i = 0; i < L2_RBC_MAXSRC; i++)
+    {
+        if (ctx->src[i].valid && ctx->src[i].id == srcId)
+            return &ctx->src[i];
+    }
+    return NULL;
+}
+
+//a new sender : its stream is joined at seq
+static L2_rbcSrc_t* L2_rbc_addSrc(L2_rbcCtx_t* ctx, uint8_t srcId, uint8_t seq)
+{
+    L2_rbcSrc_t* s = NULL;
+    uint8_t i;
+
+    for (i = 0; i < L2_RBC_MAXSRC; i++)
+    {
+        if (ctx->src[i].valid == 0)
+        {
+            s = &ctx->src[i];
+            break;
+        }
+    }
+    if (s == NULL)
+    {
+        s = &ctx->src[ctx->nextVictim];
+        ctx->nextVictim = (ctx->nextVictim + 1) % L2_RBC_MAXSRC;
+    }
+
+    memset(s, 0, sizeof(*s));
+    s->id = srcId;
+    s->valid = 1;
+    s->expSeq = seq;
+    s->highSeq = seq;
+
+    return s;
+}
+
+//gap or no gap after a change of expSeq / highSeq : arms or stops the NACK timer
+static void L2_rbc_updateTimer(L2_rbcSrc_t* s, uint32_t nowMs)
+{
+    if (s->expSeq == s->highSeq)
+    {
+        s->timer = L2_RBC_TIMER_OFF;
+        s->nackCnt = 0;
+    }
+    else if (s->timer == L2_RBC_TIMER_OFF)
+    {
+        s->timer = L2_RBC_TIMER_NACK;
+        s->dueMs = nowMs + (uint32_t)(rand() % L2_RBC_NACK_MAXDELAY_MS);
+    }
+}
+
+//broadcast data frame seq from srcId
+int L2_rbc_onData(L2_rbcCtx_t* ctx, uint32_t nowMs, uint8_t srcId, uint8_t seq)
+{
+    L2_rbcSrc_t* s = L2_rbc_findSrc(ctx, srcId);
+    int8_t d;
+
+    //a new sender : the frames before this one may have been lost too, so its stream is joined up to
+    //the size of its cache earlier (from 0 if it has just started) and the gap is NACKed as any other
+    if (s == NULL)
+        s = L2_rbc_addSrc(ctx, srcId, (uint8_t)(seq - ((seq < L2_RBC_CACHESIZE - 1) ? seq : L2_RBC_CACHESIZE - 1)));
+
+    d = L2_RBC_DIFF(seq, s->expSeq);
+    if (d < 0)
+    {
+        ctx->stats.dupCnt++;
+        return L2_RBC_DUPLICATE;
+    }
+    if (L2_RBC_DIFF(seq + 1, s->highSeq) > 0)
+        s->highSeq = seq + 1;
+
+    if (d > 0)
+    {
+        ctx->stats.gapCnt++;
+        //the sender is past our gap again well after our NACK : its repair was lost, NACK again now
+        if (s->timer == L2_RBC_TIMER_WAIT && L2_RBC_DUE(nowMs + L2_RBC_REPAIR_WAIT_MS - L2_RBC_NACK_MAXDELAY_MS, s->dueMs))
+        {
+            s->timer = L2_RBC_TIMER_OFF;
+            s->nackCnt++;
+        }
+        L2_rbc_updateTimer(s, nowMs);
+        return L2_RBC_GAP;
+    }
+
+    s->expSeq++;
+    s->nackCnt = 0;     //progress : the repair is coming
+    L2_rbc_updateTimer(s, nowMs);
+
+    return L2_RBC_ACCEPT;
+}
+
+//SYNC from srcId : next frame it will send and oldest frame it can repair
+//returns 1 if frames were given up (the partial SDU of srcId has to be dropped)
+uint8_t L2_rbc_onSync(L2_rbcCtx_t* ctx, uint32_t nowMs, uint8_t srcId, uint8_t next, uint8_t oldest)
+{
+    L2_rbcSrc_t* s = L2_rbc_findSrc(ctx, srcId);
+    uint8_t skipped = 0;
+
+    //a new sender : its stream is joined from the oldest frame it can still repair
+    if (s == NULL)
+        s = L2_rbc_addSrc(ctx, srcId, oldest);
+
+    if (L2_RBC_DIFF(next, s->highSeq) > 0)
+        s->highSeq = next;
+    if (L2_RBC_DIFF(oldest, s->expSeq) > 0)
+    {
+        ctx->stats.lostCnt += (uint8_t)(oldest - s->expSeq);
+        s->expSeq = oldest;
+        skipped = 1;
+    }
+    L2_rbc_updateTimer(s, nowMs);
+
+    return skipped;
+}
+
+//NACK from another receiver for the frames of srcId from seq on : ours is not needed if it covers our gap
+void L2_rbc_onPeerNack(L2_rbcCtx_t* ctx, uint32_t nowMs, uint8_t srcId, uint8_t seq)
+{
+    L2_rbcSrc_t* s = L2_rbc_findSrc(ctx, srcId);
+
+    if (s == NULL || s->timer != L2_RBC_TIMER_NACK || L2_RBC_DIFF(seq, s->expSeq) > 0)
+        return;
+
+    ctx->stats.nackSuppressed++;
+    s->timer = L2_RBC_TIMER_WAIT;
+    s->dueMs = nowMs + L2_RBC_REPAIR_WAIT_MS;
+}
+
+
+//next frame to send, if any (SYNC first : a receiver may have to skip ahead before the repairs,
+//then repairs, then NACKs)
+uint8_t L2_rbc_getTx(L2_rbcCtx_t* ctx, uint32_t nowMs, L2_rbcTx_t* tx)
+{
+    uint8_t i;
+
+    tx->kind = L2_RBC_TX_NONE;
+
+    if (ctx->syncPending && L2_RBC_DUE(nowMs, ctx->syncMs))
+    {
+        ctx->syncPending = 0;
+        ctx->stats.syncSent++;
+        tx->kind = L2_RBC_TX_SYNC;
+        tx->seq = ctx->txNext;
+        tx->oldest = L2_rbc_oldestSeq(ctx);
+        return tx->kind;
+    }
+
+    if (ctx->repairPending)
+    {
+        L2_rbcCache_t* c = &ctx->cache[ctx->repairSeq % L2_RBC_CACHESIZE];
+
+        tx->kind = L2_RBC_TX_REPAIR;
+        tx->seq = c->seq;
+        tx->frame = c->frame;
+        tx->size = c->size;
+        ctx->stats.repairSent++;
+
+        if (++ctx->repairSeq == ctx->txNext)
+        {
+            ctx->repairPending = 0;
+            ctx->repairMs = nowMs;
+        }
+        return tx->kind;
+    }
+
+    for (i = 0; i < L2_RBC_MAXSRC; i++)
+    {
+        L2_rbcSrc_t* s = &ctx->src[i];
+
+        if (s->valid == 0 || s->timer == L2_RBC_TIMER_OFF || !L2_RBC_DUE(nowMs, s->dueMs))
+            continue;
+
+        if (s->timer == L2_RBC_TIMER_WAIT)
+        {
+            //no repair : NACK again (after a new random delay) or give the missing frames up
+            if (++s->nackCnt > L2_RBC_MAXNACK)
+            {
+                ctx->stats.lostCnt += (uint8_t)(s->highSeq - s->expSeq);
+                s->expSeq = s->highSeq;
+                L2_rbc_updateTimer(s, nowMs);
+                tx->kind = L2_RBC_TX_SKIP;
+                tx->srcId = s->id;
+                return tx->kind;
+            }
+            s->timer = L2_RBC_TIMER_OFF;
+            L2_rbc_updateTimer(s, nowMs);
+            continue;
+        }
+
+        s->timer = L2_RBC_TIMER_WAIT;
+        s->dueMs = nowMs + L2_RBC_REPAIR_WAIT_MS;
+        ctx->stats.nackSent++;
+        tx->kind = L2_RBC_TX_NACK;
+        tx->srcId = s->id;
+        tx->seq = s->expSeq;
+        return tx->kind;
+    }
+
+    return tx->kind;
+}
@@ -0,0 +1,101 @@
+#include <stdint.h>
+#include "protocol_parameters.h"
+
+//reliable broadcast (L2_RBC_ENABLE in protocol_parameters.h)
+//broadcast frames get their own sequence numbers per sender and are delivered in order. A receiver
+//that finds a gap drops the frames after it and, after a random delay, broadcasts a NACK for the
+//first missing frame : the other receivers missing the same frame hear it and keep quiet, and the
+//sender sends again every frame from that one on (go-back-N from its cache of the last frames).
+//A SYNC frame after each burst gives the next sequence number so that the loss of the last frames
+//is found as well. The cost grows with the losses, not with the number of receivers.
+//The broadcast sequence numbers use the whole SEQ byte of the header, whatever L2_SEQ_BITS.
+//A receiver joins the stream of a new sender with the frames the sender may still have in its cache
+//and NACKs those it missed : the SYNC answering a NACK for frames no longer cached moves it on.
+#define L2_RBC_MAXSRC           4       //broadcast senders tracked by a receiver
+#define L2_RBC_CACHESIZE        16      //frames kept by the sender for repairs
+#define L2_RBC_MAXFRAME         32      //header + payload of a cached frame
+#define L2_RBC_NACK_MAXDELAY_MS 1500    //NACK delay drawn in [0, this) : time for the other receivers to hear a NACK first
+#define L2_RBC_REPAIR_WAIT_MS   3000    //wait for the repair after a NACK (sent or heard) before NACKing again
+#define L2_RBC_HOLDOFF_MS       1000    //NACKs for frames just repaired are ignored (they crossed the repair)
+#define L2_RBC_SYNC_DELAY_MS    1500    //SYNC after the last broadcast frame
+#define L2_RBC_MAXNACK          5       //NACKs without progress before the missing frames are given up
+
+//result of L2_rbc_onData
+#define L2_RBC_ACCEPT           0       //next frame in order : deliver it
+#define L2_RBC_DUPLICATE        1       //already delivered
+#define L2_RBC_GAP              2       //frames are missing before it : dropped, NACK scheduled
+
+//what L2_rbc_getTx asks to do
+#define L2_RBC_TX_NONE          0
+#define L2_RBC_TX_REPAIR        1       //send frame/size again
+#define L2_RBC_TX_NACK          2       //NACK seq to srcId
+#define L2_RBC_TX_SYNC          3       //SYNC with seq (next) and oldest
+#define L2_RBC_TX_SKIP          4       //frames from srcId were given up : drop its partial SDU
+
+typedef struct
+{
+    uint32_t nackSent;
+    uint32_t nackSuppressed;    //NACKs not sent since another receiver's NACK covered them
+    uint32_t repairSent;
+    uint32_t syncSent;
+    uint32_t gapCnt;            //frames dropped because of a gap before them
+    uint32_t dupCnt;
+    uint32_t lostCnt;           //frames given up
+} L2_rbcStats_t;
+
+typedef struct
+{
+    uint8_t seq;
+    uint8_t size;
+    uint8_t frame[L2_RBC_MAXFRAME];
+} L2_rbcCache_t;
+
+//receiver state for one broadcast sender
+typedef struct
+{
+    uint8_t id;
+    uint8_t valid;
+    uint8_t expSeq;             //next frame to deliver
+    uint8_t highSeq;            //next frame the sender will send, as far as we know
+    uint8_t timer;              //0 : off, 1 : NACK pending, 2 : waiting for the repair
+    uint8_t nackCnt;
+    uint32_t dueMs;
+} L2_rbcSrc_t;
+
+typedef struct
+{
+    //sender
+    uint8_t txNext;
+    uint8_t cacheCnt;
+    L2_rbcCache_t cache[L2_RBC_CACHESIZE];
+    uint8_t repairPending;
+    uint8_t repairSeq;          //next frame of the repair run
+    uint8_t repairFrom;         //first frame of the last repair run
+    uint32_t repairMs;          //end of the last repair run
+    uint8_t syncPending;
+    uint32_t syncMs;
+    //receiver
+    L2_rbcSrc_t src[L2_RBC_MAXSRC];
+    uint8_t nextVictim;
+    L2_rbcStats_t stats;
+} L2_rbcCtx_t;
+
+//one frame to send, filled by L2_rbc_getTx
+typedef struct
+{
+    uint8_t kind;
+    uint8_t srcId;
+    uint8_t seq;
+    uint8_t oldest;
+    const uint8_t* frame;
+    uint8_t size;
+} L2_rbcTx_t;
+
+void L2_rbc_init(L2_rbcCtx_t* ctx);
+uint8_t L2_rbc_nextTxSeq(L2_rbcCtx_t* ctx);
+void L2_rbc_storeTx(L2_rbcCtx_t* ctx, uint32_t nowMs, const uint8_t* frame, uint8_t size, uint8_t seq);
+void L2_rbc_onNack(L2_rbcCtx_t* ctx, uint32_t nowMs, uint8_t seq);
+int L2_rbc_onData(L2_rbcCtx_t* ctx, uint32_t nowMs, uint8_t srcId, uint8_t seq);
+uint8_t L2_rbc_onSync(L2_rbcCtx_t* ctx, uint32_t nowMs, uint8_t srcId, uint8_t next, uint8_t oldest);
+void L2_rbc_onPeerNack(L2_rbcCtx_t* ctx, uint32_t nowMs, uint8_t srcId, uint8_t seq);
+uint8_t L2_rbc_getTx(L2_rbcCtx_t* ctx, uint32_t nowMs, L2_rbcTx_t* tx);
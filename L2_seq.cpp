@@ -0,0 +1,54 @@
+#include "L2_seq.h"
+
+//serial number arithmetic of the L2 sequence numbers (RFC 1982)
+//No mbed dependency, so the host model (tools/seqsim.cpp) runs the same code.
+
+
+uint8_t L2_seq_next(uint8_t seq)
+{
+    return (uint8_t)((seq + 1) & L2_SEQ_MASK);
+}
+
+uint8_t L2_seq_prev(uint8_t seq)
+{
+    return (uint8_t)((seq - 1) & L2_SEQ_MASK);
+}
+
+//distance from b to a in -L2_SEQ_HALF..L2_SEQ_HALF-1 (a - b as if the numbers did not wrap)
+//-L2_SEQ_HALF is the undefined case of RFC 1982 : a and b are not ordered
+int L2_seq_diff(uint8_t a, uint8_t b)
+{
+    int d = (int)((unsigned)(a - b) & L2_SEQ_MASK);
+
+    return (d >= (int)L2_SEQ_HALF) ? d - (int)L2_SEQ_SPACE : d;
+}
+
+//1 if a comes before b
+uint8_t L2_seq_lt(uint8_t a, uint8_t b)
+{
+    int d = L2_seq_diff(a, b);
+
+    return (d < 0 && d != -(int)L2_SEQ_HALF);
+}
+
+uint8_t L2_seq_isValid(uint8_t seq)
+{
+    return ((seq & ~L2_SEQ_MASK) == 0);
+}
+
+//where rxSeq stands against expSeq
+uint8_t L2_seq_check(uint8_t rxSeq, uint8_t expSeq)
+{
+    int d;
+
+    if (L2_seq_isValid(rxSeq) == 0)
+        return L2_SEQ_INVALID;
+
+    d = L2_seq_diff(rxSeq, expSeq);
+    if (d == 0)
+        return L2_SEQ_EXPECTED;
+    if (d == -(int)L2_SEQ_HALF)
+        return L2_SEQ_INVALID;
+
+    return (d < 0) ? L2_SEQ_OLD : L2_SEQ_AHEAD;
+}
@@ -0,0 +1,29 @@
+#include <stdint.h>
+#include "protocol_parameters.h"
+
+//sequence numbers of the L2 header (L2_SEQ_BITS in protocol_parameters.h)
+//the one-byte SEQ field carries serial numbers of L2_SEQ_BITS bits that wrap at L2_SEQ_SPACE.
+//They are compared with serial number arithmetic (RFC 1982) : a is before b when b is less than half
+//the space ahead of a, so the order holds across the wrap as long as the frames in play are within
+//half the space (one PDU in flight per peer here). Two numbers exactly half the space apart are
+//not ordered. The same rules serve the TX sequence numbers, the expected RX ones and the ACK matching.
+#define L2_SEQ_SPACE            (1u << L2_SEQ_BITS)
+#define L2_SEQ_MASK             (L2_SEQ_SPACE - 1)
+#define L2_SEQ_HALF             (L2_SEQ_SPACE >> 1)
+
+#if L2_SEQ_BITS < 2 || L2_SEQ_BITS > 8
+#error "L2_SEQ_BITS must be 2..8 (one byte in the L2 header)"
+#endif
+
+//what L2_seq_check reports for a received sequence number against the expected one
+#define L2_SEQ_EXPECTED         0
+#define L2_SEQ_OLD              1       //before the expected one : already received (duplicate)
+#define L2_SEQ_AHEAD            2       //after the expected one : frames in between are missing
+#define L2_SEQ_INVALID          3       //out of the space, or half the space away (no order)
+
+uint8_t L2_seq_next(uint8_t seq);
+uint8_t L2_seq_prev(uint8_t seq);
+int L2_seq_diff(uint8_t a, uint8_t b);
+uint8_t L2_seq_lt(uint8_t a, uint8_t b);
+uint8_t L2_seq_isValid(uint8_t seq);
+uint8_t L2_seq_check(uint8_t rxSeq, uint8_t expSeq);
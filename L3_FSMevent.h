@@ -3,7 +3,9 @@ typedef enum L3_event
     L3_event_msgRcvd = 2,
     L3_event_dataToSend = 4,
     L3_event_dataSendCnf = 5,
-    L3_event_recfgSrcIdCnf = 6
+    L3_event_recfgSrcIdCnf = 6,
+    L3_event_linkDown = 7,
+    L3_event_linkUp = 8
 } L3_event_e;
 
 
@@ -2,6 +2,18 @@
 #include "L3_msg.h"
 #include "L3_timer.h"
 #include "L3_LLinterface.h"
+#include "L3_sentence.h"
+#include "L3_payoff.h"
+#include "L3_strategy.h"
+#include "L3_snapshot.h"
+#include "L3_history.h"
+#include "L3_group.h"
+#include "L3_spectator.h"
+#include "PDUbuf.h"
+#include "L2_airtime.h"
+#include "MEMstat.h"
+#include "CMDshell.h"
+#include "EVstream.h"
 #include "protocol_parameters.h"
 #include "mbed.h"
 
@@ -10,8 +22,13 @@
 #define L3STATE_SELECTION 1
 #define L3STATE_CHECKING 2
 #define L3STATE_PREDICTION 3
+#define L3STATE_RESYNC 4
 #define L3STATE_GAME_OVER 99
 
+#define L3_LASTMSG_LEN 32 // 재전송용으로 보관하는 마지막 메시지 길이
+
+int dbgmsgL3 = DBGMSG_L3_INIT;
+
 // state variables
 static uint8_t main_state = L3STATE_INITIAL_WAITING;
 static uint8_t prev_state = main_state;
@@ -30,8 +47,10 @@ static int my_choice = 0;                 // 나의 협력/배신 선택 (0:미
 static int peer_choice = 0;               // 상대방의 협력/배신 선택 (0:미정, 1:협력, 2:배신)
 static bool peer_choice_received = false; // 상대방 선택 수신 여부
 static bool result_printed = false;       // 현재 라운드 결과 출력 여부
+static bool game_over_logged = false;     // 게임 종료 이벤트를 보냈는지 (EVstream.h)
 
-static float sentence = 10.0; // 현재 형량 (시작: 10년)
+static uint32_t sentence = L3_SENTENCE_INIT; // 현재 형량 (1/1000년 단위, 시작: 10년)
+static char sentence_str[L3_SENTENCE_STRLEN]; // 형량 출력용 문자열 버퍼
 
 // CHECKING 상태 변수
 static bool my_used_prediction = false;            // 내가 예측게임 기회를 사용했는지 (Y를 선택했을 때만 true 유지)
@@ -56,12 +75,104 @@ static bool has_stored_my_prediction = false;   // 내 예측값이 저장되어
 static int stored_peer_prediction_value = 0;    // 상대방의 예측값
 static bool has_stored_peer_prediction = false; // 상대방 예측값 저장 여부
 
-// SDU (input)
-static uint8_t sdu[1030];
+// 링크 상태 (L2 링크 감시, L2_LINK_DETECTTIME)
+static bool link_down = false;          // 상대방과의 연결이 끊겨 게임이 일시 정지되었는지
+static Timer linkDownTimer;             // 연결이 끊긴 시간 (L3_LINK_ABORTTIME 초과 시 게임 중단)
+static char last_msg[L3_LASTMSG_LEN];   // 마지막으로 보낸 메시지 (연결 복구 후 재전송용)
+
+// 재시작 후 재개 (L3_snapshot.h, RESYNC 상태)
+static Timer resyncTimer;               // 재시작 후 경과 시간 (재개 시간 측정, L3_RESYNC_TIMEOUT)
+static int resync_sent_ms = -1;         // 마지막 RESYNC 요청을 보낸 시각 (-1 : 아직 보내지 않음)
+static uint32_t snapshot_load_us = 0;   // 부팅 시 스냅샷을 읽는 데 걸린 시간
+static bool resumed_round = false;      // 재개 후 첫 라운드 (라운드 기록 표시용)
+static L3_snapshot_t resume_snap;       // 재개할 라운드 경계 (진행 중인 전송이 끝나면 되돌림)
+static bool resume_waiting = false;
+
+// N명 게임 (목적지 ID가 L3_GROUP_ID, L3_group.h)
+static bool group_mode = false;         // 선택을 브로드캐스트로 주고받고 집계로 형량을 계산하는 게임인지
+static Timer groupTimer;                // 대기실 : 내 READY 후 경과 시간, 라운드 : 라운드 시작 후 경과 시간 (L3_GROUP_DEADLINE)
+static int group_ready_ms = -1;         // 마지막 READY를 보낸 시각 (-1 : 아직 동의하지 않음)
+static bool group_busy_printed = false; // 진행 중인 다른 게임 안내를 한 번만 하도록
+static int group_sent_ms = 0;           // 이번 라운드의 내 선택을 (다시) 보낼 기준 시각
+static int group_prev_choice = 0;       // 지난 라운드의 내 선택 (그 라운드에 남은 참가자에게 다시 보냄)
+static bool group_prev_resent = false;
+static uint32_t group_rounds = 0;       // 끝난 라운드 수 (라운드 지연 통계)
+static uint32_t group_deadlines = 0;    // 그중 마감으로 끝난 라운드 수
+static uint32_t group_round_ms_sum = 0;
+static uint32_t group_round_ms_max = 0;
+
+// 관전 (L3_spectator.h)
+static bool spectator_mode = false;     // 목적지 ID가 L3_SPECTATE_ID : 게임을 하지 않고 선수들의 라운드 결과로 점수판만 만듦
+static Timer specTimer;                 // 관전 노드 : 스냅샷 요청 시각, 선수 : 스냅샷 응답 간격 (L3_SPEC_SNAPTIME)
+static int spec_snap_ms = -1;           // 마지막으로 스냅샷을 보낸 시각 (-1 : 아직 없음)
+static uint32_t spec_records_sent = 0;
+static uint32_t spec_snaps_sent = 0;
 
 // serial port interface
 static Serial pc(USBTX, USBRX);
+static uint8_t myId;
 static uint8_t myDestId;
+static uint8_t maxDataSize = L3_MAXDATASIZE; // 보내는 메시지 버퍼 크기 (셸의 maxdata, L3_MAXDATASIZE 이하)
+
+
+// 이벤트 스트림 출력 (EVstream.h) : 게임 안내문과 같은 시리얼 포트로 한 바이트씩
+static void L3service_putByte(uint8_t b)
+{
+    pc.putc(b);
+}
+
+// 메시지 전송 함수 : 공유 버퍼에 메시지를 직접 작성하여 L2로 넘김 (중간 복사 없음)
+static void L3service_sendMsg(const char *fmt, ...)
+{
+    uint8_t sdu = L3_LLI_allocSdu();
+    va_list args;
+    int len;
+
+    if (sdu == PDUBUF_INVALID)
+    {
+        pc.printf("[System][WARNING] 메시지 버퍼가 부족하여 전송하지 못했습니다.\n");
+        return;
+    }
+
+    va_start(args, fmt);
+    len = vsnprintf((char *)PDUbuf_getData(sdu), maxDataSize, fmt, args);
+    va_end(args);
+    if (len > maxDataSize - 1)
+        len = maxDataSize - 1;
+
+    PDUbuf_setLen(sdu, len);
+    strncpy(last_msg, (char *)PDUbuf_getData(sdu), sizeof(last_msg) - 1);
+    L3_LLI_dataReq(sdu, myDestId); // 버퍼 소유권은 L2로 넘어감
+}
+
+// 관전 메시지 전송 : 모든 노드에게 브로드캐스트 (ACK 없음, 전송 실패 시 다시 보내는 게임 메시지(last_msg)가 아님)
+static void L3service_broadcastSpec(const char *msg)
+{
+    uint8_t sdu = L3_LLI_allocSdu();
+    int len = strlen(msg);
+
+    if (sdu == PDUBUF_INVALID)
+        return; // 관전 노드는 빠진 기록을 스냅샷으로 맞춤
+    if (len > maxDataSize - 1)
+        len = maxDataSize - 1;
+    memcpy(PDUbuf_getData(sdu), msg, len);
+    PDUbuf_setLen(sdu, len);
+    L3_LLI_dataReq(sdu, L3_SPEC_DEST);
+}
+
+// 끝난 라운드를 관전 노드에게 알림 (L3_SPEC_ENABLE) : 라운드마다 브로드캐스트 한 번
+static void L3service_publishRound(int otherChoice)
+{
+    char buf[L3_SPEC_MSGLEN];
+
+    if (!L3_SPEC_ENABLE)
+        return;
+    L3_spec_recordRound((uint16_t)round_cnt, (uint8_t)my_choice, (uint8_t)otherChoice, sentence);
+    if (L3_spec_formatRecord(buf, sizeof(buf)) >= (int)sizeof(buf))
+        return; // 프레임 하나에 들어가지 않음 : 관전 노드는 빠진 기록으로 보고 스냅샷을 요청함
+    L3service_broadcastSpec(buf);
+    spec_records_sent++;
+}
 
 
 // 결과 출력 함수
@@ -73,28 +184,37 @@ static void checkAndShowResult()
         // 내 선택과 상대방 선택 모두 완료되고 아직 결과가 출력되지 않았다면
         if (my_choice > 0 && peer_choice > 0 && !result_printed)
         {
+            L3_history_t rec; // 라운드 기록 (L3_history.h)
+
+            rec.myPred = L3_HISTORY_PRED_NONE;
+            rec.peerPred = L3_HISTORY_PRED_NONE;
             pc.printf("\n[RESULT] 당신의 선택: %s\n", (my_choice == 1 ? "협력" : "배신"));
             pc.printf("[RESULT] 상대방의 선택: %s\n", (peer_choice == 1 ? "협력" : "배신"));
 
             // 내가 한 예측 결과 확인 (이전 라운드에서 예측했다면)
             if (has_stored_my_prediction)
             {
-                if (stored_my_prediction_value == peer_choice) // 내 예측이 상대방의 실제 선택과 일치하면
-                {
-                    sentence *= (2.0f / 3.0f); // 형량 감소
-                    pc.printf("\n🎯 예측 성공! 형량이 2/3로 줄어듭니다.\n");
-                }
-                else // 내 예측이 틀렸다면
-                {
-                    sentence *= (4.0f / 3.0f); // 형량 증가
-                    pc.printf("\n❌ 예측 실패! 형량이 4/3로 늘어납니다.\n");
-                }
+                int hit = (stored_my_prediction_value == peer_choice); // 내 예측이 상대방의 실제 선택과 일치하는지
+                uint8_t num, den;
+
+                sentence = L3_payoff_applyPrediction(sentence, hit); // 예측 결과에 따라 형량 감소/증가
+                L3_payoff_getPredictionRatio(hit, &num, &den);
+                rec.myPred = hit ? L3_HISTORY_PRED_HIT : L3_HISTORY_PRED_MISS;
+                EVstream_emit(EVSTREAM_PREDICT, round_cnt, myId, stored_my_prediction_value, hit ? EVSTREAM_PRED_HIT : EVSTREAM_PRED_MISS);
+                EVstream_emit(EVSTREAM_SENTENCE, round_cnt, EVSTREAM_CAUSE_PREDICT, peer_choice, sentence);
+                if (hit)
+                    pc.printf("\n🎯 예측 성공! 형량이 %i/%i로 줄어듭니다.\n", num, den);
+                else
+                    pc.printf("\n❌ 예측 실패! 형량이 %i/%i로 늘어납니다.\n", num, den);
                 has_stored_my_prediction = false; // 예측 결과 사용 완료, 다음 라운드를 위해 초기화
             }
 
             // 상대방이 한 예측 결과 확인 (상대방이 예측했다면)
             if (has_stored_peer_prediction)
             {
+                rec.peerPred = (stored_peer_prediction_value == my_choice) ? L3_HISTORY_PRED_HIT : L3_HISTORY_PRED_MISS;
+                EVstream_emit(EVSTREAM_PREDICT, round_cnt, myDestId, stored_peer_prediction_value,
+                              (stored_peer_prediction_value == my_choice) ? EVSTREAM_PRED_HIT : EVSTREAM_PRED_MISS);
                 if (stored_peer_prediction_value == my_choice) // 상대방 예측이 나의 실제 선택과 일치하면
                 {
                     pc.printf("\n[INFO] 상대방이 당신의 선택을 정확히 예측했습니다.\n");
@@ -106,27 +226,32 @@ static void checkAndShowResult()
                 has_stored_peer_prediction = false; // 상대방 예측 결과 사용 완료, 다음 라운드를 위해 초기화
             }
 
-            // 기본 딜레마 게임 결과 계산 및 형량 반영
-            if (my_choice == 1 && peer_choice == 1)      // 둘 다 협력
-                sentence *= 1.0 / 3.0;                   // 크게 감형
-            else if (my_choice == 1 && peer_choice == 2) // 나만 협력, 상대 배신
-                sentence *= 2.0;                         // 나만 크게 증감
-            else if (my_choice == 2 && peer_choice == 1) // 나만 배신, 상대 협력
-                sentence *= 0.5;                         // 나만 크게 감형
-            else                                         // 둘 다 배신
-                sentence *= 1.5;                         // 둘 다 조금 증감
-
-            pc.printf("\n📣 당신의 형량은 %.1f년입니다.\n", sentence);
+            // 기본 딜레마 게임 결과 계산 및 형량 반영 (L3_payoff.cpp의 배율 표 참조)
+            sentence = L3_payoff_applyChoice(sentence, my_choice, peer_choice);
+            EVstream_emit(EVSTREAM_SENTENCE, round_cnt, EVSTREAM_CAUSE_ROUND, peer_choice, sentence);
+
+            pc.printf("\n📣 당신의 형량은 %s년입니다.\n", L3_sentence_format(sentence, sentence_str));
+            L3_strategy_recordRound(my_choice, peer_choice); // 자동 플레이 전략에 라운드 결과 기록
+
+            rec.newGame = (round_cnt == 1);
+            rec.resumed = resumed_round;
+            rec.myChoice = (uint8_t)my_choice;
+            rec.peerChoice = (uint8_t)peer_choice;
+            rec.sentence = sentence;
+            L3_history_append(&rec); // 라운드 기록에 덧붙임 (일정한 비용, 플래시 기록은 7라운드에 한 번)
+            L3service_publishRound(peer_choice); // 관전 노드에게 라운드 결과
+            resumed_round = false;
             result_printed = true; // 결과 출력 완료 플래그 설정;
         }
 
     }
 }
 
-// 사용자 입력 처리 함수
-static void L3service_processInputWord(void)
+// 사용자 입력 처리 함수 (키보드 또는 자동 플레이 전략에서 들어온 문자 하나를 처리)
+static void L3service_processInputChar(char c)
 {
-    char c = pc.getc(); // 시리얼 포트에서 문자 하나를 읽어옴
+    if (spectator_mode) // 관전 노드는 게임 입력을 받지 않음
+        return;
 
     // L3STATE_INITIAL_WAITING 상태 처리: 게임 시작 동의 여부 입력
     if (main_state == L3STATE_INITIAL_WAITING && !ready_to_play)
@@ -134,9 +259,13 @@ static void L3service_processInputWord(void)
         if (c == 'Y' || c == 'y')
         {
             ready_to_play = true;                               // 게임 시작 동의
-            strcpy((char *)sdu, "READY");                       // "READY" 메시지 생성
-            L3_LLI_dataReqFunc(sdu, strlen("READY"), myDestId); // 상대방에게 전송
-            pc.printf("[System] 게임 시작을 동의했습니다. 상대방을 기다리는 중...\n");
+            L3service_sendMsg("READY");                         // "READY" 메시지를 상대방에게 전송 (N명 게임 : 모든 노드에게)
+            if (group_mode) // 대기실 시간과 READY 재전송 (L3_GROUP_JOINTIME, L3_GROUP_READYTIME)
+            {
+                groupTimer.reset();
+                group_ready_ms = 0;
+            }
+            pc.printf("[System] 게임 시작을 동의했습니다. %s 기다리는 중...\n", group_mode ? "다른 참가자를" : "상대방을");
         }
         else if (c == 'N' || c == 'n')
         {
@@ -151,8 +280,15 @@ static void L3service_processInputWord(void)
         if (c == '1' || c == '2')
         {
             my_choice = (c == '1') ? 1 : 2;                         // 내 선택 저장
-            sprintf((char *)sdu, "CHOICE:%d", my_choice);           // 선택 메시지 생성
-            L3_LLI_dataReqFunc(sdu, strlen((char *)sdu), myDestId); // 상대방에게 전송
+            EVstream_emit(EVSTREAM_CHOICE, round_cnt, myId, my_choice, 0);
+            if (group_mode) // N명 게임 : 라운드 번호, 내가 아는 인원과 함께 모든 노드에게 (결과는 집계가 끝나면 FSM에서)
+            {
+                L3service_sendMsg("CHOICE:%d:%d:%d", my_choice, round_cnt, L3_group_getOthers() + 1);
+                group_sent_ms = groupTimer.read_ms();
+                pc.printf("\n[System] 선택을 완료했습니다. 다른 참가자를 기다리는 중...\n");
+                return;
+            }
+            L3service_sendMsg("CHOICE:%d", my_choice);              // 선택 메시지를 상대방에게 전송
             if (peer_choice == 0)                                   // 상대방 선택이 아직이면 대기 메시지
                 pc.printf("\n[System] 선택을 완료했습니다. 상대방을 기다리는 중...\n");
             else // 상대방 선택도 이미 완료되었으면 결과 계산 중 메시지
@@ -173,8 +309,7 @@ static void L3service_processInputWord(void)
         if (c == 'Y' || c == 'y')
         {
             my_prediction_yn_choice = 1;                            // Y (참여)
-            strcpy((char *)sdu, "PREDICT_Y");                       // "PREDICT_Y" 메시지 생성
-            L3_LLI_dataReqFunc(sdu, strlen("PREDICT_Y"), myDestId); // 상대방에게 전송
+            L3service_sendMsg("PREDICT_Y");                         // "PREDICT_Y" 메시지를 상대방에게 전송
             predict_yn_input_done = true;                           // 내 Y/N 입력 완료
             // my_used_prediction은 PREDICTION 상태로 진입할 때 (실제로 예측을 시작할 때) true로 설정
             pc.printf("[System] 예측 게임에 도전합니다.\n");
@@ -182,8 +317,7 @@ static void L3service_processInputWord(void)
         else if (c == 'N' || c == 'n')
         {
             my_prediction_yn_choice = 2;                            // N (거절)
-            strcpy((char *)sdu, "PREDICT_N");                       // "PREDICT_N" 메시지 생성
-            L3_LLI_dataReqFunc(sdu, strlen("PREDICT_N"), myDestId); // 상대방에게 전송
+            L3service_sendMsg("PREDICT_N");                         // "PREDICT_N" 메시지를 상대방에게 전송
             predict_yn_input_done = true;                           // 내 Y/N 입력 완료
             // 'N'을 선택하면 기회는 소진되지 않고 다음 라운드로 이월됩니다.
             pc.printf("[System] 예측 게임을 거절합니다.\n");
@@ -201,6 +335,7 @@ static void L3service_processInputWord(void)
             prediction_input_received = true;              // 내 예측값 입력 완료
             stored_my_prediction_value = prediction_value; // 다음 라운드 결과 계산을 위해 예측값 저장
             has_stored_my_prediction = true;               // 내 예측값이 저장되었음을 표시
+            EVstream_emit(EVSTREAM_PREDICT, round_cnt, myId, prediction_value, EVSTREAM_PRED_MADE);
             pc.printf("[System] 예측을 완료했습니다.\n");
         }
         else
@@ -211,6 +346,123 @@ static void L3service_processInputWord(void)
     }
 }
 
+// 시리얼 입력 인터럽트 : 수동 모드일 때만 키보드 입력을 게임에 반영 ('?'는 모드와 관계없이 메모리 보고, ':'는 제어 셸)
+static void L3service_processInputWord(void)
+{
+    char c = pc.getc(); // 시리얼 포트에서 문자 하나를 읽어옴
+
+    MEMstat_sampleIsrStack();
+    if (CMDshell_inputChar(c)) // ':'로 시작하는 줄은 제어 셸 명령 (실행은 메인 루프에서)
+        return;
+    if (c == MEMSTAT_REPORT_KEY) // 메모리 사용량 보고 요청 (출력은 메인 루프에서)
+    {
+        MEMstat_requestReport();
+        return;
+    }
+    if (link_down) // 연결이 끊긴 동안은 입력을 받지 않음 (메시지를 보낼 수 없음)
+    {
+        pc.printf("[System] 상대방과 다시 연결될 때까지 기다려주세요.\n");
+        return;
+    }
+    if (L3_strategy_getSelected() == L3_STRATEGY_MANUAL)
+        L3service_processInputChar(c);
+}
+
+// 링크 상태 처리 : L2가 상대방과의 연결 끊김/복구를 알리면 게임을 일시 정지/재개하고,
+// L3_LINK_ABORTTIME 초 안에 복구되지 않으면 게임을 중단함 (L2_LINK_DETECTTIME이 0이면 알림 없음)
+// 연결이 끊겨 있으면 true
+static bool L3service_checkLink(void)
+{
+    uint32_t ms = L3_LLI_getLinkMs();
+
+    if (L3_event_checkEventFlag(L3_event_linkDown))
+    {
+        L3_event_clearEventFlag(L3_event_linkDown);
+        EVstream_emit(EVSTREAM_LINK, round_cnt, L3_LLI_getLinkPeerId(), 0, ms);
+        if (L3_LLI_getLinkPeerId() == myDestId && !link_down)
+        {
+            link_down = true;
+            linkDownTimer.reset();
+            linkDownTimer.start();
+            pc.printf("\n[System] 상대방과의 연결이 끊겼습니다 (%lu.%lu초 동안 응답 없음). 재연결을 기다리는 동안 게임을 일시 정지합니다.\n",
+                      (unsigned long)(ms / 1000), (unsigned long)(ms / 100 % 10));
+        }
+    }
+
+    if (L3_event_checkEventFlag(L3_event_linkUp))
+    {
+        L3_event_clearEventFlag(L3_event_linkUp);
+        EVstream_emit(EVSTREAM_LINK, round_cnt, L3_LLI_getLinkPeerId(), 1, ms);
+        if (L3_LLI_getLinkPeerId() == myDestId)
+        {
+            if (link_down)
+            {
+                link_down = false;
+                linkDownTimer.stop();
+                pc.printf("\n[System] 상대방과 다시 연결되었습니다 (%lu.%lu초 동안 끊김). 게임을 계속합니다.\n",
+                          (unsigned long)(ms / 1000), (unsigned long)(ms / 100 % 10));
+            }
+            // 끊긴 동안 전송에 실패한 마지막 메시지를 다시 보냄
+            if (L3_LLI_getLastCnfRes() == 0 && last_msg[0] != '\0' && L3_LLI_getTxPending() == 0)
+            {
+                char msg[L3_LASTMSG_LEN];
+
+                strcpy(msg, last_msg);
+                pc.printf("[System] 전송하지 못한 메시지를 다시 보냅니다.\n");
+                L3service_sendMsg("%s", msg);
+            }
+        }
+    }
+
+    // 게임 도중 연결이 너무 오래 끊기면 게임 중단
+    if (link_down && main_state != L3STATE_INITIAL_WAITING && main_state != L3STATE_GAME_OVER &&
+        linkDownTimer.read_ms() >= L3_LINK_ABORTTIME * 1000)
+    {
+        pc.printf("\n[System] 상대방과 %d초 동안 연결되지 않아 게임을 중단합니다.\n", L3_LINK_ABORTTIME);
+        main_state = L3STATE_GAME_OVER;
+    }
+
+    return link_down;
+}
+
+// 자동 플레이 : 입력을 기다리는 상태이면 전략이 정한 문자를 입력으로 넣음
+// 이전 메시지의 전송이 끝나지 않았으면 (L2 SDU 덮어쓰기 방지) 다음 패스로 미룸
+static void L3service_autoPlay(void)
+{
+    char c = 0;
+
+    if (L3_strategy_getSelected() == L3_STRATEGY_MANUAL || L3_LLI_getTxPending() > 0)
+        return;
+
+    if (main_state == L3STATE_INITIAL_WAITING && prompt_sent && !ready_to_play)
+        c = 'Y';
+    else if (main_state == L3STATE_SELECTION && selection_msg_printed && my_choice == 0)
+        c = L3_strategy_choose();
+    else if (main_state == L3STATE_CHECKING && predict_propmt_sent && my_prediction_yn_choice == 0 && !my_used_prediction)
+        c = L3_strategy_decidePrediction();
+    else if (main_state == L3STATE_PREDICTION && my_prediction_yn_choice == 1 && !prediction_input_received)
+        c = L3_strategy_predict();
+
+    if (c != 0)
+        L3service_processInputChar(c);
+}
+
+// 자동 플레이 통계 출력 (라운드/초, 게임/시간)
+static void L3service_printAutoPlayStats(void)
+{
+    uint32_t rounds, games, elapsedMs;
+
+    L3_strategy_getStats(&rounds, &games, &elapsedMs);
+    if (elapsedMs == 0)
+        elapsedMs = 1;
+
+    pc.printf("[AUTO] %s : games %lu, rounds %lu, %lu.%lu rounds/s, %lu games/h\n", L3_strategy_getName(L3_strategy_getSelected()),
+              (unsigned long)games, (unsigned long)rounds,
+              (unsigned long)((uint64_t)rounds * 1000 / elapsedMs), (unsigned long)(((uint64_t)rounds * 10000 / elapsedMs) % 10),
+              (unsigned long)((uint64_t)games * 3600000 / elapsedMs));
+    L2_airtime_printReport(); // 노드별 전송 시간(airtime)과 airtime 1초당 goodput
+}
+
 // 라운드 초기화 (다음 라운드 시작 전 호출)
 void resetForNextRound()
 {
@@ -246,12 +498,537 @@ void resetForNextRound()
         peer_prediction_yn_choice = 2;
 }
 
+// 게임 초기화 (자동 플레이에서 새 게임 시작 전 호출)
+// peer_ready는 상대방의 READY가 먼저 도착했을 수 있으므로 여기서 초기화하지 않음
+static void resetForNewGame()
+{
+    round_cnt = 0;
+    sentence = L3_SENTENCE_INIT;
+    game_over_logged = false;
+    ready_to_play = false;
+    prompt_sent = false;
+    my_used_prediction = false;
+    peer_used_prediction = false;
+    has_stored_my_prediction = false;
+    has_stored_peer_prediction = false;
+    resetForNextRound();
+    L3_strategy_newGame();
+    L3_group_reset();
+    group_ready_ms = -1;
+    group_busy_printed = false;
+    group_prev_choice = 0;
+}
+
+// 라운드 경계의 게임 상태를 스냅샷으로 기록 (재시작 후 이 라운드부터 재개할 수 있도록)
+static void L3service_saveSnapshot(void)
+{
+    L3_snapshot_t snap;
+
+    if (group_mode) // 재개는 두 노드 사이의 RESYNC로만 가능
+        return;
+    snap.round = (uint16_t)round_cnt;
+    snap.sentence = sentence;
+    snap.myUsed = my_used_prediction;
+    snap.peerUsed = peer_used_prediction;
+    snap.myPrediction = has_stored_my_prediction ? (uint8_t)stored_my_prediction_value : 0;
+    snap.peerPrediction = has_stored_peer_prediction ? (uint8_t)stored_peer_prediction_value : 0;
+    L3_snapshot_save(&snap);
+}
+
+// 스냅샷의 라운드 경계로 게임 상태를 되돌리고 다음 라운드의 선택부터 진행
+// 앞서 보낸 메시지의 DATA_CNF가 모두 돌아온 뒤에 되돌림 (늦게 온 DATA_CNF가 재개한 라운드의 전송으로 세어지지 않도록)
+static void L3service_resume(const L3_snapshot_t *snap)
+{
+    resume_snap = *snap;
+    resume_waiting = true;
+}
+
+static void L3service_applyResume(const L3_snapshot_t *snap)
+{
+    if (main_state == L3STATE_RESYNC) // 재시작한 쪽 : 재개에 걸린 시간
+    {
+        pc.printf("[RESUME] 라운드 %u부터 재개 : 재시작 후 %d ms (스냅샷 읽기 %lu us)\n", snap->round, resyncTimer.read_ms(),
+                  (unsigned long)snapshot_load_us);
+        resyncTimer.stop();
+    }
+
+    round_cnt = snap->round;
+    sentence = snap->sentence;
+    my_used_prediction = snap->myUsed;
+    peer_used_prediction = snap->peerUsed;
+    has_stored_my_prediction = (snap->myPrediction != 0);
+    stored_my_prediction_value = snap->myPrediction;
+    has_stored_peer_prediction = (snap->peerPrediction != 0);
+    stored_peer_prediction_value = snap->peerPrediction;
+    ready_to_play = true;
+    prompt_sent = true;
+    peer_ready = false;
+    last_msg[0] = '\0';       // 되돌린 라운드의 메시지는 다시 보내지 않음
+    resumed_round = true;
+    resetForNextRound();
+    main_state = L3STATE_SELECTION;
+}
+
+// 재개할 수 없음 : 스냅샷을 버리고 새 게임
+static void L3service_abandonGame(void)
+{
+    L3_snapshot_clear();
+    resetForNewGame();
+    main_state = L3STATE_INITIAL_WAITING;
+}
+
+// 재개 요청과 응답 처리 (모든 상태에서 RESYNC 메시지를 소비함)
+// 재시작한 노드 : RESYNC:<최근 스냅샷 라운드>:<직전 스냅샷 라운드>
+// 상대방 : 양쪽 모두 가진 가장 최근 라운드로 되돌리고 RESYNC_OK:<라운드>:<그 라운드의 내 형량>, 없으면 RESYNC_NO (새 게임)
+// 양쪽이 함께 재시작하면 서로의 요청에 같은 라운드로 답하게 되고, 먼저 재개한 뒤 도착한 응답은 무시함
+static void L3service_handleResync(void)
+{
+    char *msg = (char *)L3_LLI_getMsgPtr(); // 수신 메시지 (널 종료됨, 복사 없이 수신 버퍼를 직접 참조)
+    L3_snapshot_t snap;
+    uint16_t latest, previous;
+
+    if (!L3_event_checkEventFlag(L3_event_msgRcvd) || strncmp(msg, "RESYNC", 6) != 0)
+        return;
+    L3_event_clearEventFlag(L3_event_msgRcvd);
+
+    if (strncmp(msg, "RESYNC:", 7) == 0)
+    {
+        char *next;
+        unsigned long peerLatest = strtoul(msg + 7, &next, 10);
+        unsigned long peerPrevious = (*next == ':') ? strtoul(next + 1, NULL, 10) : peerLatest;
+        bool in_game = (main_state != L3STATE_INITIAL_WAITING && main_state != L3STATE_GAME_OVER);
+        long round = -1;
+
+        if (in_game && L3_snapshot_getRounds(&latest, &previous) > 0)
+        {
+            if (latest == peerLatest || latest == peerPrevious)
+                round = latest;
+            else if (previous == peerLatest || previous == peerPrevious)
+                round = previous;
+        }
+
+        if (round >= 0 && L3_snapshot_rewind((uint16_t)round, &snap))
+        {
+            pc.printf("\n[System] 상대방이 재시작했습니다. 라운드 %ld가 끝난 시점으로 돌아가 게임을 이어갑니다.\n", round);
+            L3service_resume(&snap);
+            L3service_sendMsg("RESYNC_OK:%u:%lu", snap.round, (unsigned long)snap.sentence);
+        }
+        else
+        {
+            L3service_sendMsg("RESYNC_NO");
+            if (in_game)
+            {
+                pc.printf("\n[System] 상대방이 재시작했지만 이어갈 라운드가 없어 새 게임을 시작합니다.\n");
+                L3service_abandonGame();
+            }
+        }
+        return;
+    }
+
+    if (main_state != L3STATE_RESYNC) // 이미 재개했거나 재개를 기다리지 않음
+        return;
+
+    if (strncmp(msg, "RESYNC_OK:", 10) == 0)
+    {
+        char *next;
+        unsigned long round = strtoul(msg + 10, &next, 10);
+        unsigned long peerSentence = (*next == ':') ? strtoul(next + 1, NULL, 10) : 0;
+        char peer_sentence_str[L3_SENTENCE_STRLEN];
+
+        if (L3_snapshot_rewind((uint16_t)round, &snap))
+        {
+            pc.printf("\n[System] 상대방과 라운드를 맞췄습니다. 라운드 %lu가 끝난 시점부터 이어갑니다 (내 형량 %s년, 상대방 형량 %s년).\n",
+                      round, L3_sentence_format(snap.sentence, sentence_str), L3_sentence_format(peerSentence, peer_sentence_str));
+            L3service_resume(&snap);
+            return;
+        }
+    }
+    pc.printf("\n[System] 상대방과 이어갈 라운드가 없어 새 게임을 시작합니다.\n");
+    L3service_abandonGame();
+}
+
+// 관전 메시지 처리 (선수 : 모든 상태에서 SPEC으로 시작하는 메시지를 소비함)
+// 나에게 온 스냅샷 요청에는 L3_SPEC_SNAPTIME초에 한 번만 답함 (여러 관전 노드의 요청에 스냅샷 하나)
+static void L3service_handleSpectator(void)
+{
+    char *msg = (char *)L3_LLI_getMsgPtr(); // 수신 메시지 (널 종료됨, 복사 없이 수신 버퍼를 직접 참조)
+
+    if (!L3_event_checkEventFlag(L3_event_msgRcvd) || strncmp(msg, "SPEC", 4) != 0)
+        return;
+    L3_event_clearEventFlag(L3_event_msgRcvd);
+
+    if (strncmp(msg, "SPECR:", 6) == 0 && atoi(msg + 6) == myId && L3_SPEC_ENABLE && L3_spec_hasRecord() &&
+        (spec_snap_ms < 0 || specTimer.read_ms() - spec_snap_ms >= L3_SPEC_SNAPTIME * 1000))
+    {
+        char buf[L3_SPEC_MSGLEN];
+
+        if (L3_spec_formatSnapshot(buf, sizeof(buf)) >= (int)sizeof(buf))
+            return;
+        L3service_broadcastSpec(buf);
+        spec_snap_ms = specTimer.read_ms();
+        spec_snaps_sent++;
+    }
+}
+
+// 배율 num/den을 안내문으로 출력 ("2배로 늘어납니다", "1/3배로 줄어듭니다")
+static void L3service_printRatio(uint8_t num, uint8_t den)
+{
+    if (num == den)
+    {
+        pc.printf("그대로입니다");
+        return;
+    }
+    if (den == 1)
+        pc.printf("%i배", num);
+    else
+        pc.printf("%i/%i배", num, den);
+    pc.printf(num < den ? "로 줄어듭니다" : "로 늘어납니다");
+}
+
+// 협력/배신 규칙 안내 : 빌드된 규칙 집합(L3_PAYOFF_RULESET)의 배율 표에서 만듦
+static void L3service_printChoiceRules(void)
+{
+    uint8_t num, den;
+
+    pc.printf("  1. 협력\n");
+    pc.printf("\t두 사람이 모두 협력을 선택할 경우, 각자 형량이 ");
+    L3_payoff_getChoiceRatio(L3_CHOICE_COOPERATE, L3_CHOICE_COOPERATE, &num, &den);
+    L3service_printRatio(num, den);
+    pc.printf(".\n");
+    pc.printf("  2. 배신\n");
+    pc.printf("\t한 사람이 협력, 다른 한 사람이 배신을 선택할 경우,\n");
+    pc.printf("\t  - 협력을 고른 사람은 형량이 ");
+    L3_payoff_getChoiceRatio(L3_CHOICE_COOPERATE, L3_CHOICE_BETRAY, &num, &den);
+    L3service_printRatio(num, den);
+    pc.printf(".\n");
+    pc.printf("\t  - 배신을 고른 사람은 형량이 ");
+    L3_payoff_getChoiceRatio(L3_CHOICE_BETRAY, L3_CHOICE_COOPERATE, &num, &den);
+    L3service_printRatio(num, den);
+    pc.printf(".\n");
+    pc.printf("\t모든 사람이 배신을 선택할 경우,\n");
+    pc.printf("\t  - 두 사람 모두 형량이 ");
+    L3_payoff_getChoiceRatio(L3_CHOICE_BETRAY, L3_CHOICE_BETRAY, &num, &den);
+    L3service_printRatio(num, den);
+    pc.printf(".\n");
+}
+
+static const char *L3service_choiceName(uint8_t choice)
+{
+    return choice == L3_CHOICE_COOPERATE ? "협력" : (choice == L3_CHOICE_BETRAY ? "배신" : "?");
+}
+
+// 관전 노드 : 선수들의 라운드 결과와 스냅샷으로 점수판을 갱신하고, 기록이 빠진 선수에게 스냅샷 요청
+static void L3service_runSpectator(void)
+{
+    uint32_t nowMs = specTimer.read_ms();
+    int id;
+
+    if (L3_event_checkEventFlag(L3_event_msgRcvd))
+    {
+        char *msg = (char *)L3_LLI_getMsgPtr(); // 수신 메시지 (널 종료됨, 복사 없이 수신 버퍼를 직접 참조)
+        uint8_t src = L3_LLI_getSrcId();
+        int res;
+
+        L3_event_clearEventFlag(L3_event_msgRcvd);
+        res = L3_spec_onMsg(src, msg, nowMs);
+        if (res == L3_SPEC_UPDATED || res == L3_SPEC_GAP)
+        {
+            const L3_specPlayer_t *p = L3_spec_find(src);
+
+            pc.printf("[SPEC] 노드 %d : 라운드 %u, %s/%s, 형량 %s년, 협력 %u 배신 %u%s\n", p->id, p->round,
+                      L3service_choiceName(p->myChoice), L3service_choiceName(p->otherChoice),
+                      L3_sentence_format(p->sentence, sentence_str), p->coop, p->betray,
+                      p->synced ? "" : " (빠진 기록 : 집계를 맞추는 중)");
+        }
+    }
+
+    if (L3_LLI_getTxPending() == 0 && (id = L3_spec_nextRequest(nowMs)) >= 0)
+    {
+        char buf[L3_SPEC_MSGLEN];
+
+        snprintf(buf, sizeof(buf), "SPECR:%d", id);
+        L3service_broadcastSpec(buf);
+    }
+}
+
+// N명 게임의 선택 메시지 CHOICE:<선택>:<라운드>:<보낸 노드가 아는 인원> 해석 : 형식이 맞지 않으면 false
+// 인원은 첫 라운드의 참가자를 모두 기다리는 데 씀 (READY를 놓쳐 모르는 참가자가 있을 수 있음, 없으면 0)
+static bool L3service_parseGroupChoice(const char *msg, int *choice, uint16_t *round, uint8_t *players)
+{
+    char *next;
+
+    if (strncmp(msg, "CHOICE:", 7) != 0)
+        return false;
+    *choice = (int)strtol(msg + 7, &next, 10);
+    if (*next != ':' || (*choice != 1 && *choice != 2))
+        return false;
+    *round = (uint16_t)strtoul(next + 1, &next, 10);
+    *players = (*next == ':') ? (uint8_t)strtoul(next + 1, NULL, 10) : 0;
+    return true;
+}
+
+// N명 게임 대기실 : READY를 보낸 노드를 참가자로 모으고, L3_GROUP_PLAYERS명이 모이거나 내 READY 후
+// L3_GROUP_JOINTIME초가 지나면 (2명 이상) 시작. 먼저 시작한 노드의 첫 라운드 선택도 시작 신호로 받음
+// 내 READY는 시작할 때까지 L3_GROUP_READYTIME초마다 다시 보냄 (브로드캐스트는 ACK가 없어 손실될 수 있음)
+static void L3service_runGroupLobby(void)
+{
+    bool started = false; // 다른 노드가 첫 라운드를 시작함
+
+    if (L3_event_checkEventFlag(L3_event_msgRcvd))
+    {
+        char *msg = (char *)L3_LLI_getMsgPtr(); // 수신 메시지 (널 종료됨, 복사 없이 수신 버퍼를 직접 참조)
+        uint8_t src = L3_LLI_getSrcId();
+        uint8_t others = L3_group_getOthers();
+        int choice;
+        uint16_t round;
+        uint8_t players;
+
+        L3_event_clearEventFlag(L3_event_msgRcvd);
+        if (strcmp(msg, "READY") == 0)
+            L3_group_join(src);
+        else if (ready_to_play && L3service_parseGroupChoice(msg, &choice, &round, &players))
+        {
+            if (round == 1)
+            {
+                L3_group_onChoice(src, round, choice); // 첫 라운드 선택으로 집계 (보낸 노드도 참가자로)
+                L3_group_expect(players);
+                started = true;
+            }
+            else if (!group_busy_printed) // 이미 진행 중인 게임 : 끝난 뒤 다음 게임에 참가
+            {
+                pc.printf("[System] 다른 참가자들의 게임이 진행 중입니다. 그 게임이 끝나면 다음 게임을 시작합니다.\n");
+                group_busy_printed = true;
+            }
+        }
+        if (L3_group_getOthers() > others)
+            pc.printf("[System] 참가자 %d이(가) 게임 시작에 동의했습니다 (나를 빼고 %d명).\n", src, L3_group_getOthers());
+    }
+
+    if (!ready_to_play)
+        return;
+
+    if (started || L3_group_getOthers() + 1 >= L3_GROUP_PLAYERS ||
+        (L3_group_getOthers() > 0 && groupTimer.read_ms() >= L3_GROUP_JOINTIME * 1000))
+    {
+        pc.printf("\n[System] %d명이 게임을 시작합니다.\n", L3_group_getOthers() + 1);
+        main_state = L3STATE_SELECTION;
+    }
+    else if (groupTimer.read_ms() - group_ready_ms >= L3_GROUP_READYTIME * 1000 && L3_LLI_getTxPending() == 0)
+    {
+        L3service_sendMsg("READY");
+        group_ready_ms = groupTimer.read_ms() + rand() % 1000; // 같은 때 동의한 노드들의 READY가 계속 겹치지 않도록
+    }
+}
+
+// N명 게임의 라운드 결과 : 도착한 선택의 집계로 형량을 계산하고 라운드 시간(지연)을 기록
+static void L3service_showGroupResult(void)
+{
+    uint32_t ms = groupTimer.read_ms();
+    bool complete = L3_group_isComplete();
+    uint8_t coop, betray;
+    L3_history_t rec;
+
+    L3_group_getCounts(&coop, &betray);
+    L3_group_close(); // 첫 라운드가 끝나면 참가자가 정해짐
+    group_rounds++;
+    group_round_ms_sum += ms;
+    if (ms > group_round_ms_max)
+        group_round_ms_max = ms;
+    if (!complete)
+        group_deadlines++;
+
+    pc.printf("\n[RESULT] 당신의 선택: %s\n", (my_choice == 1 ? "협력" : "배신"));
+    pc.printf("[RESULT] 다른 참가자 %d명 중 협력 %d명, 배신 %d명%s\n", L3_group_getOthers(), coop, betray,
+              complete ? "" : " (마감까지 도착하지 않은 선택은 빼고 계산)");
+    sentence = L3_payoff_applyGroupChoice(sentence, my_choice, coop, betray); // 협력 비율로 배율 보간 (L3_payoff.cpp)
+    pc.printf("\n📣 당신의 형량은 %s년입니다.\n", L3_sentence_format(sentence, sentence_str));
+    pc.printf("[GROUP] 라운드 %d : %d명, %lu ms%s\n", round_cnt, L3_group_getOthers() + 1, (unsigned long)ms,
+              complete ? "" : " (마감)");
+
+    // 자동 플레이 전략과 라운드 기록에는 다른 참가자 다수의 선택을 상대방의 선택으로 넘김
+    peer_choice = (coop >= betray) ? 1 : 2;
+    EVstream_emit(EVSTREAM_SENTENCE, round_cnt, EVSTREAM_CAUSE_GROUP, peer_choice, sentence);
+    L3_strategy_recordRound(my_choice, peer_choice);
+    rec.newGame = (round_cnt == 1);
+    rec.resumed = 0;
+    rec.myChoice = (uint8_t)my_choice;
+    rec.peerChoice = (uint8_t)peer_choice;
+    rec.myPred = L3_HISTORY_PRED_NONE;
+    rec.peerPred = L3_HISTORY_PRED_NONE;
+    rec.sentence = sentence;
+    L3_history_append(&rec);
+    L3service_publishRound(peer_choice);
+    result_printed = true;
+}
+
+// N명 게임의 라운드 진행 : 도착한 선택을 집계하고, 다른 참가자 모두의 선택이 도착하거나
+// L3_GROUP_DEADLINE초가 지나면 결과를 계산 (마감까지 선택하지 않았으면 협력으로 처리)
+// 첫 라운드 뒤에 참가자가 READY를 보내면 그 노드의 게임이 끝난 것 (GAME_OVER가 손실됨) : 게임 종료
+// 예측 게임이 없으므로 CHECKING을 거치지 않고 바로 다음 라운드로 감
+// (한 번의 FSM 실행 사이에 도착한 다른 참가자의 선택을 놓치지 않도록)
+// 브로드캐스트 선택은 ACK가 없어 손실될 수 있음 : 라운드가 끝나지 않으면 내 선택을 L3_GROUP_READYTIME초마다
+// 다시 보내고, 지난 라운드의 선택을 받으면 (그 노드는 내 선택을 못 받음) 지난 라운드의 내 선택을 한 번 다시 보냄
+static void L3service_runGroupRound(void)
+{
+    bool deadline = (groupTimer.read_ms() >= L3_GROUP_DEADLINE * 1000);
+
+    if (L3_event_checkEventFlag(L3_event_msgRcvd))
+    {
+        char *msg = (char *)L3_LLI_getMsgPtr(); // 수신 메시지 (널 종료됨, 복사 없이 수신 버퍼를 직접 참조)
+        uint8_t src = L3_LLI_getSrcId();
+        int choice;
+        uint16_t round;
+        uint8_t players;
+
+        L3_event_clearEventFlag(L3_event_msgRcvd);
+        if (L3service_parseGroupChoice(msg, &choice, &round, &players))
+        {
+            int res;
+
+            if (round == 1)
+                L3_group_expect(players);
+            res = L3_group_onChoice(src, round, choice);
+            if (res == L3_GROUP_ACCEPT)
+                EVstream_emit(EVSTREAM_CHOICE, round, src, choice, 0);
+            if (res == L3_GROUP_ACCEPT && round == round_cnt)
+            {
+                uint8_t coop, betray;
+
+                L3_group_getCounts(&coop, &betray);
+                pc.printf("[System] 참가자 %d이(가) 선택을 완료했습니다 (%d/%d명).\n", src, coop + betray, L3_group_getOthers());
+            }
+            else if (res == L3_GROUP_LATE && round == round_cnt - 1 && group_prev_choice > 0 && !group_prev_resent)
+            {
+                L3service_sendMsg("CHOICE:%d:%d:%d", group_prev_choice, round, L3_group_getOthers() + 1);
+                group_prev_resent = true;
+            }
+        }
+        else if (strcmp(msg, "READY") == 0 && round_cnt > 1 && L3_group_find(src) >= 0)
+        {
+            pc.printf("\n📢 참가자 %d의 게임이 끝났습니다. 게임을 종료합니다.\n", src);
+            main_state = L3STATE_GAME_OVER;
+            return;
+        }
+    }
+
+    if (deadline && my_choice == 0)
+    {
+        pc.printf("\n[System] 선택 시간 %d초가 지나 협력으로 처리합니다.\n", L3_GROUP_DEADLINE);
+        L3service_processInputChar('1');
+    }
+    else if (my_choice > 0 && !L3_group_isComplete() && L3_LLI_getTxPending() == 0 &&
+             groupTimer.read_ms() - group_sent_ms >= L3_GROUP_READYTIME * 1000)
+    {
+        L3service_sendMsg("CHOICE:%d:%d:%d", my_choice, round_cnt, L3_group_getOthers() + 1);
+        group_sent_ms = groupTimer.read_ms() + rand() % 1000;
+    }
+
+    if (my_choice > 0 && (deadline || L3_group_isComplete()))
+    {
+        L3service_showGroupResult();
+        group_prev_choice = my_choice;
+        group_prev_resent = false;
+        if (sentence < L3_SENTENCE_RELEASE)
+        {
+            pc.printf("\n🎉 당신은 형량이 1년 이하가 되어 석방되었습니다! 게임에서 승리했습니다!\n");
+            L3service_sendMsg("GAME_OVER");
+            main_state = L3STATE_GAME_OVER;
+        }
+        else
+            resetForNextRound(); // 다음 라운드 프롬프트에서 집계 시작
+    }
+}
+
 // FSM 초기화
-void L3_initFSM(uint8_t destId)
+void L3_initFSM(uint8_t srcId, uint8_t destId)
 {
+    myId = srcId;                                          // 내 ID (관전 노드의 스냅샷 요청 대상인지)
     myDestId = destId;                                     // 상대방 ID 설정
+    L3_strategy_select(L3_AUTOPLAY_STRATEGY);              // 입력 방식 설정 (0 : 키보드)
     pc.attach(&L3service_processInputWord, Serial::RxIrq); // 시리얼 입력 인터럽트 설정
+    MEMstat_registerStatic("L3 serial", sizeof(pc));      // 메모리 보고용 정적 RAM 등록
+    EVstream_init(srcId, L3service_putByte);               // 이벤트 스트림 (셸의 evstream으로 켬)
     pc.printf("Welcome to the dilemma game\n");            // 환영 메시지 출력
+
+    L3_history_init(); // 라운드 기록 (플래시에 남은 기록으로 집계를 다시 채움)
+    specTimer.start();
+
+    // 관전 노드 : 게임을 하지 않음
+    spectator_mode = (destId == L3_SPECTATE_ID);
+    if (spectator_mode)
+    {
+        pc.printf("[System] 관전 노드 : 선수들이 브로드캐스트하는 라운드 결과로 점수판을 보여줍니다.\n");
+        return;
+    }
+
+    // 목적지가 브로드캐스트이면 N명 게임 (재시작 후 재개는 하지 않음)
+    group_mode = (destId == L3_GROUP_ID);
+    if (group_mode)
+    {
+        L3_group_reset();
+        groupTimer.start();
+        pc.printf("[System] N명 게임 : 선택을 모든 노드에게 보냅니다 (%d명이 모이거나 동의 후 %d초가 지나면 시작).\n",
+                  L3_GROUP_PLAYERS, L3_GROUP_JOINTIME);
+        return;
+    }
+
+    // 이 상대방과 진행 중이던 게임이 있으면 새 게임 대신 라운드를 맞춘 뒤 이어감 (CFGstore_init 이후)
+    resyncTimer.start();
+    uint8_t src = L3_snapshot_init(destId);
+    snapshot_load_us = resyncTimer.read_us();
+    if (src != L3_SNAPSHOT_SRC_NONE)
+    {
+        uint16_t latest, previous;
+
+        L3_snapshot_getRounds(&latest, &previous);
+        pc.printf("[System] 라운드 %u까지 진행된 게임이 있습니다 (%s). 상대방과 라운드를 맞추는 중...\n", latest,
+                  src == L3_SNAPSHOT_SRC_RAM ? "백업 SRAM" : "플래시");
+        main_state = prev_state = L3STATE_RESYNC;
+    }
+    else
+        resyncTimer.stop();
+}
+
+// 메시지 버퍼 크기 설정 (셸에서 호출, 범위 검사는 호출하는 쪽에서 : 가장 긴 게임 메시지 이상, L3_MAXDATASIZE 이하)
+void L3_setMaxDataSize(uint8_t size)
+{
+    maxDataSize = size;
+}
+
+uint8_t L3_getMaxDataSize(void)
+{
+    return maxDataSize;
+}
+
+// 게임 진행 상태와 입력 방식별 통계 출력 (셸의 stats 명령)
+void L3_printStats(void)
+{
+    uint32_t rounds, games, elapsedMs;
+
+    L3_strategy_getStats(&rounds, &games, &elapsedMs);
+    pc.printf("[L3] 상태 %i, 라운드 %i, 입력 방식 %s (%lu초 동안 게임 %lu, 라운드 %lu)%s\n", main_state, round_cnt,
+              L3_strategy_getName(L3_strategy_getSelected()), (unsigned long)(elapsedMs / 1000), (unsigned long)games,
+              (unsigned long)rounds, link_down ? ", 연결 끊김" : "");
+    if (group_mode)
+    {
+        const L3_groupStats_t *gs = L3_group_getStats();
+
+        pc.printf("[L3] N명 게임 : 참가자 %d명, 라운드 %lu (평균 %lu ms, 최대 %lu ms, 마감 %lu), 선택 %lu (중복 %lu, 늦음 %lu, 이른 %lu, 참가자 아님 %lu)\n",
+                  L3_group_getOthers() + 1, (unsigned long)group_rounds,
+                  (unsigned long)(group_rounds ? group_round_ms_sum / group_rounds : 0), (unsigned long)group_round_ms_max,
+                  (unsigned long)group_deadlines, (unsigned long)gs->accepted, (unsigned long)gs->duplicate,
+                  (unsigned long)gs->late, (unsigned long)gs->early, (unsigned long)gs->unknown);
+    }
+    if (spectator_mode)
+    {
+        const L3_specStats_t *ss = L3_spec_getStats();
+
+        pc.printf("[L3] 관전 : 선수 %d명, 기록 %lu (빠짐 %lu, 중복 %lu), 스냅샷 %lu, 요청 %lu\n", L3_spec_getNumPlayers(),
+                  (unsigned long)ss->records, (unsigned long)ss->gaps, (unsigned long)ss->old,
+                  (unsigned long)ss->snapshots, (unsigned long)ss->requests);
+    }
+    else if (L3_SPEC_ENABLE)
+        pc.printf("[L3] 관전용 라운드 결과 %lu, 스냅샷 %lu\n", (unsigned long)spec_records_sent, (unsigned long)spec_snaps_sent);
 }
 
 // FSM 실행 (메인 루프에서 지속적으로 호출)
@@ -262,6 +1039,30 @@ void L3_FSMrun(void)
     {
         debug_if(DBGMSG_L3, "\n[L3] State transition from %i to %i\n", prev_state, main_state);
         prev_state = main_state;
+        if (main_state == L3STATE_GAME_OVER) // 끝난 게임은 재시작해도 이어가지 않음
+            L3_snapshot_clear();
+    }
+
+    if (spectator_mode) // 관전 노드는 게임 FSM을 돌리지 않음
+    {
+        L3service_runSpectator();
+        return;
+    }
+
+    // 연결이 끊긴 동안은 게임 진행을 멈춤 (수신 메시지는 복구 후 처리)
+    if (L3service_checkLink() && main_state != L3STATE_GAME_OVER)
+        return;
+
+    L3service_handleResync(); // 재시작한 상대방과의 재개 요청/응답 (모든 상태)
+    L3service_handleSpectator(); // 관전 노드의 스냅샷 요청과 다른 선수의 관전용 기록 (모든 상태)
+
+    // 재개 : 진행 중인 전송이 끝날 때까지 게임을 멈춤 (수신 메시지는 재개 후 처리)
+    if (resume_waiting)
+    {
+        if (L3_LLI_getTxPending() > 0)
+            return;
+        resume_waiting = false;
+        L3service_applyResume(&resume_snap);
     }
 
     switch (main_state)
@@ -271,23 +1072,26 @@ void L3_FSMrun(void)
         // 게임 시작 프롬프트 (한 번만 출력)
         if (!prompt_sent)
         {
+            L3_history_runIdle(); // 게임 사이 : 라운드 기록의 플래시 영역이 거의 찼으면 미리 지움
+            L3_snapshot_runIdle(); // 스냅샷을 쓰는 설정 섹터도
             pc.printf("\n게임을 시작하시겠습니까? (Y/N): \n");
             prompt_sent = true;
         }
 
+        if (group_mode) // N명 게임 대기실
+        {
+            L3service_runGroupLobby();
+            break;
+        }
+
         // 메시지 수신 처리 (상대방의 "READY" 메시지)
         if (L3_event_checkEventFlag(L3_event_msgRcvd))
         {
-            uint8_t *dataPtr = L3_LLI_getMsgPtr();
-            uint8_t size = L3_LLI_getSize();
-            uint8_t fromId = L3_LLI_getSrcId();
-            uint8_t localCopy[1030]; // 수신 메시지 복사 버퍼
-            memcpy(localCopy, dataPtr, size);
-            localCopy[size] = '\0';                    // 널 종료 문자 추가
+            char *msg = (char *)L3_LLI_getMsgPtr();    // 수신 메시지 (널 종료됨, 복사 없이 수신 버퍼를 직접 참조)
             L3_event_clearEventFlag(L3_event_msgRcvd); // 메시지 수신 플래그 클리어
-            // pc.printf("[DEBUG] 메시지 수신: '%s' from ID: %d\n", localCopy, fromId);
+            // pc.printf("[DEBUG] 메시지 수신: '%s' from ID: %d\n", msg, L3_LLI_getSrcId());
 
-            if (strcmp((char *)localCopy, "READY") == 0)
+            if (strcmp(msg, "READY") == 0)
             {
                 peer_ready = true; // 상대방이 준비 완료
                 pc.printf("[System] 상대방도 게임 시작에 동의했습니다.\n");
@@ -297,6 +1101,8 @@ void L3_FSMrun(void)
         // 나와 상대방 모두 준비되면 SELECTION 상태로 전이
         if (ready_to_play && peer_ready)
         {
+            peer_ready = false; // 다음 게임을 위해 상대방 READY 소비
+            L3service_saveSnapshot(); // 라운드 0 스냅샷 (새 게임 시작, 이전 게임의 스냅샷은 버려짐)
             main_state = L3STATE_SELECTION;
         }
         break;
@@ -304,16 +1110,12 @@ void L3_FSMrun(void)
 
     case L3STATE_SELECTION: // 협력/배신 선택 상태
     {
-        uint8_t *dataPtr = L3_LLI_getMsgPtr();
-        uint8_t size = L3_LLI_getSize();
-        uint8_t localCopy[1030];
-        memcpy(localCopy, dataPtr, size);
-        localCopy[size] = '\0';
+        char *msg = (char *)L3_LLI_getMsgPtr(); // 수신 메시지 (널 종료됨, 복사 없이 수신 버퍼를 직접 참조)
 
         if (L3_event_checkEventFlag(L3_event_msgRcvd)){
-            if (strcmp((char *)localCopy, "GAME_OVER") == 0)
+            if (strcmp(msg, "GAME_OVER") == 0)
             {
-                pc.printf("\n📢 상대방이 형량 1년 이하로 석방되어 게임이 종료되었습니다.\n");
+                pc.printf("\n📢 %s 형량 1년 이하로 석방되어 게임이 종료되었습니다.\n", group_mode ? "다른 참가자가" : "상대방이");
                 main_state = L3STATE_GAME_OVER;
                 return;
             }
@@ -323,7 +1125,19 @@ void L3_FSMrun(void)
         if (!selection_msg_printed)
         {
             round_cnt += 1;     // 라운드 카운트 증가
-            if (round_cnt == 1) // 첫 라운드 상세 안내
+            EVstream_emit(EVSTREAM_ROUNDSTART, round_cnt, group_mode ? L3_group_getOthers() + 1 : 2, resumed_round, sentence);
+            if (group_mode)     // N명 게임 : 라운드 집계와 마감 시간 시작
+            {
+                L3_group_startRound((uint16_t)round_cnt);
+                groupTimer.reset();
+                pc.printf("----------------------------------------------------------------\n");
+                pc.printf("[ System Message ] 라운드 %d (%d명)\n", round_cnt, L3_group_getOthers() + 1);
+                pc.printf("현재 형량은 %s년입니다. %d초 안에 1(협력) 또는 2(배신)을 선택해주세요\n", L3_sentence_format(sentence, sentence_str), L3_GROUP_DEADLINE);
+                pc.printf("\t다른 참가자가 모두 협력하면 2인 게임의 상대 협력 배율, 모두 배신하면 상대 배신 배율이고,\n");
+                pc.printf("\t그 사이에서는 협력한 참가자의 비율만큼 두 배율 사이의 값이 적용됩니다.\n");
+                pc.printf("----------------------------------------------------------------\n");
+            }
+            else if (round_cnt == 1) // 첫 라운드 상세 안내
             {
                 pc.printf("\n✅ 양쪽 모두 게임 시작에 동의했습니다. 게임을 시작합니다.\n");
                 pc.printf("\n----------------------------------------------------------------\n");
@@ -333,60 +1147,54 @@ void L3_FSMrun(void)
                 pc.printf("그리고 곧, 천장에서 들려오는 냉정한 기계음이 공간을 울립니다.\n");
                 pc.printf("----------------------------------------------------------------\n");
                 pc.printf("[ System Message ]\n");
-                pc.printf(" 🧠 당신은 '시험 기간에 과제를 준 죄'로 구속되었습니다. 현재 형량은 %.1f년입니다.\n", sentence); // 초기 형량 표시
+                pc.printf(" 🧠 당신은 '시험 기간에 과제를 준 죄'로 구속되었습니다. 현재 형량은 %s년입니다.\n", L3_sentence_format(sentence, sentence_str)); // 초기 형량 표시
                 pc.printf(" \"지금부터 '배신의 방' 게임을 시작합니다.\"\n");
                 pc.printf(" \"두 사람 모두 선택을 내려야 합니다. 선택지는 다음 두 가지입니다.\"\n");
                 pc.printf("\n----------------------------------------------------------------\n");
-                pc.printf("  1. 협력\n");
-                pc.printf("\t두 사람이 모두 협력을 선택할 경우, 각자 형량의 1/3만큼 감형됩니다.\n");
-                pc.printf("  2. 배신\n");
-                pc.printf("\t한 사람이 협력, 다른 한 사람이 배신을 선택할 경우,\n");
-                pc.printf("\t  - 협력을 고른 사람은 형량이 2배가 됩니다.\n");
-                pc.printf("\t  - 배신을 고른 사람은 형량의 1/2만큼 감형됩니다.\n");
-                pc.printf("\t모든 사람이 배신을 선택할 경우,\n");
-                pc.printf("\t  - 두 사람 모두 형량이 3/2배가 됩니다.\n");
+                L3service_printChoiceRules();
                 pc.printf("----------------------------------------------------------------\n");
             }
             else // 2라운드 이후 간략 안내
             {
                 pc.printf("----------------------------------------------------------------\n");
                 pc.printf("[ System Message ]\n");
-                pc.printf("현재 형량은 %.1f년입니다.\n", sentence);
+                pc.printf("현재 형량은 %s년입니다.\n", L3_sentence_format(sentence, sentence_str));
                 pc.printf("1(협력) 또는 2(배신)을 선택해주세요\n");
                 pc.printf("----------------------------------------------------------------\n");
-                pc.printf("  1. 협력\n");
-                pc.printf("\t두 사람이 모두 협력을 선택할 경우, 각자 형량의 1/3만큼 감형됩니다.\n");
-                pc.printf("  2. 배신\n");
-                pc.printf("\t한 사람이 협력, 다른 한 사람이 배신을 선택할 경우,\n");
-                pc.printf("\t  - 협력을 고른 사람은 형량이 2배가 됩니다.\n");
-                pc.printf("\t  - 배신을 고른 사람은 형량의 1/2만큼 감형됩니다.\n");
-                pc.printf("\t모든 사람이 배신을 선택할 경우,\n");
-                pc.printf("\t  - 두 사람 모두 형량이 3/2배가 됩니다.\n");
+                L3service_printChoiceRules();
                 pc.printf("----------------------------------------------------------------\n");
             }
             selection_msg_printed = true;
         }
 
+        if (group_mode) // N명 게임 : 선택 집계와 마감 (L3_group.h)
+        {
+            L3service_runGroupRound();
+            break;
+        }
+
         // 메시지 수신 처리 (상대방의 선택 또는 예측값)
         if (L3_event_checkEventFlag(L3_event_msgRcvd))
         {
             L3_event_clearEventFlag(L3_event_msgRcvd);
 
-            if (strncmp((char *)localCopy, "CHOICE:", 7) == 0) // 상대방의 선택 메시지
+            if (strncmp(msg, "CHOICE:", 7) == 0) // 상대방의 선택 메시지
             {
-                peer_choice = atoi((char *)localCopy + 7);
+                peer_choice = atoi(msg + 7);
                 pc.printf("\n[System] 상대방이 선택을 완료했습니다.\n");
                 if (peer_choice == 1 || peer_choice == 2)
                 {
                     peer_choice_received = true;
+                    EVstream_emit(EVSTREAM_CHOICE, round_cnt, L3_LLI_getSrcId(), peer_choice, 0);
                 }
             }
             // PREDICTION 상태에서 상대방이 보낸 예측값을 SELECTION 상태에서 수신할 수 있음
             // 이 메시지는 다음 라운드 결과 계산 시 사용됨
-            else if (strncmp((char *)localCopy, "PREDICTION:", 11) == 0)
+            else if (strncmp(msg, "PREDICTION:", 11) == 0)
             {
-                stored_peer_prediction_value = atoi((char *)localCopy + 11); // 상대방 예측값 저장
+                stored_peer_prediction_value = atoi(msg + 11); // 상대방 예측값 저장
                 has_stored_peer_prediction = true;                           // 상대방 예측값 저장 플래그 설정
+                EVstream_emit(EVSTREAM_PREDICT, round_cnt, L3_LLI_getSrcId(), stored_peer_prediction_value, EVSTREAM_PRED_MADE);
                 pc.printf("\n[System] 상대방의 예측값을 수신했습니다.\n");
             }
         }
@@ -403,24 +1211,19 @@ void L3_FSMrun(void)
     case L3STATE_CHECKING: // 예측 게임 참여 여부 확인 및 게임 결과 계산 상태
     {   
 
-        uint8_t *dataPtr = L3_LLI_getMsgPtr();
-        uint8_t size = L3_LLI_getSize();
-        uint8_t localCopy[1030];
-        memcpy(localCopy, dataPtr, size);
-        localCopy[size] = '\0';
+        char *msg = (char *)L3_LLI_getMsgPtr(); // 수신 메시지 (널 종료됨, 복사 없이 수신 버퍼를 직접 참조)
 
         // 1. 게임 종료 조건 검사 (형량이 1년 미만이면 게임 종료)
-        if (sentence < 1.0f)
+        if (sentence < L3_SENTENCE_RELEASE)
         {
             pc.printf("\n🎉 당신은 형량이 1년 이하가 되어 석방되었습니다! 게임에서 승리했습니다!\n");
-            strcpy((char *)sdu, "GAME_OVER");
-            L3_LLI_dataReqFunc(sdu, strlen("GAME_OVER"), myDestId);
+            L3service_sendMsg("GAME_OVER");
             main_state = L3STATE_GAME_OVER;
             return; // 게임 종료 시 더 이상 진행하지 않음
         }
 
         if (L3_event_checkEventFlag(L3_event_msgRcvd)){
-            if (strcmp((char *)localCopy, "GAME_OVER") == 0)
+            if (strcmp(msg, "GAME_OVER") == 0)
             {
                 pc.printf("\n📢 상대방이 형량 1년 이하로 석방되어 게임이 종료되었습니다.\n");
                 main_state = L3STATE_GAME_OVER;
@@ -437,11 +1240,18 @@ void L3_FSMrun(void)
                 // 내가 예측 기회를 아직 사용하지 않았다면 나에게 질문
                 if (!my_used_prediction)
                 {
+                    uint8_t num, den;
+
                     pc.printf("----------------------------------------------------------------\n");
                     pc.printf("\n[System] 추가 미션이 도착했습니다.\n");
                     pc.printf(" \"당신은 상대방의 다음 선택을 예측할 기회가 1회 주어졌습니다.\"\n");
-                    pc.printf(" \"예측에 성공할 경우 형량의 1/3만큼 감형됩니다.\n");
-                    pc.printf("\t하지만 예측에 실패할 경우, 오히려 형량이 4/3배가 됩니다.\"\n");
+                    pc.printf(" \"예측에 성공할 경우 형량이 ");
+                    L3_payoff_getPredictionRatio(1, &num, &den);
+                    L3service_printRatio(num, den);
+                    pc.printf(".\n\t하지만 예측에 실패할 경우, 오히려 형량이 ");
+                    L3_payoff_getPredictionRatio(0, &num, &den);
+                    L3service_printRatio(num, den);
+                    pc.printf(".\"\n");
                     pc.printf(" \"예측은 단 한 번만 가능합니다. 진행하시겠습니까(Y/N)?: \"\n");
                     pc.printf("----------------------------------------------------------------\n");
                 }
@@ -457,14 +1267,14 @@ void L3_FSMrun(void)
             {
                 L3_event_clearEventFlag(L3_event_msgRcvd);
 
-                if (strcmp((char *)localCopy, "PREDICT_Y") == 0) // 상대방이 Y를 선택
+                if (strcmp(msg, "PREDICT_Y") == 0) // 상대방이 Y를 선택
                 {
                     peer_prediction_yn_choice = 1;        // Y로 설정
                     peer_prediction_yn_input_done = true; // 상대방 Y/N 입력 완료
                     peer_used_prediction = true;          // 상대방이 예측 기회를 사용했으므로 플래그 업데이트
                     pc.printf("\n[System] 상대방이 예측 게임에 도전합니다.\n");
                 }
-                else if (strcmp((char *)localCopy, "PREDICT_N") == 0) // 상대방이 N을 선택
+                else if (strcmp(msg, "PREDICT_N") == 0) // 상대방이 N을 선택
                 {
                     peer_prediction_yn_choice = 2;        // N으로 설정
                     peer_prediction_yn_input_done = true; // 상대방 Y/N 입력 완료
@@ -496,6 +1306,7 @@ void L3_FSMrun(void)
                 {
                     pc.printf("\n[System] 예측 게임을 건너뜁니다. 다음 라운드를 시작합니다.\n");
                     resetForNextRound();            // 다음 라운드를 위한 모든 변수 초기화
+                    L3service_saveSnapshot();       // 라운드 경계 스냅샷
                     main_state = L3STATE_SELECTION; // 다음 선택 게임으로 즉시 전이
                 }
             }
@@ -504,6 +1315,7 @@ void L3_FSMrun(void)
         {
             pc.printf("\n[System] 예측 게임 기회를 모두 사용했습니다. 다음 라운드를 시작합니다.\n");
             resetForNextRound();            // 다음 라운드를 위한 모든 변수 초기화
+            L3service_saveSnapshot();       // 라운드 경계 스냅샷
             main_state = L3STATE_SELECTION; // 다음 선택 게임으로 즉시 전이
         }
         break;
@@ -511,14 +1323,10 @@ void L3_FSMrun(void)
 
     case L3STATE_PREDICTION: // 예측값 입력 및 대기 상태
     {
-        uint8_t *dataPtr = L3_LLI_getMsgPtr();
-        uint8_t size = L3_LLI_getSize();
-        uint8_t localCopy[1030];
-        memcpy(localCopy, dataPtr, size);
-        localCopy[size] = '\0';
+        char *msg = (char *)L3_LLI_getMsgPtr(); // 수신 메시지 (널 종료됨, 복사 없이 수신 버퍼를 직접 참조)
         
         if (L3_event_checkEventFlag(L3_event_msgRcvd)){
-            if (strcmp((char *)localCopy, "GAME_OVER") == 0)
+            if (strcmp(msg, "GAME_OVER") == 0)
             {
                 pc.printf("\n📢 상대방이 형량 1년 이하로 석방되어 게임이 종료되었습니다.\n");
                 main_state = L3STATE_GAME_OVER;
@@ -549,8 +1357,7 @@ void L3_FSMrun(void)
         {
             // pc.printf("[DEBUG] 입력 완료: %d, 전송됨: %d\n", prediction_input_received, my_prediction_result_sent_in_this_state);
 
-            sprintf((char *)sdu, "PREDICTION:%d", prediction_value); // 내 예측값 메시지 생성
-            L3_LLI_dataReqFunc(sdu, strlen((char *)sdu), myDestId);  // 상대방에게 전송
+            L3service_sendMsg("PREDICTION:%d", prediction_value);   // 내 예측값 메시지를 상대방에게 전송
             pc.printf("[System] 나의 예측값을 상대방에게 전송했습니다.\n");
             my_prediction_result_sent_in_this_state = true; // 전송 완료 플래그 설정
         }
@@ -560,10 +1367,11 @@ void L3_FSMrun(void)
         {
             L3_event_clearEventFlag(L3_event_msgRcvd);
 
-            if (strncmp((char *)localCopy, "PREDICTION:", 11) == 0) // 상대방이 예측값을 보냈다면
+            if (strncmp(msg, "PREDICTION:", 11) == 0) // 상대방이 예측값을 보냈다면
             {
-                stored_peer_prediction_value = atoi((char *)localCopy + 11); // 상대방 예측값 저장
+                stored_peer_prediction_value = atoi(msg + 11); // 상대방 예측값 저장
                 has_stored_peer_prediction = true;                           // 상대방 예측값 저장 플래그 설정
+                EVstream_emit(EVSTREAM_PREDICT, round_cnt, L3_LLI_getSrcId(), stored_peer_prediction_value, EVSTREAM_PRED_MADE);
                 peer_prediction_result_received = true;                      // 상대방 예측값 수신 완료 플래그 설정
                 pc.printf("\n[System] 상대방의 예측을 수신했습니다.\n");
             }
@@ -582,6 +1390,7 @@ void L3_FSMrun(void)
         {
             pc.printf("[System] 예측 게임이 완료되었습니다. 다음 라운드로 진행합니다.\n");
             resetForNextRound();                             // 다음 라운드를 위한 모든 변수 초기화
+            L3service_saveSnapshot();                        // 라운드 경계 스냅샷
             main_state = L3STATE_SELECTION;                  // 다음 선택 게임으로 전이
             prediction_input_prompt_sent = false;            // 예측값 입력 프롬프트 플래그 재설정
             my_prediction_result_sent_in_this_state = false; // 예측값 전송 플래그 재설정
@@ -589,11 +1398,64 @@ void L3_FSMrun(void)
         break;
     }
 
+    case L3STATE_RESYNC: // 재시작 후 상대방과 재개할 라운드를 맞추는 상태
+    {
+        char *msg = (char *)L3_LLI_getMsgPtr(); // 수신 메시지 (널 종료됨, 복사 없이 수신 버퍼를 직접 참조)
+
+        // 재개 전에 도착한 게임 메시지는 버림 (상대방의 READY는 새 게임이 될 경우를 위해 기억)
+        if (L3_event_checkEventFlag(L3_event_msgRcvd))
+        {
+            L3_event_clearEventFlag(L3_event_msgRcvd);
+            if (strcmp(msg, "READY") == 0)
+                peer_ready = true;
+        }
+
+        if (resyncTimer.read_ms() >= L3_RESYNC_TIMEOUT * 1000)
+        {
+            pc.printf("\n[System] 상대방이 %d초 동안 응답하지 않아 새 게임을 시작합니다.\n", L3_RESYNC_TIMEOUT);
+            L3service_abandonGame();
+            break;
+        }
+
+        // 재개 요청 (응답이 없으면 L3_RESYNC_RETRYTIME초마다 다시 보냄, 이전 요청의 전송이 끝난 뒤에)
+        if ((resync_sent_ms < 0 || resyncTimer.read_ms() - resync_sent_ms >= L3_RESYNC_RETRYTIME * 1000) && L3_LLI_getTxPending() == 0)
+        {
+            uint16_t latest, previous;
+
+            L3_snapshot_getRounds(&latest, &previous);
+            L3service_sendMsg("RESYNC:%u:%u", latest, previous);
+            resync_sent_ms = resyncTimer.read_ms();
+        }
+        break;
+    }
+
     case L3STATE_GAME_OVER: // 게임 종료 상태
-        // 아무것도 안 함 (게임이 끝났으므로)
+        if (!game_over_logged) // 자동 플레이는 같은 패스에서 새 게임으로 넘어가므로 상태 전이가 아닌 여기서 한 번
+        {
+            EVstream_emit(EVSTREAM_GAMEOVER, round_cnt, sentence < L3_SENTENCE_RELEASE, link_down, sentence);
+            game_over_logged = true;
+        }
+        // N명 게임 : GAME_OVER를 받지 못하고 선택을 보내는 참가자에게 다시 알림
+        if (group_mode && L3_event_checkEventFlag(L3_event_msgRcvd) && strncmp((char *)L3_LLI_getMsgPtr(), "CHOICE:", 7) == 0)
+        {
+            L3_event_clearEventFlag(L3_event_msgRcvd);
+            if (L3_LLI_getTxPending() == 0)
+                L3service_sendMsg("GAME_OVER");
+        }
+        // 수동 모드에서는 아무것도 안 함 (게임이 끝났으므로)
+        // 자동 플레이 모드에서는 통계를 출력하고 새 게임을 시작 (GAME_OVER 등 보낸 메시지의 DATA_CNF를 모두 받은 뒤)
+        if (L3_strategy_getSelected() != L3_STRATEGY_MANUAL && L3_LLI_getTxPending() == 0)
+        {
+            L3_strategy_endGame();
+            L3service_printAutoPlayStats();
+            resetForNewGame();
+            main_state = L3STATE_INITIAL_WAITING;
+        }
         break;
 
     default: // 알 수 없는 상태
         break;
     }
+
+    L3service_autoPlay(); // 자동 플레이 전략 입력 (수동 모드에서는 아무것도 안 함)
 }
\ No newline at end of file
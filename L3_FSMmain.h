@@ -1,2 +1,5 @@
-void L3_initFSM(uint8_t);
-void L3_FSMrun(void);
\ No newline at end of file
+void L3_initFSM(uint8_t srcId, uint8_t destId);
+void L3_FSMrun(void);
+void L3_setMaxDataSize(uint8_t size);
+uint8_t L3_getMaxDataSize(void);
+void L3_printStats(void);
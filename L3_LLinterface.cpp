@@ -1,27 +1,34 @@
 #include "mbed.h"
 #include "L3_FSMevent.h"
 #include "L3_msg.h"
+#include "PDUbuf.h"
 #include "protocol_parameters.h"
 #include "time.h"
 
-static uint8_t rcvdMsg[L3_MAXDATASIZE];
-static uint8_t rcvdSize;
+static uint8_t rcvdPdu = PDUBUF_INVALID;   //last received message (PDUbuf handle handed over by L2)
 static int16_t rcvdRssi;
 static int8_t rcvdSnr;
 static uint8_t rcvdSrcId;
+static uint8_t txPending = 0;   //DATA_REQ issued but DATA_CNF not yet received
+static uint8_t lastCnfRes = 1;  //result of the last DATA_CNF
+static uint8_t linkPeerId;      //peer of the last link indication
+static uint32_t linkMs;
 
 //Downward primitives
 //TX function
-void (*L3_LLI_dataReqFunc)(uint8_t* msg, uint8_t size, uint8_t destId);
+void (*L3_LLI_dataReqFunc)(uint8_t sdu, uint8_t destId);
 void (*L3_LLI_reconfigSrcIdReqFunc)(uint8_t myId);
 
 //interface event : DATA_IND, RX data has arrived
-void L3_LLI_dataInd(uint8_t* dataPtr, uint8_t srcId, uint8_t size, int8_t snr, int16_t rssi)
+void L3_LLI_dataInd(uint8_t pdu, uint8_t srcId, int8_t snr, int16_t rssi)
 {
-    debug_if(DBGMSG_L3, "\n[L3] --> DATA IND : size:%i, %s\n", size, dataPtr);
+    //the message stays in the L2 buffer : terminate it for string handling (tailroom is reserved)
+    PDUbuf_getData(pdu)[PDUbuf_getLen(pdu)] = '\0';
+    debug_if(DBGMSG_L3, "\n[L3] --> DATA IND : size:%i, %s\n", PDUbuf_getLen(pdu), PDUbuf_getData(pdu));
 
-    memcpy(rcvdMsg, dataPtr, size*sizeof(uint8_t));
-    rcvdSize = size;
+    //the previous message is replaced (same as overwriting it)
+    PDUbuf_free(rcvdPdu);
+    rcvdPdu = pdu;
     rcvdSnr = snr;
     rcvdRssi = rssi;
     rcvdSrcId = srcId;
@@ -29,11 +36,66 @@ void L3_LLI_dataInd(uint8_t* dataPtr, uint8_t srcId, uint8_t size, int8_t snr, i
     L3_event_setEventFlag(L3_event_msgRcvd);
 }
 
+//SDU buffer for a new message (the payload is written directly into it)
+uint8_t L3_LLI_allocSdu(void)
+{
+    return PDUbuf_alloc();
+}
+
+//TX request : hands the SDU buffer over to L2 and tracks the number of outstanding requests
+void L3_LLI_dataReq(uint8_t sdu, uint8_t destId)
+{
+    txPending++;
+    L3_LLI_dataReqFunc(sdu, destId);
+}
+
+uint8_t L3_LLI_getTxPending(void)
+{
+    return txPending;
+}
+
 void L3_LLI_dataCnf(uint8_t res)
 {
     debug_if(DBGMSG_L3, "\n --> DATA CNF : res : %i\n", res);
+    if (txPending > 0)
+        txPending--;
+    lastCnfRes = res;
     L3_event_setEventFlag(L3_event_dataSendCnf);
 }
+
+uint8_t L3_LLI_getLastCnfRes(void)
+{
+    return lastCnfRes;
+}
+
+//interface event : LINK_IND, the link to a peer was lost (ms : time since it was last heard)
+//or is back (ms : time it was down)
+void L3_LLI_linkInd(uint8_t peerId, uint8_t up, uint32_t ms)
+{
+    debug_if(DBGMSG_L3, "\n --> LINK IND : peer : %i, up : %i (%lu ms)\n", peerId, up, (unsigned long)ms);
+    linkPeerId = peerId;
+    linkMs = ms;
+    if (up)
+    {
+        L3_event_clearEventFlag(L3_event_linkDown);
+        L3_event_setEventFlag(L3_event_linkUp);
+    }
+    else
+    {
+        L3_event_clearEventFlag(L3_event_linkUp);
+        L3_event_setEventFlag(L3_event_linkDown);
+    }
+}
+
+uint8_t L3_LLI_getLinkPeerId(void)
+{
+    return linkPeerId;
+}
+
+uint32_t L3_LLI_getLinkMs(void)
+{
+    return linkMs;
+}
 void L3_LLI_reconfigSrcIdCnf(uint8_t res)
 {
     debug_if(DBGMSG_L3, "\n --> RECONFIG SRCID CNF : res : %i\n", res);
@@ -41,13 +103,25 @@ void L3_LLI_reconfigSrcIdCnf(uint8_t res)
 }
 
 
+//1 once L3 has taken the last DATA_IND (L2 holds the next sub-frame of an aggregated frame until then)
+uint8_t L3_LLI_isRxFree(void)
+{
+    return (L3_event_checkEventFlag(L3_event_msgRcvd) == 0);
+}
+
 uint8_t* L3_LLI_getMsgPtr()
 {
-    return rcvdMsg;
+    static uint8_t emptyMsg[1] = {0};
+
+    if (rcvdPdu == PDUBUF_INVALID)
+        return emptyMsg;
+    return PDUbuf_getData(rcvdPdu);
 }
 uint8_t L3_LLI_getSize()
 {
-    return rcvdSize;
+    if (rcvdPdu == PDUBUF_INVALID)
+        return 0;
+    return PDUbuf_getLen(rcvdPdu);
 }
 
 uint8_t L3_LLI_getSrcId()
@@ -55,7 +129,7 @@ uint8_t L3_LLI_getSrcId()
     return rcvdSrcId;
 }
 
-void L3_LLI_setDataReqFunc(void (*funcPtr)(uint8_t*, uint8_t, uint8_t))
+void L3_LLI_setDataReqFunc(void (*funcPtr)(uint8_t, uint8_t))
 {
     L3_LLI_dataReqFunc = funcPtr;
 }
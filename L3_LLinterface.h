@@ -1,10 +1,18 @@
-extern void (*L3_LLI_dataReqFunc)(uint8_t* msg, uint8_t size, uint8_t destId);
+extern void (*L3_LLI_dataReqFunc)(uint8_t sdu, uint8_t destId);
 
-void L3_LLI_dataInd(uint8_t* dataPtr, uint8_t srcId, uint8_t size, int8_t snr, int16_t rssi);
+void L3_LLI_dataInd(uint8_t pdu, uint8_t srcId, int8_t snr, int16_t rssi);
 uint8_t* L3_LLI_getMsgPtr();
 uint8_t L3_LLI_getSize();
 uint8_t L3_LLI_getSrcId();
-void L3_LLI_setDataReqFunc(void (*funcPtr)(uint8_t*, uint8_t, uint8_t));
+uint8_t L3_LLI_isRxFree(void);
+void L3_LLI_setDataReqFunc(void (*funcPtr)(uint8_t, uint8_t));
 void L3_LLI_setReconfigSrcIdReqFunc(void (*funcPtr)(uint8_t));
+uint8_t L3_LLI_allocSdu(void);
+void L3_LLI_dataReq(uint8_t sdu, uint8_t destId);
+uint8_t L3_LLI_getTxPending(void);
 void L3_LLI_dataCnf(uint8_t res);
+uint8_t L3_LLI_getLastCnfRes(void);
+void L3_LLI_linkInd(uint8_t peerId, uint8_t up, uint32_t ms);
+uint8_t L3_LLI_getLinkPeerId(void);
+uint32_t L3_LLI_getLinkMs(void);
 void L3_LLI_reconfigSrcIdCnf(uint8_t res);
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include "string.h"
+#include "L3_group.h"
+#include "L3_payoff.h"
+
+// N명 게임의 라운드 집계 : 다른 참가자의 선택이 도착할 때마다 그 라운드의 협력/배신 수와 응답한 참가자를
+// 갱신하므로, 라운드가 끝날 때 다시 셀 필요가 없음 (형량은 L3_payoff_applyGroupChoice로 집계에서 계산)
+// 참가자는 READY나 선택을 보낸 노드이며 첫 라운드가 끝나면 정해짐 (그 뒤에 들어온 노드는 다음 게임부터)
+// 노드마다 라운드를 끝내는 시점이 다르므로 (마지막 선택을 받은 때 또는 마감) 먼저 다음 라운드로 넘어간
+// 노드의 선택은 L3_GROUP_WINDOW 라운드까지 따로 집계해 둠
+
+//한 라운드의 집계 (rounds[round % L3_GROUP_WINDOW])
+typedef struct
+{
+    uint16_t round;
+    uint16_t reported;          //선택이 도착한 참가자 (roster 자리별 비트)
+    uint8_t coop;
+    uint8_t betray;
+} L3_groupRound_t;
+
+//응답 비트가 다른 참가자 수만큼 있어야 함
+typedef char L3_group_sizeCheck[(L3_GROUP_MAXPLAYERS - 1 <= 16) ? 1 : -1];
+
+static uint8_t roster[L3_GROUP_MAXPLAYERS - 1];     //다른 참가자의 ID
+static uint8_t others = 0;
+static uint8_t closed = 0;                          //1 : 참가자가 정해짐 (첫 라운드 이후)
+static uint8_t expected = 0;                        //참가자가 정해지기 전에 기다리는 다른 참가자 수 (다른 노드가 알린 인원)
+static uint16_t curRound = 0;
+static L3_groupRound_t rounds[L3_GROUP_WINDOW];
+static L3_groupStats_t stats;
+
+
+// 새 게임 : 참가자와 집계를 비움 (통계는 유지)
+void L3_group_reset(void)
+{
+    others = 0;
+    closed = 0;
+    expected = 0;
+    memset(rounds, 0, sizeof(rounds));
+    L3_group_startRound(0); //대기실 : 첫 라운드를 먼저 시작한 노드의 선택도 받아 둠
+}
+
+// 참가자의 자리 : 처음 보는 노드는 참가자가 정해지기 전이고 자리가 있으면 추가, 아니면 -1
+int L3_group_join(uint8_t srcId)
+{
+    int slot = L3_group_find(srcId);
+
+    if (slot >= 0)
+        return slot;
+    if (closed || others >= L3_GROUP_MAXPLAYERS - 1)
+        return -1;
+    roster[others] = srcId;
+    return others++;
+}
+
+// 참가자의 자리 (참가자가 아니면 -1)
+int L3_group_find(uint8_t srcId)
+{
+    uint8_t i;
+
+    for (i = 0; i < others; i++)
+    {
+        if (roster[i] == srcId)
+            return i;
+    }
+    return -1;
+}
+
+// 참가자 확정 (첫 라운드가 끝날 때) : 이후의 새 노드는 집계하지 않음
+void L3_group_close(void)
+{
+    closed = 1;
+}
+
+// 다른 노드가 아는 인원 (나를 포함) : 참가자가 정해지기 전이면 첫 라운드는 그만큼 모일 때까지 끝나지 않음
+void L3_group_expect(uint8_t players)
+{
+    if (players > L3_GROUP_MAXPLAYERS)
+        players = L3_GROUP_MAXPLAYERS;
+    if (!closed && players > expected + 1)
+        expected = players - 1;
+}
+
+// 나를 뺀 참가자 수
+uint8_t L3_group_getOthers(void)
+{
+    return others;
+}
+
+// 라운드 시작 : 지난 라운드의 집계를 비워 그 뒤 라운드들에 씀 (이미 받아 둔 선택은 유지)
+void L3_group_startRound(uint16_t round)
+{
+    uint8_t i;
+
+    curRound = round;
+    for (i = 0; i < L3_GROUP_WINDOW; i++)
+    {
+        L3_groupRound_t* r = &rounds[(uint16_t)(round + i) % L3_GROUP_WINDOW];
+
+        if (r->round != (uint16_t)(round + i))
+        {
+            r->round = (uint16_t)(round + i);
+            r->reported = 0;
+            r->coop = 0;
+            r->betray = 0;
+        }
+    }
+}
+
+// 참가자 srcId의 라운드 선택 : 결과 (L3_GROUP_*)
+int L3_group_onChoice(uint8_t srcId, uint16_t round, int choice)
+{
+    int16_t ahead = (int16_t)(round - curRound);
+    L3_groupRound_t* r;
+    int slot;
+
+    if (ahead < 0)
+    {
+        stats.late++;
+        return L3_GROUP_LATE;
+    }
+    if (ahead >= L3_GROUP_WINDOW)
+    {
+        stats.early++;
+        return L3_GROUP_EARLY;
+    }
+    if ((slot = L3_group_join(srcId)) < 0)
+    {
+        stats.unknown++;
+        return L3_GROUP_UNKNOWN;
+    }
+
+    r = &rounds[round % L3_GROUP_WINDOW];
+    if (r->reported & (1u << slot))
+    {
+        stats.duplicate++;
+        return L3_GROUP_DUPLICATE;
+    }
+    r->reported |= (uint16_t)(1u << slot);
+    if (choice == L3_CHOICE_COOPERATE)
+        r->coop++;
+    else
+        r->betray++;
+    stats.accepted++;
+    return L3_GROUP_ACCEPT;
+}
+
+// 현재 라운드에 다른 참가자 모두의 선택이 도착했는지
+uint8_t L3_group_isComplete(void)
+{
+    return others > 0 && (closed || others >= expected) && rounds[curRound % L3_GROUP_WINDOW].reported == (uint16_t)((1u << others) - 1);
+}
+
+// 현재 라운드에 도착한 다른 참가자의 협력/배신 수
+void L3_group_getCounts(uint8_t* coop, uint8_t* betray)
+{
+    *coop = rounds[curRound % L3_GROUP_WINDOW].coop;
+    *betray = rounds[curRound % L3_GROUP_WINDOW].betray;
+}
+
+const L3_groupStats_t* L3_group_getStats(void)
+{
+    return &stats;
+}
@@ -0,0 +1,33 @@
+#include <stdint.h>
+
+#define L3_GROUP_ID             255     //목적지 ID가 이 값이면 N명 게임 : 선택을 L2 브로드캐스트(L2_PEER_BROADCAST)로 주고받음
+#define L3_GROUP_MAXPLAYERS     16      //나를 포함한 최대 인원
+#define L3_GROUP_WINDOW         4       //집계하는 라운드 수 : 현재 라운드와 먼저 진행한 노드가 보낸 다음 라운드들
+
+//L3_group_onChoice 결과
+#define L3_GROUP_ACCEPT         0       //집계에 더함
+#define L3_GROUP_DUPLICATE      1       //이 참가자의 이 라운드 선택은 이미 받음
+#define L3_GROUP_LATE           2       //지난 라운드 (마감 뒤에 도착)
+#define L3_GROUP_EARLY          3       //집계 범위 밖의 다음 라운드
+#define L3_GROUP_UNKNOWN        4       //참가자가 아님 (첫 라운드가 끝난 뒤에 들어왔거나 자리가 없음)
+
+typedef struct
+{
+    uint32_t accepted;
+    uint32_t duplicate;
+    uint32_t late;
+    uint32_t early;
+    uint32_t unknown;
+} L3_groupStats_t;
+
+void L3_group_reset(void);
+int L3_group_join(uint8_t srcId);
+int L3_group_find(uint8_t srcId);
+void L3_group_close(void);
+void L3_group_expect(uint8_t players);
+uint8_t L3_group_getOthers(void);
+void L3_group_startRound(uint16_t round);
+int L3_group_onChoice(uint8_t srcId, uint16_t round, int choice);
+uint8_t L3_group_isComplete(void);
+void L3_group_getCounts(uint8_t* coop, uint8_t* betray);
+const L3_groupStats_t* L3_group_getStats(void);
@@ -0,0 +1,328 @@
+#include "mbed.h"
+#include "string.h"
+#include "L3_history.h"
+#include "L3_sentence.h"
+#include "MEMstat.h"
+#include "protocol_parameters.h"
+
+// 라운드 기록 : 끝난 라운드마다 4바이트로 압축한 기록을 RAM 링에 덧붙이고 (지우거나 고치지 않음),
+// 7개가 모이면 플래시 페이지 하나로 내보냄 (L3_HISTORY_FLASH, 설정 섹터 바로 앞 섹터)
+// 라운드 번호는 기록하지 않고 (새 게임 플래그부터 하나씩 늘어남) 형량은 24비트 (16777년에서 포화)
+// 기록 | 7 새 게임 | 6 재개 | 5 내 배신 | 4 상대 배신 | 3-2 내 예측 | 1-0 상대 예측 | 형량 (3바이트) |
+// 집계 (협력 비율, 평균 형량, 게임당 라운드 수)는 기록을 덧붙일 때 누적 합으로 갱신하므로 조회는 계산
+// 없이 바로 출력되고, 기록 하나의 비용은 일정함 (플래시 페이지 기록은 7라운드에 한 번, 1 ms 미만)
+// 부팅 시 플래시의 기록으로 집계와 RAM 링을 다시 채움 (내보내기 전의 마지막 6라운드 이하는 리셋 때 사라짐)
+// 영역은 섹터 하나라 (STM32F4는 섹터 단위로만 지움) 지우는 1~2초 동안 플래시에서 도는 코드와 인터럽트가 모두 멈춤 :
+// 라운드 중에는 지우지 않고, 빈 페이지가 L3_HISTORY_ERASEAHEAD보다 적게 남으면 게임 사이 (시작 대기 상태)에
+// L3_history_runIdle이 미리 지움 (4096페이지 = 28672라운드에 한 번). 그 전에 영역이 다 차면 페이지를 버리고
+// (기록은 RAM 링과 집계에 남음) 다음 게임 사이에 지움
+
+#define L3_HISTORY_FLAG_NEWGAME     0x80
+#define L3_HISTORY_FLAG_RESUMED     0x40
+#define L3_HISTORY_FLAG_MYBETRAY    0x20
+#define L3_HISTORY_FLAG_PEERBETRAY  0x10
+#define L3_HISTORY_SHIFT_MYPRED     2
+#define L3_HISTORY_SHIFT_PEERPRED   0
+#define L3_HISTORY_SENTENCE_MAX     0xFFFFFFUL
+
+#define L3_HISTORY_MAGIC            0x4853      //기록이 쓰인 플래시 페이지 (0xFFFF : 지워진 페이지)
+#define L3_HISTORY_OFFSET_RECS      2
+#define L3_HISTORY_OFFSET_CRC       (L3_HISTORY_PAGESIZE - 2)
+
+//누적 집계 (부팅 시 플래시의 기록 포함)
+typedef struct
+{
+    uint32_t rounds;
+    uint32_t games;
+    uint32_t resumes;
+    uint32_t myCoop;
+    uint32_t peerCoop;
+    uint32_t bothCoop;
+    uint32_t myPredHit;
+    uint32_t myPredMiss;
+    uint32_t peerPredHit;
+    uint32_t peerPredMiss;
+    uint64_t sentenceSum;
+} L3_history_totals_t;
+
+static uint8_t ring[L3_HISTORY_RAMRECS][L3_HISTORY_RECSIZE];   //최근 기록 (압축된 그대로)
+static uint32_t appended = 0;               //링에 덧붙인 기록 수 (부팅 시 플래시에서 읽은 것 포함)
+static uint32_t spilled = 0;                //그중 플래시에 있는 기록 수
+static L3_history_totals_t totals;
+
+#if L3_HISTORY_FLASH
+//linker script symbols : end of the firmware image in flash
+extern "C" uint32_t __etext[];
+extern "C" uint32_t __data_start__[];
+extern "C" uint32_t __data_end__[];
+
+static FlashIAP flash;
+static MbedCRC<POLY_16BIT_CCITT, 16> crc16;
+static uint32_t regionAddr;
+static uint32_t pageNum = 0;                //0 : 플래시에 내보내지 않음
+static uint32_t nextPage = 0;               //첫 번째 지워진 페이지
+static uint32_t droppedPages = 0;           //영역이 차서 쓰지 못한 페이지 수
+#endif
+
+
+static void L3_history_pack(const L3_history_t* rec, uint8_t* p)
+{
+    uint32_t sentence = (rec->sentence > L3_HISTORY_SENTENCE_MAX) ? L3_HISTORY_SENTENCE_MAX : rec->sentence;
+
+    p[0] = (uint8_t)((rec->newGame ? L3_HISTORY_FLAG_NEWGAME : 0) | (rec->resumed ? L3_HISTORY_FLAG_RESUMED : 0) |
+                     (rec->myChoice == 2 ? L3_HISTORY_FLAG_MYBETRAY : 0) | (rec->peerChoice == 2 ? L3_HISTORY_FLAG_PEERBETRAY : 0) |
+                     ((rec->myPred & 0x03) << L3_HISTORY_SHIFT_MYPRED) | ((rec->peerPred & 0x03) << L3_HISTORY_SHIFT_PEERPRED));
+    p[1] = (uint8_t)(sentence >> 16);
+    p[2] = (uint8_t)(sentence >> 8);
+    p[3] = (uint8_t)sentence;
+}
+
+static void L3_history_unpack(const uint8_t* p, L3_history_t* rec)
+{
+    rec->newGame = (p[0] & L3_HISTORY_FLAG_NEWGAME) ? 1 : 0;
+    rec->resumed = (p[0] & L3_HISTORY_FLAG_RESUMED) ? 1 : 0;
+    rec->myChoice = (p[0] & L3_HISTORY_FLAG_MYBETRAY) ? 2 : 1;
+    rec->peerChoice = (p[0] & L3_HISTORY_FLAG_PEERBETRAY) ? 2 : 1;
+    rec->myPred = (p[0] >> L3_HISTORY_SHIFT_MYPRED) & 0x03;
+    rec->peerPred = (p[0] >> L3_HISTORY_SHIFT_PEERPRED) & 0x03;
+    rec->sentence = ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+//압축된 기록 하나를 링에 넣고 집계에 더함
+static void L3_history_push(const uint8_t* p)
+{
+    uint8_t flags = p[0];
+
+    memcpy(ring[appended % L3_HISTORY_RAMRECS], p, L3_HISTORY_RECSIZE);
+    appended++;
+
+    totals.rounds++;
+    if (flags & L3_HISTORY_FLAG_NEWGAME)
+        totals.games++;
+    if (flags & L3_HISTORY_FLAG_RESUMED)
+        totals.resumes++;
+    if ((flags & L3_HISTORY_FLAG_MYBETRAY) == 0)
+        totals.myCoop++;
+    if ((flags & L3_HISTORY_FLAG_PEERBETRAY) == 0)
+        totals.peerCoop++;
+    if ((flags & (L3_HISTORY_FLAG_MYBETRAY | L3_HISTORY_FLAG_PEERBETRAY)) == 0)
+        totals.bothCoop++;
+    switch ((flags >> L3_HISTORY_SHIFT_MYPRED) & 0x03)
+    {
+        case L3_HISTORY_PRED_HIT:  totals.myPredHit++;  break;
+        case L3_HISTORY_PRED_MISS: totals.myPredMiss++; break;
+    }
+    switch ((flags >> L3_HISTORY_SHIFT_PEERPRED) & 0x03)
+    {
+        case L3_HISTORY_PRED_HIT:  totals.peerPredHit++;  break;
+        case L3_HISTORY_PRED_MISS: totals.peerPredMiss++; break;
+    }
+    totals.sentenceSum += ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+#if L3_HISTORY_FLASH
+static uint16_t L3_history_crc(const uint8_t* page)
+{
+    uint32_t crc;
+
+    crc16.compute((void*)page, L3_HISTORY_OFFSET_CRC, &crc);
+    return (uint16_t)crc;
+}
+
+static uint8_t L3_history_isErased(uint32_t page)
+{
+    uint8_t magic[2];
+
+    flash.read(magic, regionAddr + page * L3_HISTORY_PAGESIZE, sizeof(magic));
+    return magic[0] == 0xFF && magic[1] == 0xFF;
+}
+
+//기록 영역 : 설정 섹터 (CFGstore.cpp) 바로 앞 섹터, 펌웨어가 침범하면 0
+static uint8_t L3_history_initFlash(void)
+{
+    uint32_t flashEnd, cfgAddr, imageEnd;
+    uint32_t lo, hi, mid;
+
+    if (flash.init() != 0)
+        return 0;
+    flashEnd = flash.get_flash_start() + flash.get_flash_size();
+    cfgAddr = flashEnd - flash.get_sector_size(flashEnd - 1);
+    regionAddr = cfgAddr - flash.get_sector_size(cfgAddr - 1);
+    imageEnd = (uint32_t)(uintptr_t)__etext + (uint32_t)((uint8_t*)__data_end__ - (uint8_t*)__data_start__);
+    if (imageEnd > regionAddr || L3_HISTORY_PAGESIZE % flash.get_page_size() != 0)
+    {
+        printf("[HIST] 펌웨어가 기록 섹터까지 차지합니다 (Makefile의 MBED_APP_SIZE). 라운드 기록은 RAM에만 남습니다.\n");
+        return 0;
+    }
+    pageNum = (cfgAddr - regionAddr) / L3_HISTORY_PAGESIZE;
+
+    //쓰인 페이지는 영역의 앞부분에 이어져 있음
+    lo = 0;
+    hi = pageNum;
+    while (lo < hi)
+    {
+        mid = (lo + hi) / 2;
+        if (L3_history_isErased(mid))
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    nextPage = lo;
+    return 1;
+}
+
+//플래시의 기록으로 집계와 링을 채움 (CRC가 맞지 않는 페이지는 건너뜀)
+static void L3_history_replayFlash(void)
+{
+    uint8_t page[L3_HISTORY_PAGESIZE];
+    uint32_t i;
+    uint8_t r;
+
+    for (i = 0; i < nextPage; i++)
+    {
+        flash.read(page, regionAddr + i * L3_HISTORY_PAGESIZE, L3_HISTORY_PAGESIZE);
+        if (page[0] != (uint8_t)(L3_HISTORY_MAGIC >> 8) || page[1] != (uint8_t)L3_HISTORY_MAGIC ||
+            ((page[L3_HISTORY_OFFSET_CRC] << 8) | page[L3_HISTORY_OFFSET_CRC + 1]) != L3_history_crc(page))
+            continue;
+        for (r = 0; r < L3_HISTORY_PAGERECS; r++)
+            L3_history_push(page + L3_HISTORY_OFFSET_RECS + r * L3_HISTORY_RECSIZE);
+    }
+    spilled = appended;
+}
+
+//아직 내보내지 않은 기록 7개를 플래시 페이지 하나로 (영역이 차 있으면 버림 : 지우는 것은 L3_history_runIdle)
+static void L3_history_spill(void)
+{
+    uint8_t page[L3_HISTORY_PAGESIZE];
+    uint16_t crc;
+    uint8_t r;
+
+    page[0] = (uint8_t)(L3_HISTORY_MAGIC >> 8);
+    page[1] = (uint8_t)L3_HISTORY_MAGIC;
+    for (r = 0; r < L3_HISTORY_PAGERECS; r++)
+        memcpy(page + L3_HISTORY_OFFSET_RECS + r * L3_HISTORY_RECSIZE, ring[(spilled + r) % L3_HISTORY_RAMRECS], L3_HISTORY_RECSIZE);
+    crc = L3_history_crc(page);
+    page[L3_HISTORY_OFFSET_CRC] = (uint8_t)(crc >> 8);
+    page[L3_HISTORY_OFFSET_CRC + 1] = (uint8_t)crc;
+    spilled += L3_HISTORY_PAGERECS;
+
+    if (pageNum == 0)
+        return;
+    if (nextPage >= pageNum)
+    {
+        droppedPages++;
+        return;
+    }
+    if (flash.program(page, regionAddr + nextPage * L3_HISTORY_PAGESIZE, L3_HISTORY_PAGESIZE) == 0)
+        nextPage++;
+    else
+        nextPage = pageNum; //쓰다 만 페이지 : 다음 페이지는 영역을 지운 뒤에
+}
+#endif
+
+//평균이나 비율을 소수점 한 자리로 (분모가 0이면 0)
+static void L3_history_ratio(uint64_t num, uint32_t den, uint32_t scale, unsigned long* whole, unsigned long* tenth)
+{
+    uint64_t v = den ? num * scale * 10 / den : 0;
+
+    *whole = (unsigned long)(v / 10);
+    *tenth = (unsigned long)(v % 10);
+}
+
+
+// 부팅 시 한 번 : 플래시의 기록으로 집계와 최근 기록을 다시 채움
+void L3_history_init(void)
+{
+    MEMstat_registerStatic("L3 history", sizeof(ring) + sizeof(totals)); // 메모리 보고용 정적 RAM 등록
+    memset(&totals, 0, sizeof(totals));
+    appended = 0;
+    spilled = 0;
+#if L3_HISTORY_FLASH
+    if (L3_history_initFlash())
+        L3_history_replayFlash();
+#endif
+}
+
+// 끝난 라운드 하나를 덧붙임 (checkAndShowResult에서 결과 계산 직후)
+void L3_history_append(const L3_history_t* rec)
+{
+    uint8_t p[L3_HISTORY_RECSIZE];
+
+    L3_history_pack(rec, p);
+    L3_history_push(p);
+    if (appended - spilled >= L3_HISTORY_PAGERECS)
+    {
+#if L3_HISTORY_FLASH
+        L3_history_spill();
+#else
+        spilled += L3_HISTORY_PAGERECS;
+#endif
+    }
+}
+
+// 게임 사이에 호출 (시작 대기 상태) : 빈 페이지가 얼마 남지 않았으면 영역을 지움 (1~2초 정지)
+void L3_history_runIdle(void)
+{
+#if L3_HISTORY_FLASH
+    if (pageNum == 0 || nextPage + L3_HISTORY_ERASEAHEAD < pageNum)
+        return;
+    printf("[HIST] 플래시 기록 영역을 지웁니다 (%lu페이지 중 %lu페이지 사용, 버린 페이지 %lu)\n", (unsigned long)pageNum,
+           (unsigned long)nextPage, (unsigned long)droppedPages);
+    if (flash.erase(regionAddr, pageNum * L3_HISTORY_PAGESIZE) != 0)
+        return;
+    nextPage = 0;
+#endif
+}
+
+// 집계 출력 (셸의 history 명령) : 누적 합에서 바로 계산
+void L3_history_printSummary(void)
+{
+    unsigned long w, t, w2, t2, w3, t3;
+    char str[L3_SENTENCE_STRLEN];
+    uint32_t avg = totals.rounds ? (uint32_t)(totals.sentenceSum / totals.rounds) : 0;
+
+    L3_history_ratio(totals.rounds, totals.games, 1, &w, &t);
+    printf("[HIST] 라운드 %lu, 게임 %lu (게임당 %lu.%lu라운드), 재개 %lu\n", (unsigned long)totals.rounds,
+           (unsigned long)totals.games, w, t, (unsigned long)totals.resumes);
+    L3_history_ratio(totals.myCoop, totals.rounds, 100, &w, &t);
+    L3_history_ratio(totals.peerCoop, totals.rounds, 100, &w2, &t2);
+    L3_history_ratio(totals.bothCoop, totals.rounds, 100, &w3, &t3);
+    printf("[HIST] 협력 비율 : 나 %lu.%lu%%, 상대 %lu.%lu%%, 둘 다 %lu.%lu%%\n", w, t, w2, t2, w3, t3);
+    printf("[HIST] 라운드 후 평균 형량 %s년, 예측 성공 : 나 %lu/%lu, 상대 %lu/%lu\n", L3_sentence_format(avg, str),
+           (unsigned long)totals.myPredHit, (unsigned long)(totals.myPredHit + totals.myPredMiss),
+           (unsigned long)totals.peerPredHit, (unsigned long)(totals.peerPredHit + totals.peerPredMiss));
+#if L3_HISTORY_FLASH
+    printf("[HIST] 보관 : RAM 최근 %lu개, 플래시 %lu/%lu페이지 (%lu라운드), 영역이 차서 버린 페이지 %lu\n",
+           (unsigned long)(appended < L3_HISTORY_RAMRECS ? appended : L3_HISTORY_RAMRECS),
+           (unsigned long)nextPage, (unsigned long)pageNum, (unsigned long)(nextPage * L3_HISTORY_PAGERECS),
+           (unsigned long)droppedPages);
+#endif
+}
+
+// 최근 기록 num개 출력 (RAM 링에 남은 만큼, 오래된 것부터)
+void L3_history_printRecent(uint16_t num)
+{
+    static const char* predName[3] = {"-", "성공", "실패"};
+    uint32_t avail = (appended < L3_HISTORY_RAMRECS) ? appended : L3_HISTORY_RAMRECS;
+    uint32_t i, round = 0;
+    L3_history_t rec;
+    char str[L3_SENTENCE_STRLEN];
+
+    if (num > avail)
+        num = (uint16_t)avail;
+    //라운드 번호는 링에서 가장 오래된 기록부터 새 게임 플래그를 따라 셈 (그 앞은 알 수 없음 : 0)
+    for (i = appended - avail; i < appended; i++)
+    {
+        L3_history_unpack(ring[i % L3_HISTORY_RAMRECS], &rec);
+        if (rec.newGame)
+            round = 1;
+        else if (round > 0)
+            round++;
+        if (i < appended - num)
+            continue;
+        printf("[HIST] #%lu 라운드 %lu : 나 %s, 상대 %s, 예측 나 %s / 상대 %s, 형량 %s년%s\n", (unsigned long)i,
+               (unsigned long)round, rec.myChoice == 1 ? "협력" : "배신", rec.peerChoice == 1 ? "협력" : "배신",
+               predName[rec.myPred % 3], predName[rec.peerPred % 3], L3_sentence_format(rec.sentence, str),
+               rec.resumed ? " (재개)" : "");
+    }
+}
@@ -0,0 +1,30 @@
+#include <stdint.h>
+
+#define L3_HISTORY_RAMRECS      64      //RAM 링에 보관하는 최근 라운드 기록 수 (셸의 history N)
+#define L3_HISTORY_RECSIZE      4       //기록 하나의 바이트 수 (플래그 8비트 + 형량 24비트)
+#define L3_HISTORY_PAGESIZE     32      //플래시 페이지 : 매직 2, 기록 7개, CRC 2
+#define L3_HISTORY_PAGERECS     ((L3_HISTORY_PAGESIZE - 4) / L3_HISTORY_RECSIZE)
+#define L3_HISTORY_ERASEAHEAD   64      //빈 페이지가 이보다 적게 남으면 다음 게임 사이에 영역을 미리 지움 (448라운드)
+
+//예측 결과 (L3_history_t의 myPred, peerPred)
+#define L3_HISTORY_PRED_NONE    0       //이번 라운드에 반영된 예측 없음
+#define L3_HISTORY_PRED_HIT     1
+#define L3_HISTORY_PRED_MISS    2
+
+//끝난 라운드 하나 (라운드 번호는 기록하지 않음 : 새 게임 기록부터 하나씩 늘어남)
+typedef struct
+{
+    uint8_t newGame;            //게임의 첫 라운드
+    uint8_t resumed;            //재시작 후 재개한 첫 라운드 (L3_snapshot.h)
+    uint8_t myChoice;           //1 : 협력, 2 : 배신
+    uint8_t peerChoice;
+    uint8_t myPred;             //내 예측 결과 (L3_HISTORY_PRED_*)
+    uint8_t peerPred;           //상대의 예측 결과
+    uint32_t sentence;          //라운드 후 내 형량 (1/1000년, 24비트를 넘으면 포화)
+} L3_history_t;
+
+void L3_history_init(void);
+void L3_history_append(const L3_history_t* rec);
+void L3_history_runIdle(void);
+void L3_history_printSummary(void);
+void L3_history_printRecent(uint16_t num);
@@ -0,0 +1,96 @@
+#include "L3_payoff.h"
+#include "L3_sentence.h"
+#include "protocol_parameters.h"
+
+// 게임 규칙을 (내 선택 x 상대 선택) -> 배율(분자/분모) 표로 정의합니다.
+// 규칙 집합은 컴파일 시점에 L3_PAYOFF_RULESET으로 선택되며, 실행 중에는 표 조회 한 번으로 형량을 계산합니다.
+// 인덱스 0 : 협력, 1 : 배신 (협력이 아닌 값은 모두 배신으로 취급)
+
+#define L3_PAYOFF_NUM       0
+#define L3_PAYOFF_DEN       1
+
+#if (L3_PAYOFF_RULESET == L3_PAYOFF_RULESET_README)
+static const uint8_t payoffTable[2][2][2] =
+{
+    // 상대 협력   상대 배신
+    { {2, 3},     {2, 1} },     //나 협력
+    { {1, 2},     {3, 2} }      //나 배신
+};
+
+static const uint8_t predictionTable[2][2] =
+{
+    {4, 3},                     //예측 실패
+    {1, 3}                      //예측 성공
+};
+#else
+static const uint8_t payoffTable[2][2][2] =
+{
+    // 상대 협력   상대 배신
+    { {1, 3},     {2, 1} },     //나 협력
+    { {1, 2},     {3, 2} }      //나 배신
+};
+
+static const uint8_t predictionTable[2][2] =
+{
+    {4, 3},                     //예측 실패
+    {2, 3}                      //예측 성공
+};
+#endif
+
+
+// 협력/배신 결과에 따른 형량 계산
+uint32_t L3_payoff_applyChoice(uint32_t sentence, int myChoice, int peerChoice)
+{
+    const uint8_t* ratio = payoffTable[myChoice != L3_CHOICE_COOPERATE][peerChoice != L3_CHOICE_COOPERATE];
+
+    return L3_sentence_scale(sentence, ratio[L3_PAYOFF_NUM], ratio[L3_PAYOFF_DEN]);
+}
+
+// N명 게임의 형량 계산 : 다른 참가자 중 협력한 비율(coop / (coop + betray))로 상대 협력과 상대 배신의
+// 배율 사이를 보간 (모두 협력하거나 모두 배신하면 2인 게임과 같은 배율, 도착한 선택이 없으면 형량 그대로)
+uint32_t L3_payoff_applyGroupChoice(uint32_t sentence, int myChoice, uint8_t coop, uint8_t betray)
+{
+    const uint8_t (*row)[2] = payoffTable[myChoice != L3_CHOICE_COOPERATE];
+    uint32_t num, den;
+    uint64_t res;
+
+    if (coop + betray == 0)
+        return sentence;
+    if (betray == 0)
+        return L3_payoff_applyChoice(sentence, myChoice, L3_CHOICE_COOPERATE);
+    if (coop == 0)
+        return L3_payoff_applyChoice(sentence, myChoice, L3_CHOICE_BETRAY);
+
+    //(coop * 협력 배율 + betray * 배신 배율) / (coop + betray), 분모를 통분
+    num = coop * row[0][L3_PAYOFF_NUM] * row[1][L3_PAYOFF_DEN] + betray * row[1][L3_PAYOFF_NUM] * row[0][L3_PAYOFF_DEN];
+    den = (coop + betray) * row[0][L3_PAYOFF_DEN] * row[1][L3_PAYOFF_DEN];
+    if (sentence > L3_SENTENCE_MAX)
+        sentence = L3_SENTENCE_MAX;
+    res = ((uint64_t)sentence * num + den / 2) / den;
+
+    return (res > L3_SENTENCE_MAX) ? L3_SENTENCE_MAX : (uint32_t)res;
+}
+
+// 예측 성공/실패에 따른 형량 계산
+uint32_t L3_payoff_applyPrediction(uint32_t sentence, int hit)
+{
+    const uint8_t* ratio = predictionTable[hit != 0];
+
+    return L3_sentence_scale(sentence, ratio[L3_PAYOFF_NUM], ratio[L3_PAYOFF_DEN]);
+}
+
+// 협력/배신 배율 조회 (규칙 안내문 출력용)
+void L3_payoff_getChoiceRatio(int myChoice, int peerChoice, uint8_t* num, uint8_t* den)
+{
+    const uint8_t* ratio = payoffTable[myChoice != L3_CHOICE_COOPERATE][peerChoice != L3_CHOICE_COOPERATE];
+
+    *num = ratio[L3_PAYOFF_NUM];
+    *den = ratio[L3_PAYOFF_DEN];
+}
+
+// 예측 배율 조회 (결과 메시지, 규칙 안내문 출력용)
+void L3_payoff_getPredictionRatio(int hit, uint8_t* num, uint8_t* den)
+{
+    *num = predictionTable[hit != 0][L3_PAYOFF_NUM];
+    *den = predictionTable[hit != 0][L3_PAYOFF_DEN];
+}
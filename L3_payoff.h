@@ -0,0 +1,14 @@
+#include <stdint.h>
+
+#define L3_CHOICE_COOPERATE             1
+#define L3_CHOICE_BETRAY                2
+
+//rule sets (select with L3_PAYOFF_RULESET in protocol_parameters.h)
+#define L3_PAYOFF_RULESET_CLASSIC       0   //협력-협력 1/3, 예측 성공 2/3 / 실패 4/3
+#define L3_PAYOFF_RULESET_README        1   //README 표 기준 : 협력-협력 2/3, 예측 성공 1/3 / 실패 4/3
+
+uint32_t L3_payoff_applyChoice(uint32_t sentence, int myChoice, int peerChoice);
+uint32_t L3_payoff_applyGroupChoice(uint32_t sentence, int myChoice, uint8_t coop, uint8_t betray);
+uint32_t L3_payoff_applyPrediction(uint32_t sentence, int hit);
+void L3_payoff_getChoiceRatio(int myChoice, int peerChoice, uint8_t* num, uint8_t* den);
+void L3_payoff_getPredictionRatio(int hit, uint8_t* num, uint8_t* den);
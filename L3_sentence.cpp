@@ -0,0 +1,43 @@
+#include "L3_sentence.h"
+
+// 형량은 1/1000년 단위의 정수로 관리합니다.
+// 부동소수점 연산(soft-float)을 쓰지 않으므로 두 노드에서 항상 같은 값이 나옵니다.
+
+// 형량에 num/den 배율 적용 (반올림, 상한에서 포화)
+uint32_t L3_sentence_scale(uint32_t sentence, uint8_t num, uint8_t den)
+{
+    uint32_t res;
+
+    if (sentence > L3_SENTENCE_MAX)
+        sentence = L3_SENTENCE_MAX;
+
+    res = (sentence * num + den / 2) / den;
+    if (res > L3_SENTENCE_MAX)
+        res = L3_SENTENCE_MAX;
+
+    return res;
+}
+
+// 소수점 한 자리 문자열로 변환 (printf의 %f 경로를 사용하지 않음)
+char* L3_sentence_format(uint32_t sentence, char* buf)
+{
+    char tmp[L3_SENTENCE_STRLEN];
+    uint32_t tenths = (sentence + L3_SENTENCE_SCALE / 20) / (L3_SENTENCE_SCALE / 10);
+    int len = 0;
+    int i = 0;
+
+    tmp[len++] = '0' + (tenths % 10);
+    tmp[len++] = '.';
+    tenths /= 10;
+    do
+    {
+        tmp[len++] = '0' + (tenths % 10);
+        tenths /= 10;
+    } while (tenths > 0);
+
+    while (len > 0)
+        buf[i++] = tmp[--len];
+    buf[i] = '\0';
+
+    return buf;
+}
@@ -0,0 +1,10 @@
+#include <stdint.h>
+
+#define L3_SENTENCE_SCALE       1000                        //고정소수점 단위 : 1/1000년
+#define L3_SENTENCE_INIT        (10 * L3_SENTENCE_SCALE)    //시작 형량 10년
+#define L3_SENTENCE_RELEASE     (1 * L3_SENTENCE_SCALE)     //석방 기준 1년
+#define L3_SENTENCE_MAX         (0xFFFFFFFFUL / 4)          //곱셈 오버플로 방지 상한 (분자 최대 4)
+#define L3_SENTENCE_STRLEN      12                          //"1073741.8" + NULL
+
+uint32_t L3_sentence_scale(uint32_t sentence, uint8_t num, uint8_t den);
+char* L3_sentence_format(uint32_t sentence, char* buf);
@@ -0,0 +1,201 @@
+#include "mbed.h"
+#include "string.h"
+#include "L3_snapshot.h"
+#include "CFGstore.h"
+#include "protocol_parameters.h"
+
+// 게임 상태 스냅샷 : 라운드 경계마다 다음 라운드를 시작하는 데 필요한 상태를 7바이트로 인코딩해
+// 리셋에도 지워지지 않는 백업 SRAM에 쓰고 (L3_SNAPSHOT_FLASH이면 플래시의 CFGstore 레코드에도),
+// 재시작한 노드는 상대방과 라운드를 맞춘 뒤 (L3_FSMmain.cpp의 RESYNC) 새 게임 대신 그 라운드부터 이어감
+// 두 노드가 라운드 경계를 지나는 시점은 메시지 하나만큼 어긋날 수 있으므로 최근 스냅샷과 직전 스냅샷을
+// 함께 보관하고, 양쪽 모두 가진 라운드 중 가장 최근 것으로 재개함
+// 백업 SRAM 기록 : 매직 2바이트, 레코드 (L3_SNAPSHOT_RECSIZE), CRC 2바이트
+// 플래시 레코드는 라운드 중에 섹터를 지우지 않음 (CFGstore_appendRecord) : 섹터가 차면 플래시에는 쓰지 않고
+// (백업 SRAM에는 남음) 게임 사이에 L3_snapshot_runIdle이 섹터를 미리 정리함
+
+#define L3_SNAPSHOT_MAGIC       0x5A3E
+#define L3_SNAPSHOT_RAMSIZE     (2 + L3_SNAPSHOT_RECSIZE + 2)
+
+#define L3_SNAPSHOT_FLAG_MYUSED     0x01
+#define L3_SNAPSHOT_FLAG_PEERUSED   0x02
+#define L3_SNAPSHOT_SHIFT_MYPRED    2
+#define L3_SNAPSHOT_SHIFT_PEERPRED  4
+
+//레코드가 플래시 슬롯 하나에 들어가야 함
+typedef char L3_snapshot_sizeCheck[(L3_SNAPSHOT_RECSIZE <= CFGSTORE_DATASIZE) ? 1 : -1];
+
+static MbedCRC<POLY_16BIT_CCITT, 16> crc16;
+static uint8_t* bkpRam;                     //백업 SRAM 기록 위치
+static uint8_t myDestId;
+static uint8_t snapNum = 0;                 //보관 중인 스냅샷 수 (0 : 진행 중인 게임 없음)
+static L3_snapshot_t snaps[2];              //0 : 최근, 1 : 직전
+
+
+static void L3_snapshot_encode(const L3_snapshot_t* snap, uint8_t* p)
+{
+    p[0] = (uint8_t)(snap->round >> 8);
+    p[1] = (uint8_t)snap->round;
+    p[2] = (uint8_t)(snap->sentence >> 24);
+    p[3] = (uint8_t)(snap->sentence >> 16);
+    p[4] = (uint8_t)(snap->sentence >> 8);
+    p[5] = (uint8_t)snap->sentence;
+    p[6] = (uint8_t)((snap->myUsed ? L3_SNAPSHOT_FLAG_MYUSED : 0) | (snap->peerUsed ? L3_SNAPSHOT_FLAG_PEERUSED : 0) |
+                     ((snap->myPrediction & 0x03) << L3_SNAPSHOT_SHIFT_MYPRED) |
+                     ((snap->peerPrediction & 0x03) << L3_SNAPSHOT_SHIFT_PEERPRED));
+}
+
+static void L3_snapshot_decode(const uint8_t* p, L3_snapshot_t* snap)
+{
+    snap->round = (uint16_t)((p[0] << 8) | p[1]);
+    snap->sentence = ((uint32_t)p[2] << 24) | ((uint32_t)p[3] << 16) | ((uint32_t)p[4] << 8) | p[5];
+    snap->myUsed = (p[6] & L3_SNAPSHOT_FLAG_MYUSED) ? 1 : 0;
+    snap->peerUsed = (p[6] & L3_SNAPSHOT_FLAG_PEERUSED) ? 1 : 0;
+    snap->myPrediction = (p[6] >> L3_SNAPSHOT_SHIFT_MYPRED) & 0x03;
+    snap->peerPrediction = (p[6] >> L3_SNAPSHOT_SHIFT_PEERPRED) & 0x03;
+}
+
+//레코드를 풀어 보관함 : 이 상대와의 게임이 아니거나 내용이 맞지 않으면 0
+static uint8_t L3_snapshot_unpack(const uint8_t* rec)
+{
+    uint8_t i;
+
+    if (rec[0] != myDestId || rec[1] > 2)
+        return 0;
+    for (i = 0; i < rec[1]; i++)
+        L3_snapshot_decode(rec + 2 + i * L3_SNAPSHOT_SIZE, &snaps[i]);
+    snapNum = rec[1];
+    return 1;
+}
+
+static uint16_t L3_snapshot_crc(const uint8_t* data, uint8_t len)
+{
+    uint32_t crc;
+
+    crc16.compute((void*)data, len, &crc);
+    return (uint16_t)crc;
+}
+
+//보관 중인 스냅샷을 백업 SRAM과 플래시에 기록
+static void L3_snapshot_write(void)
+{
+    uint8_t ram[L3_SNAPSHOT_RAMSIZE];
+    uint8_t* rec = ram + 2;
+    uint16_t crc;
+    uint8_t i;
+
+    memset(ram, 0, sizeof(ram));
+    ram[0] = (uint8_t)(L3_SNAPSHOT_MAGIC >> 8);
+    ram[1] = (uint8_t)L3_SNAPSHOT_MAGIC;
+    rec[0] = myDestId;
+    rec[1] = snapNum;
+    for (i = 0; i < snapNum; i++)
+        L3_snapshot_encode(&snaps[i], rec + 2 + i * L3_SNAPSHOT_SIZE);
+    crc = L3_snapshot_crc(ram, L3_SNAPSHOT_RAMSIZE - 2);
+    ram[L3_SNAPSHOT_RAMSIZE - 2] = (uint8_t)(crc >> 8);
+    ram[L3_SNAPSHOT_RAMSIZE - 1] = (uint8_t)crc;
+    memcpy(bkpRam, ram, sizeof(ram));
+
+#if L3_SNAPSHOT_FLASH
+    if (CFGstore_appendRecord(CFGSTORE_TYPE_SNAPSHOT, rec, L3_SNAPSHOT_RECSIZE) == 0)
+        debug_if(DBGMSG_L3, "[L3] 스냅샷을 플래시에 기록하지 못했습니다.\n");
+#endif
+}
+
+
+// 진행 중이던 게임의 스냅샷을 찾음 (백업 SRAM 먼저, 없으면 플래시) : 읽어온 곳 (L3_SNAPSHOT_SRC_*)
+// CFGstore_init 이후에 호출
+uint8_t L3_snapshot_init(uint8_t destId)
+{
+    uint8_t ram[L3_SNAPSHOT_RAMSIZE];
+
+#if defined(TARGET_STM32F4)
+    //백업 SRAM (4 KB) : 리셋으로 지워지지 않음, 쓰기 보호 해제 후 사용
+    __HAL_RCC_PWR_CLK_ENABLE();
+    HAL_PWR_EnableBkUpAccess();
+    __HAL_RCC_BKPSRAM_CLK_ENABLE();
+    bkpRam = (uint8_t*)BKPSRAM_BASE;
+#else
+    static uint8_t hostRam[L3_SNAPSHOT_RAMSIZE];
+    bkpRam = hostRam;
+#endif
+    myDestId = destId;
+    snapNum = 0;
+
+    memcpy(ram, bkpRam, sizeof(ram));
+    if (ram[0] == (uint8_t)(L3_SNAPSHOT_MAGIC >> 8) && ram[1] == (uint8_t)L3_SNAPSHOT_MAGIC &&
+        L3_snapshot_crc(ram, L3_SNAPSHOT_RAMSIZE - 2) == ((ram[L3_SNAPSHOT_RAMSIZE - 2] << 8) | ram[L3_SNAPSHOT_RAMSIZE - 1]) &&
+        L3_snapshot_unpack(ram + 2))
+        return snapNum > 0 ? L3_SNAPSHOT_SRC_RAM : L3_SNAPSHOT_SRC_NONE;
+
+#if L3_SNAPSHOT_FLASH
+    {
+        uint8_t rec[L3_SNAPSHOT_RECSIZE];
+
+        if (CFGstore_loadRecord(CFGSTORE_TYPE_SNAPSHOT, rec, L3_SNAPSHOT_RECSIZE) && L3_snapshot_unpack(rec) && snapNum > 0)
+            return L3_SNAPSHOT_SRC_FLASH;
+    }
+#endif
+    snapNum = 0;
+    return L3_SNAPSHOT_SRC_NONE;
+}
+
+// 라운드 경계의 스냅샷 기록 : 라운드 0은 새 게임의 시작 (이전 게임의 스냅샷은 버림)
+void L3_snapshot_save(const L3_snapshot_t* snap)
+{
+    if (snap->round == 0)
+        snapNum = 0;
+    else if (snapNum > 0 && snaps[0].round != snap->round)
+    {
+        snaps[1] = snaps[0];
+        snapNum = 2;
+    }
+    snaps[0] = *snap;
+    if (snapNum == 0)
+        snapNum = 1;
+    L3_snapshot_write();
+}
+
+// 게임 종료 : 재시작해도 이어갈 게임이 없음 (이미 없으면 기록하지 않음)
+void L3_snapshot_clear(void)
+{
+    if (snapNum == 0)
+        return;
+    snapNum = 0;
+    L3_snapshot_write();
+}
+
+// 게임 사이에 호출 (시작 대기 상태) : 설정 섹터의 빈 슬롯이 얼마 남지 않았으면 정리 (1~2초 정지)
+void L3_snapshot_runIdle(void)
+{
+#if L3_SNAPSHOT_FLASH
+    if (CFGstore_makeRoom(L3_SNAPSHOT_FLASHROOM))
+        debug_if(DBGMSG_L3, "[L3] 스냅샷 플래시 섹터를 정리했습니다.\n");
+#endif
+}
+
+// 보관 중인 스냅샷의 라운드 (직전 스냅샷이 없으면 최근 것과 같음) : 스냅샷 수
+uint8_t L3_snapshot_getRounds(uint16_t* latest, uint16_t* previous)
+{
+    if (snapNum == 0)
+        return 0;
+    *latest = snaps[0].round;
+    *previous = snaps[snapNum - 1].round;
+    return snapNum;
+}
+
+// 그 라운드의 스냅샷으로 되돌림 (더 최근 스냅샷은 버림) : 없으면 0
+uint8_t L3_snapshot_rewind(uint16_t round, L3_snapshot_t* snap)
+{
+    if (snapNum == 0)
+        return 0;
+    if (snaps[0].round != round)
+    {
+        if (snapNum < 2 || snaps[1].round != round)
+            return 0;
+        snaps[0] = snaps[1];
+        snapNum = 1;
+        L3_snapshot_write();
+    }
+    *snap = snaps[0];
+    return 1;
+}
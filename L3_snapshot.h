@@ -0,0 +1,28 @@
+#include <stdint.h>
+
+#define L3_SNAPSHOT_SIZE        7       //인코딩된 스냅샷 바이트 수 (라운드 2, 형량 4, 플래그 1)
+#define L3_SNAPSHOT_RECSIZE     (2 + 2 * L3_SNAPSHOT_SIZE) //상대 ID, 스냅샷 개수, 최근/직전 스냅샷
+#define L3_SNAPSHOT_FLASHROOM   256     //게임 사이에 설정 섹터의 빈 슬롯이 이보다 적으면 미리 정리 (L3_SNAPSHOT_FLASH)
+
+//스냅샷을 읽어온 곳 (L3_snapshot_init)
+#define L3_SNAPSHOT_SRC_NONE    0
+#define L3_SNAPSHOT_SRC_RAM     1       //백업 SRAM (웜 리셋)
+#define L3_SNAPSHOT_SRC_FLASH   2       //플래시 (전원 재투입)
+
+//라운드 경계의 게임 상태 (다음 라운드를 시작하는 데 필요한 것만)
+typedef struct
+{
+    uint16_t round;             //끝난 라운드 수
+    uint32_t sentence;          //내 형량 (1/1000년)
+    uint8_t myUsed;             //내가 예측 기회를 사용했는지
+    uint8_t peerUsed;           //상대가 예측 기회를 사용했는지
+    uint8_t myPrediction;       //다음 라운드에 반영할 내 예측 (0 : 없음, 1 : 협력, 2 : 배신)
+    uint8_t peerPrediction;     //다음 라운드에 반영할 상대의 예측 (0 : 없음)
+} L3_snapshot_t;
+
+uint8_t L3_snapshot_init(uint8_t destId);
+void L3_snapshot_save(const L3_snapshot_t* snap);
+void L3_snapshot_clear(void);
+void L3_snapshot_runIdle(void);
+uint8_t L3_snapshot_getRounds(uint16_t* latest, uint16_t* previous);
+uint8_t L3_snapshot_rewind(uint16_t round, L3_snapshot_t* snap);
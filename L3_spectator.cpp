@@ -0,0 +1,230 @@
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "L3_spectator.h"
+#include "L3_payoff.h"
+#include "L3_sentence.h"
+#include "protocol_parameters.h"
+
+// 관전 : 선수는 라운드가 끝날 때마다 번호를 붙인 라운드 결과를 브로드캐스트로 한 번 보내고 (재전송 없음),
+// 관전 노드는 선수마다 번호를 따라가며 점수판을 갱신함. 번호가 건너뛰면 (손실, 선수의 재시작) 라운드와
+// 형량은 그대로 쓰고 누적 집계만 스냅샷으로 맞춤 : 임의의 지연 뒤 SPECR:<선수 ID>를 보내며, 같은 선수에 대한
+// 다른 관전 노드의 요청을 들으면 내 요청을 미뤄 그 스냅샷을 같이 받음 (선수는 L3_SPEC_SNAPTIME초에 한 번만 답함)
+// 형량은 화면에 보이는 소수점 한 자리 (1/10년)로 보내 메시지가 L2 프레임 하나에 들어가게 함
+// 새 게임의 첫 라운드 기록은 누적 집계를 처음부터 다시 세므로 스냅샷 없이도 맞음
+
+static L3_specPlayer_t me;                          //선수 측 : 내 기록 상태
+static uint8_t recorded = 0;
+
+static L3_specPlayer_t board[L3_SPEC_MAXPLAYERS];   //관전 측 점수판
+static uint8_t numPlayers = 0;
+static L3_specStats_t stats;
+
+
+// 선수 측 : 끝난 라운드 (라운드 1이면 새 게임)
+void L3_spec_recordRound(uint16_t round, uint8_t myChoice, uint8_t otherChoice, uint32_t sentence)
+{
+    me.seq++;
+    if (round == 1)
+    {
+        me.coop = 0;
+        me.betray = 0;
+    }
+    me.round = round;
+    me.myChoice = myChoice;
+    me.otherChoice = otherChoice;
+    me.sentence = sentence;
+    if (myChoice == L3_CHOICE_COOPERATE)
+        me.coop++;
+    else
+        me.betray++;
+    recorded = 1;
+}
+
+// 형량 (1/1000년) -> 보내는 단위 (1/10년, L3_sentence_format과 같이 반올림)
+static unsigned long L3_spec_toTenths(uint32_t sentence)
+{
+    return (sentence + L3_SENTENCE_SCALE / 20) / (L3_SENTENCE_SCALE / 10);
+}
+
+// 마지막 라운드 결과 메시지 : 길이 (size 이상이면 잘린 것이므로 보내지 않음)
+int L3_spec_formatRecord(char* buf, int size)
+{
+    return snprintf(buf, size, "SPEC:%u:%u:%u%u:%lu", me.seq, me.round, me.myChoice, me.otherChoice,
+                    L3_spec_toTenths(me.sentence));
+}
+
+// 따라잡기 스냅샷 메시지 : 길이 (size 이상이면 잘린 것이므로 보내지 않음)
+int L3_spec_formatSnapshot(char* buf, int size)
+{
+    return snprintf(buf, size, "SPECS:%u:%u:%lu:%u:%u", me.seq, me.round, L3_spec_toTenths(me.sentence), me.coop,
+                    me.betray);
+}
+
+// 보낼 기록이 있는지 (재시작 후 첫 라운드가 끝나기 전에는 스냅샷 요청에 답하지 않음)
+uint8_t L3_spec_hasRecord(void)
+{
+    return recorded;
+}
+
+static L3_specPlayer_t* L3_spec_lookup(uint8_t id)
+{
+    uint8_t i;
+
+    for (i = 0; i < numPlayers; i++)
+    {
+        if (board[i].id == id)
+            return &board[i];
+    }
+    return NULL;
+}
+
+const L3_specPlayer_t* L3_spec_find(uint8_t id)
+{
+    return L3_spec_lookup(id);
+}
+
+// 콜론으로 구분된 숫자 num개 (마지막 뒤에는 문자열 끝) : 형식이 맞지 않으면 0
+static uint8_t L3_spec_parseFields(const char* str, unsigned long* val, uint8_t num)
+{
+    char* next;
+    uint8_t i;
+
+    for (i = 0; i < num; i++)
+    {
+        val[i] = strtoul(str, &next, 10);
+        if (next == str || *next != ((i == num - 1) ? '\0' : ':'))
+            return 0;
+        str = next + 1;
+    }
+    return 1;
+}
+
+// 관전 측 : 받은 메시지 처리 (결과 L3_SPEC_*)
+int L3_spec_onMsg(uint8_t srcId, const char* msg, uint32_t nowMs)
+{
+    unsigned long val[5];       //기록 : 번호, 라운드, 선택 2자리, 형량 / 스냅샷 : 번호, 라운드, 형량, 협력, 배신
+    uint8_t snapshot;
+    L3_specPlayer_t* p;
+    int16_t diff;
+    uint8_t myChoice = 0, otherChoice = 0;
+
+    if (strncmp(msg, "SPECR:", 6) == 0)
+    {
+        //다른 관전 노드의 요청 : 그 스냅샷을 같이 받으므로 내 요청은 미룸
+        if ((p = L3_spec_lookup((uint8_t)atoi(msg + 6))) != NULL && !p->synced)
+            p->reqAt = nowMs + L3_SPEC_REQTIME * 1000;
+        return L3_SPEC_REQUEST;
+    }
+    if (strncmp(msg, "SPECS:", 6) == 0)
+    {
+        snapshot = 1;
+        if (!L3_spec_parseFields(msg + 6, val, 5))
+            return L3_SPEC_INVALID;
+    }
+    else if (strncmp(msg, "SPEC:", 5) == 0)
+    {
+        snapshot = 0;
+        if (!L3_spec_parseFields(msg + 5, val, 4))
+            return L3_SPEC_INVALID;
+        myChoice = (uint8_t)(val[2] / 10);
+        otherChoice = (uint8_t)(val[2] % 10);
+        if (myChoice != L3_CHOICE_COOPERATE && myChoice != L3_CHOICE_BETRAY)
+            return L3_SPEC_INVALID;
+    }
+    else
+        return L3_SPEC_INVALID;
+
+    if ((p = L3_spec_lookup(srcId)) == NULL)
+    {
+        if (numPlayers >= L3_SPEC_MAXPLAYERS)
+            return L3_SPEC_FULL;
+        p = &board[numPlayers++];
+        memset(p, 0, sizeof(*p));
+        p->id = srcId;
+        p->seq = (uint16_t)(val[0] - 1);    //처음 보는 선수 : 새 게임의 첫 라운드가 아니면 스냅샷을 요청
+        p->reqAt = nowMs + rand() % L3_SPEC_REQJITTER;
+    }
+    diff = (int16_t)((uint16_t)val[0] - p->seq);
+
+    if (snapshot)
+    {
+        if (diff < 0 || (diff == 0 && p->synced))
+        {
+            stats.old++;
+            return L3_SPEC_OLD;
+        }
+        if (diff != 0) //스냅샷보다 앞선 라운드의 선택은 알 수 없음
+            p->myChoice = p->otherChoice = 0;
+        p->sentence = (uint32_t)val[2] * (L3_SENTENCE_SCALE / 10);
+        p->coop = (uint16_t)val[3];
+        p->betray = (uint16_t)val[4];
+        p->synced = 1;
+        stats.snapshots++;
+    }
+    else
+    {
+        if (diff == 0)
+        {
+            stats.old++;
+            return L3_SPEC_OLD;
+        }
+        stats.records++;
+        if (val[1] == 1) //새 게임 : 처음부터 다시 셈
+        {
+            p->coop = 0;
+            p->betray = 0;
+            p->synced = 1;
+        }
+        else if (diff != 1) //건너뛴 번호, 선수의 재시작 (번호가 되돌아감)
+        {
+            if (p->synced)
+                p->reqAt = nowMs + rand() % L3_SPEC_REQJITTER;
+            p->synced = 0;
+            stats.gaps++;
+        }
+        if (myChoice == L3_CHOICE_COOPERATE)
+            p->coop++;
+        else
+            p->betray++;
+        p->myChoice = myChoice;
+        p->otherChoice = otherChoice;
+        p->sentence = (uint32_t)val[3] * (L3_SENTENCE_SCALE / 10);
+    }
+
+    p->seq = (uint16_t)val[0];
+    p->round = (uint16_t)val[1];
+    return p->synced ? L3_SPEC_UPDATED : L3_SPEC_GAP;
+}
+
+// 스냅샷을 요청할 선수 (없으면 -1) : 요청하면 L3_SPEC_REQTIME초 뒤에 다시 요청
+int L3_spec_nextRequest(uint32_t nowMs)
+{
+    uint8_t i;
+
+    for (i = 0; i < numPlayers; i++)
+    {
+        if (!board[i].synced && (int32_t)(nowMs - board[i].reqAt) >= 0)
+        {
+            board[i].reqAt = nowMs + L3_SPEC_REQTIME * 1000;
+            stats.requests++;
+            return board[i].id;
+        }
+    }
+    return -1;
+}
+
+uint8_t L3_spec_getNumPlayers(void)
+{
+    return numPlayers;
+}
+
+const L3_specPlayer_t* L3_spec_getPlayer(uint8_t idx)
+{
+    return (idx < numPlayers) ? &board[idx] : NULL;
+}
+
+L3_specStats_t* L3_spec_getStats(void)
+{
+    return &stats;
+}
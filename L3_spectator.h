@@ -0,0 +1,62 @@
+#include <stdint.h>
+#include "L2_msg.h"
+#include "L2_crc.h"
+
+#define L3_SPECTATE_ID          0       //목적지 ID가 이 값이면 관전 노드 : 게임을 하지 않고 선수들의 라운드 결과로 점수판을 만듦
+#define L3_SPEC_DEST            255     //라운드 결과와 스냅샷은 L2 브로드캐스트로 (ACK 없음, 관전 노드가 늘어도 선수의 ARQ 부담은 그대로)
+#define L3_SPEC_MAXPLAYERS      16      //관전 노드의 점수판에 올리는 선수 수
+#define L3_SPEC_MSGLEN          (L2_MSG_MAXDATASIZE - L2_CRC_LEN + 1) //메시지 버퍼 (널 포함) : 메시지는 L2 프레임 하나의 데이터에
+                                        //들어가야 함 (브로드캐스트는 조각을 다시 맞추지 않음, 길면 보내지 않음)
+#define L3_SPEC_REQJITTER       1000    //ms : 빠진 기록을 안 뒤 요청까지 기다리는 최대 시간 (먼저 요청한 관전 노드가 있으면 그 스냅샷을 같이 받음)
+
+//선수가 보내는 메시지
+//  SPEC:<번호>:<라운드>:<내 선택><상대 선택>:<형량>      라운드 결과 (형량은 1/10년, 라운드 1은 새 게임)
+//  SPECS:<번호>:<라운드>:<형량>:<협력>:<배신>            따라잡기 스냅샷 (번호까지의 이번 게임 누적 집계)
+//관전 노드가 보내는 메시지
+//  SPECR:<선수 ID>                                       기록이 빠진 선수에게 스냅샷 요청
+
+//L3_spec_onMsg 결과
+#define L3_SPEC_UPDATED         0       //점수판 갱신
+#define L3_SPEC_GAP             1       //기록이 빠짐 : 라운드와 형량만 갱신, 누적 집계는 스냅샷을 받을 때까지 맞지 않음
+#define L3_SPEC_OLD             2       //이미 반영한 기록
+#define L3_SPEC_FULL            3       //점수판에 자리가 없음
+#define L3_SPEC_REQUEST         4       //다른 관전 노드의 스냅샷 요청 (같은 선수에 대한 내 요청은 미룸)
+#define L3_SPEC_INVALID         5       //관전 메시지가 아님
+
+//점수판의 선수 한 명
+typedef struct
+{
+    uint8_t id;
+    uint8_t synced;             //1 : 빠진 기록 없이 누적 집계가 맞음
+    uint16_t seq;               //마지막으로 반영한 기록 번호
+    uint16_t round;
+    uint8_t myChoice;           //마지막 라운드의 선수 선택 (1 : 협력, 2 : 배신, 0 : 스냅샷만 받음)
+    uint8_t otherChoice;        //상대 (N명 게임 : 다른 참가자 다수)의 선택
+    uint16_t coop;              //이번 게임의 협력 라운드 수
+    uint16_t betray;
+    uint32_t sentence;          //1/1000년 (L3_sentence.h), 1/10년 단위로 받음
+    uint32_t reqAt;             //빠진 기록이 있으면 스냅샷을 요청할 시각 (다른 관전 노드가 요청하면 미룸)
+} L3_specPlayer_t;
+
+typedef struct
+{
+    uint32_t records;
+    uint32_t snapshots;
+    uint32_t gaps;              //빠진 기록이 있던 수신 (선수의 재시작 포함)
+    uint32_t old;
+    uint32_t requests;          //내가 보낸 스냅샷 요청
+} L3_specStats_t;
+
+//선수 측 : 끝난 라운드를 기록하고 메시지를 만듦
+void L3_spec_recordRound(uint16_t round, uint8_t myChoice, uint8_t otherChoice, uint32_t sentence);
+int L3_spec_formatRecord(char* buf, int size);
+int L3_spec_formatSnapshot(char* buf, int size);
+uint8_t L3_spec_hasRecord(void);
+
+//관전 측 : 받은 메시지로 점수판 갱신, 스냅샷 요청
+int L3_spec_onMsg(uint8_t srcId, const char* msg, uint32_t nowMs);
+int L3_spec_nextRequest(uint32_t nowMs);
+const L3_specPlayer_t* L3_spec_find(uint8_t id);
+uint8_t L3_spec_getNumPlayers(void);
+const L3_specPlayer_t* L3_spec_getPlayer(uint8_t idx);
+L3_specStats_t* L3_spec_getStats(void);
@@ -0,0 +1,173 @@
+#include "mbed.h"
+#include "L3_strategy.h"
+#include "L3_payoff.h"
+
+// 자동 플레이 전략 : 키보드 입력 대신 L3 FSM에 들어갈 입력 문자('1'/'2', 'Y'/'N')를 만들어냅니다.
+// 각 전략은 선택/예측 참여/예측값 함수로 구성되며, 직전 두 라운드의 기록만 사용합니다.
+
+typedef struct
+{
+    const char* name;
+    int (*choose)(void);            //협력/배신 선택 (1/2)
+    int (*decidePrediction)(void);  //예측 게임 참여 여부 (1 : Y, 0 : N)
+    int (*predict)(void);           //상대방 다음 선택 예측 (1/2)
+} L3_strategy_t;
+
+// 라운드 기록
+static int myLast = 0;      //직전 라운드 내 선택 (0 : 없음)
+static int peerLast = 0;    //직전 라운드 상대 선택
+static int peerLast2 = 0;   //두 라운드 전 상대 선택
+
+// 통계
+static uint32_t roundCnt = 0;
+static uint32_t gameCnt = 0;
+static Timer statTimer;
+
+// 표 기반 전략 : 기본값은 Pavlov (win-stay, lose-shift), 셸의 :mode table <5자리>로 바꾸고 :save로 저장
+static uint8_t strategyTable[L3_STRATEGY_TABLESIZE] =
+{
+    L3_CHOICE_COOPERATE,    //첫 수
+    L3_CHOICE_COOPERATE,    //CC 다음
+    L3_CHOICE_BETRAY,       //CD 다음
+    L3_CHOICE_BETRAY,       //DC 다음
+    L3_CHOICE_COOPERATE     //DD 다음
+};
+
+
+static int chooseTft(void)
+{
+    return (peerLast == 0) ? L3_CHOICE_COOPERATE : peerLast;
+}
+
+static int chooseRandom(void)
+{
+    return (rand() & 1) ? L3_CHOICE_COOPERATE : L3_CHOICE_BETRAY;
+}
+
+static int chooseAlld(void)
+{
+    return L3_CHOICE_BETRAY;
+}
+
+static int chooseTable(void)
+{
+    if (myLast == 0 || peerLast == 0)
+        return strategyTable[0];
+
+    return strategyTable[1 + 2*(myLast != L3_CHOICE_COOPERATE) + (peerLast != L3_CHOICE_COOPERATE)];
+}
+
+// 상대가 두 번 연속 같은 선택을 했을 때만 예측에 참여하고, 같은 선택을 반복한다고 예측
+static int decideRepeat(void)
+{
+    return (peerLast != 0 && peerLast == peerLast2);
+}
+
+static int decideRandom(void)
+{
+    return (rand() % 4) == 0;
+}
+
+static int predictRepeat(void)
+{
+    return (peerLast == 0) ? L3_CHOICE_COOPERATE : peerLast;
+}
+
+static const L3_strategy_t strategies[L3_STRATEGY_NUM] =
+{
+    {"manual",      NULL,           NULL,           NULL},
+    {"tit-for-tat", chooseTft,      decideRepeat,   predictRepeat},
+    {"random",      chooseRandom,   decideRandom,   chooseRandom},
+    {"always-defect", chooseAlld,   decideRepeat,   predictRepeat},
+    {"table",       chooseTable,    decideRepeat,   predictRepeat}
+};
+
+static uint8_t selected = L3_STRATEGY_MANUAL;
+
+
+void L3_strategy_select(uint8_t id)
+{
+    if (id >= L3_STRATEGY_NUM)
+        id = L3_STRATEGY_MANUAL;
+
+    selected = id;
+    roundCnt = 0;
+    gameCnt = 0;
+    statTimer.reset();
+    statTimer.start();
+}
+
+uint8_t L3_strategy_getSelected(void)
+{
+    return selected;
+}
+
+const char* L3_strategy_getName(uint8_t id)
+{
+    if (id >= L3_STRATEGY_NUM)
+        return "unknown";
+
+    return strategies[id].name;
+}
+
+void L3_strategy_setTable(const uint8_t* table)
+{
+    memcpy(strategyTable, table, L3_STRATEGY_TABLESIZE);
+}
+
+void L3_strategy_getTable(uint8_t* table)
+{
+    memcpy(table, strategyTable, L3_STRATEGY_TABLESIZE);
+}
+
+void L3_strategy_newGame(void)
+{
+    myLast = 0;
+    peerLast = 0;
+    peerLast2 = 0;
+}
+
+void L3_strategy_endGame(void)
+{
+    gameCnt++;
+}
+
+void L3_strategy_recordRound(int myChoice, int peerChoice)
+{
+    myLast = myChoice;
+    peerLast2 = peerLast;
+    peerLast = peerChoice;
+    roundCnt++;
+}
+
+// 아래 함수들은 FSM에 넣을 입력 문자를 반환 (수동 모드에서는 0)
+char L3_strategy_choose(void)
+{
+    if (strategies[selected].choose == NULL)
+        return 0;
+
+    return (strategies[selected].choose() == L3_CHOICE_COOPERATE) ? '1' : '2';
+}
+
+char L3_strategy_decidePrediction(void)
+{
+    if (strategies[selected].decidePrediction == NULL)
+        return 0;
+
+    return strategies[selected].decidePrediction() ? 'Y' : 'N';
+}
+
+char L3_strategy_predict(void)
+{
+    if (strategies[selected].predict == NULL)
+        return 0;
+
+    return (strategies[selected].predict() == L3_CHOICE_COOPERATE) ? '1' : '2';
+}
+
+void L3_strategy_getStats(uint32_t* rounds, uint32_t* games, uint32_t* elapsedMs)
+{
+    *rounds = roundCnt;
+    *games = gameCnt;
+    *elapsedMs = statTimer.read_ms();
+}
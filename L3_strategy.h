@@ -0,0 +1,23 @@
+#include <stdint.h>
+
+#define L3_STRATEGY_MANUAL          0   //키보드 입력 (사람이 직접 플레이)
+#define L3_STRATEGY_TFT             1   //tit-for-tat
+#define L3_STRATEGY_RANDOM          2   //무작위
+#define L3_STRATEGY_ALLD            3   //항상 배신
+#define L3_STRATEGY_TABLE           4   //직전 라운드 결과 기반 표 (memory-one)
+#define L3_STRATEGY_NUM             5
+
+#define L3_STRATEGY_TABLESIZE       5   //첫 수, CC, CD, DC, DD 다음 수
+
+void L3_strategy_select(uint8_t id);
+uint8_t L3_strategy_getSelected(void);
+const char* L3_strategy_getName(uint8_t id);
+void L3_strategy_setTable(const uint8_t* table);
+void L3_strategy_getTable(uint8_t* table);
+void L3_strategy_newGame(void);
+void L3_strategy_endGame(void);
+void L3_strategy_recordRound(int myChoice, int peerChoice);
+char L3_strategy_choose(void);
+char L3_strategy_decidePrediction(void);
+char L3_strategy_predict(void);
+void L3_strategy_getStats(uint32_t* rounds, uint32_t* games, uint32_t* elapsedMs);
@@ -1,6 +1,7 @@
 #include "mbed.h"
 #include "L3_FSMevent.h"
 #include "protocol_parameters.h"
+#include "MEMstat.h"
 
 
 //ARQ retransmission timer
@@ -11,6 +12,7 @@ static uint8_t timerStatus = 0;
 //timer event : ARQ timeout
 void L3_timer_timeoutHandler(void) 
 {
+    MEMstat_sampleIsrStack();
     timerStatus = 0;
     //L3_event_setEventFlag(L3_event_arqTimeout);
 }
@@ -0,0 +1,163 @@
+#include "mbed.h"
+#include "malloc.h"
+#include "unistd.h"
+#include "MEMstat.h"
+#include "PDUbuf.h"
+#if MBED_MEM_TRACING_ENABLED
+#include "mbed_mem_trace.h"
+#endif
+
+//Runtime memory usage report
+//Without an RTOS the main loop and all interrupt handlers run on the single MSP stack, so one
+//painted area gives the combined high-water mark. The linker script reserves no stack section
+//(__StackLimit == __StackTop) : the stack grows down from __StackTop and the heap grows up from
+//__end__ to the SP (sbrk), so the free RAM between the heap break and the SP is painted at init,
+//and scanned from the break of the moment (the heap may have grown into the painted area since).
+//The handlers additionally sample the SP on entry, which tells how deep the main context
+//already was when the deepest interrupt hit.
+//Heap figures come from mbed_stats when the build enables MBED_HEAP_STATS_ENABLED,
+//otherwise from the newlib allocator (mallinfo).
+
+//linker script symbols
+extern "C" uint32_t __data_start__[];
+extern "C" uint32_t __bss_end__[];
+extern "C" uint32_t __StackTop[];
+
+static uint32_t* paintStart = NULL;         //heap break at init : bottom of the painted area
+static uint32_t* paintEnd = NULL;           //painting stopped here (the SP at init minus the margin)
+static uint32_t isrMinSp = 0xFFFFFFFFUL;    //lowest SP seen on interrupt handler entry
+static volatile uint8_t reportRequested = 0;
+
+static const char* staticName[MEMSTAT_MAXENTRIES];
+static uint32_t staticSize[MEMSTAT_MAXENTRIES];
+static uint8_t staticNum = 0;
+
+
+//current heap break, word aligned
+static uint32_t* MEMstat_getHeapBreak(void)
+{
+    return (uint32_t*)(((uintptr_t)sbrk(0) + 3) & ~(uintptr_t)3);
+}
+
+//fills the free RAM between the heap and the stack with the paint pattern (call first thing in main)
+void MEMstat_init(void)
+{
+    uint32_t* p = MEMstat_getHeapBreak();
+    uint32_t* end = (uint32_t*)(uintptr_t)(__get_MSP() - MEMSTAT_STACK_MARGIN);
+
+    paintStart = p;
+    while (p < end)
+        *p++ = MEMSTAT_PAINT_PATTERN;
+    paintEnd = p;
+
+#if MBED_MEM_TRACING_ENABLED
+    mbed_mem_trace_set_callback(mbed_mem_trace_default_callback);
+#endif
+
+    MEMstat_registerStatic("PDUbuf pool", PDUBUF_NUM * PDUBUF_SIZE);
+}
+
+//to be called at the beginning of interrupt handlers
+void MEMstat_sampleIsrStack(void)
+{
+    uint32_t sp = __get_MSP();
+
+    if (sp < isrMinSp)
+        isrMinSp = sp;
+}
+
+//modules register their large static buffers/objects here for the per-module breakdown
+void MEMstat_registerStatic(const char* name, uint32_t size)
+{
+    if (staticNum >= MEMSTAT_MAXENTRIES)
+        return;
+
+    staticName[staticNum] = name;
+    staticSize[staticNum] = size;
+    staticNum++;
+}
+
+//bottom of the painted area still free of heap
+static uint32_t* MEMstat_getScanStart(void)
+{
+    uint32_t* brk = MEMstat_getHeapBreak();
+
+    return (brk > paintStart) ? brk : paintStart;
+}
+
+//deepest stack usage so far in bytes (0 if the stack could not be painted)
+uint32_t MEMstat_getStackPeak(void)
+{
+    uint32_t* p;
+
+    if (paintEnd == NULL || paintEnd <= paintStart)
+        return 0;
+
+    p = MEMstat_getScanStart();
+
+    while (p < paintEnd && *p == MEMSTAT_PAINT_PATTERN)
+        p++;
+
+    return (uint32_t)((uint8_t*)__StackTop - (uint8_t*)p);
+}
+
+//may be called from interrupt context : the report itself is printed from the main loop
+void MEMstat_requestReport(void)
+{
+    reportRequested = 1;
+}
+
+void MEMstat_run(void)
+{
+    if (reportRequested)
+    {
+        reportRequested = 0;
+        MEMstat_printReport();
+    }
+}
+
+void MEMstat_printReport(void)
+{
+    uint32_t* scanStart = MEMstat_getScanStart();
+    uint32_t stackSize = (uint32_t)((uint8_t*)__StackTop - (uint8_t*)scanStart);
+    uint32_t staticRam = (uint32_t)((uint8_t*)__bss_end__ - (uint8_t*)__data_start__);
+    uint32_t stackPeak = MEMstat_getStackPeak();
+    uint32_t registered = 0;
+    uint8_t inUse, peak;
+    uint32_t allocFail, copies;
+    uint8_t i;
+
+    printf("\n[MEM] stack (main + ISR) : %lu / %lu bytes peak (free RAM above the heap)", (unsigned long)stackPeak,
+           (unsigned long)stackSize);
+    if (paintEnd != NULL && paintEnd > scanStart && *scanStart != MEMSTAT_PAINT_PATTERN)
+        printf(" (OVERFLOW : stack reached the heap)");
+    printf("\n");
+    if (isrMinSp != 0xFFFFFFFFUL)
+        printf("[MEM] deepest stack at ISR entry : %lu bytes\n", (unsigned long)((uintptr_t)__StackTop - isrMinSp));
+
+#if MBED_HEAP_STATS_ENABLED
+    {
+        mbed_stats_heap_t heap;
+        mbed_stats_heap_get(&heap);
+        printf("[MEM] heap : %lu bytes in %lu blocks, peak %lu, failed %lu\n", (unsigned long)heap.current_size,
+               (unsigned long)heap.alloc_cnt, (unsigned long)heap.max_size, (unsigned long)heap.alloc_fail_cnt);
+    }
+#else
+    {
+        struct mallinfo mi = mallinfo();
+        printf("[MEM] heap : %lu bytes in use, %lu bytes reserved from sbrk\n", (unsigned long)mi.uordblks, (unsigned long)mi.arena);
+    }
+#endif
+
+    printf("[MEM] static RAM (.data + .bss) : %lu bytes\n", (unsigned long)staticRam);
+    for (i = 0; i < staticNum; i++)
+    {
+        printf("[MEM]   %-16s %5lu\n", staticName[i], (unsigned long)staticSize[i]);
+        registered += staticSize[i];
+    }
+    if (staticRam >= registered)
+        printf("[MEM]   %-16s %5lu\n", "others", (unsigned long)(staticRam - registered));
+
+    PDUbuf_getStats(&inUse, &peak, &allocFail, &copies);
+    printf("[MEM] PDUbuf : %i/%i blocks in use, peak %i, alloc fail %lu\n", inUse, PDUBUF_NUM, peak, (unsigned long)allocFail);
+}
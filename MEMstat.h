@@ -0,0 +1,14 @@
+#include <stdint.h>
+
+#define MEMSTAT_PAINT_PATTERN   0xA5A5A5A5UL        //fill value of the unused stack area
+#define MEMSTAT_STACK_MARGIN    64                  //bytes below the SP at painting time left untouched
+#define MEMSTAT_MAXENTRIES      8                   //number of static RAM figures that can be registered
+#define MEMSTAT_REPORT_KEY      '?'                 //serial key requesting a memory report
+
+void MEMstat_init(void);
+void MEMstat_sampleIsrStack(void);
+void MEMstat_registerStatic(const char* name, uint32_t size);
+uint32_t MEMstat_getStackPeak(void);
+void MEMstat_requestReport(void);
+void MEMstat_run(void);
+void MEMstat_printReport(void);
@@ -0,0 +1,139 @@
+#include "mbed.h"
+#include "PDUbuf.h"
+
+//Shared PDU buffer pool for L2 and L3
+//Fixed-size blocks are handed between layers by handle and released by reference count.
+//Each block keeps PDUBUF_HEADROOM bytes in front of the data so that lower layers can
+//prepend their headers in place instead of copying the payload into their own buffers.
+//alloc/ref/free may be called from the PHY RX interrupt, so they run in a critical section.
+
+static uint8_t pool[PDUBUF_NUM][PDUBUF_SIZE];
+static uint8_t refCnt[PDUBUF_NUM];
+static uint8_t offset[PDUBUF_NUM];          //start of the data in the block
+static uint8_t length[PDUBUF_NUM];          //data length
+
+//statistics
+static uint8_t inUseCnt = 0;
+static uint8_t peakCnt = 0;
+static uint32_t allocFailCnt = 0;
+static uint32_t copyCnt = 0;                //payload copies done through PDUbuf_put()
+
+
+uint8_t PDUbuf_alloc(void)
+{
+    uint8_t i;
+    uint8_t buf = PDUBUF_INVALID;
+
+    core_util_critical_section_enter();
+    for (i = 0; i < PDUBUF_NUM; i++)
+    {
+        if (refCnt[i] == 0)
+        {
+            refCnt[i] = 1;
+            offset[i] = PDUBUF_HEADROOM;
+            length[i] = 0;
+            buf = i;
+
+            inUseCnt++;
+            if (inUseCnt > peakCnt)
+                peakCnt = inUseCnt;
+            break;
+        }
+    }
+    if (buf == PDUBUF_INVALID)
+        allocFailCnt++;
+    core_util_critical_section_exit();
+
+    return buf;
+}
+
+void PDUbuf_ref(uint8_t buf)
+{
+    if (buf >= PDUBUF_NUM)
+        return;
+
+    core_util_critical_section_enter();
+    refCnt[buf]++;
+    core_util_critical_section_exit();
+}
+
+void PDUbuf_free(uint8_t buf)
+{
+    if (buf >= PDUBUF_NUM)
+        return;
+
+    core_util_critical_section_enter();
+    if (refCnt[buf] > 0)
+    {
+        refCnt[buf]--;
+        if (refCnt[buf] == 0)
+            inUseCnt--;
+    }
+    core_util_critical_section_exit();
+}
+
+uint8_t* PDUbuf_getData(uint8_t buf)
+{
+    return &pool[buf][offset[buf]];
+}
+
+uint8_t PDUbuf_getLen(uint8_t buf)
+{
+    return length[buf];
+}
+
+void PDUbuf_setLen(uint8_t buf, uint8_t len)
+{
+    if (offset[buf] + len > PDUBUF_SIZE - 1)
+        len = PDUBUF_SIZE - 1 - offset[buf];
+
+    length[buf] = len;
+}
+
+//prepend len bytes in front of the data (header), returns the new data start
+uint8_t* PDUbuf_push(uint8_t buf, uint8_t len)
+{
+    if (len > offset[buf])
+    {
+        debug("[PDUbuf][WARNING] not enough headroom (%i < %i)\n", offset[buf], len);
+        return NULL;
+    }
+
+    offset[buf] -= len;
+    length[buf] += len;
+
+    return &pool[buf][offset[buf]];
+}
+
+//strip len bytes from the front of the data (header), returns the new data start
+uint8_t* PDUbuf_pull(uint8_t buf, uint8_t len)
+{
+    if (len > length[buf])
+        len = length[buf];
+
+    offset[buf] += len;
+    length[buf] -= len;
+
+    return &pool[buf][offset[buf]];
+}
+
+//append a copy of data at the end, one byte is always kept free for string termination
+int PDUbuf_put(uint8_t buf, const uint8_t* data, uint8_t len)
+{
+    if (offset[buf] + length[buf] + len > PDUBUF_SIZE - 1)
+        return 1;
+
+    memcpy(&pool[buf][offset[buf] + length[buf]], data, len);
+    length[buf] += len;
+    copyCnt++;
+
+    return 0;
+}
+
+void PDUbuf_getStats(uint8_t* inUse, uint8_t* peak, uint32_t* allocFail, uint32_t* copies)
+{
+    *inUse = inUseCnt;
+    *peak = peakCnt;
+    *allocFail = allocFailCnt;
+    *copies = copyCnt;
+}
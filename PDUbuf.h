@@ -0,0 +1,21 @@
+#include <stdint.h>
+#include "protocol_parameters.h"
+
+#define PDUBUF_NUM              8                   //number of blocks in the pool
+#define PDUBUF_HEADROOM         4                   //room for lower layer headers prepended in place
+#define PDUBUF_TAILROOM         4                   //room for trailers and L3 string termination
+#define PDUBUF_MAXDATA          L3_MAXDATASIZE      //largest SDU carried in one block
+#define PDUBUF_SIZE             (PDUBUF_HEADROOM + PDUBUF_MAXDATA + PDUBUF_TAILROOM)
+
+#define PDUBUF_INVALID          0xFF                //invalid buffer handle
+
+uint8_t PDUbuf_alloc(void);
+void PDUbuf_ref(uint8_t buf);
+void PDUbuf_free(uint8_t buf);
+uint8_t* PDUbuf_getData(uint8_t buf);
+uint8_t PDUbuf_getLen(uint8_t buf);
+void PDUbuf_setLen(uint8_t buf, uint8_t len);
+uint8_t* PDUbuf_push(uint8_t buf, uint8_t len);
+uint8_t* PDUbuf_pull(uint8_t buf, uint8_t len);
+int PDUbuf_put(uint8_t buf, const uint8_t* data, uint8_t len);
+void PDUbuf_getStats(uint8_t* inUse, uint8_t* peak, uint32_t* allocFail, uint32_t* copies);
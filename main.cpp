@@ -2,6 +2,9 @@
 #include "string.h"
 #include "L2_FSMmain.h"
 #include "L3_FSMmain.h"
+#include "MEMstat.h"
+#include "CMDshell.h"
+#include "CFGstore.h"
 
 //serial port interface
 Serial pc(USBTX, USBRX);
@@ -12,17 +15,65 @@ Serial pc(USBTX, USBRX);
 uint8_t input_thisId=1;
 uint8_t input_destId=0;
 
+//a key within CFGSTORE_OVERRIDE_MS asks for the IDs again instead of using the stored ones
+static bool waitOverride(const CFGstore_t* cfg)
+{
+    Timer t;
+
+    pc.printf(":: stored configuration : ID %i, dest %i (press a key within %i ms to change it)\n", cfg->thisId, cfg->destId, CFGSTORE_OVERRIDE_MS);
+    t.start();
+    while (t.read_ms() < CFGSTORE_OVERRIDE_MS)
+    {
+        if (pc.readable())
+        {
+            pc.getc();
+            return true;
+        }
+    }
+    return false;
+}
+
 //FSM operation implementation ------------------------------------------------
 int main(void){
 
+    CFGstore_t cfg;
+    bool stored;
+    Timer bootTimer;
+    int waitMs = 0;
+    int id;
+
+    //stack painting for the memory report (before the stack grows)
+    MEMstat_init();
+    bootTimer.start();
+
     //initialization
     pc.printf("------------------ protocol stack starts! --------------------------\n");
+    //node configuration from flash : no typing needed after a reset
+    stored = (CFGstore_init() && CFGstore_load(&cfg));
+    if (stored && CFGSTORE_OVERRIDE_MS > 0)
+    {
+        stored = !waitOverride(&cfg);
+        waitMs = bootTimer.read_ms();
+    }
+    if (stored)
+    {
+        input_thisId = cfg.thisId;
+        input_destId = cfg.destId;
+    }
+    else
+    {
+        int t0 = bootTimer.read_ms();
+
         //source & destination ID setting
-    pc.printf(":: ID for this node : ");
-    pc.scanf("%d", &input_thisId);
-    pc.printf(":: ID for the destination : ");
-    pc.scanf("%d", &input_destId);
-    pc.getc();
+        pc.printf(":: ID for this node : ");
+        pc.scanf("%d", &id);
+        input_thisId = (uint8_t)id;
+        pc.printf(":: ID for the destination : ");
+        pc.scanf("%d", &id);
+        input_destId = (uint8_t)id;
+        pc.getc();
+        waitMs += bootTimer.read_ms() - t0;
+    }
 
     pc.printf("endnode : %i, dest : %i\n", input_thisId, input_destId);
     
@@ -30,12 +81,27 @@ int main(void){
 
     //initialize lower layer stacks
     L2_initFSM(input_thisId);
-    L3_initFSM(input_destId);
+    L3_initFSM(input_thisId, input_destId);
+    if (stored)
+        CFGstore_apply(&cfg); //tuned parameters of the record over the compiled ones
+    else
+    {
+        //new IDs : stored with the compiled parameters for the next boot
+        CFGstore_capture(&cfg);
+        cfg.thisId = input_thisId;
+        cfg.destId = input_destId;
+        if (CFGstore_save(&cfg) == 0)
+            pc.printf("[CFG] configuration could not be stored\n");
+    }
+    pc.printf("[CFG] ready in %i ms (%i ms of it waiting for the console), configuration %s (record %u)\n",
+              bootTimer.read_ms(), waitMs, stored ? "from flash" : "entered", CFGstore_getSaveCount());
     
     while(1)
 {
     L3_FSMrun();
     L2_FSMrun();
+    CMDshell_run();     //shell commands take effect here, between two FSM passes
+    MEMstat_run();
     
 }
 
@@ -1,9 +1,64 @@
-#define DBGMSG_L2                       0 //debug print control
-#define DBGMSG_L3                       0 //debug print control
+//the parameters marked (shell) are initial values, the serial control shell changes them at runtime (see CMDshell.h)
+#define DBGMSG_L2_INIT                  0 //debug print control (shell)
+#define DBGMSG_L3_INIT                  0 //debug print control (shell)
+#define DBGMSG_L2                       dbgmsgL2
+#define DBGMSG_L3                       dbgmsgL3
+extern int dbgmsgL2;
+extern int dbgmsgL3;
+#define EVSTREAM_INIT                   0 //1 : binary game/link event frames on the console next to the text (shell, EVstream.h, tools/evreader.cpp)
 
-#define L3_MAXDATASIZE                  1024
+#define L3_MAXDATASIZE                  240 //size of the SDU buffers, the shell can only lower the message length below it
 
 
-#define L2_ARQ_MAXRETRANSMISSION        10
-#define L2_ARQ_MAXWAITTIME              5
-#define L2_ARQ_MINWAITTIME              2
\ No newline at end of file
+#define L2_ARQ_MAXRETRANSMISSION        10 //(shell)
+#define L2_ARQ_MAXWAITTIME              5 //s (shell)
+#define L2_ARQ_MINWAITTIME              2 //s (shell)
+#define L2_LLI_PKT_LOSS                 0 //% of the received frames dropped on purpose (loss emulation) (shell)
+#ifndef L2_SEQ_BITS         //tools/seqsim.cpp sets it on the command line
+#define L2_SEQ_BITS                     8 //width of the unicast sequence numbers, 2..8 (see L2_seq.h)
+#endif
+
+#define L2_FCS_MODE                     0 //0 : no L2 FCS, 1 : CRC-16 (MbedCRC), 2 : CRC-32 (STM32 CRC unit) (see L2_crc.h)
+#define L2_FCS_BENCHMARK                0 //1 : print the throughput of each CRC backend at startup
+#ifndef L2_FEC_GROUPSIZE    //tools/fecsim.cpp sets it on the command line
+#define L2_FEC_GROUPSIZE                0 //0 : no FEC, otherwise data fragments per XOR parity fragment (code rate G/(G+1), see L2_fec.h)
+#endif
+#ifndef L2_LINKADAPT        //tools/ratesim.cpp sets it on the command line
+#define L2_LINKADAPT                    0 //1 : SNR-driven PHY rate selection, advised to the peer in the ACKs (see L2_rate.h)
+#endif
+#ifndef L2_RATE_NUMRATES
+#define L2_RATE_NUMRATES                4 //rates of L2_rate.cpp in use : 4 = SF7 with CR 4/5..4/8, more also change the SF (host model only)
+#endif
+#define L2_RATE_HYSTERESIS              1 //dB of SNR to spare before moving to a faster rate
+#define L2_CSMA_ENABLE                  0 //1 : listen before talk with random backoff before each frame (see L2_csma.h)
+#define L2_CSMA_RSSI_THRESHOLD          -90 //dBm : the channel is busy above this RSSI
+#define L2_DUTYCYCLE_PERMILLE           0 //TX airtime budget in 1/1000 of the window (10 = 1 %), 0 : no limit (see L2_airtime.h)
+#define L2_DUTYCYCLE_WINDOW             3600 //s, sliding window of the budget
+#define L2_DUTYCYCLE_ACKRESERVE         10 //% of the budget that only ACKs may use
+#define L2_RBC_ENABLE                   0 //1 : reliable broadcast, lost broadcast frames are NACKed and repaired (see L2_rbc.h)
+#define L2_LINK_DETECTTIME              0 //s without hearing a peer before its link is reported down to L3 (10 or more on lossy links), 0 : no liveness probing (see L2_link.h)
+#define L2_AGG_ENABLE                   0 //1 : small SDUs queued for the same peer go out packed in one frame (see L2_agg.h)
+#define L2_AGG_DELAYMS                  50 //ms a lone SDU may wait for others to the same peer, 0 : only the SDUs already queued are packed
+
+#define L3_PAYOFF_RULESET               0 //0 : classic rules, 1 : README table rules (see L3_payoff.h)
+#ifndef L3_AUTOPLAY_STRATEGY //tools/netsim sets it on the command line
+#define L3_AUTOPLAY_STRATEGY            0 //0 : keyboard input, otherwise automated player (see L3_strategy.h)
+#endif
+#define L3_LINK_ABORTTIME               60 //s the game waits for a lost link to come back before it is aborted
+#ifndef L3_SNAPSHOT_FLASH   //tools/netsim sets it on the command line
+#define L3_SNAPSHOT_FLASH               0 //1 : the round snapshots also go to flash at each round (a power cycle resumes too), 0 : backup SRAM only (warm reset) (see L3_snapshot.h)
+#endif
+#define L3_RESYNC_RETRYTIME             3 //s between two resync requests of a restarted node
+#define L3_RESYNC_TIMEOUT               30 //s a restarted node waits for the peer to resync before it starts a new game
+#ifndef L3_HISTORY_FLASH    //tools/netsim sets it on the command line
+#define L3_HISTORY_FLASH                1 //1 : the round history spills to flash, the sector before the configuration (see L3_history.h), 0 : RAM ring only
+#endif
+#define L3_GROUP_PLAYERS                4 //players of a broadcast game (destination ID 255, see L3_group.h) : it starts once this many are ready
+#define L3_GROUP_JOINTIME               30 //s after my READY : the game starts with the players ready by then (2 or more)
+#define L3_GROUP_READYTIME              3 //s between the READY (or unanswered CHOICE) broadcasts of a player waiting for the others
+#define L3_GROUP_DEADLINE               10 //s a round waits for the choices of the other players (the missing ones are left out)
+#ifndef L3_SPEC_ENABLE      //tools/netsim sets it on the command line
+#define L3_SPEC_ENABLE                  0 //1 : each round result is broadcast once for spectator nodes (destination ID 0, see L3_spectator.h)
+#endif
+#define L3_SPEC_SNAPTIME                2 //s between two catch-up snapshots of a player (one snapshot answers every spectator that asked)
+#define L3_SPEC_REQTIME                 5 //s between two catch-up requests of a spectator for the same player
@@ -0,0 +1,355 @@
+// Host-side model of the L2 frame aggregation (L2_agg.cpp, L2_AGG_DELAYMS) under bursty game traffic
+//
+// One node sends game messages to another with the stop-and-wait ARQ of the FSM (timer drawn in
+// L2_ARQ_MINWAITTIME..L2_ARQ_MAXWAITTIME, L2_ARQ_MAXRETRANSMISSION retransmissions) over the
+// neighbour table of the FSM (L2_peer.cpp : queue of L2_PEER_QUEUESIZE SDUs, holds). Messages come
+// in bursts (a move, its chat line and the score update), bursts after an exponential think time,
+// the SDUs of a burst a few ms apart. Each frame is lost independently with the given probability
+// and takes the LoRa time on air of the fastest rate (L2_rate_getToaUs).
+//  - off   : one SDU per frame, as without aggregation
+//  - N ms  : the SDUs queued for the peer are packed in one AGG frame when it is its turn
+//            (L2_agg_fits / L2_agg_put), a lone SDU waits up to N ms for others (0 : no wait)
+// The receiver splits each frame with L2_agg_next and delivers the sub-frames one by one, which
+// must give back every SDU once, in order. For each loss rate : frames per second (data + ACK),
+// time on air per second and per delivered SDU with what is saved against off, SDUs per frame,
+// latency (queued -> ACKed) mean / p99, SDUs rejected (queue full) and given up.
+//
+// build : g++ -O2 -std=gnu++98 -I.. -o aggsim aggsim.cpp ../L2_agg.cpp ../L2_peer.cpp ../L2_rate.cpp ../L2_airtime.cpp
+// usage : ./aggsim [-t simulated s per point] [-m mean think time ms] [-b max SDUs per burst] [-g max gap in a burst ms] [-s seed]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+#include "L2_agg.h"
+#include "L2_peer.h"
+#include "L2_rate.h"
+
+#define SIM_PEERID              2
+#define SIM_PHYHDR              4       //header phymac puts in front of the L2 frame
+#define SIM_HDRSIZE             2       //L2_MSG_OFFSET_DATA
+#define SIM_MAXDATASIZE         26      //L2_MSG_MAXDATASIZE
+#define SIM_FCSLEN              2       //CRC-16 (L2_FCS_MODE 1)
+#define SIM_ACKSIZE             3
+#define SIM_TURNAROUND_MS       5       //frame end -> ACK start at the receiver
+#define SIM_MAXLEN              (SIM_MAXDATASIZE - SIM_FCSLEN)
+#define SIM_NUMSDU              255     //SDU handles (uint8_t in the peer queue, L2_PEER_NOSDU excluded)
+#define SIM_OFF                 -1
+
+typedef struct
+{
+    uint8_t len;
+    uint8_t data[SIM_MAXLEN];
+    uint32_t index;         //order of the SDU (not on air, for the check)
+    uint32_t queuedMs;
+} simSdu_t;
+
+typedef struct
+{
+    uint64_t frames;
+    double airUs;
+    uint32_t sdus;          //offered
+    uint32_t dataFrames;    //new data frames (retransmissions not counted)
+    uint32_t acked;
+    uint32_t rejected;
+    uint32_t failed;
+    uint32_t misdelivered;
+    std::vector<uint32_t> latency;
+} simResult_t;
+
+static double lossP;
+static double thinkMs = 3000;
+static uint32_t maxBurst = 3;
+static uint32_t maxGapMs = 40;
+
+static simSdu_t sdus[SIM_NUMSDU];
+static uint8_t nextHandle;
+
+static uint64_t rngState = 88172645463325252ULL;
+static double rnd(void)
+{
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return (double)((rngState * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+static uint32_t arqWait(void)
+{
+    return L2_ARQ_MINWAITTIME * 1000 + (uint32_t)(rnd() * (L2_ARQ_MAXWAITTIME - L2_ARQ_MINWAITTIME) * 1000);
+}
+
+static uint32_t frameMs(uint8_t l2Size)
+{
+    return (L2_rate_getToaUs(0, l2Size + SIM_FCSLEN + SIM_PHYHDR) + 999) / 1000;
+}
+
+//game message : a move or a score line of a few bytes, now and then a longer chat line
+static uint8_t sduLen(void)
+{
+    return (rnd() < 0.2) ? (uint8_t)(8 + rnd() * 13) : (uint8_t)(2 + rnd() * 5);
+}
+
+//L2_holdForAgg of the FSM
+static void holdForAgg(L2_peer_t* peer, int delayMs, uint32_t now)
+{
+    uint8_t aggLen = 0;
+    uint8_t i;
+
+    if (delayMs <= 0 || peer->txSdu != L2_PEER_NOSDU)
+        return;
+
+    for (i = 0; i < peer->qLen; i++)
+    {
+        uint8_t len = sdus[peer->queue[(peer->qHead + i) % L2_PEER_QUEUESIZE]].len;
+
+        if (L2_agg_fits(aggLen, len, SIM_MAXLEN) == 0)
+        {
+            L2_peer_release(peer);
+            return;
+        }
+        aggLen += L2_AGG_SUBHDR + len;
+    }
+    if (peer->qLen >= L2_PEER_QUEUESIZE || L2_agg_fits(aggLen, 1, SIM_MAXLEN) == 0)
+        L2_peer_release(peer);
+    else
+        L2_peer_hold(peer, now + delayMs);
+}
+
+static void run(simResult_t* res, uint32_t simMs, int delayMs)
+{
+    L2_peerTable_t tbl;
+    L2_peer_t* peer;
+    std::vector<uint8_t> inFlight;      //SDUs of the PDU in flight
+    uint8_t payload[SIM_MAXLEN];
+    uint8_t payloadLen = 0;
+    uint8_t isAgg = 0;
+    uint32_t nextBurst, nextSdu = 0, burstLeft = 0;
+    uint32_t txEnd = 0, ackAt = 0, deadline = 0;
+    uint32_t sduIndex = 0, rxIndex = 0;
+    uint8_t waiting = 0, ackOnAir = 0, retxCnt = 0;
+    uint32_t now;
+    unsigned i;
+
+    res->frames = 0;
+    res->airUs = 0;
+    res->sdus = res->dataFrames = res->acked = res->rejected = res->failed = res->misdelivered = 0;
+    res->latency.clear();
+    L2_peer_init(&tbl);
+    peer = L2_peer_add(&tbl, SIM_PEERID, 0);
+    nextHandle = 0;
+    nextBurst = 1 + (uint32_t)(-thinkMs * log(1.0 - rnd()));
+
+    for (now = 0; now < simMs; now++)
+    {
+        //game traffic : bursts of 1..maxBurst SDUs
+        if (burstLeft == 0 && now >= nextBurst)
+        {
+            burstLeft = 1 + (uint32_t)(rnd() * maxBurst);
+            nextSdu = now;
+            nextBurst = now + 1 + (uint32_t)(-thinkMs * log(1.0 - rnd()));
+        }
+        if (burstLeft > 0 && now >= nextSdu)
+        {
+            simSdu_t* s = &sdus[nextHandle];
+
+            s->len = sduLen();
+            for (i = 0; i < s->len; i++)
+                s->data[i] = (uint8_t)(sduIndex + i);
+            s->index = sduIndex;
+            s->queuedMs = now;
+            res->sdus++;
+            if (L2_peer_enqueue(&tbl, peer, nextHandle) != 0)
+                res->rejected++;
+            else
+            {
+                sduIndex++;
+                nextHandle = (uint8_t)((nextHandle + 1) % SIM_NUMSDU);
+                if (delayMs != SIM_OFF)
+                    holdForAgg(peer, delayMs, now);
+            }
+            burstLeft--;
+            nextSdu = now + (uint32_t)(rnd() * (maxGapMs + 1));
+        }
+
+        //end of the data frame : the receiver splits it and ACKs it
+        if (waiting && ackOnAir == 0 && now == txEnd)
+        {
+            if (rnd() >= lossP)
+            {
+                uint8_t pos = 0, subLen;
+                int off;
+
+                //a PDU received again (lost ACK) is only ACKed, one after given up ones is taken as is
+                if (sdus[inFlight[0]].index >= rxIndex)
+                {
+                    rxIndex = sdus[inFlight[0]].index;
+                    if (isAgg == 0)
+                        rxIndex++;
+                    else if (L2_agg_count(payload, payloadLen) != inFlight.size())
+                        res->misdelivered += (uint32_t)inFlight.size();
+                    else
+                    {
+                        for (i = 0; (off = L2_agg_next(payload, payloadLen, &pos, &subLen)) >= 0; i++)
+                        {
+                            simSdu_t* s = &sdus[inFlight[i]];
+
+                            if (s->index != rxIndex || subLen != s->len || memcmp(payload + off, s->data, subLen) != 0)
+                                res->misdelivered++;
+                            rxIndex++;
+                        }
+                    }
+                }
+                ackOnAir = 1;
+                ackAt = now + SIM_TURNAROUND_MS + frameMs(SIM_ACKSIZE);
+                res->frames++;
+                res->airUs += L2_rate_getToaUs(0, SIM_ACKSIZE + SIM_FCSLEN + SIM_PHYHDR);
+            }
+        }
+        if (ackOnAir && now == ackAt)
+        {
+            ackOnAir = 0;
+            if (rnd() >= lossP)
+            {
+                for (i = 0; i < inFlight.size(); i++)
+                    res->latency.push_back(now - sdus[inFlight[i]].queuedMs);
+                res->acked += (uint32_t)inFlight.size();
+                inFlight.clear();
+                peer->txSdu = L2_PEER_NOSDU;
+                waiting = 0;
+            }
+        }
+
+        //ARQ timer : the same frame again, or its SDUs are given up
+        if (waiting && ackOnAir == 0 && now > txEnd && now >= deadline)
+        {
+            if (retxCnt >= L2_ARQ_MAXRETRANSMISSION)
+            {
+                res->failed += (uint32_t)inFlight.size();
+                inFlight.clear();
+                peer->txSdu = L2_PEER_NOSDU;
+                waiting = 0;
+            }
+            else
+            {
+                retxCnt++;
+                res->frames++;
+                res->airUs += L2_rate_getToaUs(0, SIM_HDRSIZE + payloadLen + SIM_FCSLEN + SIM_PHYHDR);
+                txEnd = now + frameMs(SIM_HDRSIZE + payloadLen);
+                deadline = txEnd + arqWait();
+            }
+        }
+
+        //new PDU : L2_peer_next, then L2_packTxSdu of the FSM
+        if (waiting == 0 && L2_peer_next(&tbl, now) == peer)
+        {
+            uint8_t sdu = L2_peer_dequeue(peer);
+
+            peer->txSdu = sdu;
+            inFlight.push_back(sdu);
+            payloadLen = sdus[sdu].len;
+            memcpy(payload, sdus[sdu].data, payloadLen);
+            isAgg = 0;
+            if (delayMs != SIM_OFF && peer->qLen > 0 &&
+                L2_agg_fits(L2_AGG_SUBHDR + payloadLen, sdus[peer->queue[peer->qHead]].len, SIM_MAXLEN))
+            {
+                payloadLen = L2_agg_put(payload, 0, sdus[sdu].data, sdus[sdu].len);
+                while (peer->qLen > 0 && L2_agg_fits(payloadLen, sdus[peer->queue[peer->qHead]].len, SIM_MAXLEN))
+                {
+                    sdu = L2_peer_dequeue(peer);
+                    payloadLen = L2_agg_put(payload, payloadLen, sdus[sdu].data, sdus[sdu].len);
+                    inFlight.push_back(sdu);
+                }
+                isAgg = 1;
+            }
+            waiting = 1;
+            retxCnt = 0;
+            res->frames++;
+            res->dataFrames++;
+            res->airUs += L2_rate_getToaUs(0, SIM_HDRSIZE + payloadLen + SIM_FCSLEN + SIM_PHYHDR);
+            txEnd = now + frameMs(SIM_HDRSIZE + payloadLen);
+            deadline = txEnd + arqWait();
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    static const int delays[] = {SIM_OFF, 0, 20, 50, 100};
+    static const double losses[] = {0.0, 0.1, 0.3};
+    uint32_t simSec = 3600;
+    unsigned li, di, i;
+    int opt;
+    int failed = 0;
+
+    while ((opt = getopt(argc, argv, "t:m:b:g:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 't': simSec = (uint32_t)atol(optarg); break;
+            case 'm': thinkMs = atof(optarg); break;
+            case 'b': maxBurst = (uint32_t)atoi(optarg); break;
+            case 'g': maxGapMs = (uint32_t)atoi(optarg); break;
+            case 's': rngState = strtoull(optarg, NULL, 0) | 1; break;
+            default:
+                fprintf(stderr, "usage : %s [-t simulated s per point] [-m mean think time ms] [-b max SDUs per burst] [-g max gap in a burst ms] [-s seed]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (simSec == 0 || thinkMs <= 0 || maxBurst == 0)
+    {
+        fprintf(stderr, "simulated time, think time and burst size must be > 0\n");
+        return 1;
+    }
+
+    printf("%lu s per point, bursts of 1..%lu SDUs every %.0f ms on average, %lu ms apart at most, frames of %i bytes at most\n",
+           (unsigned long)simSec, (unsigned long)maxBurst, thinkMs, (unsigned long)maxGapMs, SIM_MAXDATASIZE);
+    printf("loss | aggregation | frames/s | airtime ms/s | ms/SDU | saved | SDUs/frame | latency mean    p99 | rejected | given up\n");
+
+    for (li = 0; li < sizeof(losses) / sizeof(losses[0]); li++)
+    {
+        double offPerSdu = 0;
+
+        lossP = losses[li];
+        for (di = 0; di < sizeof(delays) / sizeof(delays[0]); di++)
+        {
+            simResult_t r;
+            double sum = 0, perSdu;
+            char mode[16];
+
+            run(&r, simSec * 1000, delays[di]);
+            for (i = 0; i < r.latency.size(); i++)
+                sum += r.latency[i];
+            std::sort(r.latency.begin(), r.latency.end());
+            perSdu = r.acked ? r.airUs / 1000.0 / r.acked : 0.0;
+            if (delays[di] == SIM_OFF)
+            {
+                offPerSdu = perSdu;
+                snprintf(mode, sizeof(mode), "off");
+            }
+            else
+                snprintf(mode, sizeof(mode), "%i ms", delays[di]);
+            printf("%3.0f%% | %-11s | %8.3f | %12.1f | %6.1f | %4.0f%% | %10.2f | %9.2fs %6.2fs | %8lu | %8lu\n",
+                   100.0 * lossP, mode, r.frames / (double)simSec, r.airUs / 1000.0 / simSec, perSdu,
+                   offPerSdu > 0 ? 100.0 * (1.0 - perSdu / offPerSdu) : 0.0,
+                   r.dataFrames ? (double)(r.acked + r.failed) / r.dataFrames : 0.0,
+                   r.latency.empty() ? 0.0 : sum / r.latency.size() / 1000.0,
+                   r.latency.empty() ? 0.0 : r.latency[(size_t)(r.latency.size() * 0.99)] / 1000.0,
+                   (unsigned long)r.rejected, (unsigned long)r.failed);
+            if (r.misdelivered > 0)
+            {
+                printf("     %lu SDUs misdelivered\n", (unsigned long)r.misdelivered);
+                failed = 1;
+            }
+        }
+    }
+    if (failed)
+        printf("FAILED\n");
+
+    return failed;
+}
@@ -0,0 +1,222 @@
+// Host-side throughput benchmark of the L2 FCS backends
+//
+// Computes the two frame check sequences of L2_crc.cpp with every software backend
+// and reports bytes/cycle (TSC cycles on x86, otherwise bytes/ns) :
+//  - CRC-32/MPEG-2 (the STM32 CRC unit polynomial) : bitwise, byte table, slicing-by-8
+//  - CRC-16/CCITT-FALSE (MbedCRC<POLY_16BIT_CCITT, 16>) : bitwise, byte table
+// All backends are checked against the standard check values before measuring.
+// The target backends (STM32 CRC unit, MbedCRC) are measured on the board with
+// L2_FCS_BENCHMARK in protocol_parameters.h.
+//
+// build : g++ -O2 -o crcbench crcbench.cpp
+// usage : ./crcbench [-n bytes per call] [-r total MB]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAS_TSC   1
+#else
+#define BENCH_HAS_TSC   0
+#endif
+
+#define POLY32          0x04C11DB7UL
+#define INIT32          0xFFFFFFFFUL
+#define POLY16          0x1021
+#define INIT16          0xFFFF
+
+static uint32_t table32[8][256];
+static uint16_t table16[256];
+
+
+//table generation ----------------------------------------------------------------
+static void initTables(void)
+{
+    uint32_t i, k, c;
+
+    for (i = 0; i < 256; i++)
+    {
+        c = i << 24;
+        for (k = 0; k < 8; k++)
+            c = (c & 0x80000000UL) ? (c << 1) ^ POLY32 : (c << 1);
+        table32[0][i] = c;
+
+        c = i << 8;
+        for (k = 0; k < 8; k++)
+            c = (c & 0x8000) ? (c << 1) ^ POLY16 : (c << 1);
+        table16[i] = (uint16_t)c;
+    }
+
+    //table32[k][i] : CRC of byte i followed by k zero bytes
+    for (k = 1; k < 8; k++)
+        for (i = 0; i < 256; i++)
+            table32[k][i] = (table32[k-1][i] << 8) ^ table32[0][table32[k-1][i] >> 24];
+}
+
+//CRC-32/MPEG-2 backends ------------------------------------------------------------
+static uint32_t crc32Bitwise(const uint8_t* p, size_t n)
+{
+    uint32_t crc = INIT32;
+    int b;
+
+    while (n--)
+    {
+        crc ^= (uint32_t)*p++ << 24;
+        for (b = 0; b < 8; b++)
+            crc = (crc & 0x80000000UL) ? (crc << 1) ^ POLY32 : (crc << 1);
+    }
+    return crc;
+}
+
+static uint32_t crc32Table(const uint8_t* p, size_t n)
+{
+    uint32_t crc = INIT32;
+
+    while (n--)
+        crc = (crc << 8) ^ table32[0][(crc >> 24) ^ *p++];
+    return crc;
+}
+
+static uint32_t crc32Slice8(const uint8_t* p, size_t n)
+{
+    uint32_t crc = INIT32;
+    uint32_t a;
+
+    while (n >= 8)
+    {
+        a = crc ^ (((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3]);
+        crc = table32[7][a >> 24] ^ table32[6][(a >> 16) & 0xFF] ^ table32[5][(a >> 8) & 0xFF] ^ table32[4][a & 0xFF]
+            ^ table32[3][p[4]] ^ table32[2][p[5]] ^ table32[1][p[6]] ^ table32[0][p[7]];
+        p += 8;
+        n -= 8;
+    }
+    while (n--)
+        crc = (crc << 8) ^ table32[0][(crc >> 24) ^ *p++];
+    return crc;
+}
+
+//CRC-16/CCITT-FALSE backends -------------------------------------------------------
+static uint32_t crc16Bitwise(const uint8_t* p, size_t n)
+{
+    uint32_t crc = INIT16;
+    int b;
+
+    while (n--)
+    {
+        crc ^= (uint32_t)*p++ << 8;
+        for (b = 0; b < 8; b++)
+            crc = (crc & 0x8000) ? ((crc << 1) ^ POLY16) & 0xFFFF : (crc << 1) & 0xFFFF;
+    }
+    return crc;
+}
+
+static uint32_t crc16Table(const uint8_t* p, size_t n)
+{
+    uint32_t crc = INIT16;
+
+    while (n--)
+        crc = ((crc << 8) ^ table16[(crc >> 8) ^ *p++]) & 0xFFFF;
+    return crc;
+}
+
+
+typedef uint32_t (*crcFunc)(const uint8_t*, size_t);
+
+typedef struct
+{
+    const char* name;
+    crcFunc func;
+    uint32_t check;     //CRC of "123456789"
+} backend_t;
+
+static const backend_t backends[] =
+{
+    {"CRC-32 bitwise",          crc32Bitwise,   0x0376E6E7UL},
+    {"CRC-32 byte table",       crc32Table,     0x0376E6E7UL},
+    {"CRC-32 slicing-by-8",     crc32Slice8,    0x0376E6E7UL},
+    {"CRC-16 bitwise",          crc16Bitwise,   0x29B1},
+    {"CRC-16 byte table",       crc16Table,     0x29B1},
+};
+#define NUM_BACKENDS    (sizeof(backends) / sizeof(backends[0]))
+
+
+static uint64_t nowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int main(int argc, char** argv)
+{
+    size_t callSize = 240;          //one L3 SDU
+    size_t totalMb = 64;
+    volatile uint32_t sink = 0;
+    uint8_t* buf;
+    size_t i, calls;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:")) != -1)
+    {
+        if (opt == 'n')
+            callSize = (size_t)atoi(optarg);
+        else if (opt == 'r')
+            totalMb = (size_t)atoi(optarg);
+        else
+        {
+            fprintf(stderr, "usage : %s [-n bytes per call] [-r total MB]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (callSize == 0)
+        callSize = 1;
+
+    initTables();
+
+    for (i = 0; i < NUM_BACKENDS; i++)
+    {
+        uint32_t crc = backends[i].func((const uint8_t*)"123456789", 9);
+        if (crc != backends[i].check)
+        {
+            fprintf(stderr, "%s : check value 0x%08X != 0x%08X\n", backends[i].name, crc, backends[i].check);
+            return 1;
+        }
+    }
+
+    buf = (uint8_t*)malloc(callSize);
+    for (i = 0; i < callSize; i++)
+        buf[i] = (uint8_t)(i * 7 + 1);
+    calls = totalMb * 1024 * 1024 / callSize + 1;
+
+    printf("%zu bytes per call, %zu calls per backend\n", callSize, calls);
+    for (i = 0; i < NUM_BACKENDS; i++)
+    {
+        uint64_t t0, t1, c0 = 0, c1 = 0;
+        double bytes = (double)callSize * calls;
+        size_t k;
+
+        t0 = nowNs();
+#if BENCH_HAS_TSC
+        c0 = __rdtsc();
+#endif
+        for (k = 0; k < calls; k++)
+            sink += backends[i].func(buf, callSize);
+#if BENCH_HAS_TSC
+        c1 = __rdtsc();
+#endif
+        t1 = nowNs();
+
+        if (BENCH_HAS_TSC)
+            printf("%-22s : %7.3f bytes/cycle  %8.1f MB/s\n", backends[i].name, bytes / (double)(c1 - c0), bytes / ((t1 - t0) / 1e3));
+        else
+            printf("%-22s : %7.3f bytes/ns     %8.1f MB/s\n", backends[i].name, bytes / (double)(t1 - t0), bytes / ((t1 - t0) / 1e3));
+    }
+
+    free(buf);
+    return 0;
+}
@@ -0,0 +1,264 @@
+// Host-side model of the L2 channel access (L2_csma.cpp) with several contending nodes
+//
+// Every node runs its own L2_csmaCtx_t as the firmware does : a frame waits its random backoff,
+// senses the channel for SIM_SENSE_US (only a transmission that started before the sensing is
+// heard) and is sent, backed off again or given up. Frames last the LoRa time on air of rate 0
+// (L2_rate_getToaUs) and two frames that overlap in time are both lost (no capture effect).
+// ALOHA (send as soon as the frame is ready, the behaviour without L2_CSMA_ENABLE) is run on the
+// same traffic for comparison.
+//  - burst mode : every node gets a frame at the same time (e.g. the ACKs of a broadcast round)
+//  - load mode : each node sends a new frame after an exponential idle time, the mean idle time
+//    being set so that the offered airtime of all the nodes is the given fraction of the channel
+//
+// build : g++ -O2 -std=gnu++98 -I.. -o csmasim csmasim.cpp ../L2_csma.cpp ../L2_rate.cpp ../L2_airtime.cpp
+// usage : ./csmasim [-b | -l offered load] [-n max nodes] [-f frames per node] [-p payload bytes] [-s seed]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "L2_csma.h"
+#include "L2_rate.h"
+
+#define SIM_MAXNODES            16
+#define SIM_PHYHDR              4       //header phymac puts in front of the L2 frame
+#define SIM_SENSE_US            1000    //channel sensing time (HW_IsChannelFree)
+
+#define SIM_ALOHA               0
+#define SIM_CSMA                1
+
+typedef enum
+{
+    SIM_IDLE,               //waiting for the next frame
+    SIM_BACKOFF,            //waiting for the next channel sensing
+    SIM_TX,                 //on air
+    SIM_DONE                //no more frames (burst round over)
+} simState_t;
+
+typedef struct
+{
+    simState_t state;
+    double next;            //time of the next event of this node (us)
+    double txStart;
+    double readyTime;       //time the current frame became ready
+    uint8_t collided;
+    uint32_t left;          //frames still to send
+    L2_csmaCtx_t csma;
+} simNode_t;
+
+typedef struct
+{
+    uint32_t frames;
+    uint32_t sent;
+    uint32_t collided;
+    uint32_t failed;
+    double delaySum;        //ready -> on air (us)
+    double busy;            //time the channel carried at least one frame (us)
+    double time;
+} simResult_t;
+
+static simNode_t nodes[SIM_MAXNODES];
+static int payload = 26;
+static double toaUs;
+
+static uint64_t rngState = 88172645463325252ULL;
+static double rnd(void)
+{
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return (double)((rngState * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+//a frame becomes ready at time t
+static void frameReady(simNode_t* n, uint8_t policy, double t)
+{
+    n->readyTime = t;
+    n->state = SIM_BACKOFF;
+    n->next = t;
+    if (policy == SIM_CSMA)
+        n->next += L2_csma_start(&n->csma, 0) + SIM_SENSE_US;
+}
+
+static void nextFrame(simNode_t* n, uint8_t policy, double t, double idleUs)
+{
+    if (n->left == 0)
+    {
+        n->state = SIM_DONE;
+        return;
+    }
+    n->left--;
+    if (idleUs <= 0.0)
+    {
+        n->state = SIM_IDLE;
+        return;
+    }
+    frameReady(n, policy, t - idleUs * log(1.0 - rnd()));
+}
+
+//a frame is heard by the sensing that ends at t if it was on air when the sensing started
+static uint8_t channelFree(int self, int numNodes, double t)
+{
+    int i;
+
+    for (i = 0; i < numNodes; i++)
+    {
+        if (i != self && nodes[i].state == SIM_TX && nodes[i].txStart < t - SIM_SENSE_US)
+            return 0;
+    }
+    return 1;
+}
+
+//burst : idleUs 0, every node sends framesPerNode rounds of one simultaneous frame
+static void run(simResult_t* r, int numNodes, uint8_t policy, uint32_t framesPerNode, double idleUs)
+{
+    double busyStart = 0.0;
+    int onAir = 0;
+    int i;
+
+    memset(r, 0, sizeof(*r));
+    for (i = 0; i < numNodes; i++)
+    {
+        L2_csma_init(&nodes[i].csma);
+        nodes[i].left = framesPerNode;
+        nextFrame(&nodes[i], policy, 0.0, idleUs);
+    }
+
+    for (;;)
+    {
+        simNode_t* n = NULL;
+        int self = -1;
+        double t;
+
+        //start of a burst round : all the nodes are idle
+        for (i = 0; i < numNodes; i++)
+        {
+            if (nodes[i].state != SIM_IDLE)
+                break;
+        }
+        if (i == numNodes)
+        {
+            for (i = 0; i < numNodes; i++)
+                frameReady(&nodes[i], policy, r->time);
+        }
+
+        for (i = 0; i < numNodes; i++)
+        {
+            if ((nodes[i].state == SIM_BACKOFF || nodes[i].state == SIM_TX) && (n == NULL || nodes[i].next < n->next))
+            {
+                n = &nodes[i];
+                self = i;
+            }
+        }
+        if (n == NULL)
+            break;
+        t = n->next;
+        r->time = t;
+
+        if (n->state == SIM_TX)
+        {
+            //end of a transmission
+            if (--onAir == 0)
+                r->busy += t - busyStart;
+            r->sent++;
+            if (n->collided)
+                r->collided++;
+            nextFrame(n, policy, t, idleUs);
+            continue;
+        }
+
+        if (policy == SIM_CSMA)
+        {
+            uint32_t delay;
+
+            switch (L2_csma_onCca(&n->csma, channelFree(self, numNodes, t), &delay))
+            {
+                case L2_CSMA_BACKOFF:
+                    n->next = t + delay + SIM_SENSE_US;
+                    continue;
+                case L2_CSMA_FAIL:
+                    r->frames++;
+                    r->failed++;
+                    nextFrame(n, policy, t, idleUs);
+                    continue;
+                default:
+                    break;
+            }
+        }
+
+        //start of a transmission : overlaps every frame on air
+        n->collided = 0;
+        for (i = 0; i < numNodes; i++)
+        {
+            if (i != self && nodes[i].state == SIM_TX)
+            {
+                nodes[i].collided = 1;
+                n->collided = 1;
+            }
+        }
+        if (onAir++ == 0)
+            busyStart = t;
+        r->frames++;
+        r->delaySum += t - n->readyTime;
+        n->state = SIM_TX;
+        n->txStart = t;
+        n->next = t + toaUs;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t framesPerNode = 2000;
+    int maxNodes = 8;
+    double load = 0.0;
+    int numNodes;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "bl:n:f:p:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'b': load = 0.0; break;
+            case 'l': load = atof(optarg); break;
+            case 'n': maxNodes = atoi(optarg); break;
+            case 'f': framesPerNode = (uint32_t)atoi(optarg); break;
+            case 'p': payload = atoi(optarg); break;
+            case 's': rngState = strtoull(optarg, NULL, 0) | 1; srand((unsigned)rngState); break;
+            default:
+                fprintf(stderr, "usage : %s [-b | -l offered load] [-n max nodes] [-f frames per node] [-p payload bytes] [-s seed]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (payload < 1 || payload > 26 || maxNodes < 2 || maxNodes > SIM_MAXNODES || framesPerNode == 0 || load < 0.0)
+    {
+        fprintf(stderr, "payload must be 1..26 bytes, nodes 2..%i\n", SIM_MAXNODES);
+        return 1;
+    }
+
+    toaUs = L2_rate_getToaUs(0, payload + 2 + SIM_PHYHDR);
+    if (load > 0.0)
+        printf("load mode : offered load %.2f, frame %.1f ms on air\n", load, toaUs / 1000.0);
+    else
+        printf("burst mode : all the nodes ready at once, frame %.1f ms on air\n", toaUs / 1000.0);
+    printf("backoff slot %i ms, BE %i..%i, %i busy senses max\n",
+           L2_CSMA_SLOT_US / 1000, L2_CSMA_MINBE, L2_CSMA_MAXBE, L2_CSMA_MAXBACKOFFS);
+    printf("nodes | ALOHA collided | CSMA collided | CSMA failed | CSMA access delay | channel use ALOHA / CSMA\n");
+
+    for (numNodes = 2; numNodes <= maxNodes; numNodes++)
+    {
+        simResult_t a, c;
+        double idleUs = load > 0.0 ? numNodes * toaUs / load : 0.0;
+
+        run(&a, numNodes, SIM_ALOHA, framesPerNode, idleUs);
+        run(&c, numNodes, SIM_CSMA, framesPerNode, idleUs);
+
+        printf("%5i | %13.1f%% | %12.1f%% | %10.1f%% | %14.1f ms | %5.1f%% / %5.1f%%\n", numNodes,
+               100.0 * a.collided / a.sent, 100.0 * c.collided / (c.sent ? c.sent : 1), 100.0 * c.failed / c.frames,
+               c.delaySum / (c.sent ? c.sent : 1) / 1000.0, 100.0 * a.busy / a.time, 100.0 * c.busy / c.time);
+    }
+
+    return 0;
+}
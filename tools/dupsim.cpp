@@ -0,0 +1,221 @@
+// Host-side model of the L2 duplicate cache (L2_peer_rxAcked / L2_peer_rxIsAcked) under ACK loss
+//
+// One node sends SDUs to another with the stop-and-wait ARQ of the FSM (timer drawn in
+// L2_ARQ_MINWAITTIME..L2_ARQ_MAXWAITTIME, L2_ARQ_MAXRETRANSMISSION retransmissions), one SDU after
+// the other. Data frames and ACKs are lost independently with their own probabilities. The receiver
+// runs the receive path of the FSM on its own L2_peer_t : sequence numbers checked with L2_seq_check,
+// and a PDU received again because our ACK was lost is either
+//  - dropped without an ACK (the FSM before the duplicate cache) : the sender retransmits until it
+//    gives up and L3 gets dataCnf(0) for an SDU that was delivered
+//  - ACKed again from the duplicate cache, without a second delivery to L3 (L2_peer_rxCheckOld, as
+//    L2_receiveData : only a PDU behind the window of the cache is taken for a sender restart)
+// For each ACK loss rate : dataCnf(0) per 1000 SDUs, those of them for delivered SDUs (spurious),
+// SDUs delivered twice (must be 0), duplicates ACKed again, frames and time per SDU.
+// With -d, a late copy of one of the L2_PEER_RXCACHE - 1 PDUs before the last one reaches the
+// receiver after that share of the SDUs : it is old and must not be delivered twice either.
+//
+// build : g++ -O2 -std=gnu++98 -I.. -o dupsim dupsim.cpp ../L2_peer.cpp ../L2_seq.cpp
+// usage : ./dupsim [-n SDUs per point] [-l data frame loss] [-d late copies per SDU] [-f data frame ms] [-a ACK frame ms] [-s seed]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "L2_peer.h"
+#include "L2_seq.h"
+
+#define SIM_TURNAROUND_MS       5       //data frame end -> ACK start at the receiver
+#define SIM_PEERID              1
+
+typedef struct
+{
+    uint32_t cnfFail;       //dataCnf(0)
+    uint32_t spurious;      //dataCnf(0) for an SDU the receiver delivered
+    uint32_t doubleDelivered;
+    uint32_t dupReAcked;
+    uint64_t frames;
+    double timeMs;
+} simResult_t;
+
+static double dataLossP = 0.0;
+static double ackLossP;
+static double lateP = 0.02;
+static uint32_t dataMs = 71;
+static uint32_t ackMs = 36;
+
+static uint64_t rngState = 88172645463325252ULL;
+static double rnd(void)
+{
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return (double)((rngState * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+static uint32_t arqWait(void)
+{
+    return L2_ARQ_MINWAITTIME * 1000 + (uint32_t)(rnd() * (L2_ARQ_MAXWAITTIME - L2_ARQ_MINWAITTIME) * 1000);
+}
+
+//old sequence number at the receiver : returns 1 if delivered to L3, *ackSent 1 if ACKed
+static uint8_t rxOld(L2_peerTable_t* rxTbl, L2_peer_t* rxPeer, uint8_t seq, uint8_t useCache, uint8_t* ackSent)
+{
+    if (!useCache)
+        return 0;
+
+    //L2_receiveData : ACK again from the cache, resync only behind its window
+    switch (L2_peer_rxCheckOld(rxPeer, seq))
+    {
+        case L2_PEER_RXOLD_ACKED:
+            L2_peer_rxAcked(rxTbl, rxPeer, seq);
+            *ackSent = 1;
+            return 0;
+        case L2_PEER_RXOLD_RESTART:
+            rxPeer->rxSeq = L2_seq_next(seq);
+            rxPeer->rxAckedLen = 0;
+            rxPeer->rxAckedIdx = 0;
+            L2_peer_rxAcked(rxTbl, rxPeer, seq);
+            *ackSent = 1;
+            return 1;
+    }
+    return 0;
+}
+
+static void run(simResult_t* res, uint32_t numSdu, uint8_t useCache)
+{
+    L2_peerTable_t rxTbl;
+    L2_peer_t* rxPeer;
+    uint8_t txSeq = 0;
+    uint32_t i;
+
+    memset(res, 0, sizeof(*res));
+    L2_peer_init(&rxTbl);
+    rxPeer = L2_peer_add(&rxTbl, SIM_PEERID, 0);
+    rxPeer->rxSynced = 1;
+
+    for (i = 0; i < numSdu; i++)
+    {
+        uint8_t retxCnt = 0;
+        uint8_t deliveries = 0;
+        uint8_t acked = 0;
+
+        for (;;)
+        {
+            uint8_t ackSent = 0;
+
+            //data frame, then the ACK right after it if the receiver sends one
+            res->frames++;
+            res->timeMs += dataMs;
+            if (rnd() >= dataLossP)
+            {
+                switch (L2_seq_check(txSeq, rxPeer->rxSeq))
+                {
+                    case L2_SEQ_EXPECTED:
+                        deliveries++;
+                        rxPeer->rxSeq = L2_seq_next(rxPeer->rxSeq);
+                        L2_peer_rxAcked(&rxTbl, rxPeer, txSeq);
+                        ackSent = 1;
+                        break;
+                    case L2_SEQ_OLD:
+                        deliveries += rxOld(&rxTbl, rxPeer, txSeq, useCache, &ackSent);
+                        break;
+                }
+            }
+            if (ackSent)
+            {
+                res->frames++;
+                if (rnd() >= ackLossP)
+                {
+                    res->timeMs += SIM_TURNAROUND_MS + ackMs;
+                    acked = 1;
+                    break;
+                }
+            }
+
+            //ARQ timer from the end of the data frame
+            res->timeMs += arqWait();
+            if (retxCnt >= L2_ARQ_MAXRETRANSMISSION)
+                break;
+            retxCnt++;
+        }
+
+        if (acked == 0)
+        {
+            res->cnfFail++;
+            if (deliveries > 0)
+                res->spurious++;
+        }
+        if (deliveries > 1)
+            res->doubleDelivered++;
+
+        //late copy of an earlier PDU (relayed or stuck in a retransmission elsewhere) : old, must not
+        //reach L3 again
+        if (i >= L2_PEER_RXCACHE && rnd() < lateP)
+        {
+            uint8_t lateSeq = txSeq;
+            uint8_t back = 1 + (uint8_t)(rnd() * (L2_PEER_RXCACHE - 1));
+            uint8_t ackSent = 0;
+
+            while (back-- > 0)
+                lateSeq = L2_seq_prev(lateSeq);
+            res->frames++;
+            if (L2_seq_check(lateSeq, rxPeer->rxSeq) == L2_SEQ_OLD)
+                res->doubleDelivered += rxOld(&rxTbl, rxPeer, lateSeq, useCache, &ackSent);
+        }
+        txSeq = L2_seq_next(txSeq);
+    }
+    res->dupReAcked = rxTbl.stats.dupReAcked;
+}
+
+int main(int argc, char** argv)
+{
+    static const double ackLosses[] = {0.0, 0.05, 0.1, 0.2, 0.3};
+    uint32_t numSdu = 10000;
+    unsigned li;
+    int m, opt;
+
+    while ((opt = getopt(argc, argv, "n:l:d:f:a:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': numSdu = (uint32_t)atol(optarg); break;
+            case 'l': dataLossP = atof(optarg); break;
+            case 'd': lateP = atof(optarg); break;
+            case 'f': dataMs = (uint32_t)atoi(optarg); break;
+            case 'a': ackMs = (uint32_t)atoi(optarg); break;
+            case 's': rngState = strtoull(optarg, NULL, 0) | 1; break;
+            default:
+                fprintf(stderr, "usage : %s [-n SDUs per point] [-l data frame loss] [-d late copies per SDU] [-f data frame ms] [-a ACK frame ms] [-s seed]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (numSdu == 0 || dataLossP < 0 || dataLossP >= 1 || lateP < 0 || lateP > 1 || dataMs == 0 || ackMs == 0)
+    {
+        fprintf(stderr, "SDUs and frame times must be > 0, data frame loss in [0, 1), late copies in [0, 1]\n");
+        return 1;
+    }
+
+    printf("%lu SDUs per point, data frame loss %.0f%%, late copies %.0f%%, data %lu ms / ACK %lu ms on air, ARQ %i..%i s x %i retransmissions\n",
+           (unsigned long)numSdu, 100.0 * dataLossP, 100.0 * lateP, (unsigned long)dataMs, (unsigned long)ackMs,
+           L2_ARQ_MINWAITTIME, L2_ARQ_MAXWAITTIME, L2_ARQ_MAXRETRANSMISSION);
+    printf("ACK loss | receiver     | dataCnf(0)/1000 | spurious/1000 | delivered twice | re-ACKed | frames/SDU | s/SDU\n");
+
+    for (li = 0; li < sizeof(ackLosses) / sizeof(ackLosses[0]); li++)
+    {
+        ackLossP = ackLosses[li];
+        for (m = 0; m < 2; m++)
+        {
+            simResult_t r;
+
+            run(&r, numSdu, (uint8_t)m);
+            printf("    %3.0f%% | %-12s | %15.1f | %13.1f | %15lu | %8lu | %10.2f | %5.2f\n",
+                   100.0 * ackLossP, m ? "re-ACK cache" : "drop", 1000.0 * r.cnfFail / numSdu,
+                   1000.0 * r.spurious / numSdu, (unsigned long)r.doubleDelivered, (unsigned long)r.dupReAcked,
+                   (double)r.frames / numSdu, r.timeMs / 1000.0 / numSdu);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,441 @@
+// Host-side reader of the binary event stream (EVstream.h) : console captures -> columnar file
+//
+// A capture is the raw byte stream of a node console (e.g. cat /dev/ttyACM0 > node1.cap) with the
+// shell parameter evstream set to 1 : the game text with event frames in between. The capture is cut
+// at the EVSTREAM_DELIM bytes, and a chunk of EVSTREAM_FRAMESIZE - 2 bytes that COBS-decodes and
+// whose CRC-16/CCITT-FALSE matches is an event ; everything else is text (printed with -t).
+// The events of all the captures go into one columnar file, one array per field, so that an
+// analysis of thousands of games reads only the columns it needs :
+//  "EVC1"  u32 rows  u16 columns, then per column : name (16 bytes, NUL padded)  u8 width (1, 2, 4)
+//          rows values of width bytes, little-endian
+// columns : capture (index of the input file), node, seq, time (ms), type, round, a, b, value (the
+// record fields, EVstream.h), game (games started by the node so far in the capture, 0 before the first)
+// -r prints the analysis of a columnar file : games, cooperation by round, predictions, releases, links.
+//
+// build : g++ -O2 -std=gnu++98 -I.. -o evreader evreader.cpp
+// usage : ./evreader [-o out.evc] [-t] capture... | ./evreader -r file.evc
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <vector>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "EVstream.h"
+
+#define EVC_MAGIC               "EVC1"
+#define EVC_NAMELEN             16
+#define EVC_NUMCOLS             10
+#define EVC_MAXROUND            10      //rounds shown one by one in the analysis (later ones share a line)
+
+typedef struct
+{
+    uint16_t capture;
+    uint8_t node;
+    uint16_t seq;
+    uint32_t time;
+    uint8_t type;
+    uint16_t round;
+    uint8_t a;
+    uint8_t b;
+    uint32_t value;
+    uint32_t game;
+} event_t;
+
+typedef struct
+{
+    const char* name;
+    uint8_t width;
+} column_t;
+
+static const column_t columns[EVC_NUMCOLS] =
+{
+    {"capture", 2}, {"node", 1}, {"seq", 2}, {"time", 4}, {"type", 1},
+    {"round", 2}, {"a", 1}, {"b", 1}, {"value", 4}, {"game", 4}
+};
+
+typedef struct
+{
+    uint32_t bytes;
+    uint32_t textBytes;
+    uint32_t frames;
+    uint32_t crcErrors;         //chunks of the frame size whose CRC does not match
+    uint32_t lost;              //events missing from the sequence numbers
+    uint32_t restarts;          //sequence number back to 0 (node reset)
+    uint32_t perType[EVSTREAM_NUMTYPES];
+} captureStats_t;
+
+
+//CRC-16/CCITT-FALSE, bitwise (MbedCRC<POLY_16BIT_CCITT, 16> on the node)
+static uint16_t crc16(const uint8_t* data, int size)
+{
+    uint16_t crc = 0xFFFF;
+    int i, b;
+
+    for (i = 0; i < size; i++)
+    {
+        crc ^= (uint16_t)(data[i] << 8);
+        for (b = 0; b < 8; b++)
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+//COBS-decodes a chunk (no delimiter inside) : decoded size, -1 if it is not COBS
+static int cobsDecode(const uint8_t* in, int size, uint8_t* out, int outSize)
+{
+    int i = 0, len = 0;
+
+    while (i < size)
+    {
+        int code = in[i++];
+        int j;
+
+        if (code == 0 || i + code - 1 > size)
+            return -1;
+        for (j = 1; j < code; j++)
+        {
+            if (len >= outSize)
+                return -1;
+            out[len++] = in[i++];
+        }
+        if (code < 0xFF && i < size)
+        {
+            if (len >= outSize)
+                return -1;
+            out[len++] = 0;
+        }
+    }
+    return len;
+}
+
+static uint16_t getU16(const uint8_t* p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t getU32(const uint8_t* p)
+{
+    return ((uint32_t)getU16(p) << 16) | getU16(p + 2);
+}
+
+//a chunk between two delimiters : event (1) or text (0)
+static int parseChunk(const uint8_t* chunk, int size, event_t* ev)
+{
+    uint8_t rec[EVSTREAM_RECSIZE + 2];
+
+    if (size != EVSTREAM_FRAMESIZE - 2 || cobsDecode(chunk, size, rec, sizeof(rec)) != (int)sizeof(rec))
+        return 0;
+    if (crc16(rec, EVSTREAM_RECSIZE) != getU16(rec + EVSTREAM_RECSIZE))
+        return -1;
+    ev->type = rec[0];
+    ev->node = rec[1];
+    ev->seq = getU16(rec + 2);
+    ev->time = getU32(rec + 4);
+    ev->round = getU16(rec + 8);
+    ev->a = rec[10];
+    ev->b = rec[11];
+    ev->value = getU32(rec + 12);
+    return 1;
+}
+
+static int readCapture(const char* path, uint16_t capture, int echoText, std::vector<event_t>& events, captureStats_t* st)
+{
+    FILE* f = fopen(path, "rb");
+    std::vector<uint8_t> chunk;
+    std::map<uint8_t, std::pair<uint16_t, uint32_t> > nodes;     //node -> last seq, games
+    int c;
+
+    if (f == NULL)
+    {
+        perror(path);
+        return 0;
+    }
+    memset(st, 0, sizeof(*st));
+
+    do
+    {
+        c = fgetc(f);
+        if (c != EOF)
+            st->bytes++;
+        if (c != EOF && c != EVSTREAM_DELIM)
+        {
+            chunk.push_back((uint8_t)c);
+            continue;
+        }
+        if (!chunk.empty())
+        {
+            event_t ev;
+            int res = parseChunk(&chunk[0], (int)chunk.size(), &ev);
+
+            if (res == 1)
+            {
+                std::map<uint8_t, std::pair<uint16_t, uint32_t> >::iterator it = nodes.find(ev.node);
+
+                if (it == nodes.end())
+                    it = nodes.insert(std::make_pair(ev.node, std::make_pair((uint16_t)(ev.seq - 1), (uint32_t)0))).first;
+                if (ev.seq == 0 && it->second.first != 0xFFFF)
+                    st->restarts++;
+                else
+                    st->lost += (uint16_t)(ev.seq - it->second.first - 1);
+                it->second.first = ev.seq;
+                if (ev.type == EVSTREAM_ROUNDSTART && ev.round == 1 && ev.b == 0)
+                    it->second.second++;
+                ev.capture = capture;
+                ev.game = it->second.second;
+                events.push_back(ev);
+                st->frames++;
+                st->perType[ev.type < EVSTREAM_NUMTYPES ? ev.type : 0]++;
+            }
+            else
+            {
+                if (res < 0)
+                    st->crcErrors++;
+                st->textBytes += (uint32_t)chunk.size();
+                if (echoText)
+                    fwrite(&chunk[0], 1, chunk.size(), stdout);
+            }
+            chunk.clear();
+        }
+    } while (c != EOF);
+
+    fclose(f);
+    return 1;
+}
+
+static void putLe(FILE* f, uint32_t val, int width)
+{
+    int i;
+
+    for (i = 0; i < width; i++)
+        fputc((int)((val >> (8 * i)) & 0xFF), f);
+}
+
+static uint32_t getField(const event_t& ev, int col)
+{
+    switch (col)
+    {
+    case 0: return ev.capture;
+    case 1: return ev.node;
+    case 2: return ev.seq;
+    case 3: return ev.time;
+    case 4: return ev.type;
+    case 5: return ev.round;
+    case 6: return ev.a;
+    case 7: return ev.b;
+    case 8: return ev.value;
+    default: return ev.game;
+    }
+}
+
+static int writeColumns(const char* path, const std::vector<event_t>& events)
+{
+    FILE* f = fopen(path, "wb");
+    char name[EVC_NAMELEN];
+    size_t r;
+    int col;
+
+    if (f == NULL)
+    {
+        perror(path);
+        return 0;
+    }
+    fwrite(EVC_MAGIC, 1, 4, f);
+    putLe(f, (uint32_t)events.size(), 4);
+    putLe(f, EVC_NUMCOLS, 2);
+    for (col = 0; col < EVC_NUMCOLS; col++)
+    {
+        memset(name, 0, sizeof(name));
+        strncpy(name, columns[col].name, sizeof(name) - 1);
+        fwrite(name, 1, sizeof(name), f);
+        fputc(columns[col].width, f);
+        for (r = 0; r < events.size(); r++)
+            putLe(f, getField(events[r], col), columns[col].width);
+    }
+    return fclose(f) == 0;
+}
+
+//columnar file -> one array per column name (values widened to 32 bits)
+static int readColumns(const char* path, std::map<std::string, std::vector<uint32_t> >& cols, uint32_t* rows)
+{
+    FILE* f = fopen(path, "rb");
+    uint8_t hdr[10];
+    uint16_t num, i;
+
+    if (f == NULL)
+    {
+        perror(path);
+        return 0;
+    }
+    if (fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr) || memcmp(hdr, EVC_MAGIC, 4) != 0)
+    {
+        fprintf(stderr, "%s : not a columnar event file\n", path);
+        fclose(f);
+        return 0;
+    }
+    *rows = hdr[4] | (hdr[5] << 8) | (hdr[6] << 16) | ((uint32_t)hdr[7] << 24);
+    num = (uint16_t)(hdr[8] | (hdr[9] << 8));
+    for (i = 0; i < num; i++)
+    {
+        char name[EVC_NAMELEN + 1];
+        std::vector<uint32_t> v;
+        int width;
+        uint32_t r;
+
+        name[EVC_NAMELEN] = '\0';
+        if (fread(name, 1, EVC_NAMELEN, f) != EVC_NAMELEN || (width = fgetc(f)) == EOF || width < 1 || width > 4)
+            break;
+        for (r = 0; r < *rows; r++)
+        {
+            uint8_t b[4] = {0, 0, 0, 0};
+
+            if (fread(b, 1, width, f) != (size_t)width)
+                break;
+            v.push_back(b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24));
+        }
+        cols[name] = v;
+    }
+    fclose(f);
+    for (i = 0; i < EVC_NUMCOLS; i++)
+    {
+        if (cols[columns[i].name].size() != *rows)
+        {
+            fprintf(stderr, "%s : column %s missing or cut\n", path, columns[i].name);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void analyse(const char* path)
+{
+    std::map<std::string, std::vector<uint32_t> > cols;
+    std::map<uint64_t, uint32_t> games;                 //(capture, node, game) -> rounds
+    uint32_t rows, r, i;
+    uint32_t coop[EVC_MAXROUND + 1] = {0}, chosen[EVC_MAXROUND + 1] = {0};
+    uint32_t predicted = 0, hits = 0, overs = 0, released = 0, linkLost = 0, linkDown = 0, linkUp = 0;
+    uint64_t finalSum = 0, downMs = 0;
+
+    if (!readColumns(path, cols, &rows))
+        return;
+    const std::vector<uint32_t>& capture = cols["capture"];
+    const std::vector<uint32_t>& node = cols["node"];
+    const std::vector<uint32_t>& type = cols["type"];
+    const std::vector<uint32_t>& round = cols["round"];
+    const std::vector<uint32_t>& a = cols["a"];
+    const std::vector<uint32_t>& b = cols["b"];
+    const std::vector<uint32_t>& value = cols["value"];
+    const std::vector<uint32_t>& game = cols["game"];
+
+    for (r = 0; r < rows; r++)
+    {
+        uint64_t key = ((uint64_t)capture[r] << 40) | ((uint64_t)node[r] << 32) | game[r];
+
+        switch (type[r])
+        {
+        case EVSTREAM_ROUNDSTART:
+            if (game[r] > 0 && round[r] > games[key])
+                games[key] = round[r];
+            break;
+        case EVSTREAM_CHOICE:
+            if (a[r] == node[r]) //own choices only : the peer's are in its own capture
+            {
+                i = round[r] < EVC_MAXROUND ? round[r] : EVC_MAXROUND;
+                chosen[i]++;
+                coop[i] += (b[r] == 1);
+            }
+            break;
+        case EVSTREAM_PREDICT:
+            if (a[r] == node[r] && value[r] != EVSTREAM_PRED_MADE)
+            {
+                predicted++;
+                hits += (value[r] == EVSTREAM_PRED_HIT);
+            }
+            break;
+        case EVSTREAM_GAMEOVER:
+            overs++;
+            released += a[r];
+            linkLost += b[r];
+            finalSum += value[r];
+            break;
+        case EVSTREAM_LINK:
+            if (b[r])
+            {
+                linkUp++;
+                downMs += value[r];
+            }
+            else
+                linkDown++;
+            break;
+        }
+    }
+
+    uint64_t totalRounds = 0;
+    for (std::map<uint64_t, uint32_t>::iterator it = games.begin(); it != games.end(); ++it)
+        totalRounds += it->second;
+    printf("%s : %u events, %u games (node view), %.2f rounds/game\n", path, rows, (unsigned)games.size(),
+           games.empty() ? 0.0 : (double)totalRounds / games.size());
+    printf(" round  choices  coop%%\n");
+    for (i = 1; i <= EVC_MAXROUND; i++)
+    {
+        if (chosen[i] > 0)
+            printf(" %3u%s  %7u  %5.1f\n", i, i == EVC_MAXROUND ? "+" : " ", chosen[i], 100.0 * coop[i] / chosen[i]);
+    }
+    printf(" predictions checked %u, hit %.1f%%\n", predicted, predicted ? 100.0 * hits / predicted : 0.0);
+    printf(" games over %u : released %.1f%%, link lost %u, final sentence %.1f years (mean)\n", overs,
+           overs ? 100.0 * released / overs : 0.0, linkLost, overs ? finalSum / 1000.0 / overs : 0.0);
+    printf(" link down %u, up %u (%.1f s down, mean)\n", linkDown, linkUp, linkUp ? downMs / 1000.0 / linkUp : 0.0);
+}
+
+int main(int argc, char** argv)
+{
+    const char* out = "events.evc";
+    const char* analysis = NULL;
+    int echoText = 0;
+    std::vector<event_t> events;
+    int opt, i;
+
+    while ((opt = getopt(argc, argv, "o:r:t")) != -1)
+    {
+        switch (opt)
+        {
+            case 'o': out = optarg; break;
+            case 'r': analysis = optarg; break;
+            case 't': echoText = 1; break;
+            default:
+                fprintf(stderr, "usage : %s [-o out.evc] [-t] capture... | %s -r file.evc\n", argv[0], argv[0]);
+                return 1;
+        }
+    }
+    if (analysis != NULL)
+    {
+        analyse(analysis);
+        return 0;
+    }
+    if (optind >= argc)
+    {
+        fprintf(stderr, "no capture given\n");
+        return 1;
+    }
+
+    printf("capture                  bytes   text  events  crc err  lost  resets  round choice predict sentence over link\n");
+    for (i = optind; i < argc; i++)
+    {
+        captureStats_t st;
+
+        if (!readCapture(argv[i], (uint16_t)(i - optind), echoText, events, &st))
+            return 1;
+        printf("%-20.20s %9u %6u %7u %8u %5u %7u %6u %6u %7u %8u %4u %4u\n", argv[i], st.bytes, st.textBytes, st.frames,
+               st.crcErrors, st.lost, st.restarts, st.perType[EVSTREAM_ROUNDSTART], st.perType[EVSTREAM_CHOICE],
+               st.perType[EVSTREAM_PREDICT], st.perType[EVSTREAM_SENTENCE], st.perType[EVSTREAM_GAMEOVER],
+               st.perType[EVSTREAM_LINK]);
+    }
+    if (!writeColumns(out, events))
+        return 1;
+    printf("%u events -> %s (%i columns)\n", (unsigned)events.size(), out, EVC_NUMCOLS);
+    return 0;
+}
@@ -0,0 +1,263 @@
+// Host-side Monte Carlo of L2 stop-and-wait ARQ against FEC block ARQ
+//
+// Sends SDUs over a channel that loses every frame (data and ACK) independently and
+// compares, for a range of loss rates, the two ways L2 can carry an SDU longer than one frame:
+//  - ARQ : one fragment per frame, each fragment ACKed and retransmitted on timeout
+//  - FEC : the whole SDU plus XOR parity (L2_fec.cpp, group of L2_FEC_GROUPSIZE) sent
+//          back-to-back, one ACK at the end of the block, whole block resent on timeout
+//          (FEC : the receiver ACKs a block it has once the sender is done with it, as the firmware,
+//           last : only when it hears the last frame of the block, the rule before)
+// The timer values are those of protocol_parameters.h (random timeout between
+// L2_ARQ_MINWAITTIME and L2_ARQ_MAXWAITTIME seconds, L2_ARQ_MAXRETRANSMISSION retries).
+// Reported per loss rate : goodput (SDU bytes per second of channel time), mean and 99th
+// percentile SDU latency, frames on air per SDU and the ratio of SDUs given up.
+//
+// build : g++ -O2 -std=gnu++98 -I.. -DL2_FEC_GROUPSIZE=2 -o fecsim fecsim.cpp ../L2_fec.cpp
+//         (the group size is fixed at build time, as in the firmware)
+// usage : ./fecsim [-n SDU bytes] [-f fragment bytes] [-a airtime ms per frame]
+//                  [-k ACK airtime ms] [-m SDUs per point] [-s seed]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "L2_fec.h"
+
+static const double lossPoints[] = {0.0, 0.01, 0.02, 0.05, 0.1, 0.15, 0.2, 0.3};
+#define NUM_LOSSPOINTS          (sizeof(lossPoints) / sizeof(lossPoints[0]))
+
+typedef struct
+{
+    double totalTime;       //channel time, ms
+    double totalBytes;
+    double frames;
+    uint32_t delivered;
+    uint32_t failed;
+    double* latency;        //per delivered SDU, ms
+} simResult_t;
+
+static double simAirtime = 30.0;
+static double simAckAirtime = 15.0;
+static double simLoss = 0.0;
+
+//uniform in [0,1) (xorshift64*)
+static uint64_t rngState = 88172645463325252ULL;
+static double rnd(void)
+{
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return (double)((rngState * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+static int lost(void)
+{
+    return rnd() < simLoss;
+}
+
+//same draw as the firmware ARQ timer
+static double arqTimeout(void)
+{
+    return 1000.0 * (L2_ARQ_MINWAITTIME + rnd() * (L2_ARQ_MAXWAITTIME - L2_ARQ_MINWAITTIME));
+}
+
+
+//stop-and-wait : returns the SDU time (ms), negative if given up
+static double sendArq(uint8_t sduLen, uint8_t fragSize, double* frames)
+{
+    uint8_t numFrag = L2_fec_getNumData(sduLen, fragSize);
+    double t = 0.0;
+    uint8_t i;
+
+    for (i = 0; i < numFrag; i++)
+    {
+        int retx = 0;
+
+        for (;;)
+        {
+            t += simAirtime;
+            (*frames)++;
+            if (!lost())
+            {
+                t += simAckAirtime;
+                if (!lost())
+                    break;
+            }
+            t += arqTimeout();
+            if (++retx > L2_ARQ_MAXRETRANSMISSION)
+                return -t;
+        }
+    }
+    return t;
+}
+
+//FEC block : the receiver keeps what it got across retransmissions of the same block and ACKs
+//at the end of the block when it has the SDU and heard a frame of this pass once it had it (as in
+//L2_receiveFecFrame), or with ackOnLast only when it has the SDU and hears the last frame
+static double sendFec(const uint8_t* sdu, uint8_t sduLen, uint8_t fragSize, double* frames, uint8_t ackOnLast)
+{
+    static uint8_t rxData[256], rxParity[L2_FEC_MAXPARITYFRAG * 32];
+    uint8_t frag[32];
+    L2_fecRx_t rx;
+    uint8_t numData = L2_fec_getNumData(sduLen, fragSize);
+    uint8_t numFrames = numData + L2_fec_getNumParity(numData);
+    uint8_t complete = 0;
+    double t = 0.0;
+    int retx = 0;
+    uint8_t i;
+
+    L2_fec_rxInit(&rx, rxData, rxParity, sduLen, fragSize);
+
+    for (;;)
+    {
+        uint8_t lastHeard = 0;
+        uint8_t heardComplete = 0;
+
+        for (i = 0; i < numFrames; i++)
+        {
+            uint8_t len = L2_fec_getFragment(frag, sdu, sduLen, fragSize, i);
+
+            t += simAirtime;
+            (*frames)++;
+            lastHeard = 0;
+            if (lost())
+                continue;
+            lastHeard = 1;
+            if (!complete && L2_fec_rxPut(&rx, i, frag, len) == 1)
+                complete = 1;
+            heardComplete = complete;
+        }
+
+        if (ackOnLast ? (complete && lastHeard) : heardComplete)
+        {
+            t += simAckAirtime;
+            if (!lost())
+                break;
+        }
+        t += arqTimeout();
+        if (++retx > L2_ARQ_MAXRETRANSMISSION)
+            return -t;
+    }
+
+    if (memcmp(rxData, sdu, sduLen) != 0)
+    {
+        fprintf(stderr, "FEC rebuilt a wrong SDU\n");
+        exit(1);
+    }
+    return t;
+}
+
+static void account(simResult_t* r, double t, uint8_t sduLen)
+{
+    if (t < 0)
+    {
+        r->totalTime -= t;
+        r->failed++;
+        return;
+    }
+    r->totalTime += t;
+    r->totalBytes += sduLen;
+    r->latency[r->delivered++] = t;
+}
+
+static void report(const char* name, simResult_t* r, uint32_t numSdu)
+{
+    double mean = 0.0, p99 = 0.0;
+    uint32_t i;
+
+    if (r->delivered > 0)
+    {
+        for (i = 0; i < r->delivered; i++)
+            mean += r->latency[i];
+        mean /= r->delivered;
+        std::sort(r->latency, r->latency + r->delivered);
+        p99 = r->latency[(r->delivered - 1) * 99 / 100];
+    }
+
+    printf("  %-4s %9.1f B/s  lat %8.1f ms (p99 %8.1f)  %6.2f frames/SDU  %6.3f%% dropped\n",
+           name, r->totalBytes / (r->totalTime / 1000.0), mean, p99,
+           r->frames / numSdu, 100.0 * r->failed / numSdu);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t numSdu = 20000;
+    int sduLen = 60;
+    int fragSize = 24;
+    uint8_t sdu[256];
+    uint32_t p, k;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:f:a:k:m:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': sduLen = atoi(optarg); break;
+            case 'f': fragSize = atoi(optarg); break;
+            case 'a': simAirtime = atof(optarg); break;
+            case 'k': simAckAirtime = atof(optarg); break;
+            case 'm': numSdu = (uint32_t)atoi(optarg); break;
+            case 's': rngState = strtoull(optarg, NULL, 0) | 1; break;
+            default:
+                fprintf(stderr, "usage : %s [-n SDU bytes] [-f fragment bytes] [-a airtime ms] [-k ACK airtime ms] [-m SDUs] [-s seed]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (sduLen < 1 || sduLen > 255 || fragSize < 1 || fragSize > 32 || numSdu == 0)
+    {
+        fprintf(stderr, "SDU must be 1..255 bytes and fragments 1..32 bytes\n");
+        return 1;
+    }
+    if (L2_fec_getNumData(sduLen, fragSize) > L2_FEC_MAXDATAFRAG)
+    {
+        fprintf(stderr, "%i fragments per SDU exceed L2_FEC_MAXDATAFRAG (%i)\n", L2_fec_getNumData(sduLen, fragSize), L2_FEC_MAXDATAFRAG);
+        return 1;
+    }
+    if (L2_FEC_GROUPSIZE == 0)
+    {
+        fprintf(stderr, "built with L2_FEC_GROUPSIZE 0 : rebuild with -DL2_FEC_GROUPSIZE=<group size>\n");
+        return 1;
+    }
+
+    for (k = 0; k < (uint32_t)sduLen; k++)
+        sdu[k] = (uint8_t)(k * 13 + 5);
+
+    printf("SDU %i bytes, %i byte fragments (%i frames ARQ, %i frames FEC G=%i), airtime %.1f/%.1f ms\n",
+           sduLen, fragSize, L2_fec_getNumData(sduLen, fragSize),
+           L2_fec_getNumData(sduLen, fragSize) + L2_fec_getNumParity(L2_fec_getNumData(sduLen, fragSize)),
+           L2_FEC_GROUPSIZE, simAirtime, simAckAirtime);
+
+    for (p = 0; p < NUM_LOSSPOINTS; p++)
+    {
+        simResult_t arq, fec, fecLast;
+
+        memset(&arq, 0, sizeof(arq));
+        memset(&fec, 0, sizeof(fec));
+        memset(&fecLast, 0, sizeof(fecLast));
+        arq.latency = new double[numSdu];
+        fec.latency = new double[numSdu];
+        fecLast.latency = new double[numSdu];
+        simLoss = lossPoints[p];
+
+        for (k = 0; k < numSdu; k++)
+        {
+            account(&arq, sendArq(sduLen, fragSize, &arq.frames), sduLen);
+            account(&fec, sendFec(sdu, sduLen, fragSize, &fec.frames, 0), sduLen);
+            account(&fecLast, sendFec(sdu, sduLen, fragSize, &fecLast.frames, 1), sduLen);
+        }
+
+        printf("loss %4.1f%%\n", 100.0 * simLoss);
+        report("ARQ", &arq, numSdu);
+        report("FEC", &fec, numSdu);
+        report("last", &fecLast, numSdu);
+
+        delete[] arq.latency;
+        delete[] fec.latency;
+        delete[] fecLast.latency;
+    }
+
+    return 0;
+}
@@ -0,0 +1,377 @@
+// Host-side model of the N-player game (destination ID 255, L3_group.cpp) : round time vs players
+//
+// Every player broadcasts its choice of the round (CHOICE:<choice>:<round>:<players>) once it has
+// chosen, and ends the round when the choices of all the others have arrived or L3_GROUP_DEADLINE
+// has passed, as L3service_runGroupRound does. Broadcasts are not ACKed : a player whose round is
+// not over sends its choice again every L3_GROUP_READYTIME s (+ up to 1 s of jitter), and a player
+// that hears the choice of the round it has just left sends its own choice of that round once more.
+// The choices of the next L3_GROUP_WINDOW rounds are kept for the players that are still behind.
+// Frames last the LoRa time on air of rate 0 (L2_rate_getToaUs), two overlapping frames are both
+// lost, a node does not hear while it sends, and each link loses a frame with the given probability.
+// Channel access is ALOHA (send at once) or L2_CSMA_ENABLE (L2_csma.cpp), as in csmasim.
+//
+// build : g++ -O2 -std=gnu++98 -I.. -o groupsim groupsim.cpp ../L2_csma.cpp ../L2_rate.cpp ../L2_airtime.cpp
+// usage : ./groupsim [-n max players] [-r rounds] [-l link loss] [-t max think time (ms)] [-p payload bytes] [-s seed]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <vector>
+#include <algorithm>
+
+#include "L2_csma.h"
+#include "L2_rate.h"
+#include "L3_group.h"
+#include "protocol_parameters.h"
+
+#define SIM_MAXNODES            L3_GROUP_MAXPLAYERS
+#define SIM_PHYHDR              4       //header phymac puts in front of the L2 frame
+#define SIM_SENSE_US            1000    //channel sensing time (HW_IsChannelFree)
+#define SIM_TXQUEUE             4       //choices waiting for the channel at one node
+#define SIM_NONE                1e300
+
+#define SIM_ALOHA               0
+#define SIM_CSMA                1
+
+typedef enum
+{
+    SIM_IDLE,               //nothing to send
+    SIM_BACKOFF,            //waiting for the next channel sensing
+    SIM_TX                  //on air
+} simMac_t;
+
+typedef struct
+{
+    //game
+    uint32_t round;
+    double roundStart;
+    double choiceAt;        //the player has chosen at that time
+    uint8_t chosen;
+    double resendAt;        //next broadcast of an unanswered choice
+    uint8_t prevResent;
+    uint32_t heard[L3_GROUP_WINDOW];    //players whose choice of the round arrived (bit per player)
+    uint32_t heardRound[L3_GROUP_WINDOW];
+    uint32_t rounds;
+
+    //channel
+    simMac_t mac;
+    double macNext;
+    double txStart;
+    uint8_t collided;
+    uint32_t txQueue[SIM_TXQUEUE];      //rounds of the choices to send
+    uint8_t txLen;
+    L2_csmaCtx_t csma;
+} simNode_t;
+
+typedef struct
+{
+    std::vector<double> roundMs;
+    uint32_t deadlines;
+    uint32_t frames;
+} simResult_t;
+
+static simNode_t nodes[SIM_MAXNODES];
+static double toaUs;
+static double loss = 0.0;
+static double thinkUs = 0.0;
+
+static uint64_t rngState = 88172645463325252ULL;
+static double rnd(void)
+{
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return (double)((rngState * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+//the first queued choice goes through channel access
+static void startAccess(simNode_t* n, uint8_t policy, double t)
+{
+    n->mac = SIM_BACKOFF;
+    n->macNext = t;
+    if (policy == SIM_CSMA)
+        n->macNext += L2_csma_start(&n->csma, 0) + SIM_SENSE_US;
+}
+
+static void send(simNode_t* n, uint8_t policy, uint32_t round, double t)
+{
+    if (n->txLen == SIM_TXQUEUE)
+        return;
+    n->txQueue[n->txLen++] = round;
+    if (n->mac == SIM_IDLE)
+        startAccess(n, policy, t);
+}
+
+//the first queued choice is sent or given up
+static void nextFrame(simNode_t* n, uint8_t policy, double t)
+{
+    memmove(&n->txQueue[0], &n->txQueue[1], (n->txLen - 1) * sizeof(n->txQueue[0]));
+    n->txLen--;
+    n->mac = SIM_IDLE;
+    if (n->txLen > 0)
+        startAccess(n, policy, t);
+}
+
+static uint32_t* heardOf(simNode_t* n, uint32_t round)
+{
+    uint8_t i = round % L3_GROUP_WINDOW;
+
+    if (n->heardRound[i] != round)
+    {
+        n->heardRound[i] = round;
+        n->heard[i] = 0;
+    }
+    return &n->heard[i];
+}
+
+static uint8_t isComplete(simNode_t* n, int self, int numNodes)
+{
+    return *heardOf(n, n->round) == (((1u << numNodes) - 1) & ~(1u << self));
+}
+
+static void startRound(simNode_t* n, double t)
+{
+    n->round++;
+    n->roundStart = t;
+    n->chosen = 0;
+    n->choiceAt = t + thinkUs * rnd();
+    n->resendAt = SIM_NONE;
+}
+
+//the round of node self ends at t (all the choices heard, or deadline)
+static void endRound(simResult_t* r, simNode_t* n, uint8_t deadline, double t)
+{
+    r->roundMs.push_back((t - n->roundStart) / 1000.0);
+    if (deadline)
+        r->deadlines++;
+    n->rounds++;
+    n->prevResent = 0;
+    startRound(n, t);
+}
+
+static void deliver(simNode_t* to, int from, uint8_t policy, uint32_t round, double t)
+{
+    int32_t ahead = (int32_t)(round - to->round);
+
+    if (ahead < 0)
+    {
+        //the sender is still in the round I left : it missed my choice
+        if (ahead == -1 && to->prevResent == 0)
+        {
+            send(to, policy, round, t);
+            to->prevResent = 1;
+        }
+        return;
+    }
+    if (ahead < L3_GROUP_WINDOW)
+        *heardOf(to, round) |= 1u << from;
+}
+
+static void run(simResult_t* r, int numNodes, uint8_t policy, uint32_t rounds)
+{
+    int i;
+
+    r->roundMs.clear();
+    r->deadlines = r->frames = 0;
+    memset(nodes, 0, sizeof(nodes));
+    for (i = 0; i < numNodes; i++)
+    {
+        L2_csma_init(&nodes[i].csma);
+        memset(nodes[i].heardRound, 0xFF, sizeof(nodes[i].heardRound));
+        startRound(&nodes[i], 0.0);
+    }
+
+    while (nodes[0].rounds < rounds)
+    {
+        simNode_t* n = NULL;
+        int self = -1;
+        int what = 0;       //0 : channel, 1 : choice, 2 : resend, 3 : deadline
+        double t = SIM_NONE;
+
+        for (i = 0; i < numNodes; i++)
+        {
+            simNode_t* c = &nodes[i];
+            double deadlineAt = c->roundStart + L3_GROUP_DEADLINE * 1000000.0;
+
+            if (c->mac != SIM_IDLE && c->macNext < t)
+            {
+                t = c->macNext; n = c; self = i; what = 0;
+            }
+            if (c->chosen == 0 && c->choiceAt < t)
+            {
+                t = c->choiceAt; n = c; self = i; what = 1;
+            }
+            if (c->chosen && c->resendAt < t)
+            {
+                t = c->resendAt; n = c; self = i; what = 2;
+            }
+            if (deadlineAt < t)
+            {
+                t = deadlineAt; n = c; self = i; what = 3;
+            }
+        }
+
+        if (what == 1)
+        {
+            n->chosen = 1;
+            send(n, policy, n->round, t);
+            n->resendAt = t + L3_GROUP_READYTIME * 1000000.0;
+            if (isComplete(n, self, numNodes))
+                endRound(r, n, 0, t);
+            continue;
+        }
+        if (what == 2)
+        {
+            //only while nothing waits for the channel (L3_LLI_getTxPending)
+            if (n->txLen == 0)
+            {
+                send(n, policy, n->round, t);
+                n->resendAt = t + L3_GROUP_READYTIME * 1000000.0 + 1000000.0 * rnd();
+            }
+            else
+                n->resendAt = n->macNext;
+            continue;
+        }
+        if (what == 3)
+        {
+            if (n->chosen == 0)     //cooperation by default
+            {
+                n->chosen = 1;
+                send(n, policy, n->round, t);
+            }
+            endRound(r, n, 1, t);
+            continue;
+        }
+
+        if (n->mac == SIM_TX)
+        {
+            //end of a transmission : heard by every node that was not on air meanwhile
+            uint32_t round = n->txQueue[0];
+
+            if (n->collided == 0)
+            {
+                for (i = 0; i < numNodes; i++)
+                {
+                    if (i != self && rnd() >= loss)
+                    {
+                        deliver(&nodes[i], self, policy, round, t);
+                        if (nodes[i].chosen && isComplete(&nodes[i], i, numNodes))
+                            endRound(r, &nodes[i], 0, t);
+                    }
+                }
+            }
+            nextFrame(n, policy, t);
+            continue;
+        }
+
+        if (policy == SIM_CSMA)
+        {
+            uint32_t delay;
+            uint8_t busy = 0;
+
+            for (i = 0; i < numNodes; i++)
+            {
+                if (i != self && nodes[i].mac == SIM_TX && nodes[i].txStart < t - SIM_SENSE_US)
+                    busy = 1;
+            }
+            switch (L2_csma_onCca(&n->csma, busy == 0, &delay))
+            {
+                case L2_CSMA_BACKOFF:
+                    n->macNext = t + delay + SIM_SENSE_US;
+                    continue;
+                case L2_CSMA_FAIL:
+                    nextFrame(n, policy, t);
+                    continue;
+                default:
+                    break;
+            }
+        }
+
+        //start of a transmission : overlaps every frame on air
+        n->collided = 0;
+        for (i = 0; i < numNodes; i++)
+        {
+            if (i != self && nodes[i].mac == SIM_TX)
+            {
+                nodes[i].collided = 1;
+                n->collided = 1;
+            }
+        }
+        r->frames++;
+        n->mac = SIM_TX;
+        n->txStart = t;
+        n->macNext = t + toaUs;
+    }
+}
+
+static double percentile(std::vector<double>& v, double p)
+{
+    if (v.empty())
+        return 0.0;
+    std::sort(v.begin(), v.end());
+    return v[(size_t)(p * (v.size() - 1))];
+}
+
+static double mean(const std::vector<double>& v)
+{
+    double s = 0.0;
+    size_t i;
+
+    for (i = 0; i < v.size(); i++)
+        s += v[i];
+    return v.empty() ? 0.0 : s / v.size();
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t rounds = 2000;
+    int maxNodes = 8;
+    int payload = 16;
+    int numNodes;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:l:t:p:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': maxNodes = atoi(optarg); break;
+            case 'r': rounds = (uint32_t)atoi(optarg); break;
+            case 'l': loss = atof(optarg); break;
+            case 't': thinkUs = atof(optarg) * 1000.0; break;
+            case 'p': payload = atoi(optarg); break;
+            case 's': rngState = strtoull(optarg, NULL, 0) | 1; srand((unsigned)rngState); break;
+            default:
+                fprintf(stderr, "usage : %s [-n max players] [-r rounds] [-l link loss] [-t max think time (ms)] [-p payload bytes] [-s seed]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (payload < 1 || payload > 26 || maxNodes < 2 || maxNodes > SIM_MAXNODES || rounds == 0 || loss < 0.0 || loss >= 1.0)
+    {
+        fprintf(stderr, "payload must be 1..26 bytes, players 2..%i, loss 0..1\n", SIM_MAXNODES);
+        return 1;
+    }
+
+    toaUs = L2_rate_getToaUs(0, payload + 2 + SIM_PHYHDR);
+    printf("choice frame %.1f ms on air, link loss %.0f%%, think time 0..%.0f ms\n", toaUs / 1000.0, loss * 100.0, thinkUs / 1000.0);
+    printf("resend every %i s, deadline %i s, %u rounds of player 0\n", L3_GROUP_READYTIME, L3_GROUP_DEADLINE, rounds);
+    printf("players | ALOHA round mean / p95 | deadline | frames/round | CSMA round mean / p95 | deadline | frames/round\n");
+
+    for (numNodes = 2; numNodes <= maxNodes; numNodes++)
+    {
+        simResult_t a, c;
+        double aRounds, cRounds;
+
+        run(&a, numNodes, SIM_ALOHA, rounds);
+        run(&c, numNodes, SIM_CSMA, rounds);
+        aRounds = (double)a.roundMs.size() / numNodes;
+        cRounds = (double)c.roundMs.size() / numNodes;
+
+        printf("%7i | %8.0f / %6.0f ms | %7.1f%% | %12.1f | %7.0f / %6.0f ms | %7.1f%% | %12.1f\n", numNodes,
+               mean(a.roundMs), percentile(a.roundMs, 0.95), 100.0 * a.deadlines / a.roundMs.size(), a.frames / aRounds,
+               mean(c.roundMs), percentile(c.roundMs, 0.95), 100.0 * c.deadlines / c.roundMs.size(), c.frames / cRounds);
+    }
+
+    return 0;
+}
@@ -0,0 +1,304 @@
+// Host-side model of the L2 link liveness detection (L2_link.cpp) between two nodes, one of them killed mid-run
+//
+// Both nodes run the stop-and-wait ARQ of the FSM (timer drawn in L2_ARQ_MINWAITTIME..L2_ARQ_MAXWAITTIME,
+// L2_ARQ_MAXRETRANSMISSION retransmissions) with game-like traffic : one SDU after an exponential think
+// time, once the previous one is confirmed. Each node runs its own L2_linkCtx_t as the firmware does,
+// polled every millisecond, and sends its probes / replies unless the channel is left to the ACK of
+// its last frame (L2_PEER_ACKGUARDMS). Each frame is lost independently with the given probability
+// (no collisions).
+// Node B is killed at a random time, and node A is told the link is gone either by the ARQ giving up
+// (first failed SDU, the only notice without liveness) or by L2_link_poll reporting it down : for each
+// detection time and loss rate, mean / worst time from the kill to the notice. A run of the same length
+// without the kill gives the false downs per hour and the probe overhead.
+//
+// build : g++ -O2 -std=gnu++98 -I.. -o linksim linksim.cpp ../L2_link.cpp
+// usage : ./linksim [-n runs] [-m mean think time ms] [-f frame time ms] [-s seed]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "L2_link.h"
+#include "L2_peer.h"
+
+#define SIM_NODES               2
+#define SIM_KILL_MIN            60000   //node B is killed in [SIM_KILL_MIN, SIM_KILL_MIN + SIM_KILL_SPAN) ms
+#define SIM_KILL_SPAN           60000
+#define SIM_RUN_MS              600000  //length of a run without the kill
+
+#define SIM_FRAME_DATA          0
+#define SIM_FRAME_ACK           1
+#define SIM_FRAME_PROBE         2
+#define SIM_FRAME_REPLY         3
+
+typedef struct
+{
+    uint8_t kind;
+    uint32_t end;
+} simTx_t;
+
+typedef struct
+{
+    L2_linkCtx_t link;
+    uint8_t alive;
+    uint8_t waitAck;
+    uint8_t ackPending;
+    uint8_t retxCnt;
+    uint32_t ackDeadline;
+    uint32_t nextSdu;
+    uint32_t txEnd;
+    simTx_t tx;             //frame on air (txEnd > now)
+} simNode_t;
+
+typedef struct
+{
+    uint32_t noticeMs;      //kill -> notice at node A
+    uint32_t failedSdu;
+    uint32_t dataFrames;
+    uint32_t ctrlFrames;    //probes and replies
+    uint32_t falseDowns;
+} simResult_t;
+
+static simNode_t nodes[SIM_NODES];
+static double lossP;
+static uint32_t frameMs = 60;
+static double thinkMs = 5000;
+
+static uint64_t rngState = 88172645463325252ULL;
+static double rnd(void)
+{
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return (double)((rngState * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+static uint32_t thinkTime(void)
+{
+    return 1 + (uint32_t)(-thinkMs * log(1.0 - rnd()));
+}
+
+static uint32_t arqWait(void)
+{
+    return L2_ARQ_MINWAITTIME * 1000 + (uint32_t)(rnd() * (L2_ARQ_MAXWAITTIME - L2_ARQ_MINWAITTIME) * 1000);
+}
+
+static void startTx(simNode_t* s, uint8_t kind, uint32_t now, simResult_t* res)
+{
+    s->tx.kind = kind;
+    s->tx.end = now + frameMs;
+    s->txEnd = s->tx.end;
+    if (kind == SIM_FRAME_DATA || kind == SIM_FRAME_ACK)
+        res->dataFrames++;
+    else
+        res->ctrlFrames++;
+}
+
+//SDU of node n done (res : 1 confirmed, 0 failed), the next one after a think time
+static void sduDone(int n, uint8_t ok, uint32_t now, uint32_t killMs, simResult_t* res)
+{
+    simNode_t* s = &nodes[n];
+
+    s->waitAck = 0;
+    s->nextSdu = now + thinkTime();
+    if (ok)
+        return;
+    res->failedSdu++;
+    if (n == 0 && killMs != 0 && now >= killMs && res->noticeMs == 0)
+        res->noticeMs = now - killMs;
+}
+
+static void run(simResult_t* res, uint32_t detectMs, uint32_t killMs)
+{
+    uint32_t endMs = (killMs != 0) ? 0xFFFFFFFF : SIM_RUN_MS;
+    uint32_t now;
+    int n;
+
+    memset(res, 0, sizeof(*res));
+    memset(nodes, 0, sizeof(nodes));
+    for (n = 0; n < SIM_NODES; n++)
+    {
+        L2_link_init(&nodes[n].link, detectMs);
+        nodes[n].alive = 1;
+        nodes[n].nextSdu = thinkTime();
+    }
+
+    for (now = 1; now < endMs; now++)
+    {
+        if (killMs != 0 && now == killMs)
+            nodes[1].alive = 0;
+
+        //end of transmissions : the other node gets the frame unless lost, dead or transmitting
+        for (n = 0; n < SIM_NODES; n++)
+        {
+            simNode_t* s = &nodes[n];
+            simNode_t* r = &nodes[1 - n];
+
+            if (s->txEnd != now || s->alive == 0)
+                continue;
+            if (r->alive == 0 || r->txEnd > now - frameMs || rnd() < lossP)
+                continue;
+
+            if (s->tx.kind == SIM_FRAME_DATA)
+                L2_link_watch(&r->link, (uint8_t)n, now);
+            L2_link_onRx(&r->link, (uint8_t)n, now);
+            switch (s->tx.kind)
+            {
+                case SIM_FRAME_DATA:
+                    r->ackPending = 1;
+                    break;
+                case SIM_FRAME_ACK:
+                    if (r->waitAck)
+                        sduDone(1 - n, 1, now, killMs, res);
+                    break;
+                case SIM_FRAME_PROBE:
+                    L2_link_onProbe(&r->link, (uint8_t)n, now);
+                    break;
+            }
+        }
+
+        for (n = 0; n < SIM_NODES; n++)
+        {
+            simNode_t* s = &nodes[n];
+            uint8_t peer;
+            uint32_t ms;
+
+            if (s->alive == 0)
+                continue;
+
+            //link down : in-flight SDU given up at once, as L2_checkLinks does
+            switch (L2_link_poll(&s->link, now, &peer, &ms))
+            {
+                case L2_LINK_DOWN:
+                    if (killMs == 0)
+                        res->falseDowns++;
+                    if (n == 0 && killMs != 0 && now >= killMs && res->noticeMs == 0)
+                        res->noticeMs = now - killMs;
+                    if (s->waitAck)
+                        sduDone(n, 0, now, killMs, res);
+                    break;
+            }
+
+            //ARQ timer
+            if (s->waitAck && now >= s->ackDeadline)
+            {
+                if (s->retxCnt >= L2_ARQ_MAXRETRANSMISSION || L2_link_isUp(&s->link, (uint8_t)(1 - n)) == 0)
+                    sduDone(n, 0, now, killMs, res);
+                else if (s->txEnd <= now)
+                {
+                    s->retxCnt++;
+                    startTx(s, SIM_FRAME_DATA, now, res);
+                    s->ackDeadline = s->txEnd + arqWait();
+                }
+            }
+
+            if (s->txEnd > now)
+                continue;
+            if (s->ackPending)
+            {
+                s->ackPending = 0;
+                startTx(s, SIM_FRAME_ACK, now, res);
+            }
+            else if (s->waitAck == 0 && now >= s->nextSdu)
+            {
+                L2_link_watch(&s->link, (uint8_t)(1 - n), now);
+                if (L2_link_isUp(&s->link, (uint8_t)(1 - n)) == 0)
+                    sduDone(n, 0, now, killMs, res);
+                else
+                {
+                    s->waitAck = 1;
+                    s->retxCnt = 0;
+                    startTx(s, SIM_FRAME_DATA, now, res);
+                    s->ackDeadline = s->txEnd + arqWait();
+                }
+            }
+            else if (s->waitAck == 0 || now >= s->txEnd + L2_PEER_ACKGUARDMS)
+            {
+                switch (L2_link_getTx(&s->link, now, &peer))
+                {
+                    case L2_LINK_PROBE: startTx(s, SIM_FRAME_PROBE, now, res); break;
+                    case L2_LINK_REPLY: startTx(s, SIM_FRAME_REPLY, now, res); break;
+                }
+            }
+        }
+
+        if (killMs != 0 && res->noticeMs != 0)
+            break;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    static const uint32_t detectTimes[] = {0, 5, 10, 20};
+    static const double losses[] = {0.0, 0.1, 0.3};
+    int numRuns = 200;
+    unsigned li, di;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:m:f:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': numRuns = atoi(optarg); break;
+            case 'm': thinkMs = atof(optarg); break;
+            case 'f': frameMs = (uint32_t)atoi(optarg); break;
+            case 's': rngState = strtoull(optarg, NULL, 0) | 1; srand((unsigned)rngState); break;
+            default:
+                fprintf(stderr, "usage : %s [-n runs] [-m mean think time ms] [-f frame time ms] [-s seed]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (numRuns <= 0 || thinkMs <= 0 || frameMs == 0)
+    {
+        fprintf(stderr, "runs, think time and frame time must be > 0\n");
+        return 1;
+    }
+
+    printf("%i runs, think time %.0f ms, frames %lu ms on air, ARQ %i..%i s x %i retransmissions\n",
+           numRuns, thinkMs, (unsigned long)frameMs, L2_ARQ_MINWAITTIME, L2_ARQ_MAXWAITTIME, L2_ARQ_MAXRETRANSMISSION);
+    printf(" loss | detect | kill -> notice : mean   worst | false downs/h | probes+replies/min | data+ACK/min\n");
+
+    for (li = 0; li < sizeof(losses) / sizeof(losses[0]); li++)
+    {
+        lossP = losses[li];
+        for (di = 0; di < sizeof(detectTimes) / sizeof(detectTimes[0]); di++)
+        {
+            double sum = 0, falseDowns = 0, ctrl = 0, data = 0;
+            uint32_t worst = 0;
+            int i;
+
+            for (i = 0; i < numRuns; i++)
+            {
+                simResult_t r;
+
+                run(&r, detectTimes[di] * 1000, SIM_KILL_MIN + (uint32_t)(rnd() * SIM_KILL_SPAN));
+                sum += r.noticeMs;
+                if (r.noticeMs > worst)
+                    worst = r.noticeMs;
+            }
+            for (i = 0; i < (numRuns + 9) / 10; i++)
+            {
+                simResult_t r;
+
+                run(&r, detectTimes[di] * 1000, 0);
+                falseDowns += r.falseDowns;
+                ctrl += r.ctrlFrames;
+                data += r.dataFrames;
+            }
+
+            {
+                double minutes = (double)SIM_RUN_MS / 60000.0 * ((numRuns + 9) / 10);
+
+                printf("%4.0f%% | %4lus%s |                %6.1fs %6.1fs | %13.2f | %18.2f | %12.2f\n",
+                       100.0 * lossP, (unsigned long)detectTimes[di], detectTimes[di] ? " " : "*",
+                       sum / numRuns / 1000.0, worst / 1000.0, falseDowns / minutes * 60.0, ctrl / minutes, data / minutes);
+            }
+        }
+    }
+    printf("* : no liveness detection, the ARQ giving up is the only notice\n");
+
+    return 0;
+}
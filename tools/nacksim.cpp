@@ -0,0 +1,207 @@
+// Host-side model of the L2 fast retransmission on NACK (L2_peer_nacked) against the ARQ timer alone
+//
+// One node sends single-frame PDUs to another with the stop-and-wait ARQ of the FSM (timer drawn in
+// L2_ARQ_MINWAITTIME..L2_ARQ_MAXWAITTIME, L2_ARQ_MAXRETRANSMISSION retransmissions), one after the
+// other. Each frame is lost with the given frame error rate : part of the failed frames vanish (not
+// even detected), the others arrive damaged (FCS mismatch, L2_FCS_MODE > 0) with the PHY header, hence
+// the sender, intact. The receiver ACKs the PDUs it gets (again if it had them already) and :
+//  - timer : drops damaged frames, the sender retransmits when its timer expires
+//  - NACK  : NACKs a damaged data frame at once, the sender retransmits on the NACK
+// NACKs and ACKs go through the same channel. For each frame error rate : latency (first transmission
+// -> ACK) of the PDUs whose first data frame arrived damaged (what a NACK can recover) and of all the
+// PDUs that needed a retransmission, mean / median / 99th percentile, p99 over all PDUs, frames per
+// PDU and PDUs given up.
+//
+// build : g++ -O2 -std=gnu++98 -I.. -o nacksim nacksim.cpp ../L2_peer.cpp
+// usage : ./nacksim [-n PDUs per point] [-d damaged share of the failed frames] [-f data frame ms] [-a ACK frame ms] [-s seed]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+#include "L2_peer.h"
+
+#define SIM_TURNAROUND_MS       5       //frame end -> ACK / NACK start at the receiver
+#define SIM_PEERID              2
+
+#define SIM_FRAME_OK            0
+#define SIM_FRAME_LOST          1
+#define SIM_FRAME_DAMAGED       2
+
+typedef struct
+{
+    std::vector<uint32_t> recovery;     //latency of the PDUs that needed a retransmission, ms
+    std::vector<uint32_t> damaged;      //those whose first data frame arrived damaged
+    std::vector<uint32_t> all;
+    uint64_t frames;
+    uint32_t failed;
+} simResult_t;
+
+static double ferP;
+static double damagedShare = 0.5;
+static uint32_t dataMs = 71;
+static uint32_t ackMs = 36;
+
+static uint64_t rngState = 88172645463325252ULL;
+static double rnd(void)
+{
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return (double)((rngState * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+static uint32_t arqWait(void)
+{
+    return L2_ARQ_MINWAITTIME * 1000 + (uint32_t)(rnd() * (L2_ARQ_MAXWAITTIME - L2_ARQ_MINWAITTIME) * 1000);
+}
+
+static uint8_t frameOutcome(void)
+{
+    if (rnd() >= ferP)
+        return SIM_FRAME_OK;
+    return (rnd() < damagedShare) ? SIM_FRAME_DAMAGED : SIM_FRAME_LOST;
+}
+
+static void run(simResult_t* res, uint32_t numPdu, uint8_t useNack)
+{
+    L2_peerTable_t tbl;
+    L2_peer_t* peer;
+    uint32_t now = 0;
+    uint32_t i;
+
+    res->recovery.clear();
+    res->damaged.clear();
+    res->all.clear();
+    res->frames = 0;
+    res->failed = 0;
+    L2_peer_init(&tbl);
+    peer = L2_peer_add(&tbl, SIM_PEERID, 0);
+
+    for (i = 0; i < numPdu; i++)
+    {
+        uint32_t start = now;
+        uint8_t retxCnt = 0;
+        uint8_t acked = 0;
+        uint8_t firstDamaged = 0;
+
+        for (;;)
+        {
+            uint8_t data = frameOutcome();
+
+            if (retxCnt == 0)
+                firstDamaged = (data == SIM_FRAME_DAMAGED);
+            //data frame, then the receiver answers right after it (ACK, NACK or nothing)
+            res->frames++;
+            now += dataMs;
+            L2_peer_startWait(peer, now, arqWait());
+            if (data == SIM_FRAME_OK || (useNack && data == SIM_FRAME_DAMAGED))
+            {
+                res->frames++;
+                if (frameOutcome() == SIM_FRAME_OK)
+                {
+                    if (data == SIM_FRAME_OK)
+                    {
+                        now += SIM_TURNAROUND_MS + ackMs;
+                        L2_peer_stopWait(peer);
+                        acked = 1;
+                        break;
+                    }
+                    L2_peer_nacked(peer, now + SIM_TURNAROUND_MS + ackMs);
+                }
+            }
+
+            //timer expired or NACKed : retransmission, or the PDU is given up
+            now = peer->ackDeadlineMs;
+            L2_peer_stopWait(peer);
+            if (retxCnt >= L2_ARQ_MAXRETRANSMISSION)
+                break;
+            retxCnt++;
+        }
+
+        if (acked == 0)
+        {
+            res->failed++;
+            continue;
+        }
+        res->all.push_back(now - start);
+        if (retxCnt > 0)
+            res->recovery.push_back(now - start);
+        if (firstDamaged)
+            res->damaged.push_back(now - start);
+    }
+}
+
+static void printStats(std::vector<uint32_t>& v)
+{
+    double sum = 0;
+    unsigned i;
+
+    if (v.empty())
+    {
+        printf(" %7s %7s %7s |", "-", "-", "-");
+        return;
+    }
+    std::sort(v.begin(), v.end());
+    for (i = 0; i < v.size(); i++)
+        sum += v[i];
+    printf(" %7.2f %7.2f %7.2f |", sum / v.size() / 1000.0, v[v.size() / 2] / 1000.0,
+           v[(size_t)(v.size() * 0.99)] / 1000.0);
+}
+
+int main(int argc, char** argv)
+{
+    static const double fers[] = {0.01, 0.05, 0.1, 0.2, 0.3};
+    uint32_t numPdu = 20000;
+    unsigned fi;
+    int m, opt;
+
+    while ((opt = getopt(argc, argv, "n:d:f:a:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': numPdu = (uint32_t)atol(optarg); break;
+            case 'd': damagedShare = atof(optarg); break;
+            case 'f': dataMs = (uint32_t)atoi(optarg); break;
+            case 'a': ackMs = (uint32_t)atoi(optarg); break;
+            case 's': rngState = strtoull(optarg, NULL, 0) | 1; break;
+            default:
+                fprintf(stderr, "usage : %s [-n PDUs per point] [-d damaged share of the failed frames] [-f data frame ms] [-a ACK frame ms] [-s seed]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (numPdu == 0 || damagedShare < 0 || damagedShare > 1 || dataMs == 0 || ackMs == 0)
+    {
+        fprintf(stderr, "PDUs and frame times must be > 0, damaged share in [0, 1]\n");
+        return 1;
+    }
+
+    printf("%lu PDUs per point, %.0f%% of the failed frames damaged (the others vanish), data %lu ms / ACK %lu ms on air, ARQ %i..%i s x %i retransmissions\n",
+           (unsigned long)numPdu, 100.0 * damagedShare, (unsigned long)dataMs, (unsigned long)ackMs,
+           L2_ARQ_MINWAITTIME, L2_ARQ_MAXWAITTIME, L2_ARQ_MAXRETRANSMISSION);
+    printf(" FER | recovery | first frame damaged (s) : mean  median     p99 | retransmitted (s) : mean  median     p99 | all p99 (s) | frames/PDU | given up\n");
+
+    for (fi = 0; fi < sizeof(fers) / sizeof(fers[0]); fi++)
+    {
+        ferP = fers[fi];
+        for (m = 0; m < 2; m++)
+        {
+            simResult_t r;
+
+            run(&r, numPdu, (uint8_t)m);
+            printf("%3.0f%% | %-8s |                   ", 100.0 * ferP, m ? "NACK" : "timer");
+            printStats(r.damaged);
+            printf("             ");
+            printStats(r.recovery);
+            std::sort(r.all.begin(), r.all.end());
+            printf(" %11.2f | %10.2f | %8lu\n", r.all.empty() ? 0.0 : r.all[(size_t)(r.all.size() * 0.99)] / 1000.0,
+                   (double)r.frames / numPdu, (unsigned long)r.failed);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,18 @@
+#!/bin/sh
+# Builds the full-stack simulator (netsim.cpp) and one node of it (node.so : the firmware + node.cpp)
+# usage : sh build.sh [-DNAME=value ...]   (extra protocol_parameters.h overrides, e.g. -DL3_SPEC_ENABLE=1)
+#
+# The node plays with the random automated player, stores its round snapshots as CFGstore records
+# (kept by the simulator across a reset, the backup SRAM of the target is not simulated) and keeps
+# its round history in RAM (no FlashIAP on the host).
+# -I- : mbed.h of this directory is found instead of the real one next to the firmware sources.
+
+set -e
+cd "$(dirname "$0")"
+SRCS=$(ls ../../*.cpp | grep -v -e '/main.cpp$' -e '/MEMstat.cpp$' -e '/CFGstore.cpp$')
+DEFS="-DL3_AUTOPLAY_STRATEGY=2 -DL3_SNAPSHOT_FLASH=1 -DL3_HISTORY_FLASH=0"
+
+g++ -O1 -std=gnu++98 -fPIC -shared -fno-gnu-unique -funsigned-char $DEFS "$@" -I. -I- -I../.. \
+    -o node.so $SRCS node.cpp 2>&1 | grep -v "obsolete option '-I-'" || true
+test -f node.so
+g++ -O2 -std=gnu++98 -rdynamic -I. -I../.. -o netsim netsim.cpp ../../L2_airtime.cpp -ldl
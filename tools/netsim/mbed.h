@@ -0,0 +1,162 @@
+#ifndef NETSIM_MBED_H
+#define NETSIM_MBED_H
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include "netsim.h"
+
+//the part of the mbed OS 2 API the firmware uses, on the clock and console of netsim.cpp
+//(found before the real mbed.h : build.sh puts this directory first with -I-)
+
+#define USBTX                   0
+#define USBRX                   1
+#define POLY_16BIT_CCITT        0x1021
+
+extern netsim_api_t* netsimApi;
+
+static inline void debug(const char* fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    netsimApi->vlog(netsimApi->node, fmt, ap);
+    va_end(ap);
+}
+
+static inline void debug_if(int cond, const char* fmt, ...)
+{
+    va_list ap;
+
+    if (!cond)
+        return;
+    va_start(ap, fmt);
+    netsimApi->vlog(netsimApi->node, fmt, ap);
+    va_end(ap);
+}
+
+static inline void core_util_critical_section_enter(void) {}
+static inline void core_util_critical_section_exit(void) {}
+static inline void wait_ms(int ms) {}
+static inline void wait(float s) {}
+static inline uint32_t us_ticker_read(void) { return (uint32_t)netsimApi->nowUs(); }
+
+class Serial
+{
+public:
+    enum IrqType { RxIrq = 0, TxIrq };
+
+    Serial(int tx, int rx, int baud = 9600) {}
+    int printf(const char* fmt, ...)
+    {
+        va_list ap;
+
+        va_start(ap, fmt);
+        netsimApi->vlog(netsimApi->node, fmt, ap);
+        va_end(ap);
+        return 0;
+    }
+    int getc(void) { return netsimApi->getc(netsimApi->node); }
+    int putc(int c) { return c; }
+    int readable(void) { return netsimApi->readable(netsimApi->node); }
+    void baud(int baud) {}
+    void attach(void (*fn)(void), IrqType type = RxIrq)
+    {
+        if (type == RxIrq)
+            netsimApi->attachRx(netsimApi->node, fn);
+    }
+};
+
+class RawSerial : public Serial
+{
+public:
+    RawSerial(int tx, int rx, int baud = 9600) : Serial(tx, rx, baud) {}
+};
+
+class Timeout
+{
+public:
+    Timeout() : id(-1) {}
+    void attach(void (*fn)(void), float s) { attach_us(fn, (uint32_t)(s * 1e6f)); }
+    void attach_us(void (*fn)(void), uint32_t us)
+    {
+        detach();
+        id = netsimApi->schedule(netsimApi->node, fn, us);
+    }
+    void detach(void)
+    {
+        if (id >= 0)
+            netsimApi->cancel(id);
+        id = -1;
+    }
+
+private:
+    int id;
+};
+
+class Ticker : public Timeout {};
+
+class Timer
+{
+public:
+    Timer() : running(0), acc(0), t0(0) {}
+    void start(void)
+    {
+        if (!running)
+        {
+            t0 = netsimApi->nowUs();
+            running = 1;
+        }
+    }
+    void stop(void)
+    {
+        if (running)
+        {
+            acc += netsimApi->nowUs() - t0;
+            running = 0;
+        }
+    }
+    void reset(void)
+    {
+        acc = 0;
+        t0 = netsimApi->nowUs();
+    }
+    uint64_t read_high_resolution_us(void) { return acc + (running ? netsimApi->nowUs() - t0 : 0); }
+    int read_ms(void) { return (int)(read_high_resolution_us() / 1000); }
+    int read_us(void) { return (int)read_high_resolution_us(); }
+
+private:
+    int running;
+    uint64_t acc;
+    uint64_t t0;
+};
+
+template <uint32_t polynomial, uint8_t width>
+class MbedCRC
+{
+public:
+    MbedCRC() : init(0xFFFF) {}
+    MbedCRC(uint32_t initial, uint32_t finalXor, bool reflectIn, bool reflectOut) : init(initial) {}
+    int32_t compute(void* buf, uint64_t size, uint32_t* crc)
+    {
+        const uint8_t* p = (const uint8_t*)buf;
+        uint32_t c = init;
+        uint64_t i;
+        int b;
+
+        for (i = 0; i < size; i++)
+        {
+            c ^= (uint32_t)p[i] << (width - 8);
+            for (b = 0; b < 8; b++)
+                c = (c & (1UL << (width - 1))) ? (c << 1) ^ polynomial : (c << 1);
+        }
+        *crc = c & ((1UL << width) - 1);
+        return 0;
+    }
+
+private:
+    uint32_t init;
+};
+#endif
@@ -0,0 +1,563 @@
+// Full-stack host simulator : the whole firmware (L2 + L3 + shell) of several nodes on a shared channel
+//
+// Each node is its own copy of node.so (firmware sources + node.cpp, see build.sh) so that the static
+// state of the firmware is per node. The simulator runs the main loop of every node every
+// NETSIM_STEP_US, fires their Timeouts, and carries their frames : a frame takes the LoRa time on air of
+// SF7 / 125 kHz / CR 4/5 (L2_airtime.cpp), is lost when it overlaps another frame (no capture), and
+// is otherwise lost / bit-flipped independently at each receiver with the given probabilities.
+// CFGstore records are kept by the simulator, so they survive a reset as the flash does.
+// Nodes get IDs 1..N. With 2 players they play each other, with more the broadcast game
+// (destination 255); the last -S nodes are spectators (destination 0). The game is played by the
+// automated player of L3_AUTOPLAY_STRATEGY (build.sh sets one). The console of every node is printed
+// with the simulated time and the node number ("[  12.345] N1| ..."), so its own reports
+// ([RESUME], [SPEC], [AIR], :stats) can be grepped.
+//
+// build : sh build.sh   (netsim and node.so, see there for the protocol_parameters.h overrides)
+// usage : ./netsim [-t seconds] [-n nodes] [-S spectators] [-l frame loss] [-a ACK loss] [-c bit flip]
+//                  [-r node@s (reset)] [-k node@s (power off)] [-i node@s:text (console input)]
+//                  [-s seed] [-q] [node.so]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <map>
+#include <vector>
+#include <deque>
+#include <string>
+
+#include "netsim.h"
+#include "L2_airtime.h"
+
+#define NETSIM_MAXNODES         16
+#define NETSIM_STEP_US          200     //one main loop pass of every node
+#define NETSIM_INPUTGAP_US      100000  //between two console characters
+#define NETSIM_SNR              8       //dB of every received frame
+#define NETSIM_LINELEN          1024
+#define NETSIM_SPECTATE_ID      0       //destination ID of a spectator (L3_SPECTATE_ID)
+#define NETSIM_GROUP_ID         255     //destination ID of the broadcast game
+
+#define NETSIM_EV_TIMER         0
+#define NETSIM_EV_TXEND         1
+
+typedef void (*setApiFn)(netsim_api_t*);
+typedef void (*initFn)(uint8_t, uint8_t);
+typedef void (*stepFn)(void);
+typedef void (*txDoneFn)(int);
+typedef void (*rxFn)(uint8_t, uint8_t*, uint8_t, uint8_t, int8_t);
+
+typedef struct
+{
+    int kind;
+    int id;
+    int node;
+    void (*fn)(void);               //timer
+    uint64_t start;                 //frame : start of the transmission
+    std::vector<uint8_t> data;
+    uint8_t dest;
+} simEvent_t;
+
+typedef struct
+{
+    int node;
+    uint64_t start;
+    uint64_t end;
+} simOnAir_t;
+
+typedef struct
+{
+    void* handle;
+    netsim_api_t api;
+    stepFn step;
+    txDoneFn txDone;
+    rxFn rx;
+    void (*rxIrq)(void);
+    std::deque<char> input;
+    uint64_t lastInputUs;
+    uint8_t id;
+    uint8_t destId;
+    int dead;
+    int gen;                        //copies of node.so loaded (resets)
+    char line[NETSIM_LINELEN];
+    int lineLen;
+} simNode_t;
+
+typedef struct
+{
+    uint64_t atUs;
+    int node;
+    std::string text;
+} simInput_t;
+
+typedef std::multimap<uint64_t, simEvent_t> simQueue_t;
+
+static simNode_t nodes[NETSIM_MAXNODES];
+static int numNodes = 2;
+static int numSpectators = 0;
+static uint64_t nowUs = 0;
+static simQueue_t events;
+static std::map<int, simQueue_t::iterator> eventById;
+static int nextEventId = 1;
+static std::vector<simOnAir_t> onAir;
+static std::map<std::pair<int, int>, std::vector<uint8_t> > nvStore;
+static std::vector<simInput_t> inputs;
+static const char* libPath = "./node.so";
+static char tmpDir[64];
+static unsigned seed = 1;
+static double lossP = 0.0;
+static double ackLossP = -1.0;      //-1 : same as lossP
+static double flipP = 0.0;
+static int quiet = 0;
+static int resetNode = -1;
+static uint64_t resetUs = 0;
+static int killNode = -1;
+static uint64_t killUs = 0;
+
+static uint32_t framesTx = 0;
+static uint32_t collisions = 0;
+static uint32_t framesLost = 0;
+static uint32_t framesFlipped = 0;
+static uint64_t airUs = 0;
+
+
+//the firmware seeds rand() with time(NULL) (L2_LLinterface.cpp) : the simulated clock instead, so that
+//a seed gives the same run again (exported to node.so with -rdynamic, see build.sh)
+extern "C" time_t time(time_t* t)
+{
+    time_t now = (time_t)(seed + nowUs / 1000000);
+
+    if (t != NULL)
+        *t = now;
+    return now;
+}
+
+//API for the nodes -------------------------------------------------------------------
+static void sim_vlog(int node, const char* fmt, va_list ap)
+{
+    simNode_t* n = &nodes[node];
+    char buf[NETSIM_LINELEN];
+    char* p;
+
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    for (p = buf; *p; p++)
+    {
+        if (*p == '\n' || n->lineLen >= NETSIM_LINELEN - 1)
+        {
+            n->line[n->lineLen] = 0;
+            if (!quiet && n->lineLen > 0)
+                printf("[%8.3f] N%i| %s\n", nowUs / 1e6, node, n->line);
+            n->lineLen = 0;
+        }
+        if (*p != '\n')
+            n->line[n->lineLen++] = *p;
+    }
+}
+
+static uint64_t sim_nowUs(void)
+{
+    return nowUs;
+}
+
+static int sim_addEvent(simEvent_t* ev, uint64_t atUs)
+{
+    ev->id = nextEventId++;
+    eventById[ev->id] = events.insert(std::make_pair(atUs, *ev));
+    return ev->id;
+}
+
+static int sim_schedule(int node, void (*fn)(void), uint64_t delayUs)
+{
+    simEvent_t ev;
+
+    ev.kind = NETSIM_EV_TIMER;
+    ev.node = node;
+    ev.fn = fn;
+    ev.start = nowUs;
+    ev.dest = 0;
+    return sim_addEvent(&ev, nowUs + delayUs);
+}
+
+static void sim_cancel(int id)
+{
+    std::map<int, simQueue_t::iterator>::iterator it = eventById.find(id);
+
+    if (it == eventById.end())
+        return;
+    events.erase(it->second);
+    eventById.erase(it);
+}
+
+static int sim_getc(int node)
+{
+    char c;
+
+    if (nodes[node].input.empty())
+        return 0;
+    c = nodes[node].input.front();
+    nodes[node].input.pop_front();
+    return c;
+}
+
+static int sim_readable(int node)
+{
+    return !nodes[node].input.empty();
+}
+
+static void sim_attachRx(int node, void (*fn)(void))
+{
+    nodes[node].rxIrq = fn;
+}
+
+static uint64_t sim_toaUs(uint8_t size)
+{
+    return L2_airtime_getToaUs(7, 0, 1, L2_AIRTIME_PREAMBLELEN, size + L2_AIRTIME_PHYHDR);
+}
+
+static int sim_phyTx(int node, const uint8_t* data, uint8_t size, uint8_t dest)
+{
+    simOnAir_t air;
+    simEvent_t ev;
+    uint64_t toa = sim_toaUs(size);
+
+    air.node = node;
+    air.start = nowUs;
+    air.end = nowUs + toa;
+    onAir.push_back(air);
+
+    ev.kind = NETSIM_EV_TXEND;
+    ev.node = node;
+    ev.fn = NULL;
+    ev.start = nowUs;
+    ev.data.assign(data, data + size);
+    ev.dest = dest;
+    sim_addEvent(&ev, nowUs + toa);
+
+    framesTx++;
+    airUs += toa;
+    return 0;
+}
+
+static int sim_chanBusy(int node)
+{
+    size_t i;
+
+    for (i = 0; i < onAir.size(); i++)
+    {
+        if (onAir[i].node != node && onAir[i].start <= nowUs && onAir[i].end > nowUs)
+            return 1;
+    }
+    return 0;
+}
+
+static int sim_nvLoad(int node, uint8_t type, uint8_t* data, uint8_t len)
+{
+    std::map<std::pair<int, int>, std::vector<uint8_t> >::iterator it = nvStore.find(std::make_pair(node, (int)type));
+
+    if (it == nvStore.end() || it->second.size() != len)
+        return 0;
+    memcpy(data, &it->second[0], len);
+    return 1;
+}
+
+static int sim_nvSave(int node, uint8_t type, const uint8_t* data, uint8_t len)
+{
+    nvStore[std::make_pair(node, (int)type)].assign(data, data + len);
+    return 1;
+}
+
+
+//nodes and channel -------------------------------------------------------------------
+static double rnd(void)
+{
+    return (double)rand() / ((double)RAND_MAX + 1.0);
+}
+
+//loads a fresh copy of node.so for the node (boot, or reboot after a reset)
+static void sim_loadNode(int node)
+{
+    simNode_t* n = &nodes[node];
+    char path[128];
+    char cmd[512];
+
+    snprintf(path, sizeof(path), "%s/node_%i_%i.so", tmpDir, node, n->gen++);
+    snprintf(cmd, sizeof(cmd), "cp '%s' '%s'", libPath, path);
+    if (system(cmd) != 0 || (n->handle = dlopen(path, RTLD_NOW | RTLD_LOCAL)) == NULL)
+    {
+        fprintf(stderr, "cannot load %s : %s\n", libPath, dlerror());
+        exit(1);
+    }
+    unlink(path);
+
+    n->api.node = node;
+    n->api.vlog = sim_vlog;
+    n->api.nowUs = sim_nowUs;
+    n->api.schedule = sim_schedule;
+    n->api.cancel = sim_cancel;
+    n->api.getc = sim_getc;
+    n->api.readable = sim_readable;
+    n->api.attachRx = sim_attachRx;
+    n->api.phyTx = sim_phyTx;
+    n->api.chanBusy = sim_chanBusy;
+    n->api.nvLoad = sim_nvLoad;
+    n->api.nvSave = sim_nvSave;
+    n->rxIrq = NULL;
+    n->lineLen = 0;
+
+    ((setApiFn)dlsym(n->handle, NETSIM_SYM_SETAPI))(&n->api);
+    n->step = (stepFn)dlsym(n->handle, NETSIM_SYM_STEP);
+    n->txDone = (txDoneFn)dlsym(n->handle, NETSIM_SYM_TXDONE);
+    n->rx = (rxFn)dlsym(n->handle, NETSIM_SYM_RX);
+    ((initFn)dlsym(n->handle, NETSIM_SYM_INIT))(n->id, n->destId);
+}
+
+//the node reboots : its timers and frame on air are gone, the records it stored stay
+static void sim_resetNode(int node)
+{
+    simQueue_t::iterator it;
+    size_t i;
+
+    for (it = events.begin(); it != events.end(); )
+    {
+        if (it->second.node == node)
+        {
+            eventById.erase(it->second.id);
+            events.erase(it++);
+        }
+        else
+            ++it;
+    }
+    for (i = 0; i < onAir.size(); )
+    {
+        if (onAir[i].node == node)
+            onAir.erase(onAir.begin() + i);
+        else
+            i++;
+    }
+    dlclose(nodes[node].handle);
+    printf("[%8.3f] *** node %i reset\n", nowUs / 1e6, node);
+    sim_loadNode(node);
+}
+
+//end of a transmission : confirmed to the sender, delivered to the receivers unless it collided
+static void sim_txEnd(simEvent_t* ev)
+{
+    int collided = 0;
+    int i;
+    size_t k;
+
+    nodes[ev->node].txDone(0);
+
+    for (k = 0; k < onAir.size(); k++)
+    {
+        if (onAir[k].node != ev->node && onAir[k].start < nowUs && onAir[k].end > ev->start)
+            collided = 1;
+    }
+    for (k = 0; k < onAir.size(); )
+    {
+        if (onAir[k].end + 10000000ULL < nowUs)     //kept a while for the overlap checks of later frames
+            onAir.erase(onAir.begin() + k);
+        else
+            k++;
+    }
+    if (collided)
+    {
+        collisions++;
+        if (!quiet)
+            printf("[%8.3f] *** frame of node %i collided\n", nowUs / 1e6, ev->node);
+        return;
+    }
+
+    for (i = 0; i < numNodes; i++)
+    {
+        std::vector<uint8_t> data = ev->data;
+        double p = (ackLossP >= 0 && data[0] == 0) ? ackLossP : lossP;     //type 0 : ACK
+
+        if (i == ev->node || nodes[i].dead)
+            continue;
+        if (ev->dest != NETSIM_GROUP_ID && ev->dest != nodes[i].id)
+            continue;
+        if (rnd() < p)
+        {
+            framesLost++;
+            continue;
+        }
+        if (rnd() < flipP)
+        {
+            data[rand() % data.size()] ^= (uint8_t)(1 << (rand() % 8));
+            framesFlipped++;
+        }
+        nodes[i].rx(nodes[ev->node].id, &data[0], (uint8_t)data.size(), ev->dest == NETSIM_GROUP_ID, NETSIM_SNR);
+    }
+}
+
+static int sim_parseNodeTime(const char* arg, int* node, uint64_t* us)
+{
+    double s;
+
+    if (sscanf(arg, "%i@%lf", node, &s) != 2 || *node < 0 || s < 0)
+        return 0;
+    *us = (uint64_t)(s * 1e6);
+    return 1;
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "usage : %s [-t seconds] [-n nodes] [-S spectators] [-l frame loss] [-a ACK loss] [-c bit flip]\n"
+                    "          [-r node@s] [-k node@s] [-i node@s:text] [-s seed] [-q] [node.so]\n", prog);
+}
+
+int main(int argc, char** argv)
+{
+    double seconds = 600;
+    uint64_t endUs;
+    int numPlayers;
+    int opt, i;
+
+    while ((opt = getopt(argc, argv, "t:n:S:l:a:c:r:k:i:s:q")) != -1)
+    {
+        switch (opt)
+        {
+            case 't': seconds = atof(optarg); break;
+            case 'n': numNodes = atoi(optarg); break;
+            case 'S': numSpectators = atoi(optarg); break;
+            case 'l': lossP = atof(optarg); break;
+            case 'a': ackLossP = atof(optarg); break;
+            case 'c': flipP = atof(optarg); break;
+            case 's': seed = (unsigned)strtoul(optarg, NULL, 0); break;
+            case 'q': quiet = 1; break;
+            case 'r':
+                if (!sim_parseNodeTime(optarg, &resetNode, &resetUs))
+                {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'k':
+                if (!sim_parseNodeTime(optarg, &killNode, &killUs))
+                {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'i':
+            {
+                simInput_t in;
+                const char* colon = strchr(optarg, ':');
+
+                if (colon == NULL || !sim_parseNodeTime(optarg, &in.node, &in.atUs))
+                {
+                    usage(argv[0]);
+                    return 1;
+                }
+                in.text = std::string(colon + 1) + "\n";
+                inputs.push_back(in);
+                break;
+            }
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (optind < argc)
+        libPath = argv[optind];
+    numPlayers = numNodes - numSpectators;
+    if (numNodes < 2 || numNodes > NETSIM_MAXNODES || numPlayers < 2 || resetNode >= numNodes || killNode >= numNodes)
+    {
+        fprintf(stderr, "2..%i nodes, 2 players or more\n", NETSIM_MAXNODES);
+        return 1;
+    }
+    for (i = 0; i < (int)inputs.size(); i++)
+    {
+        if (inputs[i].node >= numNodes)
+        {
+            fprintf(stderr, "no node %i\n", inputs[i].node);
+            return 1;
+        }
+    }
+
+    strcpy(tmpDir, "/tmp/netsimXXXXXX");
+    if (mkdtemp(tmpDir) == NULL)
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+    srand(seed);
+    for (i = 0; i < numNodes; i++)
+    {
+        nodes[i].id = (uint8_t)(i + 1);
+        if (i >= numPlayers)
+            nodes[i].destId = NETSIM_SPECTATE_ID;
+        else if (numPlayers == 2)
+            nodes[i].destId = (uint8_t)(2 - i);
+        else
+            nodes[i].destId = NETSIM_GROUP_ID;
+        nodes[i].dead = 0;
+        nodes[i].gen = 0;
+        nodes[i].lastInputUs = 0;
+        sim_loadNode(i);
+    }
+
+    endUs = (uint64_t)(seconds * 1e6);
+    while (nowUs < endUs)
+    {
+        if (resetNode >= 0 && nowUs >= resetUs)
+        {
+            sim_resetNode(resetNode);
+            resetNode = -1;
+        }
+        if (killNode >= 0 && nowUs >= killUs)
+        {
+            nodes[killNode].dead = 1;
+            printf("[%8.3f] *** node %i powered off\n", nowUs / 1e6, killNode);
+            killNode = -1;
+        }
+        for (i = 0; i < (int)inputs.size(); )
+        {
+            if (nowUs >= inputs[i].atUs)
+            {
+                nodes[inputs[i].node].input.insert(nodes[inputs[i].node].input.end(), inputs[i].text.begin(), inputs[i].text.end());
+                inputs.erase(inputs.begin() + i);
+            }
+            else
+                i++;
+        }
+
+        for (i = 0; i < numNodes; i++)
+        {
+            simNode_t* n = &nodes[i];
+
+            if (n->dead)
+                continue;
+            if (!n->input.empty() && n->rxIrq != NULL && nowUs - n->lastInputUs >= NETSIM_INPUTGAP_US)
+            {
+                n->lastInputUs = nowUs;
+                n->rxIrq();
+            }
+            n->step();
+        }
+
+        nowUs += NETSIM_STEP_US;
+        while (!events.empty() && events.begin()->first <= nowUs)
+        {
+            simEvent_t ev = events.begin()->second;
+
+            eventById.erase(ev.id);
+            events.erase(events.begin());
+            if (nodes[ev.node].dead)
+                continue;
+            if (ev.kind == NETSIM_EV_TIMER)
+                ev.fn();
+            else
+                sim_txEnd(&ev);
+        }
+    }
+
+    printf("SIM END t=%.1f s : %lu frames (%.1f s on air), %lu collided, %lu lost, %lu bit-flipped\n", nowUs / 1e6,
+           (unsigned long)framesTx, airUs / 1e6, (unsigned long)collisions, (unsigned long)framesLost, (unsigned long)framesFlipped);
+    rmdir(tmpDir);
+    return 0;
+}
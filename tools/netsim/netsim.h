@@ -0,0 +1,28 @@
+#include <stdint.h>
+#include <stdarg.h>
+
+//interface between the simulator (netsim.cpp) and one node (node.cpp linked with the firmware into node.so)
+//The simulator owns the clock, the channel and the storage that survives a reset; each node loads its
+//own copy of node.so, so the static state of the firmware is per node and a reset reloads it.
+typedef struct
+{
+    int node;
+    void (*vlog)(int node, const char* fmt, va_list ap);            //console output of the node
+    uint64_t (*nowUs)(void);
+    int (*schedule)(int node, void (*fn)(void), uint64_t delayUs);  //Timeout : returns an id for cancel
+    void (*cancel)(int id);
+    int (*getc)(int node);                                          //console input
+    int (*readable)(int node);
+    void (*attachRx)(int node, void (*fn)(void));
+    int (*phyTx)(int node, const uint8_t* data, uint8_t size, uint8_t dest);
+    int (*chanBusy)(int node);                                      //another node is on air (CSMA)
+    int (*nvLoad)(int node, uint8_t type, uint8_t* data, uint8_t len);  //CFGstore records
+    int (*nvSave)(int node, uint8_t type, const uint8_t* data, uint8_t len);
+} netsim_api_t;
+
+//entry points of node.so (extern "C", looked up with dlsym)
+#define NETSIM_SYM_SETAPI       "netsim_setApi"
+#define NETSIM_SYM_INIT         "netsim_init"
+#define NETSIM_SYM_STEP         "netsim_step"
+#define NETSIM_SYM_TXDONE       "netsim_txDone"
+#define NETSIM_SYM_RX           "netsim_rx"
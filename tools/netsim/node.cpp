@@ -0,0 +1,114 @@
+// One node of the full-stack simulator : the hardware the firmware expects, on the API of netsim.cpp
+//
+// Linked with the firmware sources (all but main.cpp, MEMstat.cpp and CFGstore.cpp) into node.so by
+// build.sh. phymac frames go to the simulated channel, CFGstore records to a store of the simulator
+// that survives a reset (as the flash does), MEMstat is left out (linker symbols of the target).
+
+#include "mbed.h"
+#include "L2_FSMmain.h"
+#include "L3_FSMmain.h"
+#include "CMDshell.h"
+#include "CFGstore.h"
+#include "MEMstat.h"
+#include "PHYMAC_layer.h"
+
+#define NODE_SNR                8       //dB reported for every received frame
+#define NODE_RSSI               -60     //dBm
+
+netsim_api_t* netsimApi;
+
+static void (*dataCnfFunc)(int);
+static void (*dataIndFunc)(uint8_t, uint8_t*, uint8_t, uint8_t);
+static int8_t rxSnr = NODE_SNR;
+
+
+//PHY / MAC -------------------------------------------------------------------------
+void phymac_init(uint8_t id, void (*cnfFunc)(int), void (*indFunc)(uint8_t, uint8_t*, uint8_t, uint8_t))
+{
+    dataCnfFunc = cnfFunc;
+    dataIndFunc = indFunc;
+}
+
+int phymac_dataReq(uint8_t* dataPtr, uint8_t size, uint8_t destId)
+{
+    return netsimApi->phyTx(netsimApi->node, dataPtr, size, destId);
+}
+
+int16_t phymac_getDataRssi(void) { return NODE_RSSI; }
+int8_t phymac_getDataSnr(void) { return rxSnr; }
+int phymac_configSrcId(uint8_t id) { return 0; }
+void phymac_startRx(void) {}
+
+int HAL_cmd_Sleep(void) { return 0; }
+bool HAL_isSignalDetected(void) { return false; }
+bool HAL_isRxOngoing(void) { return false; }
+bool HW_IsChannelFree(unsigned long freq, short rssiThreshold) { return !netsimApi->chanBusy(netsimApi->node); }
+
+//MEMstat : needs the linker symbols and the MSP of the target ---------------------------
+void MEMstat_init(void) {}
+void MEMstat_sampleIsrStack(void) {}
+void MEMstat_registerStatic(const char* name, uint32_t size) {}
+uint32_t MEMstat_getStackPeak(void) { return 0; }
+void MEMstat_requestReport(void) {}
+void MEMstat_run(void) {}
+void MEMstat_printReport(void) {}
+
+//CFGstore : no stored configuration, records kept by the simulator -----------------------
+uint8_t CFGstore_init(void) { return 0; }
+uint8_t CFGstore_load(CFGstore_t* cfg) { return 0; }
+uint8_t CFGstore_save(const CFGstore_t* cfg) { return 0; }
+uint8_t CFGstore_erase(void) { return 0; }
+void CFGstore_capture(CFGstore_t* cfg) {}
+void CFGstore_apply(const CFGstore_t* cfg) {}
+uint16_t CFGstore_getSaveCount(void) { return 0; }
+uint8_t CFGstore_makeRoom(uint32_t slots) { return 0; }
+
+uint8_t CFGstore_loadRecord(uint8_t type, uint8_t* data, uint8_t len)
+{
+    return (uint8_t)netsimApi->nvLoad(netsimApi->node, type, data, len);
+}
+
+uint8_t CFGstore_saveRecord(uint8_t type, const uint8_t* data, uint8_t len)
+{
+    return (uint8_t)netsimApi->nvSave(netsimApi->node, type, data, len);
+}
+
+uint8_t CFGstore_appendRecord(uint8_t type, const uint8_t* data, uint8_t len)
+{
+    return CFGstore_saveRecord(type, data, len);
+}
+
+//entry points of the simulator -----------------------------------------------------------
+extern "C"
+{
+void netsim_setApi(netsim_api_t* api)
+{
+    netsimApi = api;
+}
+
+//what main.cpp does after reading the IDs from the console
+void netsim_init(uint8_t id, uint8_t destId)
+{
+    L2_initFSM(id);
+    L3_initFSM(id, destId);
+}
+
+//one pass of the main loop of main.cpp
+void netsim_step(void)
+{
+    L3_FSMrun();
+    L2_FSMrun();
+    CMDshell_run();
+}
+
+void netsim_txDone(int err)
+{
+    dataCnfFunc(err);
+}
+
+void netsim_rx(uint8_t srcId, uint8_t* data, uint8_t size, uint8_t broadcast, int8_t snr)
+{
+    rxSnr = snr;
+    dataIndFunc(srcId, data, size, broadcast);
+}
+}
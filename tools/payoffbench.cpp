@@ -0,0 +1,208 @@
+// Host-side benchmark of the payoff rules : table lookup against the old if/else chain
+//
+// Times L3_payoff_applyChoice / L3_payoff_applyPrediction of the firmware (L3_payoff.cpp, one
+// ratio table lookup) against the if/else chain checkAndShowResult used before the tables,
+// both calling L3_sentence_scale, on the same pregenerated random rounds (choices and prediction
+// hits are random so that the branches of the chain are not predictable). Reports ns and TSC
+// cycles per round. Both versions are first checked to give the same sentence for every
+// combination (classic rule set, L3_PAYOFF_RULESET 0 : the chain only knows these rules).
+//
+// build : g++ -O2 -std=gnu++98 -I.. -o payoffbench payoffbench.cpp ../L3_payoff.cpp ../L3_sentence.cpp
+// usage : ./payoffbench [-n rounds per pass] [-p passes]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAS_TSC   1
+#else
+#define BENCH_HAS_TSC   0
+#endif
+
+#include "L3_payoff.h"
+#include "L3_sentence.h"
+#include "protocol_parameters.h"
+
+//one round of input : my choice, peer choice, prediction hit (-1 : no prediction this round)
+typedef struct
+{
+    uint8_t myChoice;
+    uint8_t peerChoice;
+    int8_t hit;
+} Round;
+
+
+//the rules as checkAndShowResult computed them before L3_payoff.cpp (out of line like the firmware calls)
+__attribute__((noinline)) static uint32_t chainPrediction(uint32_t sentence, int hit)
+{
+    if (hit)
+        sentence = L3_sentence_scale(sentence, 2, 3);
+    else
+        sentence = L3_sentence_scale(sentence, 4, 3);
+    return sentence;
+}
+
+__attribute__((noinline)) static uint32_t chainChoice(uint32_t sentence, int myChoice, int peerChoice)
+{
+    if (myChoice == 1 && peerChoice == 1)
+        sentence = L3_sentence_scale(sentence, 1, 3);
+    else if (myChoice == 1 && peerChoice == 2)
+        sentence = L3_sentence_scale(sentence, 2, 1);
+    else if (myChoice == 2 && peerChoice == 1)
+        sentence = L3_sentence_scale(sentence, 1, 2);
+    else
+        sentence = L3_sentence_scale(sentence, 3, 2);
+    return sentence;
+}
+
+static uint32_t runChain(const Round* r, size_t num)
+{
+    uint32_t sentence = L3_SENTENCE_INIT;
+    size_t i;
+
+    for (i = 0; i < num; i++)
+    {
+        if (r[i].hit >= 0)
+            sentence = chainPrediction(sentence, r[i].hit);
+        sentence = chainChoice(sentence, r[i].myChoice, r[i].peerChoice);
+        if (sentence == 0 || sentence >= L3_SENTENCE_MAX) //keep the sentence in the range a game plays in
+            sentence = L3_SENTENCE_INIT;
+    }
+    return sentence;
+}
+
+static uint32_t runTable(const Round* r, size_t num)
+{
+    uint32_t sentence = L3_SENTENCE_INIT;
+    size_t i;
+
+    for (i = 0; i < num; i++)
+    {
+        if (r[i].hit >= 0)
+            sentence = L3_payoff_applyPrediction(sentence, r[i].hit);
+        sentence = L3_payoff_applyChoice(sentence, r[i].myChoice, r[i].peerChoice);
+        if (sentence == 0 || sentence >= L3_SENTENCE_MAX)
+            sentence = L3_SENTENCE_INIT;
+    }
+    return sentence;
+}
+
+static uint64_t nowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+//every (sentence, choices, hit) combination on a spread of sentences : number of mismatches
+static int checkSame(void)
+{
+    static const uint32_t sentences[] = {0, 1, 2, 3, 999, 1000, 7500, L3_SENTENCE_INIT, 123457, L3_SENTENCE_MAX - 1, L3_SENTENCE_MAX};
+    int bad = 0;
+    size_t s;
+    int me, peer, hit;
+
+    for (s = 0; s < sizeof(sentences) / sizeof(sentences[0]); s++)
+    {
+        for (hit = 0; hit < 2; hit++)
+            bad += (chainPrediction(sentences[s], hit) != L3_payoff_applyPrediction(sentences[s], hit));
+        for (me = 1; me <= 2; me++)
+            for (peer = 1; peer <= 2; peer++)
+                bad += (chainChoice(sentences[s], me, peer) != L3_payoff_applyChoice(sentences[s], me, peer));
+    }
+    return bad;
+}
+
+int main(int argc, char** argv)
+{
+    size_t num = 1000000;
+    int passes = 5;
+    Round* rounds;
+    volatile uint32_t sink = 0;
+    const char* names[2] = {"if/else chain", "table lookup"};
+    double best[2][2];
+    size_t i;
+    int p, v;
+
+    for (p = 1; p < argc; p++)
+    {
+        if (!strcmp(argv[p], "-n") && p + 1 < argc)
+            num = (size_t)atol(argv[++p]);
+        else if (!strcmp(argv[p], "-p") && p + 1 < argc)
+            passes = atoi(argv[++p]);
+        else
+        {
+            printf("usage : %s [-n rounds per pass] [-p passes]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (L3_PAYOFF_RULESET != L3_PAYOFF_RULESET_CLASSIC)
+    {
+        printf("L3_PAYOFF_RULESET is not the classic rule set : the if/else chain does not apply\n");
+        return 1;
+    }
+    if (checkSame() != 0)
+    {
+        printf("table and chain give different sentences\n");
+        return 1;
+    }
+
+    rounds = (Round*)malloc(num * sizeof(Round));
+    if (rounds == NULL)
+        return 1;
+    srand(1);
+    for (i = 0; i < num; i++)
+    {
+        rounds[i].myChoice = (uint8_t)(1 + rand() % 2);
+        rounds[i].peerChoice = (uint8_t)(1 + rand() % 2);
+        rounds[i].hit = (int8_t)((rand() % 4 == 0) ? rand() % 2 : -1); //a prediction in a quarter of the rounds
+    }
+    if (runChain(rounds, num) != runTable(rounds, num))
+    {
+        printf("table and chain diverge on the random rounds\n");
+        return 1;
+    }
+
+    //best of the passes, the two versions alternating so that both see the same machine state
+    for (v = 0; v < 2; v++)
+        best[v][0] = best[v][1] = 1e30;
+    for (p = 0; p < passes; p++)
+    {
+        for (v = 0; v < 2; v++)
+        {
+            uint64_t t0, t1, c0 = 0, c1 = 0;
+
+            t0 = nowNs();
+#if BENCH_HAS_TSC
+            c0 = __rdtsc();
+#endif
+            sink += (v == 0) ? runChain(rounds, num) : runTable(rounds, num);
+#if BENCH_HAS_TSC
+            c1 = __rdtsc();
+#endif
+            t1 = nowNs();
+            if ((t1 - t0) / (double)num < best[v][0])
+                best[v][0] = (t1 - t0) / (double)num;
+            if ((c1 - c0) / (double)num < best[v][1])
+                best[v][1] = (c1 - c0) / (double)num;
+        }
+    }
+
+    printf("%lu rounds per pass, best of %d passes\n", (unsigned long)num, passes);
+    for (v = 0; v < 2; v++)
+    {
+        if (BENCH_HAS_TSC)
+            printf("%-14s : %6.2f ns/round  %6.2f cycles/round\n", names[v], best[v][0], best[v][1]);
+        else
+            printf("%-14s : %6.2f ns/round\n", names[v], best[v][0]);
+    }
+    printf("table / chain  : %.2f\n", best[1][0] / best[0][0]);
+
+    free(rounds);
+    return (int)(sink & 0);
+}
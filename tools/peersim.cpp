@@ -0,0 +1,397 @@
+// Host-side model of the per-peer ARQ contexts (L2_peer.cpp) : head-of-line blocking behind a stalled peer
+//
+// One node sends SDUs to 2..4 peers (Poisson arrivals per peer), with stop-and-wait ARQ per PDU as the
+// FSM does (timer drawn in L2_ARQ_MINWAITTIME..L2_ARQ_MAXWAITTIME, L2_ARQ_MAXRETRANSMISSION
+// retransmissions). Peer 0 may be stalled (switched off : it never answers). Data frames and ACKs are
+// lost independently on the healthy links, and the sender does not hear an ACK while it transmits.
+// Two schedulers :
+//  - shared : one queue of L2_TXQUEUE_SIZE SDUs and one PDU in flight for all peers (the FSM before
+//    the neighbour table) : every SDU waits behind the retransmissions to the stalled peer
+//  - per-peer : the neighbour table of the FSM (L2_peer_next round-robin, one queue and one PDU in
+//    flight per peer, ACK guard after each frame)
+// For each : SDUs delivered to the healthy peers, their latency (arrival -> ACK, mean / 95th percentile),
+// SDUs dropped because their queue was full, and SDUs given up on the stalled peer.
+//
+// build : g++ -O2 -std=gnu++98 -I.. -o peersim peersim.cpp ../L2_peer.cpp
+// usage : ./peersim [-p peers] [-i mean SDU interval per peer ms] [-t simulated s] [-f data frame ms] [-a ACK frame ms] [-s seed]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "L2_peer.h"
+
+#define SIM_MAXPEERS            (L2_PEER_MAXPEERS)
+#define SIM_TXQUEUE_SIZE        4       //L2_TXQUEUE_SIZE of the FSM
+#define SIM_TURNAROUND_MS       5       //data frame end -> ACK start at the receiver
+#define SIM_MAXSDU              250     //SDUs alive at the same time (handles 0..249)
+#define SIM_MAXLAT              200000
+
+typedef struct
+{
+    uint8_t peer;
+    uint32_t arrivalMs;
+} simSdu_t;
+
+typedef struct
+{
+    uint32_t delivered;
+    uint32_t dropped;       //queue full
+    uint32_t failed;        //max retransmissions reached
+} simCount_t;
+
+typedef struct
+{
+    simCount_t healthy;
+    simCount_t stalled;
+    double latMean;
+    double latP95;
+} simResult_t;
+
+static int numPeers = 3;
+static double sduIntervalMs = 10000;
+static uint32_t simMs = 3600000;
+static uint32_t dataMs = 71;
+static uint32_t ackMs = 36;
+static double lossP;
+static uint8_t stalledOn;
+
+static simSdu_t sdus[SIM_MAXSDU];
+static uint8_t sduUsed[SIM_MAXSDU];
+static uint32_t lat[SIM_MAXLAT];
+static uint32_t numLat;
+
+static uint64_t rngState = 88172645463325252ULL;
+static uint64_t arrivalSeed;
+static uint64_t arrivalState;   //SDU arrivals drawn apart : the same for both schedulers
+static double rndFrom(uint64_t* state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return (double)((*state * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+static double rnd(void)
+{
+    return rndFrom(&rngState);
+}
+
+static uint32_t interArrival(void)
+{
+    return 1 + (uint32_t)(-sduIntervalMs * log(1.0 - rndFrom(&arrivalState)));
+}
+
+static uint32_t arqWait(void)
+{
+    return 1000 * (L2_ARQ_MINWAITTIME + (uint32_t)(rnd() * (L2_ARQ_MAXWAITTIME - L2_ARQ_MINWAITTIME)));
+}
+
+static uint8_t isStalled(int p)
+{
+    return (stalledOn && p == 0);
+}
+
+static uint8_t allocSdu(int p, uint32_t now)
+{
+    uint8_t i;
+
+    for (i = 0; i < SIM_MAXSDU; i++)
+    {
+        if (sduUsed[i] == 0)
+        {
+            sduUsed[i] = 1;
+            sdus[i].peer = (uint8_t)p;
+            sdus[i].arrivalMs = now;
+            return i;
+        }
+    }
+    return L2_PEER_NOSDU;
+}
+
+static simCount_t* countOf(simResult_t* res, int p)
+{
+    return isStalled(p) ? &res->stalled : &res->healthy;
+}
+
+static void sduDone(simResult_t* res, uint8_t sdu, uint8_t ok, uint32_t now)
+{
+    int p = sdus[sdu].peer;
+
+    sduUsed[sdu] = 0;
+    if (ok == 0)
+    {
+        countOf(res, p)->failed++;
+        return;
+    }
+    countOf(res, p)->delivered++;
+    if (isStalled(p) == 0 && numLat < SIM_MAXLAT)
+        lat[numLat++] = now - sdus[sdu].arrivalMs;
+}
+
+//data frame to p sent in [start, end) : the ACK reaches the sender at the returned time, 0 if it does not
+static uint32_t ackTime(int p, uint32_t end)
+{
+    if (isStalled(p) || rnd() < lossP || rnd() < lossP)
+        return 0;
+    return end + SIM_TURNAROUND_MS + ackMs;
+}
+
+static int cmpU32(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+
+    return (x > y) - (x < y);
+}
+
+static void finish(simResult_t* res)
+{
+    double sum = 0;
+    uint32_t i;
+
+    for (i = 0; i < numLat; i++)
+        sum += lat[i];
+    res->latMean = numLat ? sum / numLat : 0;
+    qsort(lat, numLat, sizeof(lat[0]), cmpU32);
+    res->latP95 = numLat ? lat[(numLat * 95) / 100] : 0;
+}
+
+static void reset(simResult_t* res, uint32_t* nextArrival)
+{
+    int p;
+
+    memset(res, 0, sizeof(*res));
+    memset(sduUsed, 0, sizeof(sduUsed));
+    numLat = 0;
+    arrivalState = arrivalSeed;
+    for (p = 0; p < numPeers; p++)
+        nextArrival[p] = interArrival();
+}
+
+//one queue, one PDU in flight
+static void runShared(simResult_t* res)
+{
+    uint32_t nextArrival[SIM_MAXPEERS];
+    uint8_t queue[SIM_TXQUEUE_SIZE];
+    uint8_t qHead = 0, qLen = 0;
+    uint8_t cur = L2_PEER_NOSDU;
+    uint8_t retxCnt = 0;
+    uint32_t txEnd = 0, ackAt = 0, deadline = 0;
+    uint8_t waiting = 0;
+    uint32_t now;
+    int p;
+
+    reset(res, nextArrival);
+    for (now = 1; now < simMs; now++)
+    {
+        for (p = 0; p < numPeers; p++)
+        {
+            uint8_t sdu;
+
+            if (now < nextArrival[p])
+                continue;
+            nextArrival[p] = now + interArrival();
+            if (qLen >= SIM_TXQUEUE_SIZE || (sdu = allocSdu(p, now)) == L2_PEER_NOSDU)
+            {
+                countOf(res, p)->dropped++;
+                continue;
+            }
+            queue[(qHead + qLen++) % SIM_TXQUEUE_SIZE] = sdu;
+        }
+
+        if (now == txEnd && cur != L2_PEER_NOSDU)
+        {
+            ackAt = ackTime(sdus[cur].peer, now);
+            deadline = now + arqWait();
+            waiting = 1;
+        }
+        if (waiting && ackAt != 0 && now == ackAt)
+        {
+            waiting = 0;
+            sduDone(res, cur, 1, now);
+            cur = L2_PEER_NOSDU;
+        }
+        if (waiting && now >= deadline)
+        {
+            waiting = 0;
+            if (retxCnt >= L2_ARQ_MAXRETRANSMISSION)
+            {
+                sduDone(res, cur, 0, now);
+                cur = L2_PEER_NOSDU;
+            }
+            else
+            {
+                retxCnt++;
+                txEnd = now + dataMs;
+            }
+        }
+
+        if (cur == L2_PEER_NOSDU && qLen > 0)
+        {
+            cur = queue[qHead];
+            qHead = (qHead + 1) % SIM_TXQUEUE_SIZE;
+            qLen--;
+            retxCnt = 0;
+            txEnd = now + dataMs;
+        }
+    }
+    finish(res);
+}
+
+//neighbour table of the FSM
+static void runPerPeer(simResult_t* res)
+{
+    static L2_peerTable_t tbl;
+    uint32_t nextArrival[SIM_MAXPEERS];
+    uint32_t ackAt[SIM_MAXPEERS];
+    L2_peer_t* txPeer = NULL;
+    uint32_t txEnd = 0;
+    uint32_t now;
+    int p;
+
+    reset(res, nextArrival);
+    memset(ackAt, 0, sizeof(ackAt));
+    L2_peer_init(&tbl);
+
+    for (now = 1; now < simMs; now++)
+    {
+        L2_peer_t* peer;
+
+        for (p = 0; p < numPeers; p++)
+        {
+            uint8_t sdu;
+
+            if (now < nextArrival[p])
+                continue;
+            nextArrival[p] = now + interArrival();
+            peer = L2_peer_add(&tbl, (uint8_t)(p + 2), now);
+            if (peer == NULL || (sdu = allocSdu(p, now)) == L2_PEER_NOSDU)
+            {
+                countOf(res, p)->dropped++;
+                continue;
+            }
+            if (L2_peer_enqueue(&tbl, peer, sdu) != 0)
+            {
+                sduUsed[sdu] = 0;
+                countOf(res, p)->dropped++;
+            }
+        }
+
+        //end of our frame : its ACK is awaited
+        if (txPeer != NULL && now == txEnd)
+        {
+            ackAt[txPeer->id - 2] = ackTime(txPeer->id - 2, now);
+            L2_peer_startWait(txPeer, now, arqWait());
+            txPeer = NULL;
+        }
+        //ACKs : heard unless we were sending
+        for (p = 0; p < numPeers; p++)
+        {
+            if (ackAt[p] != now)
+                continue;
+            ackAt[p] = 0;
+            peer = L2_peer_find(&tbl, (uint8_t)(p + 2));
+            if (peer != NULL && peer->waitAck && (txPeer == NULL || txEnd - dataMs >= now || txEnd <= now - ackMs))
+            {
+                L2_peer_stopWait(peer);
+                sduDone(res, peer->txSdu, 1, now);
+                peer->txSdu = L2_PEER_NOSDU;
+            }
+        }
+        if (txPeer != NULL)
+            continue;
+
+        //as the FSM in IDLE : ACK guard, timeouts, then new data
+        if (L2_peer_inAckGuard(&tbl, now))
+            continue;
+        if ((peer = L2_peer_getExpired(&tbl, now)) != NULL)
+        {
+            L2_peer_stopWait(peer);
+            if (peer->retxCnt >= L2_ARQ_MAXRETRANSMISSION)
+            {
+                sduDone(res, peer->txSdu, 0, now);
+                peer->txSdu = L2_PEER_NOSDU;
+            }
+            else
+            {
+                peer->retxCnt++;
+                txPeer = peer;
+                txEnd = now + dataMs;
+            }
+        }
+        else if ((peer = L2_peer_next(&tbl, now)) != NULL)
+        {
+            if (peer->txSdu == L2_PEER_NOSDU)
+                peer->txSdu = L2_peer_dequeue(peer);
+            peer->retxCnt = 0;
+            txPeer = peer;
+            txEnd = now + dataMs;
+        }
+    }
+    finish(res);
+}
+
+int main(int argc, char** argv)
+{
+    static const double losses[] = {0.0, 0.1, 0.3};
+    unsigned li;
+    int stalled, sched;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "p:i:t:f:a:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'p': numPeers = atoi(optarg); break;
+            case 'i': sduIntervalMs = atof(optarg); break;
+            case 't': simMs = (uint32_t)(atof(optarg) * 1000); break;
+            case 'f': dataMs = (uint32_t)atoi(optarg); break;
+            case 'a': ackMs = (uint32_t)atoi(optarg); break;
+            case 's': rngState = strtoull(optarg, NULL, 0) | 1; break;
+            default:
+                fprintf(stderr, "usage : %s [-p peers] [-i mean SDU interval per peer ms] [-t simulated s] [-f data frame ms] [-a ACK frame ms] [-s seed]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (numPeers < 2 || numPeers > SIM_MAXPEERS || sduIntervalMs <= 0 || dataMs == 0 || ackMs == 0 ||
+        SIM_TURNAROUND_MS + ackMs > L2_PEER_ACKGUARDMS)
+    {
+        fprintf(stderr, "peers 2..%i, interval and frame times > 0, ACK within the ACK guard (%i ms)\n", SIM_MAXPEERS, L2_PEER_ACKGUARDMS);
+        return 1;
+    }
+
+    arrivalSeed = rngState ^ 0x9E3779B97F4A7C15ULL;
+    printf("%i peers, one SDU every %.0f ms per peer, %.0f s, data %lu ms / ACK %lu ms on air, ARQ %i..%i s x %i retransmissions\n",
+           numPeers, sduIntervalMs, simMs / 1000.0, (unsigned long)dataMs, (unsigned long)ackMs,
+           L2_ARQ_MINWAITTIME, L2_ARQ_MAXWAITTIME, L2_ARQ_MAXRETRANSMISSION);
+    printf(" loss | peer 0  | scheduler | healthy peers : delivered dropped | latency mean    p95 | stalled peer : given up dropped\n");
+
+    for (li = 0; li < sizeof(losses) / sizeof(losses[0]); li++)
+    {
+        lossP = losses[li];
+        for (stalled = 0; stalled <= 1; stalled++)
+        {
+            stalledOn = (uint8_t)stalled;
+            for (sched = 0; sched <= 1; sched++)
+            {
+                simResult_t r;
+
+                if (sched == 0)
+                    runShared(&r);
+                else
+                    runPerPeer(&r);
+                printf("%4.0f%% | %-7s | %-9s |                 %9lu %7lu |        %6.2fs %6.2fs |              %8lu %7lu\n",
+                       100.0 * lossP, stalled ? "stalled" : "healthy", sched ? "per-peer" : "shared",
+                       (unsigned long)r.healthy.delivered, (unsigned long)r.healthy.dropped,
+                       r.latMean / 1000.0, r.latP95 / 1000.0,
+                       (unsigned long)r.stalled.failed, (unsigned long)r.stalled.dropped);
+            }
+        }
+    }
+
+    return 0;
+}
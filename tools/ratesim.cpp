@@ -0,0 +1,190 @@
+// Host-side model of the L2 link adaptation (L2_rate.cpp) over an SNR-dependent LoRa PHY
+//
+// One sender streams full L2 frames to one receiver with stop-and-wait ARQ. The channel has a
+// mean SNR plus per-frame Gaussian fading; a frame (data or ACK) is lost with the FER of the
+// rate it is sent with at the SNR it sees (logistic curve around the snr50 of the rate table, the
+// model the snrReq column of L2_rate.cpp was computed from), and takes the LoRa time on air of
+// that rate (L2_rate_getToaUs). The receiver feeds the measured SNR (1 dB steps, as phymac
+// reports it) to L2_rate_updateSnr and sends its advice back in the ACK, as the firmware does.
+// For each mean SNR, the adaptive link is compared with every fixed rate :
+// goodput (payload bytes per second), frame loss and time on air per delivered frame.
+//
+// build : g++ -O2 -std=gnu++98 -I.. -DL2_LINKADAPT=1 -o ratesim ratesim.cpp ../L2_rate.cpp ../L2_airtime.cpp
+//         (-DL2_RATE_NUMRATES=9 adds the SF8..SF12 rates to the model)
+// usage : ./ratesim [-f fading sigma dB] [-n frames per point] [-p payload bytes] [-s seed]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "L2_rate.h"
+
+#define SIM_TXID                1       //L2 ID of the sender (peer of the receiver)
+#define SIM_RXID                2       //L2 ID of the receiver (peer of the sender)
+#define SIM_PHYHDR              4       //header phymac puts in front of the L2 frame
+#define SIM_ACKSIZE             3
+#define SIM_ADAPTIVE            0xFF
+#define SIM_FER_SLOPE           1.75    //steepness of the FER curve (1/dB) : 90 % -> 10 % loss in 2.5 dB
+
+typedef struct
+{
+    double time;            //us
+    double airtime;         //us
+    uint32_t delivered;
+    uint32_t sent;
+    uint32_t lost;
+    double rateSum;
+} simResult_t;
+
+static double fadingSigma = 1.5;
+static int payload = 26;
+
+static uint64_t rngState = 88172645463325252ULL;
+static double rnd(void)
+{
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return (double)((rngState * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+static double gauss(void)
+{
+    double u = rnd(), v = rnd();
+
+    if (u < 1e-12)
+        u = 1e-12;
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+//frame error rate of the model at the given SNR (dB)
+static double modelFer(uint8_t rate, double snr)
+{
+    return 1.0 / (1.0 + exp(SIM_FER_SLOPE * (snr - L2_rate_getRate(rate)->snr50 / 10.0)));
+}
+
+//one transmission at the given rate : returns 1 if received, the SNR it was received with in *snr
+static int channel(uint8_t rate, double meanSnr, double* snr)
+{
+    *snr = meanSnr + fadingSigma * gauss();
+    return rnd() >= modelFer(rate, *snr);
+}
+
+static void runPoint(simResult_t* r, double meanSnr, uint8_t policy, uint32_t numFrames)
+{
+    uint8_t phySize = payload + 2 + SIM_PHYHDR;
+    uint32_t k;
+
+    memset(r, 0, sizeof(*r));
+    L2_rate_init();
+
+    for (k = 0; k < numFrames; k++)
+    {
+        int retx = 0;
+
+        for (;;)
+        {
+            uint8_t rate = (policy == SIM_ADAPTIVE) ? L2_rate_selectTx(SIM_RXID) : policy;
+            uint8_t ackRate;
+            double snr;
+            uint32_t toa = L2_rate_getToaUs(rate, phySize);
+
+            r->sent++;
+            r->rateSum += rate;
+            r->time += toa;
+            r->airtime += toa;
+
+            if (channel(rate, meanSnr, &snr))
+            {
+                //receiver side : estimate, then ACK with the advice (sent at the advised rate)
+                L2_rate_updateSnr(SIM_TXID, (int8_t)floor(snr + 0.5));
+                ackRate = (policy == SIM_ADAPTIVE) ? L2_rate_getAdvice(SIM_TXID) : policy;
+                toa = L2_rate_getToaUs(ackRate, SIM_ACKSIZE + SIM_PHYHDR);
+                r->time += toa;
+                r->airtime += toa;
+
+                if (channel(ackRate, meanSnr, &snr))
+                {
+                    if (policy == SIM_ADAPTIVE)
+                        L2_rate_setAdvised(SIM_RXID, L2_rate_getAdvice(SIM_TXID));
+                    r->delivered++;
+                    break;
+                }
+            }
+
+            r->lost++;
+            r->time += 1e6 * (L2_ARQ_MINWAITTIME + rnd() * (L2_ARQ_MAXWAITTIME - L2_ARQ_MINWAITTIME));
+            if (policy == SIM_ADAPTIVE)
+                L2_rate_onTimeout(SIM_RXID);
+            if (++retx > L2_ARQ_MAXRETRANSMISSION)
+                break;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t numFrames = 5000;
+    uint8_t numRates = L2_rate_getNumRates();
+    double snr;
+    uint8_t i;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:n:p:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'f': fadingSigma = atof(optarg); break;
+            case 'n': numFrames = (uint32_t)atoi(optarg); break;
+            case 'p': payload = atoi(optarg); break;
+            case 's': rngState = strtoull(optarg, NULL, 0) | 1; break;
+            default:
+                fprintf(stderr, "usage : %s [-f fading sigma dB] [-n frames per point] [-p payload bytes] [-s seed]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (L2_LINKADAPT == 0)
+    {
+        fprintf(stderr, "built with L2_LINKADAPT 0 : rebuild with -DL2_LINKADAPT=1\n");
+        return 1;
+    }
+    if (payload < 1 || payload > 26 || numFrames == 0)
+    {
+        fprintf(stderr, "payload must be 1..26 bytes\n");
+        return 1;
+    }
+
+    printf("rates :");
+    for (i = 0; i < numRates; i++)
+    {
+        const L2_rate_t* r = L2_rate_getRate(i);
+        printf("  %i=SF%i/%ik/4:%i (%.1f ms, FER %.1f%% at %.1f dB)", i, r->sf, 125 << r->bw, r->cr + 4,
+               L2_rate_getToaUs(i, payload + 2 + SIM_PHYHDR) / 1000.0, 100.0 * modelFer(i, r->snrReq / 10.0), r->snrReq / 10.0);
+    }
+    printf("\ngoodput in B/s (frame loss %%) per mean SNR, fading sigma %.1f dB\n", fadingSigma);
+
+    printf("  SNR |");
+    for (i = 0; i < numRates; i++)
+        printf("   fixed %i      |", i);
+    printf("  adaptive       | mean rate | airtime/frame\n");
+
+    for (snr = 4.0; snr >= (numRates > 4 ? -22.0 : -12.0); snr -= 1.0)
+    {
+        simResult_t r;
+
+        printf("%5.0f |", snr);
+        for (i = 0; i < numRates; i++)
+        {
+            runPoint(&r, snr, i, numFrames);
+            printf(" %6.1f (%4.1f%%) |", payload * r.delivered / (r.time / 1e6), 100.0 * r.lost / r.sent);
+        }
+        runPoint(&r, snr, SIM_ADAPTIVE, numFrames);
+        printf(" %6.1f (%4.1f%%) | %9.2f | %8.1f ms\n", payload * r.delivered / (r.time / 1e6), 100.0 * r.lost / r.sent,
+               r.rateSum / r.sent, r.delivered ? r.airtime / r.delivered / 1000.0 : 0.0);
+    }
+
+    return 0;
+}
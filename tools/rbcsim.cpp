@@ -0,0 +1,313 @@
+// Host-side model of the L2 reliable broadcast (L2_rbc.cpp) with one sender and 2..32 receivers
+//
+// Every node runs its own L2_rbcCtx_t as the firmware does, polled every millisecond : the sender
+// broadcasts bursts of new frames, the receivers NACK their gaps and the sender repairs them. Each
+// frame is lost independently on each link with the given probability, frames that overlap in time
+// are lost at every node (no capture) and a node does not hear while it transmits. Frames last the
+// LoRa time on air of rate 0 (L2_rate_getToaUs).
+// For each number of receivers and loss rate : delivered frames, frames on air per new frame
+// (data + repairs, NACKs, SYNCs), NACKs suppressed, and the frames a per-receiver ARQ would need
+// for the same losses (each receiver in turn, one ACK per frame : N x (1/(1-p)^2 + 1/(1-p))).
+//
+// build : g++ -O2 -std=gnu++98 -I.. -o rbcsim rbcsim.cpp ../L2_rbc.cpp ../L2_rate.cpp ../L2_airtime.cpp
+// usage : ./rbcsim [-f new frames] [-b burst length] [-i burst interval ms] [-c (carrier sense)] [-s seed]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "L2_rbc.h"
+#include "L2_rate.h"
+
+#define SIM_MAXRX               32
+#define SIM_PHYHDR              4       //header phymac puts in front of the L2 frame
+#define SIM_DATASIZE            28      //L2 header + full payload
+#define SIM_CTRLSIZE            3       //NACK / SYNC
+#define SIM_SENDERID            1
+#define SIM_DRAIN_MS            120000  //time left for the repairs after the last new frame
+
+typedef struct
+{
+    int node;
+    uint32_t start;
+    uint32_t end;
+    uint8_t collided;
+    uint8_t kind;           //L2_RBC_TX_xxx, L2_RBC_TX_NONE for a new data frame
+    uint8_t seq;
+    uint8_t oldest;
+    uint8_t srcId;
+} simTx_t;
+
+typedef struct
+{
+    L2_rbcCtx_t rbc;
+    uint32_t txStart;       //last transmission of the node
+    uint32_t txEnd;
+    uint32_t nextTry;       //carrier sense backoff
+    uint32_t delivered;
+} simNode_t;
+
+typedef struct
+{
+    uint32_t newFrames;
+    uint32_t repairs;
+    uint32_t nacks;
+    uint32_t suppressed;
+    uint32_t syncs;
+    uint32_t collisions;
+    uint64_t delivered;
+    uint32_t drainMs;       //last new frame -> everything delivered (or given up)
+} simResult_t;
+
+static simNode_t nodes[SIM_MAXRX + 1];
+static simTx_t onAir[SIM_MAXRX + 1];
+static int numOnAir;
+static double lossP;
+static int carrierSense = 0;
+static uint32_t dataToa, ctrlToa;
+
+static uint64_t rngState = 88172645463325252ULL;
+static double rnd(void)
+{
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return (double)((rngState * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+static uint8_t nodeId(int n)
+{
+    return (uint8_t)(SIM_SENDERID + n);
+}
+
+//frame of node n ends : every other node that was listening gets it, unless lost or collided
+static void deliver(const simTx_t* t, int numNodes, uint32_t now)
+{
+    int j;
+
+    for (j = 0; j < numNodes; j++)
+    {
+        simNode_t* r = &nodes[j];
+
+        if (j == t->node || t->collided || rnd() < lossP)
+            continue;
+        if (r->txStart < t->end && r->txEnd > t->start)
+            continue;   //was transmitting during the frame
+
+        switch (t->kind)
+        {
+            case L2_RBC_TX_NONE:
+            case L2_RBC_TX_REPAIR:
+                if (L2_rbc_onData(&r->rbc, now, nodeId(t->node), t->seq) == L2_RBC_ACCEPT)
+                    r->delivered++;
+                break;
+            case L2_RBC_TX_NACK:
+                if (t->srcId == nodeId(j))
+                    L2_rbc_onNack(&r->rbc, now, t->seq);
+                else
+                    L2_rbc_onPeerNack(&r->rbc, now, t->srcId, t->seq);
+                break;
+            case L2_RBC_TX_SYNC:
+                L2_rbc_onSync(&r->rbc, now, nodeId(t->node), t->seq, t->oldest);
+                break;
+        }
+    }
+}
+
+static uint8_t channelBusy(uint32_t now)
+{
+    int i;
+
+    for (i = 0; i < numOnAir; i++)
+    {
+        if (onAir[i].start < now)
+            return 1;
+    }
+    return 0;
+}
+
+static void startTx(int n, uint32_t now, const L2_rbcTx_t* tx, simResult_t* res)
+{
+    simTx_t* t = &onAir[numOnAir++];
+    int i;
+
+    t->node = n;
+    t->start = now;
+    t->kind = tx->kind;
+    t->seq = tx->seq;
+    t->oldest = tx->oldest;
+    t->srcId = tx->srcId;
+    t->end = now + ((tx->kind == L2_RBC_TX_NONE || tx->kind == L2_RBC_TX_REPAIR) ? dataToa : ctrlToa);
+    t->collided = 0;
+    for (i = 0; i < numOnAir - 1; i++)
+    {
+        onAir[i].collided = 1;
+        t->collided = 1;
+    }
+    if (t->collided)
+        res->collisions++;
+
+    nodes[n].txStart = now;
+    nodes[n].txEnd = t->end;
+}
+
+static void run(simResult_t* res, int numRx, uint32_t numFrames, uint32_t burst, uint32_t interval)
+{
+    int numNodes = numRx + 1;
+    uint32_t queued = 0, sent = 0;
+    uint32_t lastNew = 0;
+    uint32_t now;
+    int n, i;
+
+    memset(res, 0, sizeof(*res));
+    memset(nodes, 0, sizeof(nodes));
+    //the receivers have joined the stream before it starts
+    for (n = 0; n < numNodes; n++)
+    {
+        L2_rbc_init(&nodes[n].rbc);
+        if (n > 0)
+            L2_rbc_onSync(&nodes[n].rbc, 0, nodeId(0), 0, 0);
+    }
+    numOnAir = 0;
+
+    for (now = 1; ; now++)
+    {
+        //new frames of the sender
+        if (sent + queued < numFrames && (now - 1) % interval == 0)
+            queued += (numFrames - sent - queued < burst) ? numFrames - sent - queued : burst;
+
+        //end of transmissions
+        for (i = 0; i < numOnAir; )
+        {
+            if (onAir[i].end == now)
+            {
+                simTx_t t = onAir[i];
+
+                onAir[i] = onAir[--numOnAir];
+                deliver(&t, numNodes, now);
+            }
+            else
+                i++;
+        }
+
+        //idle nodes : polled as the FSM does in IDLE (reliable broadcast first, then new data)
+        for (n = 0; n < numNodes; n++)
+        {
+            simNode_t* s = &nodes[n];
+            L2_rbcTx_t tx;
+
+            if (s->txEnd > now || now < s->nextTry)
+                continue;
+            if (carrierSense && channelBusy(now))
+            {
+                s->nextTry = now + 5 * (1 + rand() % 8);
+                continue;
+            }
+
+            if (L2_rbc_getTx(&s->rbc, now, &tx) != L2_RBC_TX_NONE)
+            {
+                if (tx.kind == L2_RBC_TX_SKIP)
+                    continue;
+                if (tx.kind == L2_RBC_TX_REPAIR)
+                    res->repairs++;
+                else if (tx.kind == L2_RBC_TX_NACK)
+                    res->nacks++;
+                else
+                    res->syncs++;
+                startTx(n, now, &tx, res);
+            }
+            else if (n == 0 && queued > 0)
+            {
+                uint8_t frame[SIM_DATASIZE] = {1, 0};
+
+                tx.kind = L2_RBC_TX_NONE;
+                tx.seq = L2_rbc_nextTxSeq(&s->rbc);
+                frame[1] = tx.seq;
+                L2_rbc_storeTx(&s->rbc, now, frame, sizeof(frame), tx.seq);
+                startTx(n, now, &tx, res);
+                queued--;
+                sent++;
+                res->newFrames++;
+                lastNew = now;
+            }
+        }
+
+        //done : every receiver has every frame (or gave it up) and nothing is left to send
+        if (sent == numFrames && numOnAir == 0)
+        {
+            uint64_t done = 0;
+
+            for (n = 1; n < numNodes; n++)
+                done += nodes[n].delivered + nodes[n].rbc.stats.lostCnt;
+            if (done >= (uint64_t)numFrames * numRx && nodes[0].rbc.repairPending == 0)
+                break;
+        }
+        if (sent == numFrames && now > lastNew + SIM_DRAIN_MS)
+            break;
+    }
+
+    res->drainMs = now - lastNew;
+    for (n = 1; n < numNodes; n++)
+    {
+        res->delivered += nodes[n].delivered;
+        res->suppressed += nodes[n].rbc.stats.nackSuppressed;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    static const int rxCounts[] = {2, 4, 8, 16, 32};
+    static const double losses[] = {0.01, 0.05, 0.1, 0.2};
+    uint32_t numFrames = 64, burst = 4, interval = 5000;
+    unsigned li, ri;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:b:i:cs:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'f': numFrames = (uint32_t)atoi(optarg); break;
+            case 'b': burst = (uint32_t)atoi(optarg); break;
+            case 'i': interval = (uint32_t)atoi(optarg); break;
+            case 'c': carrierSense = 1; break;
+            case 's': rngState = strtoull(optarg, NULL, 0) | 1; srand((unsigned)rngState); break;
+            default:
+                fprintf(stderr, "usage : %s [-f new frames] [-b burst length] [-i burst interval ms] [-c] [-s seed]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (numFrames == 0 || burst == 0 || burst > L2_RBC_CACHESIZE || interval == 0)
+    {
+        fprintf(stderr, "frames and interval must be > 0, burst 1..%i\n", L2_RBC_CACHESIZE);
+        return 1;
+    }
+
+    dataToa = L2_rate_getToaUs(0, SIM_DATASIZE + SIM_PHYHDR) / 1000;
+    ctrlToa = L2_rate_getToaUs(0, SIM_CTRLSIZE + SIM_PHYHDR) / 1000;
+    printf("%lu new frames in bursts of %lu every %lu ms, data %lu ms / NACK %lu ms on air, %s\n",
+           (unsigned long)numFrames, (unsigned long)burst, (unsigned long)interval,
+           (unsigned long)dataToa, (unsigned long)ctrlToa, carrierSense ? "carrier sense" : "no carrier sense");
+    printf(" loss |  rx | delivered | frames on air per new frame : repairs  NACKs  SYNC  total | suppressed | collisions | drain  | per-rx ARQ\n");
+
+    for (li = 0; li < sizeof(losses) / sizeof(losses[0]); li++)
+    {
+        lossP = losses[li];
+        for (ri = 0; ri < sizeof(rxCounts) / sizeof(rxCounts[0]); ri++)
+        {
+            simResult_t r;
+            double nf;
+
+            run(&r, rxCounts[ri], numFrames, burst, interval);
+            nf = r.newFrames;
+            printf("%4.0f%% | %3i | %8.2f%% |                               %6.2f %6.2f %5.2f %6.2f | %10lu | %10lu | %5.1fs | %9.1f\n",
+                   100.0 * lossP, rxCounts[ri], 100.0 * r.delivered / ((double)numFrames * rxCounts[ri]),
+                   r.repairs / nf, r.nacks / nf, r.syncs / nf, (nf + r.repairs + r.nacks + r.syncs) / nf,
+                   (unsigned long)r.suppressed, (unsigned long)r.collisions, r.drainMs / 1000.0,
+                   rxCounts[ri] * (1.0 / ((1.0 - lossP) * (1.0 - lossP)) + 1.0 / (1.0 - lossP)));
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,242 @@
+// Host-side benchmark of the sentence path : fixed-point against the float build it replaced
+//
+// Times one round of the sentence path as checkAndShowResult runs it : a prediction ratio in a
+// quarter of the rounds, the choice ratio, then the sentence printed with one decimal. The
+// fixed-point version is the firmware's (L3_sentence_scale, L3_sentence_format, 1/1000 years);
+// the float version is the code before L3_sentence.cpp, kept as it was : float sentence, the
+// prediction ratios as float constants, the choice ratios as double constants (1.0 / 3.0 ...,
+// the product goes through double) and "%.1f" formatting. Both run on the same pregenerated
+// random rounds (classic rule set) and report ns and TSC cycles per round, with and without the
+// formatting. The printed sentences of the two versions are compared : the float one drifts from
+// the exact ratios, the fixed-point one is the same on every node.
+//
+// This measures the host CPU, which has hardware double : on the Cortex-M4 (single precision FPU,
+// soft-float double and a soft-float printf path) the float build is slower than shown here, and
+// its flash cost (arm-none-eabi-size of the two builds) can only be measured with the target
+// toolchain.
+//
+// build : g++ -O2 -std=gnu++98 -I.. -o sentencebench sentencebench.cpp ../L3_sentence.cpp
+// usage : ./sentencebench [-n rounds per pass] [-p passes]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAS_TSC   1
+#else
+#define BENCH_HAS_TSC   0
+#endif
+
+#include "L3_sentence.h"
+
+#define BENCH_FLOAT_MAX     1000000.0f  //float sentence kept in the range a game plays in
+
+//one round of input : my choice, peer choice, prediction hit (-1 : no prediction this round)
+typedef struct
+{
+    uint8_t myChoice;
+    uint8_t peerChoice;
+    int8_t hit;
+} Round;
+
+
+//the sentence path before L3_sentence.cpp (out of line like the firmware calls)
+__attribute__((noinline)) static float floatRound(float sentence, const Round* r)
+{
+    if (r->hit == 1)
+        sentence *= (2.0f / 3.0f);
+    else if (r->hit == 0)
+        sentence *= (4.0f / 3.0f);
+
+    if (r->myChoice == 1 && r->peerChoice == 1)
+        sentence *= 1.0 / 3.0;
+    else if (r->myChoice == 1 && r->peerChoice == 2)
+        sentence *= 2.0;
+    else if (r->myChoice == 2 && r->peerChoice == 1)
+        sentence *= 0.5;
+    else
+        sentence *= 1.5;
+    return sentence;
+}
+
+__attribute__((noinline)) static uint32_t fixedRound(uint32_t sentence, const Round* r)
+{
+    if (r->hit == 1)
+        sentence = L3_sentence_scale(sentence, 2, 3);
+    else if (r->hit == 0)
+        sentence = L3_sentence_scale(sentence, 4, 3);
+
+    if (r->myChoice == 1 && r->peerChoice == 1)
+        sentence = L3_sentence_scale(sentence, 1, 3);
+    else if (r->myChoice == 1 && r->peerChoice == 2)
+        sentence = L3_sentence_scale(sentence, 2, 1);
+    else if (r->myChoice == 2 && r->peerChoice == 1)
+        sentence = L3_sentence_scale(sentence, 1, 2);
+    else
+        sentence = L3_sentence_scale(sentence, 3, 2);
+    return sentence;
+}
+
+//sum of the printed characters : keeps the formatting from being optimized out
+static uint32_t strSum(const char* str)
+{
+    uint32_t sum = 0;
+
+    while (*str)
+        sum += (uint8_t)*str++;
+    return sum;
+}
+
+static uint32_t runFloat(const Round* r, size_t num, int format)
+{
+    float sentence = L3_SENTENCE_INIT / (float)L3_SENTENCE_SCALE;
+    char buf[32];
+    uint32_t sum = 0;
+    size_t i;
+
+    for (i = 0; i < num; i++)
+    {
+        sentence = floatRound(sentence, &r[i]);
+        if (format)
+        {
+            snprintf(buf, sizeof(buf), "%.1f", sentence);
+            sum += strSum(buf);
+        }
+        if (sentence < 0.001f || sentence >= BENCH_FLOAT_MAX)
+            sentence = L3_SENTENCE_INIT / (float)L3_SENTENCE_SCALE;
+    }
+    return sum + (uint32_t)sentence;
+}
+
+static uint32_t runFixed(const Round* r, size_t num, int format)
+{
+    uint32_t sentence = L3_SENTENCE_INIT;
+    char buf[L3_SENTENCE_STRLEN];
+    uint32_t sum = 0;
+    size_t i;
+
+    for (i = 0; i < num; i++)
+    {
+        sentence = fixedRound(sentence, &r[i]);
+        if (format)
+            sum += strSum(L3_sentence_format(sentence, buf));
+        if (sentence == 0 || sentence >= (uint32_t)(BENCH_FLOAT_MAX * L3_SENTENCE_SCALE))
+            sentence = L3_SENTENCE_INIT;
+    }
+    return sum + sentence;
+}
+
+//games of up to 20 rounds from the starting sentence : rounds whose printed sentences differ
+static size_t countMismatch(const Round* r, size_t num, size_t* compared)
+{
+    float fs = 0;
+    uint32_t xs = 0;
+    char fbuf[32], xbuf[L3_SENTENCE_STRLEN];
+    size_t i, bad = 0;
+
+    *compared = 0;
+    for (i = 0; i < num; i++)
+    {
+        if (i % 20 == 0)
+        {
+            fs = L3_SENTENCE_INIT / (float)L3_SENTENCE_SCALE;
+            xs = L3_SENTENCE_INIT;
+        }
+        fs = floatRound(fs, &r[i]);
+        xs = fixedRound(xs, &r[i]);
+        snprintf(fbuf, sizeof(fbuf), "%.1f", fs);
+        L3_sentence_format(xs, xbuf);
+        (*compared)++;
+        bad += (strcmp(fbuf, xbuf) != 0);
+    }
+    return bad;
+}
+
+static uint64_t nowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int main(int argc, char** argv)
+{
+    size_t num = 1000000;
+    int passes = 5;
+    Round* rounds;
+    volatile uint32_t sink = 0;
+    const char* names[4] = {"float ratios", "fixed ratios", "float + %.1f", "fixed + format"};
+    double best[4][2];
+    size_t i, bad, compared;
+    int p, v;
+
+    for (p = 1; p < argc; p++)
+    {
+        if (!strcmp(argv[p], "-n") && p + 1 < argc)
+            num = (size_t)atol(argv[++p]);
+        else if (!strcmp(argv[p], "-p") && p + 1 < argc)
+            passes = atoi(argv[++p]);
+        else
+        {
+            printf("usage : %s [-n rounds per pass] [-p passes]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    rounds = (Round*)malloc(num * sizeof(Round));
+    if (rounds == NULL)
+        return 1;
+    srand(1);
+    for (i = 0; i < num; i++)
+    {
+        rounds[i].myChoice = (uint8_t)(1 + rand() % 2);
+        rounds[i].peerChoice = (uint8_t)(1 + rand() % 2);
+        rounds[i].hit = (int8_t)((rand() % 4 == 0) ? rand() % 2 : -1); //a prediction in a quarter of the rounds
+    }
+
+    //best of the passes, the versions alternating so that all see the same machine state
+    for (v = 0; v < 4; v++)
+        best[v][0] = best[v][1] = 1e30;
+    for (p = 0; p < passes; p++)
+    {
+        for (v = 0; v < 4; v++)
+        {
+            uint64_t t0, t1, c0 = 0, c1 = 0;
+
+            t0 = nowNs();
+#if BENCH_HAS_TSC
+            c0 = __rdtsc();
+#endif
+            sink += (v % 2 == 0) ? runFloat(rounds, num, v / 2) : runFixed(rounds, num, v / 2);
+#if BENCH_HAS_TSC
+            c1 = __rdtsc();
+#endif
+            t1 = nowNs();
+            if ((t1 - t0) / (double)num < best[v][0])
+                best[v][0] = (t1 - t0) / (double)num;
+            if ((c1 - c0) / (double)num < best[v][1])
+                best[v][1] = (c1 - c0) / (double)num;
+        }
+    }
+
+    printf("%lu rounds per pass, best of %d passes\n", (unsigned long)num, passes);
+    for (v = 0; v < 4; v++)
+    {
+        if (BENCH_HAS_TSC)
+            printf("%-14s : %7.2f ns/round  %7.2f cycles/round\n", names[v], best[v][0], best[v][1]);
+        else
+            printf("%-14s : %7.2f ns/round\n", names[v], best[v][0]);
+    }
+    printf("fixed / float  : %.2f (ratios), %.2f (with formatting)\n", best[1][0] / best[0][0], best[3][0] / best[2][0]);
+
+    bad = countMismatch(rounds, num, &compared);
+    printf("printed sentence differs in %lu of %lu rounds (games of 20 rounds from %u years)\n",
+           (unsigned long)bad, (unsigned long)compared, (unsigned)(L3_SENTENCE_INIT / L3_SENTENCE_SCALE));
+
+    free(rounds);
+    return (int)(sink & 0);
+}
@@ -0,0 +1,299 @@
+// Host-side long run of the L2 sequence numbers (L2_seq.cpp) across many wraps
+//
+// First checks the serial number arithmetic over every pair of numbers of the space (next / prev,
+// distance, order, what L2_seq_check reports). Then a sender and a receiver exchange SDUs over a
+// channel that loses each frame with the given probability and delays it by a random time (so
+// frames may overtake each other), one frame per millisecond at most :
+//  - window 1 is the stop-and-wait of the FSM (one PDU in flight per peer)
+//  - the largest window is half the space less one : the receiver may be a whole window ahead of the
+//    oldest PDU the sender still retransmits, and numbers half the space apart have no order
+// Each frame is numbered with the L2_SEQ_BITS wide sequence numbers only, and carries the index of
+// its SDU for the check : every SDU must come out once and in order (a wrong SDU taken for the
+// expected one is a misdelivery) and the longest time between two deliveries shows a stall (a run
+// with nothing delivered for SIM_STALLMS is stopped). A larger window (-w) shows what happens when
+// the order no longer holds.
+//
+// build : g++ -O2 -std=gnu++98 -I.. -DL2_SEQ_BITS=4 -o seqsim seqsim.cpp ../L2_seq.cpp
+//         (the width is fixed at build time, as in the firmware)
+// usage : ./seqsim [-n SDUs per run] [-d mean delay ms] [-j delay jitter ms] [-w window] [-s seed]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <vector>
+
+#include "L2_seq.h"
+
+#define SIM_MAXDELAY            256     //ms, calendar length (delay + jitter and the timeouts fit in it)
+#define SIM_STALLMS             60000
+
+typedef struct
+{
+    uint8_t isAck;
+    uint8_t seq;
+    uint32_t sdu;           //index of the SDU (not on air, for the check)
+    uint32_t sendCnt;       //timeout event : transmission it belongs to
+} simEvt_t;
+
+typedef struct
+{
+    uint64_t frames;
+    uint64_t retx;
+    uint64_t dupAcked;      //old frames ACKed again
+    uint64_t dropped;       //out of the receiver window
+    uint64_t misdelivered;
+    uint8_t stalled;
+    uint32_t delivered;
+    uint32_t maxGapMs;
+    uint32_t endMs;
+} simResult_t;
+
+static double lossP;
+static uint32_t delayMs = 20;
+static uint32_t jitterMs = 10;
+
+static uint64_t rngState = 88172645463325252ULL;
+static double rnd(void)
+{
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return (double)((rngState * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+static std::vector<simEvt_t> calendar[SIM_MAXDELAY];
+
+static void schedule(uint32_t at, const simEvt_t& e)
+{
+    calendar[at % SIM_MAXDELAY].push_back(e);
+}
+
+//frame on the channel : lost or delivered after the delay
+static void channel(uint32_t now, const simEvt_t& e)
+{
+    if (rnd() < lossP)
+        return;
+    schedule(now + delayMs + (uint32_t)(rnd() * (jitterMs + 1)), e);
+}
+
+static int checkArith(void)
+{
+    unsigned a, k;
+    int err = 0;
+
+    for (a = 0; a < L2_SEQ_SPACE; a++)
+    {
+        uint8_t s = (uint8_t)a;
+
+        err += (L2_seq_isValid(s) == 0);
+        err += (L2_seq_prev(L2_seq_next(s)) != s);
+        err += (L2_seq_check(s, s) != L2_SEQ_EXPECTED);
+        for (k = 1; k < L2_SEQ_SPACE; k++)
+        {
+            uint8_t b = (uint8_t)((a + k) & L2_SEQ_MASK);
+
+            if (k < L2_SEQ_HALF)
+            {
+                err += (L2_seq_diff(b, s) != (int)k || L2_seq_diff(s, b) != -(int)k);
+                err += (L2_seq_lt(s, b) == 0 || L2_seq_lt(b, s) != 0);
+                err += (L2_seq_check(b, s) != L2_SEQ_AHEAD || L2_seq_check(s, b) != L2_SEQ_OLD);
+            }
+            else if (k == L2_SEQ_HALF)
+            {
+                err += (L2_seq_lt(s, b) != 0 || L2_seq_lt(b, s) != 0);
+                err += (L2_seq_check(b, s) != L2_SEQ_INVALID);
+            }
+        }
+    }
+    for (a = L2_SEQ_SPACE; a < 256; a++)
+        err += (L2_seq_isValid((uint8_t)a) != 0 || L2_seq_check((uint8_t)a, 0) != L2_SEQ_INVALID);
+
+    return err;
+}
+
+static void run(simResult_t* res, uint32_t numSdu, uint32_t window)
+{
+    static uint8_t acked[L2_SEQ_SPACE];
+    static uint32_t txSdu[L2_SEQ_SPACE];
+    static uint32_t sendCnt[L2_SEQ_SPACE];
+    static uint8_t rxHave[L2_SEQ_SPACE];
+    static uint32_t rxSdu[L2_SEQ_SPACE];
+    std::vector<uint8_t> retxQueue;
+    uint32_t timeoutMs = 2 * (delayMs + jitterMs) + 2;
+    uint32_t base = 0, nextSdu = 0;     //first SDU not ACKed, next new SDU
+    uint8_t baseSeq = 0, nextSeq = 0;
+    uint8_t expSeq = 0;
+    uint32_t lastDelivery = 0;
+    uint32_t now;
+    unsigned i;
+
+    memset(res, 0, sizeof(*res));
+    memset(acked, 0, sizeof(acked));
+    memset(rxHave, 0, sizeof(rxHave));
+    memset(sendCnt, 0, sizeof(sendCnt));
+    for (i = 0; i < SIM_MAXDELAY; i++)
+        calendar[i].clear();
+
+    for (now = 0; res->delivered < numSdu; now++)
+    {
+        if (now - lastDelivery > SIM_STALLMS)
+        {
+            res->stalled = 1;
+            res->maxGapMs = now - lastDelivery;
+            break;
+        }
+        std::vector<simEvt_t> evts;
+        int seq = -1;
+
+        evts.swap(calendar[now % SIM_MAXDELAY]);
+        for (i = 0; i < evts.size(); i++)
+        {
+            simEvt_t e = evts[i];
+
+            if (e.isAck == 1)
+            {
+                //sender : an ACK of a PDU in the window marks it done, the window slides over the done ones
+                int d = L2_seq_diff(e.seq, baseSeq);
+
+                if (d >= 0 && (uint32_t)d < nextSdu - base)
+                    acked[e.seq] = 1;
+                while (base < nextSdu && acked[baseSeq])
+                {
+                    acked[baseSeq] = 0;
+                    baseSeq = L2_seq_next(baseSeq);
+                    base++;
+                }
+            }
+            else if (e.isAck == 0)
+            {
+                //receiver : frames of the window are kept and delivered in order, older ones ACKed again
+                //(lost ACK), as the FSM does with its duplicate cache (L2_peer_rxIsAcked)
+                int d = L2_seq_diff(e.seq, expSeq);
+                simEvt_t ack = {1, e.seq, 0, 0};
+
+                if (L2_seq_check(e.seq, expSeq) == L2_SEQ_INVALID || d >= (int)window || d < -(int)window)
+                {
+                    res->dropped++;
+                    continue;
+                }
+                if (d < 0)
+                    res->dupAcked++;
+                else if (rxHave[e.seq] == 0)
+                {
+                    rxHave[e.seq] = 1;
+                    rxSdu[e.seq] = e.sdu;
+                }
+                while (rxHave[expSeq])
+                {
+                    if (rxSdu[expSeq] != res->delivered)
+                        res->misdelivered++;
+                    rxHave[expSeq] = 0;
+                    expSeq = L2_seq_next(expSeq);
+                    res->delivered++;
+                    if (now - lastDelivery > res->maxGapMs)
+                        res->maxGapMs = now - lastDelivery;
+                    lastDelivery = now;
+                }
+                res->frames++;
+                channel(now, ack);
+            }
+            else if (e.sendCnt == sendCnt[e.seq] && acked[e.seq] == 0 && L2_seq_diff(e.seq, baseSeq) >= 0 &&
+                     (uint32_t)L2_seq_diff(e.seq, baseSeq) < nextSdu - base)
+            {
+                retxQueue.push_back(e.seq);     //timeout of a PDU still in the window
+            }
+        }
+
+        //one frame per ms : retransmissions first, then a new PDU if the window has room
+        while (!retxQueue.empty() && seq < 0)
+        {
+            uint8_t r = retxQueue[0];
+
+            retxQueue.erase(retxQueue.begin());
+            if (acked[r] == 0 && L2_seq_diff(r, baseSeq) >= 0 && (uint32_t)L2_seq_diff(r, baseSeq) < nextSdu - base)
+            {
+                seq = r;
+                res->retx++;
+            }
+        }
+        if (seq < 0 && nextSdu - base < window && nextSdu < numSdu)
+        {
+            seq = nextSeq;
+            txSdu[seq] = nextSdu++;
+            acked[seq] = 0;
+            nextSeq = L2_seq_next(nextSeq);
+        }
+        if (seq >= 0)
+        {
+            simEvt_t data = {0, (uint8_t)seq, txSdu[seq], 0};
+            simEvt_t tmo = {2, (uint8_t)seq, 0, ++sendCnt[seq]};
+
+            res->frames++;
+            channel(now, data);
+            schedule(now + timeoutMs, tmo);
+        }
+    }
+    res->endMs = now;
+}
+
+int main(int argc, char** argv)
+{
+    static const double losses[] = {0.0, 0.1, 0.3};
+    uint32_t numSdu = 1000000;
+    uint32_t windows[2] = {1, L2_SEQ_HALF - 1};
+    unsigned numWindows = (L2_SEQ_HALF - 1 > 1) ? 2 : 1;
+    unsigned li, wi;
+    int err, opt;
+    int failed = 0;
+
+    while ((opt = getopt(argc, argv, "n:d:j:w:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': numSdu = (uint32_t)atol(optarg); break;
+            case 'd': delayMs = (uint32_t)atoi(optarg); break;
+            case 'j': jitterMs = (uint32_t)atoi(optarg); break;
+            case 'w': windows[0] = (uint32_t)atoi(optarg); numWindows = 1; break;
+            case 's': rngState = strtoull(optarg, NULL, 0) | 1; break;
+            default:
+                fprintf(stderr, "usage : %s [-n SDUs per run] [-d mean delay ms] [-j delay jitter ms] [-w window] [-s seed]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (numSdu == 0 || windows[0] == 0 || 2 * (delayMs + jitterMs) + 2 >= SIM_MAXDELAY)
+    {
+        fprintf(stderr, "SDUs and window must be > 0, 2 x (delay + jitter) + 2 < %i ms\n", SIM_MAXDELAY);
+        return 1;
+    }
+
+    err = checkArith();
+    printf("L2_SEQ_BITS %i : space %u, serial number arithmetic over all pairs : %s (%i errors)\n",
+           L2_SEQ_BITS, L2_SEQ_SPACE, err ? "FAILED" : "ok", err);
+    printf("%lu SDUs per run, delay %lu..%lu ms, at most 1 frame per ms\n",
+           (unsigned long)numSdu, (unsigned long)delayMs, (unsigned long)(delayMs + jitterMs));
+    printf("window | loss |  wraps | frames/s | retx/SDU | old re-ACKed | out of window | misdelivered | longest gap\n");
+
+    for (wi = 0; wi < numWindows; wi++)
+    {
+        for (li = 0; li < sizeof(losses) / sizeof(losses[0]); li++)
+        {
+            simResult_t r;
+
+            lossP = losses[li];
+            run(&r, numSdu, windows[wi]);
+            printf("%6lu | %3.0f%% | %6lu | %8.1f | %8.3f | %12llu | %13llu | %12llu | %8lu ms%s\n",
+                   (unsigned long)windows[wi], 100.0 * lossP, (unsigned long)(r.delivered / L2_SEQ_SPACE),
+                   r.frames * 1000.0 / r.endMs, (double)r.retx / numSdu, (unsigned long long)r.dupAcked,
+                   (unsigned long long)r.dropped, (unsigned long long)r.misdelivered, (unsigned long)r.maxGapMs,
+                   r.stalled ? " STALLED" : "");
+            if (r.misdelivered > 0 || r.stalled)
+                failed = 1;
+        }
+    }
+    if (err || failed)
+        printf("FAILED\n");
+
+    return (err || failed) ? 1 : 0;
+}
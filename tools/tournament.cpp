@@ -0,0 +1,463 @@
+// Host-side round-robin tournament for the dilemma game
+//
+// Plays every pair of strategies (including self-play) against each other using
+// exactly the sentence rules of the firmware (L3_payoff.cpp / L3_sentence.cpp):
+// multiplicative payoffs, the one-shot prediction that is scored on the next round,
+// and release when the sentence drops below L3_SENTENCE_RELEASE.
+// Matches of one pairing are played in batches of TNMT_BATCH so that the strategy dispatch
+// and the task queue cost once per batch; the scoring stays a scalar call of the firmware
+// functions per match (out of line, one division each), it is not vectorized.
+//
+// build : g++ -O2 -std=gnu++98 -I.. -o tournament tournament.cpp ../L3_payoff.cpp ../L3_sentence.cpp -lpthread
+// usage : ./tournament [-t threads] [-m matches per pairing] [-r max rounds] [-s seed]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "L3_sentence.h"
+#include "L3_payoff.h"
+
+#define TNMT_BATCH              8       //matches of one pairing stepped together
+#define TNMT_MAXTHREADS         64
+#define TNMT_DEFAULT_MATCHES    4096
+#define TNMT_DEFAULT_MAXROUNDS  100
+
+#define C   L3_CHOICE_COOPERATE
+#define D   L3_CHOICE_BETRAY
+
+//strategy ids -------------------------------------------------------------------
+enum
+{
+    STRAT_ALLC = 0,
+    STRAT_ALLD,
+    STRAT_TFT,
+    STRAT_STFT,
+    STRAT_TF2T,
+    STRAT_GRIM,
+    STRAT_PAVLOV,
+    STRAT_RANDOM,
+    STRAT_TFT_PREDICT,
+    STRAT_NUM
+};
+
+static const char* stratName[STRAT_NUM] =
+{
+    "AllC", "AllD", "TitForTat", "SuspiciousTFT", "TitForTwoTats",
+    "Grim", "Pavlov", "Random", "TFT+Predict"
+};
+
+//state of one side of the table for a batch of matches ---------------------------
+typedef struct
+{
+    uint32_t sentence[TNMT_BATCH];
+    uint8_t last[TNMT_BATCH];           //my choice in the previous round (0 : none)
+    uint8_t peerLast[TNMT_BATCH];       //peer choice in the previous round
+    uint8_t peerLast2[TNMT_BATCH];      //peer choice two rounds ago
+    uint8_t grudge[TNMT_BATCH];         //peer has ever defected
+    uint8_t usedPrediction[TNMT_BATCH];
+    uint8_t prediction[TNMT_BATCH];     //stored prediction, scored on the next round (0 : none)
+    uint8_t choice[TNMT_BATCH];
+} side_t;
+
+typedef struct
+{
+    uint64_t wins;
+    uint64_t draws;
+    uint64_t losses;
+    uint64_t rounds;
+    uint64_t matches;
+    uint64_t sentenceSum;               //final sentence, 1/1000 years
+} standing_t;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    uint32_t head;
+    uint32_t tail;
+    standing_t standing[STRAT_NUM];
+    pthread_t thread;
+    int id;
+} worker_t;
+
+static int nThreads;
+static uint32_t matchesPerPair = TNMT_DEFAULT_MATCHES;
+static uint32_t maxRounds = TNMT_DEFAULT_MAXROUNDS;
+static uint32_t baseSeed = 1;
+
+static int pairA[STRAT_NUM * STRAT_NUM];
+static int pairB[STRAT_NUM * STRAT_NUM];
+static uint32_t nPairs;
+static uint32_t batchesPerPair;
+static worker_t workers[TNMT_MAXTHREADS];
+
+
+static inline uint32_t rng_next(uint32_t* x)
+{
+    uint32_t v = *x;
+    v ^= v << 13;
+    v ^= v >> 17;
+    v ^= v << 5;
+    *x = v;
+    return v;
+}
+
+//choice of one side in every match of the batch
+static void strategy_choose(int strat, side_t* s, uint32_t round, uint32_t* rng)
+{
+    int l;
+
+    switch (strat)
+    {
+        case STRAT_ALLC:
+            for (l = 0; l < TNMT_BATCH; l++)
+                s->choice[l] = C;
+            break;
+        case STRAT_ALLD:
+            for (l = 0; l < TNMT_BATCH; l++)
+                s->choice[l] = D;
+            break;
+        case STRAT_TFT:
+        case STRAT_TFT_PREDICT:
+            for (l = 0; l < TNMT_BATCH; l++)
+                s->choice[l] = (round == 0) ? C : s->peerLast[l];
+            break;
+        case STRAT_STFT:
+            for (l = 0; l < TNMT_BATCH; l++)
+                s->choice[l] = (round == 0) ? D : s->peerLast[l];
+            break;
+        case STRAT_TF2T:
+            for (l = 0; l < TNMT_BATCH; l++)
+                s->choice[l] = (s->peerLast[l] == D && s->peerLast2[l] == D) ? D : C;
+            break;
+        case STRAT_GRIM:
+            for (l = 0; l < TNMT_BATCH; l++)
+                s->choice[l] = s->grudge[l] ? D : C;
+            break;
+        case STRAT_PAVLOV:
+            //win-stay, lose-shift : repeat when the peer cooperated, switch otherwise
+            for (l = 0; l < TNMT_BATCH; l++)
+            {
+                if (round == 0)
+                    s->choice[l] = C;
+                else if (s->peerLast[l] == C)
+                    s->choice[l] = s->last[l];
+                else
+                    s->choice[l] = (s->last[l] == C) ? D : C;
+            }
+            break;
+        case STRAT_RANDOM:
+        default:
+            for (l = 0; l < TNMT_BATCH; l++)
+                s->choice[l] = (rng_next(&rng[l]) & 1) ? C : D;
+            break;
+    }
+}
+
+//one-shot prediction, made after the round result and scored on the next round
+static void strategy_predict(int strat, side_t* s, uint32_t round)
+{
+    int l;
+
+    if (strat != STRAT_TFT_PREDICT)
+        return;
+
+    //predict that a peer who repeated its move twice keeps doing so
+    for (l = 0; l < TNMT_BATCH; l++)
+    {
+        if (!s->usedPrediction[l] && round > 0 && s->peerLast[l] == s->peerLast2[l])
+        {
+            s->prediction[l] = s->peerLast[l];
+            s->usedPrediction[l] = 1;
+        }
+    }
+}
+
+static void side_init(side_t* s)
+{
+    int l;
+
+    for (l = 0; l < TNMT_BATCH; l++)
+    {
+        s->sentence[l] = L3_SENTENCE_INIT;
+        s->last[l] = 0;
+        s->peerLast[l] = 0;
+        s->peerLast2[l] = 0;
+        s->grudge[l] = 0;
+        s->usedPrediction[l] = 0;
+        s->prediction[l] = 0;
+    }
+}
+
+//same order as checkAndShowResult : stored prediction first, then the choice payoff
+static void side_score(side_t* s, const side_t* peer, const uint8_t* done)
+{
+    int l;
+
+    for (l = 0; l < TNMT_BATCH; l++)
+    {
+        if (done[l])
+            continue;
+        if (s->prediction[l])
+        {
+            s->sentence[l] = L3_payoff_applyPrediction(s->sentence[l], s->prediction[l] == peer->choice[l]);
+            s->prediction[l] = 0;
+        }
+        s->sentence[l] = L3_payoff_applyChoice(s->sentence[l], s->choice[l], peer->choice[l]);
+    }
+}
+
+static void side_remember(side_t* s, const side_t* peer)
+{
+    int l;
+
+    for (l = 0; l < TNMT_BATCH; l++)
+    {
+        s->peerLast2[l] = s->peerLast[l];
+        s->peerLast[l] = peer->choice[l];
+        s->last[l] = s->choice[l];
+        s->grudge[l] |= (peer->choice[l] == D);
+    }
+}
+
+//plays TNMT_BATCH matches of one pairing and accumulates the standings
+static void play_batch(uint32_t task, standing_t* standing)
+{
+    uint32_t pair = task / batchesPerPair;
+    int a = pairA[pair];
+    int b = pairB[pair];
+    side_t sa, sb;
+    uint32_t rngA[TNMT_BATCH], rngB[TNMT_BATCH];
+    uint8_t done[TNMT_BATCH];
+    uint32_t doneRound[TNMT_BATCH];
+    uint32_t nDone = 0;
+    uint32_t round;
+    int l;
+
+    side_init(&sa);
+    side_init(&sb);
+    for (l = 0; l < TNMT_BATCH; l++)
+    {
+        //deterministic per match, independent of the thread schedule
+        rngA[l] = (baseSeed * 2654435761u) ^ (task * TNMT_BATCH + l + 1) * 0x9E3779B9u;
+        rngB[l] = rngA[l] ^ 0x5bd1e995u;
+        if (rngA[l] == 0) rngA[l] = 1;
+        if (rngB[l] == 0) rngB[l] = 1;
+        done[l] = 0;
+        doneRound[l] = maxRounds;
+    }
+
+    for (round = 0; round < maxRounds && nDone < TNMT_BATCH; round++)
+    {
+        strategy_choose(a, &sa, round, rngA);
+        strategy_choose(b, &sb, round, rngB);
+
+        side_score(&sa, &sb, done);
+        side_score(&sb, &sa, done);
+
+        for (l = 0; l < TNMT_BATCH; l++)
+        {
+            if (!done[l] && (sa.sentence[l] < L3_SENTENCE_RELEASE || sb.sentence[l] < L3_SENTENCE_RELEASE))
+            {
+                done[l] = 1;
+                doneRound[l] = round + 1;
+                nDone++;
+            }
+        }
+
+        side_remember(&sa, &sb);
+        side_remember(&sb, &sa);
+        strategy_predict(a, &sa, round);
+        strategy_predict(b, &sb, round);
+    }
+
+    for (l = 0; l < TNMT_BATCH; l++)
+    {
+        int aFree = sa.sentence[l] < L3_SENTENCE_RELEASE;
+        int bFree = sb.sentence[l] < L3_SENTENCE_RELEASE;
+
+        if (aFree == bFree)
+        {
+            standing[a].draws++;
+            standing[b].draws++;
+        }
+        else if (aFree)
+        {
+            standing[a].wins++;
+            standing[b].losses++;
+        }
+        else
+        {
+            standing[b].wins++;
+            standing[a].losses++;
+        }
+        standing[a].matches++;
+        standing[b].matches++;
+        standing[a].rounds += doneRound[l];
+        standing[b].rounds += doneRound[l];
+        standing[a].sentenceSum += sa.sentence[l];
+        standing[b].sentenceSum += sb.sentence[l];
+    }
+}
+
+//work-stealing : owners pop from the head, thieves take half of the victim's tail
+static int worker_take(worker_t* w, uint32_t* task)
+{
+    int res = 0;
+
+    pthread_mutex_lock(&w->lock);
+    if (w->head < w->tail)
+    {
+        *task = w->head++;
+        res = 1;
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    return res;
+}
+
+static int worker_steal(worker_t* self)
+{
+    int i;
+
+    for (i = 1; i < nThreads; i++)
+    {
+        worker_t* victim = &workers[(self->id + i) % nThreads];
+        uint32_t from = 0, to = 0;
+
+        pthread_mutex_lock(&victim->lock);
+        if (victim->tail - victim->head > 1)
+        {
+            uint32_t half = (victim->tail - victim->head) / 2;
+            to = victim->tail;
+            from = to - half;
+            victim->tail = from;
+        }
+        pthread_mutex_unlock(&victim->lock);
+
+        if (to > from)
+        {
+            pthread_mutex_lock(&self->lock);
+            self->head = from;
+            self->tail = to;
+            pthread_mutex_unlock(&self->lock);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static void* worker_main(void* arg)
+{
+    worker_t* w = (worker_t*)arg;
+    uint32_t task;
+
+    for (;;)
+    {
+        while (worker_take(w, &task))
+            play_batch(task, w->standing);
+
+        if (worker_steal(w) == 0)
+            break;
+    }
+
+    return NULL;
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char* argv[])
+{
+    standing_t total[STRAT_NUM];
+    uint32_t nTasks, per;
+    uint64_t nMatches = 0;
+    double t0, elapsed;
+    char sentenceStr[L3_SENTENCE_STRLEN];
+    int opt, i, j;
+
+    nThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    while ((opt = getopt(argc, argv, "t:m:r:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 't': nThreads = atoi(optarg); break;
+            case 'm': matchesPerPair = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'r': maxRounds = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 's': baseSeed = (uint32_t)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-t threads] [-m matches per pairing] [-r max rounds] [-s seed]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (nThreads < 1)
+        nThreads = 1;
+    if (nThreads > TNMT_MAXTHREADS)
+        nThreads = TNMT_MAXTHREADS;
+    if (matchesPerPair < TNMT_BATCH)
+        matchesPerPair = TNMT_BATCH;
+
+    nPairs = 0;
+    for (i = 0; i < STRAT_NUM; i++)
+        for (j = i; j < STRAT_NUM; j++)
+        {
+            pairA[nPairs] = i;
+            pairB[nPairs] = j;
+            nPairs++;
+        }
+    batchesPerPair = (matchesPerPair + TNMT_BATCH - 1) / TNMT_BATCH;
+    nTasks = nPairs * batchesPerPair;
+    per = (nTasks + nThreads - 1) / nThreads;
+
+    for (i = 0; i < nThreads; i++)
+    {
+        workers[i].id = i;
+        workers[i].head = (uint32_t)i * per < nTasks ? (uint32_t)i * per : nTasks;
+        workers[i].tail = workers[i].head + per < nTasks ? workers[i].head + per : nTasks;
+        memset(workers[i].standing, 0, sizeof(workers[i].standing));
+        pthread_mutex_init(&workers[i].lock, NULL);
+    }
+
+    t0 = now_sec();
+    for (i = 0; i < nThreads; i++)
+        pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+    for (i = 0; i < nThreads; i++)
+        pthread_join(workers[i].thread, NULL);
+    elapsed = now_sec() - t0;
+
+    memset(total, 0, sizeof(total));
+    for (i = 0; i < nThreads; i++)
+        for (j = 0; j < STRAT_NUM; j++)
+        {
+            total[j].wins += workers[i].standing[j].wins;
+            total[j].draws += workers[i].standing[j].draws;
+            total[j].losses += workers[i].standing[j].losses;
+            total[j].rounds += workers[i].standing[j].rounds;
+            total[j].matches += workers[i].standing[j].matches;
+            total[j].sentenceSum += workers[i].standing[j].sentenceSum;
+        }
+    nMatches = (uint64_t)nTasks * TNMT_BATCH;
+
+    printf("%-16s %10s %10s %10s %8s %12s\n", "strategy", "wins", "draws", "losses", "rounds", "avg sentence");
+    for (i = 0; i < STRAT_NUM; i++)
+    {
+        uint64_t m = total[i].matches ? total[i].matches : 1;
+
+        printf("%-16s %10llu %10llu %10llu %8.2f %12s\n", stratName[i],
+               (unsigned long long)total[i].wins, (unsigned long long)total[i].draws, (unsigned long long)total[i].losses,
+               (double)total[i].rounds / m, L3_sentence_format((uint32_t)(total[i].sentenceSum / m), sentenceStr));
+    }
+    printf("\n%llu matches in %.3f s on %i threads : %.0f matches/s\n",
+           (unsigned long long)nMatches, elapsed, nThreads, nMatches / (elapsed > 0 ? elapsed : 1e-9));
+
+    return 0;
+}